@@ -4,15 +4,19 @@
 
 #include <sys/types.h>
 
+#include <algorithm>
 #include <atomic>
 #include <cstdio>
 #include <cstdlib>
+#include <string>
+#include <vector>
 
 #include "leveldb/cache.h"
 #include "leveldb/comparator.h"
 #include "leveldb/db.h"
 #include "leveldb/env.h"
 #include "leveldb/filter_policy.h"
+#include "leveldb/rate_limiter.h"
 #include "leveldb/write_batch.h"
 #include "port/port.h"
 #include "util/crc32c.h"
@@ -33,6 +37,7 @@
 //      readseq       -- read N times sequentially
 //      readreverse   -- read N times in reverse order
 //      readrandom    -- read N times in random order
+//      multireadrandom -- read N times in random order, 100 keys per MultiGet
 //      readmissing   -- read N missing keys in random order
 //      readhot       -- read N times in random order from 1% section of DB
 //      seekrandom    -- N random seeks
@@ -103,13 +108,69 @@ static int FLAGS_cache_size = -1;
 // Maximum number of files to keep open at the same time (use default if == 0)
 static int FLAGS_open_files = 0;
 
+// Threads probing level-0 files in parallel on a read (0 = sequential)
+static int FLAGS_level0_read_threads = 0;
+
+// Most compactions to run at the same time (needs as many
+// --compaction_threads)
+static int FLAGS_max_background_compactions = 1;
+
+// Most threads one compaction is split across
+static int FLAGS_max_subcompactions = 1;
+
+// Run compactions as a pipeline of read, merge and write threads
+static bool FLAGS_pipelined_compaction = false;
+
+// Threads compressing the data blocks of each table being written
+// (0 = compress on the writing thread)
+static int FLAGS_compression_threads = 0;
+
 // Bloom filter bits per key.
 // Negative means use default settings.
 static int FLAGS_bloom_bits = -1;
 
+// Kind of filter: "bloom" or "blocked_bloom" (both sized by --bloom_bits),
+// or "binary_fuse" (used whenever --bloom_bits is not negative).
+static const char* FLAGS_filter = "bloom";
+
+// If true, build one filter per table instead of one per 2KB of data.
+static bool FLAGS_full_table_filter = false;
+
+// If true, add a hash index to each data block for point lookups.
+static bool FLAGS_data_block_hash_index = false;
+
+// If true, split table indexes and filters into partitions.
+static bool FLAGS_partitioned_index = false;
+
+// If true, keep index and filter blocks in the block cache, in a high
+// priority pool, pinning those of level-0 tables.
+static bool FLAGS_cache_index_and_filter_blocks = false;
+
+// If true, read table files with O_DIRECT.
+static bool FLAGS_use_direct_reads = false;
+
+// If true, write the table files of flushes and compactions with O_DIRECT.
+static bool FLAGS_use_direct_io_for_flush_and_compaction = false;
+
+// Bytes per second that flushes and compactions may write (0 = no limit)
+static int FLAGS_rate_limiter_bytes_per_sec = 0;
+
+// If non-zero, tune the rate limit from the compaction debt, reaching
+// --rate_limiter_bytes_per_sec at this many pending bytes
+static int FLAGS_rate_limiter_target_pending_bytes = 0;
+
+// Bytes that iterators prefetch ahead of their reads.  If zero, let them
+// adapt to the access pattern.
+static int FLAGS_readahead_size = 0;
+
 // Common key prefix length.
 static int FLAGS_key_prefix = 0;
 
+// Threads in the Env's high priority (memtable flush) and low priority
+// (compaction) background pools.
+static int FLAGS_flush_threads = 1;
+static int FLAGS_compaction_threads = 1;
+
 // If true, do not destroy the existing database.  If you set this
 // flag and also specify a benchmark that wants a fresh database, that
 // benchmark will fail.
@@ -366,10 +427,23 @@ struct ThreadState {
 
 }  // namespace
 
+static const FilterPolicy* NewFilterPolicy() {
+  if (strcmp(FLAGS_filter, "blocked_bloom") == 0) {
+    return NewBlockedBloomFilterPolicy(FLAGS_bloom_bits);
+  } else if (strcmp(FLAGS_filter, "binary_fuse") == 0) {
+    return NewBinaryFuseFilterPolicy();
+  } else if (strcmp(FLAGS_filter, "bloom") != 0) {
+    std::fprintf(stderr, "unknown filter '%s'\n", FLAGS_filter);
+    std::exit(1);
+  }
+  return NewBloomFilterPolicy(FLAGS_bloom_bits);
+}
+
 class Benchmark {
  private:
   Cache* cache_;
   const FilterPolicy* filter_policy_;
+  RateLimiter* rate_limiter_;
   DB* db_;
   int num_;
   int value_size_;
@@ -460,10 +534,17 @@ class Benchmark {
 
  public:
   Benchmark()
-      : cache_(FLAGS_cache_size >= 0 ? NewLRUCache(FLAGS_cache_size) : nullptr),
-        filter_policy_(FLAGS_bloom_bits >= 0
-                           ? NewBloomFilterPolicy(FLAGS_bloom_bits)
-                           : nullptr),
+      : cache_(FLAGS_cache_size < 0 ? nullptr
+               : FLAGS_cache_index_and_filter_blocks
+                   ? NewLRUCache(FLAGS_cache_size, 0.5)
+                   : NewLRUCache(FLAGS_cache_size)),
+        filter_policy_(FLAGS_bloom_bits >= 0 ? NewFilterPolicy() : nullptr),
+        rate_limiter_(FLAGS_rate_limiter_bytes_per_sec <= 0 ? nullptr
+                      : FLAGS_rate_limiter_target_pending_bytes > 0
+                          ? NewAutoTunedRateLimiter(
+                                FLAGS_rate_limiter_bytes_per_sec,
+                                FLAGS_rate_limiter_target_pending_bytes)
+                          : NewRateLimiter(FLAGS_rate_limiter_bytes_per_sec)),
         db_(nullptr),
         num_(FLAGS_num),
         value_size_(FLAGS_value_size),
@@ -488,6 +569,7 @@ class Benchmark {
     delete db_;
     delete cache_;
     delete filter_policy_;
+    delete rate_limiter_;
   }
 
   void Run() {
@@ -550,6 +632,9 @@ class Benchmark {
         method = &Benchmark::ReadReverse;
       } else if (name == Slice("readrandom")) {
         method = &Benchmark::ReadRandom;
+      } else if (name == Slice("multireadrandom")) {
+        entries_per_batch_ = 100;
+        method = &Benchmark::MultiReadRandom;
       } else if (name == Slice("readmissing")) {
         method = &Benchmark::ReadMissing;
       } else if (name == Slice("seekrandom")) {
@@ -769,7 +854,22 @@ class Benchmark {
       options.comparator = &count_comparator_;
     }
     options.max_open_files = FLAGS_open_files;
+    options.level0_read_threads = FLAGS_level0_read_threads;
+    options.max_background_compactions = FLAGS_max_background_compactions;
+    options.max_subcompactions = FLAGS_max_subcompactions;
+    options.pipelined_compaction = FLAGS_pipelined_compaction;
+    options.compression_threads = FLAGS_compression_threads;
     options.filter_policy = filter_policy_;
+    options.full_table_filter = FLAGS_full_table_filter;
+    options.data_block_hash_index = FLAGS_data_block_hash_index;
+    options.partitioned_index = FLAGS_partitioned_index;
+    options.cache_index_and_filter_blocks = FLAGS_cache_index_and_filter_blocks;
+    options.pin_l0_filter_and_index_blocks_in_cache =
+        FLAGS_cache_index_and_filter_blocks;
+    options.use_direct_reads = FLAGS_use_direct_reads;
+    options.use_direct_io_for_flush_and_compaction =
+        FLAGS_use_direct_io_for_flush_and_compaction;
+    options.rate_limiter = rate_limiter_;
     options.reuse_logs = FLAGS_reuse_logs;
     Status s = DB::Open(options, FLAGS_db, &db_);
     if (!s.ok()) {
@@ -804,6 +904,7 @@ class Benchmark {
     KeyBuffer key; 
     for (int i = 0; i < num_; i += entries_per_batch_) {
       batch.Clear();
+      batch.SetPresorted(seq);
       for (int j = 0; j < entries_per_batch_; j++) {
         const int k = seq ? i + j : thread->rand.Uniform(FLAGS_num);
         key.Set(k);
@@ -821,7 +922,9 @@ class Benchmark {
   }
 
   void ReadSequential(ThreadState* thread) {
-    Iterator* iter = db_->NewIterator(ReadOptions());
+    ReadOptions options;
+    options.readahead_size = FLAGS_readahead_size;
+    Iterator* iter = db_->NewIterator(options);
     int i = 0;
     int64_t bytes = 0;
     for (iter->SeekToFirst(); i < reads_ && iter->Valid(); iter->Next()) {
@@ -865,6 +968,35 @@ class Benchmark {
     thread->stats.AddMessage(msg);
   }
 
+  void MultiReadRandom(ThreadState* thread) {
+    ReadOptions options;
+    std::vector<std::string> keys(entries_per_batch_);
+    std::vector<Slice> key_slices(entries_per_batch_);
+    std::vector<std::string> values(entries_per_batch_);
+    std::vector<Status> statuses(entries_per_batch_);
+    int found = 0;
+    KeyBuffer key;
+    for (int i = 0; i < reads_; i += entries_per_batch_) {
+      const int n = std::min(entries_per_batch_, reads_ - i);
+      for (int j = 0; j < n; j++) {
+        key.Set(thread->rand.Uniform(FLAGS_num));
+        keys[j] = key.slice().ToString();
+        key_slices[j] = keys[j];
+      }
+      db_->MultiGet(options, n, key_slices.data(), values.data(),
+                    statuses.data());
+      for (int j = 0; j < n; j++) {
+        if (statuses[j].ok()) {
+          found++;
+        }
+        thread->stats.FinishedSingleOp();
+      }
+    }
+    char msg[100];
+    std::snprintf(msg, sizeof(msg), "(%d of %d found)", found, num_);
+    thread->stats.AddMessage(msg);
+  }
+
   void ReadMissing(ThreadState* thread) {
     ReadOptions options;
     std::string value;
@@ -1043,6 +1175,35 @@ int main(int argc, char** argv) {
     } else if (sscanf(argv[i], "--use_existing_db=%d%c", &n, &junk) == 1 &&
                (n == 0 || n == 1)) {
       FLAGS_use_existing_db = n;
+    } else if (sscanf(argv[i], "--full_table_filter=%d%c", &n, &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_full_table_filter = n;
+    } else if (sscanf(argv[i], "--data_block_hash_index=%d%c", &n, &junk) ==
+                   1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_data_block_hash_index = n;
+    } else if (sscanf(argv[i], "--partitioned_index=%d%c", &n, &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_partitioned_index = n;
+    } else if (sscanf(argv[i], "--cache_index_and_filter_blocks=%d%c", &n,
+                      &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_cache_index_and_filter_blocks = n;
+    } else if (sscanf(argv[i], "--use_direct_reads=%d%c", &n, &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_use_direct_reads = n;
+    } else if (sscanf(argv[i], "--use_direct_io_for_flush_and_compaction=%d%c",
+                      &n, &junk) == 1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_use_direct_io_for_flush_and_compaction = n;
+    } else if (sscanf(argv[i], "--rate_limiter_bytes_per_sec=%d%c", &n,
+                      &junk) == 1) {
+      FLAGS_rate_limiter_bytes_per_sec = n;
+    } else if (sscanf(argv[i], "--rate_limiter_target_pending_bytes=%d%c", &n,
+                      &junk) == 1) {
+      FLAGS_rate_limiter_target_pending_bytes = n;
+    } else if (sscanf(argv[i], "--readahead_size=%d%c", &n, &junk) == 1) {
+      FLAGS_readahead_size = n;
     } else if (sscanf(argv[i], "--reuse_logs=%d%c", &n, &junk) == 1 &&
                (n == 0 || n == 1)) {
       FLAGS_reuse_logs = n;
@@ -1062,12 +1223,31 @@ int main(int argc, char** argv) {
       FLAGS_block_size = n;
     } else if (sscanf(argv[i], "--key_prefix=%d%c", &n, &junk) == 1) {
       FLAGS_key_prefix = n;
+    } else if (sscanf(argv[i], "--flush_threads=%d%c", &n, &junk) == 1) {
+      FLAGS_flush_threads = n;
+    } else if (sscanf(argv[i], "--compaction_threads=%d%c", &n, &junk) == 1) {
+      FLAGS_compaction_threads = n;
+    } else if (sscanf(argv[i], "--max_background_compactions=%d%c", &n,
+                      &junk) == 1) {
+      FLAGS_max_background_compactions = n;
+    } else if (sscanf(argv[i], "--max_subcompactions=%d%c", &n, &junk) == 1) {
+      FLAGS_max_subcompactions = n;
+    } else if (sscanf(argv[i], "--pipelined_compaction=%d%c", &n, &junk) ==
+                   1 &&
+               (n == 0 || n == 1)) {
+      FLAGS_pipelined_compaction = n;
+    } else if (sscanf(argv[i], "--compression_threads=%d%c", &n, &junk) == 1) {
+      FLAGS_compression_threads = n;
     } else if (sscanf(argv[i], "--cache_size=%d%c", &n, &junk) == 1) {
       FLAGS_cache_size = n;
     } else if (sscanf(argv[i], "--bloom_bits=%d%c", &n, &junk) == 1) {
       FLAGS_bloom_bits = n;
     } else if (sscanf(argv[i], "--open_files=%d%c", &n, &junk) == 1) {
       FLAGS_open_files = n;
+    } else if (sscanf(argv[i], "--level0_read_threads=%d%c", &n, &junk) == 1) {
+      FLAGS_level0_read_threads = n;
+    } else if (strncmp(argv[i], "--filter=", 9) == 0) {
+      FLAGS_filter = argv[i] + 9;
     } else if (strncmp(argv[i], "--db=", 5) == 0) {
       FLAGS_db = argv[i] + 5;
     } else {
@@ -1077,6 +1257,10 @@ int main(int argc, char** argv) {
   }
 
   leveldb::g_env = leveldb::Env::Default();
+  leveldb::g_env->SetBackgroundThreads(FLAGS_flush_threads,
+                                       leveldb::Env::kHighPriority);
+  leveldb::g_env->SetBackgroundThreads(FLAGS_compaction_threads,
+                                       leveldb::Env::kLowPriority);
 
   // Choose a location for the test database if none given with --db=<path>
   if (FLAGS_db == nullptr) {
@@ -0,0 +1,178 @@
+// Copyright (c) 2026 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+// Compares the linear scan and heap implementations of the merging
+// iterator for a range of child counts.  Each child is an in-memory block,
+// and the keys are dealt out to the children at random, as for tables
+// whose key ranges overlap.
+//
+// Usage: merger_bench [--num=N] [--reads=N] [--children=2,4,8,...]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "leveldb/comparator.h"
+#include "leveldb/env.h"
+#include "leveldb/iterator.h"
+#include "leveldb/options.h"
+#include "table/block.h"
+#include "table/block_builder.h"
+#include "table/format.h"
+#include "table/merger.h"
+#include "util/random.h"
+
+// Number of entries across all children
+static int FLAGS_num = 1000000;
+
+// Number of seeks for the seek benchmark, each followed by 10 Next() calls
+static int FLAGS_reads = 100000;
+
+// Comma-separated list of child counts
+static const char* FLAGS_children = "2,3,4,6,8,16,32,64";
+
+namespace leveldb {
+
+namespace {
+
+class Children {
+ public:
+  explicit Children(int n) {
+    Random rnd(301);
+    std::vector<std::vector<int>> child_keys(n);
+    for (int i = 0; i < FLAGS_num; i++) {
+      child_keys[rnd.Uniform(n)].push_back(i);
+    }
+    Options options;
+    char key[100];
+    for (int c = 0; c < n; c++) {
+      BlockBuilder builder(&options);
+      for (int k : child_keys[c]) {
+        std::snprintf(key, sizeof(key), "%016d", k);
+        builder.Add(key, "value");
+      }
+      contents_.push_back(builder.Finish().ToString());
+    }
+    for (const std::string& data : contents_) {
+      BlockContents contents;
+      contents.data = data;
+      contents.cachable = false;
+      contents.heap_allocated = false;
+      blocks_.push_back(new Block(contents));
+    }
+  }
+
+  ~Children() {
+    for (Block* block : blocks_) {
+      delete block;
+    }
+  }
+
+  Iterator* NewMerger(bool use_heap) const {
+    std::vector<Iterator*> children;
+    for (Block* block : blocks_) {
+      children.push_back(block->NewIterator(BytewiseComparator()));
+    }
+    return NewMergingIterator(BytewiseComparator(), children.data(),
+                              static_cast<int>(children.size()), use_heap);
+  }
+
+ private:
+  std::vector<std::string> contents_;
+  std::vector<Block*> blocks_;
+};
+
+enum Workload { kForward, kReverse, kSeek };
+
+// Returns the nanoseconds per entry visited.
+double Run(const Children& children, bool use_heap, Workload workload) {
+  Env* env = Env::Default();
+  Iterator* iter = children.NewMerger(use_heap);
+  int64_t entries = 0;
+  const uint64_t start = env->NowMicros();
+  if (workload == kForward) {
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      entries++;
+    }
+  } else if (workload == kReverse) {
+    for (iter->SeekToLast(); iter->Valid(); iter->Prev()) {
+      entries++;
+    }
+  } else {
+    Random rnd(17);
+    char key[100];
+    for (int i = 0; i < FLAGS_reads; i++) {
+      std::snprintf(key, sizeof(key), "%016d", rnd.Uniform(FLAGS_num));
+      iter->Seek(key);
+      for (int j = 0; j < 10 && iter->Valid(); j++) {
+        iter->Next();
+        entries++;
+      }
+    }
+  }
+  const uint64_t elapsed = env->NowMicros() - start;
+  if (!iter->status().ok()) {
+    std::fprintf(stderr, "%s\n", iter->status().ToString().c_str());
+    std::exit(1);
+  }
+  delete iter;
+  return entries == 0 ? 0 : elapsed * 1e3 / entries;
+}
+
+void RunAll() {
+  std::fprintf(stdout, "Entries:    %d\n", FLAGS_num);
+  std::fprintf(stdout, "Seeks:      %d (10 entries each)\n", FLAGS_reads);
+  std::fprintf(stdout,
+               "------------------------------------------------------------"
+               "----------\n");
+  std::fprintf(stdout, "%8s %19s %19s %19s\n", "", "forward (ns/entry)",
+               "reverse (ns/entry)", "seek (ns/entry)");
+  std::fprintf(stdout, "%8s %9s %9s %9s %9s %9s %9s\n", "children", "linear",
+               "heap", "linear", "heap", "linear", "heap");
+
+  const char* p = FLAGS_children;
+  while (*p != '\0') {
+    const int n = std::atoi(p);
+    if (n >= 2) {
+      Children children(n);
+      std::fprintf(stdout, "%8d", n);
+      for (Workload w : {kForward, kReverse, kSeek}) {
+        std::fprintf(stdout, " %9.1f %9.1f", Run(children, false, w),
+                     Run(children, true, w));
+      }
+      std::fprintf(stdout, "\n");
+      std::fflush(stdout);
+    }
+    p = std::strchr(p, ',');
+    if (p == nullptr) {
+      break;
+    }
+    p++;
+  }
+}
+
+}  // namespace
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  for (int i = 1; i < argc; i++) {
+    int n;
+    char junk;
+    if (sscanf(argv[i], "--num=%d%c", &n, &junk) == 1) {
+      FLAGS_num = n;
+    } else if (sscanf(argv[i], "--reads=%d%c", &n, &junk) == 1) {
+      FLAGS_reads = n;
+    } else if (strncmp(argv[i], "--children=", 11) == 0) {
+      FLAGS_children = argv[i] + 11;
+    } else {
+      std::fprintf(stderr, "Invalid flag '%s'\n", argv[i]);
+      std::exit(1);
+    }
+  }
+  leveldb::RunAll();
+  return 0;
+}
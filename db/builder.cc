@@ -11,11 +11,58 @@
 #include "leveldb/db.h"
 #include "leveldb/env.h"
 #include "leveldb/iterator.h"
+#include "leveldb/rate_limiter.h"
+#include "table/table_builder_internal.h"
 
 namespace leveldb {
 
+namespace {
+
+// Asks the rate limiter for every byte before it is appended.  The bytes a
+// Sync() writes out were paid for when they were appended.
+class RateLimitedWritableFile : public WritableFile {
+ public:
+  RateLimitedWritableFile(WritableFile* file, RateLimiter* limiter)
+      : file_(file), limiter_(limiter) {}
+
+  ~RateLimitedWritableFile() override { delete file_; }
+
+  Status Append(const Slice& data) override {
+    limiter_->Request(data.size());
+    return file_->Append(data);
+  }
+  Status Close() override { return file_->Close(); }
+  Status Flush() override { return file_->Flush(); }
+  Status Sync() override { return file_->Sync(); }
+
+ private:
+  WritableFile* const file_;
+  RateLimiter* const limiter_;
+};
+
+}  // namespace
+
+Status NewTableFile(Env* env, const Options& options, const std::string& fname,
+                    WritableFile** result) {
+  Status s;
+  if (options.use_direct_io_for_flush_and_compaction) {
+    FileOptions file_options;
+    file_options.use_direct_io = true;
+    // Tables are only read once they are finished.
+    file_options.defer_flush = true;
+    s = env->NewWritableFile(fname, file_options, result);
+  } else {
+    s = env->NewWritableFile(fname, result);
+  }
+  if (s.ok() && options.rate_limiter != nullptr) {
+    *result = new RateLimitedWritableFile(*result, options.rate_limiter);
+  }
+  return s;
+}
+
 Status BuildTable(const std::string& dbname, Env* env, const Options& options,
-                  TableCache* table_cache, Iterator* iter, FileMetaData* meta) {
+                  TableCache* table_cache, Iterator* iter, FileMetaData* meta,
+                  ThreadPool* compression_pool) {
   Status s;
   meta->file_size = 0;
   iter->SeekToFirst();
@@ -23,12 +70,13 @@ Status BuildTable(const std::string& dbname, Env* env, const Options& options,
   std::string fname = TableFileName(dbname, meta->number);
   if (iter->Valid()) {
     WritableFile* file;
-    s = env->NewWritableFile(fname, &file);
+    s = NewTableFile(env, options, fname, &file);
     if (!s.ok()) {
       return s;
     }
 
-    TableBuilder* builder = new TableBuilder(options, file);
+    TableBuilder* builder =
+        TableBuilderInternal::New(options, file, compression_pool);
     meta->smallest.DecodeFrom(iter->key());
     Slice key;
     for (; iter->Valid(); iter->Next()) {
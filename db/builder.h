@@ -15,15 +15,25 @@ struct FileMetaData;
 class Env;
 class Iterator;
 class TableCache;
+class ThreadPool;
 class VersionEdit;
+class WritableFile;
+
+// Create the file "fname" for a table written by a flush or a compaction,
+// opened as options.use_direct_io_for_flush_and_compaction asks and, if
+// options.rate_limiter is set, with its appends paced by the limiter.
+Status NewTableFile(Env* env, const Options& options, const std::string& fname,
+                    WritableFile** result);
 
 // Build a Table file from the contents of *iter.  The generated file
 // will be named according to meta->number.  On success, the rest of
 // *meta will be filled with metadata about the generated table.
 // If no data is present in *iter, meta->file_size will be set to
-// zero, and no Table file will be produced.
+// zero, and no Table file will be produced.  Data blocks are compressed on
+// "compression_pool" if it is non-null.
 Status BuildTable(const std::string& dbname, Env* env, const Options& options,
-                  TableCache* table_cache, Iterator* iter, FileMetaData* meta);
+                  TableCache* table_cache, Iterator* iter, FileMetaData* meta,
+                  ThreadPool* compression_pool);
 
 }  // namespace leveldb
 
@@ -0,0 +1,252 @@
+// Copyright (c) 2026 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "db/compaction_pipeline.h"
+
+#include <cassert>
+
+#include "leveldb/comparator.h"
+#include "leveldb/env.h"
+#include "leveldb/iterator.h"
+#include "util/mutexlock.h"
+
+namespace leveldb {
+
+void EntryBatch::Add(const Slice& key, const Slice& value) {
+  entries_.push_back(Entry{data_.size(), static_cast<uint32_t>(key.size()),
+                           static_cast<uint32_t>(value.size())});
+  data_.append(key.data(), key.size());
+  data_.append(value.data(), value.size());
+}
+
+EntryBatchQueue::EntryBatchQueue(int capacity)
+    : capacity_(capacity), cv_(&mu_), finished_(false), cancelled_(false) {
+  assert(capacity > 0);
+}
+
+EntryBatchQueue::~EntryBatchQueue() {
+  for (EntryBatch* batch : batches_) {
+    delete batch;
+  }
+}
+
+bool EntryBatchQueue::Push(EntryBatch* batch) {
+  MutexLock l(&mu_);
+  assert(!finished_);
+  while (batches_.size() >= capacity_ && !cancelled_) {
+    cv_.Wait();
+  }
+  if (cancelled_) {
+    delete batch;
+    return false;
+  }
+  batches_.push_back(batch);
+  cv_.SignalAll();
+  return true;
+}
+
+void EntryBatchQueue::Finish() {
+  MutexLock l(&mu_);
+  finished_ = true;
+  cv_.SignalAll();
+}
+
+EntryBatch* EntryBatchQueue::Pop() {
+  MutexLock l(&mu_);
+  while (batches_.empty() && !finished_ && !cancelled_) {
+    cv_.Wait();
+  }
+  if (batches_.empty()) {
+    return nullptr;
+  }
+  EntryBatch* batch = batches_.front();
+  batches_.pop_front();
+  cv_.SignalAll();
+  return batch;
+}
+
+void EntryBatchQueue::Cancel() {
+  MutexLock l(&mu_);
+  cancelled_ = true;
+  cv_.SignalAll();
+}
+
+namespace {
+
+// Batches queued ahead of the one being read
+static const int kPrefetchBatches = 2;
+
+class PrefetchingIterator : public Iterator {
+ public:
+  PrefetchingIterator(Env* env, Iterator* child, const Comparator* comparator,
+                      const Slice* limit, size_t batch_bytes)
+      : env_(env),
+        child_(child),
+        comparator_(comparator),
+        has_limit_(limit != nullptr),
+        limit_(limit != nullptr ? limit->ToString() : std::string()),
+        batch_bytes_(batch_bytes),
+        queue_(kPrefetchBatches),
+        started_(false),
+        has_target_(false),
+        current_(nullptr),
+        index_(0),
+        done_cv_(&mu_),
+        reader_done_(false) {}
+
+  PrefetchingIterator(const PrefetchingIterator&) = delete;
+  PrefetchingIterator& operator=(const PrefetchingIterator&) = delete;
+
+  ~PrefetchingIterator() override {
+    if (started_) {
+      queue_.Cancel();
+      MutexLock l(&mu_);
+      while (!reader_done_) {
+        done_cv_.Wait();
+      }
+    }
+    delete current_;
+    delete child_;
+  }
+
+  bool Valid() const override { return current_ != nullptr; }
+
+  void SeekToFirst() override { Start(); }
+
+  void Seek(const Slice& target) override {
+    has_target_ = true;
+    target_ = target.ToString();
+    Start();
+  }
+
+  void Next() override {
+    assert(Valid());
+    index_++;
+    if (index_ == current_->size()) {
+      NextBatch();
+    }
+  }
+
+  void SeekToLast() override { Unsupported(); }
+  void Prev() override { Unsupported(); }
+
+  Slice key() const override {
+    assert(Valid());
+    return current_->key(index_);
+  }
+
+  Slice value() const override {
+    assert(Valid());
+    return current_->value(index_);
+  }
+
+  Status status() const override {
+    if (!status_.ok()) {
+      return status_;
+    }
+    MutexLock l(&mu_);
+    return reader_status_;
+  }
+
+ private:
+  static void ReaderMain(void* arg) {
+    reinterpret_cast<PrefetchingIterator*>(arg)->Read();
+  }
+
+  // Runs on the reader thread.
+  void Read() {
+    if (has_target_) {
+      child_->Seek(target_);
+    } else {
+      child_->SeekToFirst();
+    }
+    EntryBatch* batch = new EntryBatch;
+    for (; child_->Valid(); child_->Next()) {
+      const Slice key = child_->key();
+      if (has_limit_ && comparator_->Compare(key, limit_) >= 0) {
+        break;
+      }
+      batch->Add(key, child_->value());
+      if (batch->ApproximateBytes() >= batch_bytes_) {
+        if (!queue_.Push(batch)) {
+          batch = nullptr;
+          break;
+        }
+        batch = new EntryBatch;
+      }
+    }
+    if (batch != nullptr) {
+      if (batch->empty()) {
+        delete batch;
+      } else {
+        queue_.Push(batch);
+      }
+    }
+    const Status s = child_->status();
+    {
+      MutexLock l(&mu_);
+      reader_status_ = s;
+    }
+    queue_.Finish();
+
+    MutexLock l(&mu_);
+    reader_done_ = true;
+    done_cv_.SignalAll();
+  }
+
+  void Start() {
+    if (started_) {
+      Unsupported();
+      return;
+    }
+    started_ = true;
+    env_->StartThread(&PrefetchingIterator::ReaderMain, this);
+    NextBatch();
+  }
+
+  void NextBatch() {
+    delete current_;
+    current_ = queue_.Pop();
+    index_ = 0;
+  }
+
+  void Unsupported() {
+    status_ = Status::NotSupported("prefetching iterator only moves forward");
+    delete current_;
+    current_ = nullptr;
+  }
+
+  Env* const env_;
+  Iterator* const child_;
+  const Comparator* const comparator_;
+  const bool has_limit_;
+  const std::string limit_;
+  const size_t batch_bytes_;
+  EntryBatchQueue queue_;
+
+  // Set before the reader thread starts
+  bool started_;
+  bool has_target_;
+  std::string target_;
+
+  // Used by the caller's thread only
+  EntryBatch* current_;
+  size_t index_;
+  Status status_;
+
+  mutable port::Mutex mu_;
+  port::CondVar done_cv_ GUARDED_BY(mu_);
+  Status reader_status_ GUARDED_BY(mu_);
+  bool reader_done_ GUARDED_BY(mu_);
+};
+
+}  // namespace
+
+Iterator* NewPrefetchingIterator(Env* env, Iterator* child,
+                                 const Comparator* comparator,
+                                 const Slice* limit, size_t batch_bytes) {
+  return new PrefetchingIterator(env, child, comparator, limit, batch_bytes);
+}
+
+}  // namespace leveldb
@@ -0,0 +1,115 @@
+// Copyright (c) 2026 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// Pieces for running the stages of a compaction on separate threads: input
+// tables read and decompressed ahead of the merge, and surviving entries
+// handed on to the thread that builds the output tables.
+
+#ifndef STORAGE_LEVELDB_DB_COMPACTION_PIPELINE_H_
+#define STORAGE_LEVELDB_DB_COMPACTION_PIPELINE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "leveldb/slice.h"
+#include "port/port.h"
+#include "port/thread_annotations.h"
+
+namespace leveldb {
+
+class Comparator;
+class Env;
+class Iterator;
+
+// Key/value pairs copied into one buffer, to be passed between threads.
+class EntryBatch {
+ public:
+  EntryBatch() = default;
+
+  EntryBatch(const EntryBatch&) = delete;
+  EntryBatch& operator=(const EntryBatch&) = delete;
+
+  void Add(const Slice& key, const Slice& value);
+
+  size_t size() const { return entries_.size(); }
+  bool empty() const { return entries_.empty(); }
+
+  // Bytes of keys and values held.
+  size_t ApproximateBytes() const { return data_.size(); }
+
+  Slice key(size_t i) const {
+    return Slice(data_.data() + entries_[i].offset, entries_[i].key_size);
+  }
+  Slice value(size_t i) const {
+    return Slice(data_.data() + entries_[i].offset + entries_[i].key_size,
+                 entries_[i].value_size);
+  }
+
+ private:
+  struct Entry {
+    size_t offset;
+    uint32_t key_size;
+    uint32_t value_size;
+  };
+
+  std::string data_;
+  std::vector<Entry> entries_;
+};
+
+// A bounded queue of batches from one producer thread to one consumer.
+class EntryBatchQueue {
+ public:
+  // The queue holds at most "capacity" batches.
+  explicit EntryBatchQueue(int capacity);
+
+  EntryBatchQueue(const EntryBatchQueue&) = delete;
+  EntryBatchQueue& operator=(const EntryBatchQueue&) = delete;
+
+  // Deletes the batches that were never popped.
+  ~EntryBatchQueue();
+
+  // Takes ownership of "batch" and queues it, blocking while the queue is
+  // full.  Returns false, deleting the batch, once Cancel() was called.
+  bool Push(EntryBatch* batch);
+
+  // Called by the producer after its last Push().
+  void Finish();
+
+  // Returns the next batch, which the caller must delete, blocking while
+  // the queue is empty.  Returns null once the producer has finished and
+  // every batch has been popped.
+  EntryBatch* Pop();
+
+  // Called by the consumer to stop the producer early.  Later Push() calls
+  // fail.
+  void Cancel();
+
+ private:
+  const size_t capacity_;
+
+  port::Mutex mu_;
+  port::CondVar cv_ GUARDED_BY(mu_);
+  std::deque<EntryBatch*> batches_ GUARDED_BY(mu_);
+  bool finished_ GUARDED_BY(mu_);
+  bool cancelled_ GUARDED_BY(mu_);
+};
+
+// Returns an iterator over the entries of "child", which are read on a
+// thread of their own into a few batches of about "batch_bytes" bytes
+// ahead of the caller.  If "limit" is non-null, the reading stops before
+// the first key at or past *limit, as ordered by "comparator".  Takes
+// ownership of "child".
+//
+// The result only moves forward: it may be positioned once, by
+// SeekToFirst() or Seek(), and then advanced with Next().
+Iterator* NewPrefetchingIterator(Env* env, Iterator* child,
+                                 const Comparator* comparator,
+                                 const Slice* limit, size_t batch_bytes);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_DB_COMPACTION_PIPELINE_H_
@@ -0,0 +1,183 @@
+// Copyright (c) 2026 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "db/compaction_pipeline.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "leveldb/comparator.h"
+#include "leveldb/env.h"
+#include "leveldb/iterator.h"
+#include "leveldb/options.h"
+#include "table/block.h"
+#include "table/block_builder.h"
+#include "table/format.h"
+#include "util/mutexlock.h"
+#include "util/testutil.h"
+
+namespace leveldb {
+
+static std::string Key(int i) {
+  char buf[100];
+  std::snprintf(buf, sizeof(buf), "key%06d", i);
+  return std::string(buf);
+}
+
+struct Producer {
+  EntryBatchQueue* queue;
+  int batches;
+  int pushed;
+  bool cancelled;
+  port::Mutex mu;
+  port::CondVar cv;
+  bool done;
+
+  Producer(EntryBatchQueue* queue, int batches)
+      : queue(queue),
+        batches(batches),
+        pushed(0),
+        cancelled(false),
+        cv(&mu),
+        done(false) {}
+
+  static void Run(void* arg) {
+    Producer* p = reinterpret_cast<Producer*>(arg);
+    for (int i = 0; i < p->batches; i++) {
+      EntryBatch* batch = new EntryBatch;
+      batch->Add(Key(i), "v" + std::to_string(i));
+      if (!p->queue->Push(batch)) {
+        p->cancelled = true;
+        break;
+      }
+      p->pushed++;
+    }
+    p->queue->Finish();
+    MutexLock l(&p->mu);
+    p->done = true;
+    p->cv.SignalAll();
+  }
+
+  void Wait() {
+    MutexLock l(&mu);
+    while (!done) {
+      cv.Wait();
+    }
+  }
+};
+
+TEST(EntryBatchQueueTest, InOrder) {
+  EntryBatchQueue queue(2);
+  Producer producer(&queue, 100);
+  Env::Default()->StartThread(&Producer::Run, &producer);
+  int count = 0;
+  while (EntryBatch* batch = queue.Pop()) {
+    ASSERT_EQ(1, batch->size());
+    ASSERT_EQ(Key(count), batch->key(0).ToString());
+    ASSERT_EQ("v" + std::to_string(count), batch->value(0).ToString());
+    delete batch;
+    count++;
+  }
+  producer.Wait();
+  ASSERT_EQ(100, count);
+  ASSERT_TRUE(!producer.cancelled);
+}
+
+TEST(EntryBatchQueueTest, Cancel) {
+  EntryBatchQueue queue(2);
+  Producer producer(&queue, 100);
+  Env::Default()->StartThread(&Producer::Run, &producer);
+  delete queue.Pop();
+  queue.Cancel();
+  producer.Wait();
+  ASSERT_TRUE(producer.cancelled);
+  ASSERT_LT(producer.pushed, 100);
+}
+
+static const int kKeys = 2000;
+
+class PrefetchingIteratorTest : public testing::Test {
+ public:
+  PrefetchingIteratorTest() : block_(nullptr) {
+    Options options;
+    BlockBuilder builder(&options);
+    for (int i = 0; i < kKeys; i++) {
+      builder.Add(Key(i), std::string(100, 'a' + i % 26));
+    }
+    contents_ = builder.Finish().ToString();
+    BlockContents contents;
+    contents.data = contents_;
+    contents.cachable = false;
+    contents.heap_allocated = false;
+    block_ = new Block(contents);
+  }
+
+  ~PrefetchingIteratorTest() { delete block_; }
+
+  // Batches of about 1KB, so that the reader runs many batches ahead.
+  Iterator* NewIterator(const Slice* limit) {
+    return NewPrefetchingIterator(Env::Default(),
+                                  block_->NewIterator(BytewiseComparator()),
+                                  BytewiseComparator(), limit, 1024);
+  }
+
+  std::string contents_;
+  Block* block_;
+};
+
+TEST_F(PrefetchingIteratorTest, Scan) {
+  Iterator* iter = NewIterator(nullptr);
+  int count = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    ASSERT_EQ(Key(count), iter->key().ToString());
+    ASSERT_EQ(std::string(100, 'a' + count % 26), iter->value().ToString());
+    count++;
+  }
+  ASSERT_EQ(kKeys, count);
+  ASSERT_LEVELDB_OK(iter->status());
+  delete iter;
+}
+
+TEST_F(PrefetchingIteratorTest, SeekAndLimit) {
+  const std::string limit = Key(1500);
+  const Slice limit_slice(limit);
+  Iterator* iter = NewIterator(&limit_slice);
+  iter->Seek(Key(700));
+  int count = 700;
+  for (; iter->Valid(); iter->Next()) {
+    ASSERT_EQ(Key(count), iter->key().ToString());
+    count++;
+  }
+  ASSERT_EQ(1500, count);
+  ASSERT_LEVELDB_OK(iter->status());
+  delete iter;
+}
+
+TEST_F(PrefetchingIteratorTest, ForwardOnly) {
+  Iterator* iter = NewIterator(nullptr);
+  iter->SeekToFirst();
+  ASSERT_TRUE(iter->Valid());
+  iter->Seek(Key(10));
+  ASSERT_TRUE(!iter->Valid());
+  ASSERT_TRUE(iter->status().IsNotSupportedError());
+  delete iter;
+}
+
+TEST_F(PrefetchingIteratorTest, DeleteBeforeEnd) {
+  // The reader is blocked on a full queue when the iterator goes away.
+  Iterator* iter = NewIterator(nullptr);
+  iter->SeekToFirst();
+  ASSERT_TRUE(iter->Valid());
+  Env::Default()->SleepForMicroseconds(10000);
+  delete iter;
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -13,6 +13,7 @@
 #include <vector>
 
 #include "db/builder.h"
+#include "db/compaction_pipeline.h"
 #include "db/db_iter.h"
 #include "db/dbformat.h"
 #include "db/filename.h"
@@ -27,16 +28,19 @@
 #include "db/write_batch_internal.h"
 #include "leveldb/db.h"
 #include "leveldb/env.h"
+#include "leveldb/rate_limiter.h"
 #include "leveldb/status.h"
 #include "leveldb/table.h"
 #include "leveldb/table_builder.h"
 #include "port/port.h"
 #include "table/block.h"
 #include "table/merger.h"
+#include "table/table_builder_internal.h"
 #include "table/two_level_iterator.h"
 #include "util/coding.h"
 #include "util/logging.h"
 #include "util/mutexlock.h"
+#include "util/thread_pool.h"
 
 namespace leveldb {
 
@@ -67,6 +71,8 @@ struct DBImpl::CompactionState {
   explicit CompactionState(Compaction* c)
       : compaction(c),
         smallest_snapshot(0),
+        start(nullptr),
+        end(nullptr),
         outfile(nullptr),
         builder(nullptr),
         total_bytes(0) {}
@@ -79,6 +85,17 @@ struct DBImpl::CompactionState {
   // we can drop all entries for the same key with sequence numbers < S.
   SequenceNumber smallest_snapshot;
 
+  // User keys [*start,*end) covered by this state; null means unbounded.
+  // Only subcompactions cover part of the compaction's range.
+  const std::string* start;
+  const std::string* end;
+  Compaction::Cursor cursor;
+
+  // Set if the compaction is split into subcompactions, which are run
+  // in parallel.  The outputs are gathered here once all are done.
+  std::vector<std::string> boundaries;
+  std::vector<CompactionState*> subcompactions;
+
   std::vector<Output> outputs;
 
   // State kept for output being generated
@@ -88,6 +105,87 @@ struct DBImpl::CompactionState {
   uint64_t total_bytes;
 };
 
+// Queued batches of entries between the merge and the output stage of a
+// pipelined compaction, and their size.
+static const int kCompactionOutputBatches = 4;
+static const size_t kCompactionOutputBatchBytes = 128 * 1024;
+
+struct DBImpl::SubcompactionJob {
+  DBImpl* db;
+  CompactionState* compact;
+  Status status;
+  bool done;
+  port::CondVar* cv;
+};
+
+// Builds the output tables of a pipelined compaction from the entries that
+// survive the merge, on a thread of its own.
+struct DBImpl::CompactionOutputStage {
+  CompactionOutputStage(DBImpl* db, CompactionState* compact)
+      : db(db),
+        compact(compact),
+        queue(kCompactionOutputBatches),
+        done(false),
+        cv(&db->mutex_) {}
+
+  DBImpl* const db;
+  CompactionState* const compact;
+  EntryBatchQueue queue;
+  Status status;
+  bool done;
+  port::CondVar cv;
+};
+
+// A consistent set of memtables and table files that reads can pin without
+// holding mutex_.  Each SuperVersion holds a reference to its memtables and
+// Version; those are dropped under mutex_ once the last reader is done.
+struct DBImpl::SuperVersion {
+  SuperVersion() : mem(nullptr), imm(nullptr), current(nullptr), number(0),
+                   refs(0) {}
+
+  void Ref() { refs.fetch_add(1, std::memory_order_relaxed); }
+
+  // Returns true if this was the last reference.
+  bool Unref() { return refs.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+
+  TQMemTable* mem;
+  TQMemTable* imm;  // May be null
+  Version* current;
+  uint64_t number;  // Value of super_version_number_ when installed
+  std::atomic<int> refs;
+};
+
+// Holds a thread's cached SuperVersion (which owns one reference), nullptr,
+// or kSuperVersionInUse while a read has taken the cached one.
+struct DBImpl::SuperVersionSlot {
+  SuperVersionSlot() : sv(nullptr) {}
+
+  std::atomic<SuperVersion*> sv;
+  // Keeps neighbouring slots off each other's cache lines.
+  char padding[64];
+};
+
+namespace {
+
+// Number of super version slots.  Threads beyond this share slots, which
+// only costs some cache misses.
+const size_t kNumSuperVersionSlots = 64;
+
+// Address stored in a slot while its SuperVersion is in use.
+char super_version_in_use;
+void* const kSuperVersionInUse = &super_version_in_use;
+
+// Slot index for the calling thread.  Threads are spread over the slots
+// round-robin on first use.
+size_t SuperVersionSlotIndex() {
+  static std::atomic<size_t> next_slot(0);
+  thread_local size_t slot =
+      next_slot.fetch_add(1, std::memory_order_relaxed) % kNumSuperVersionSlots;
+  return slot;
+}
+
+}  // namespace
+
 // Fix user-supplied options to be reasonable
 template <class T, class V>
 static void ClipToRange(T* ptr, V minvalue, V maxvalue) {
@@ -97,14 +195,26 @@ static void ClipToRange(T* ptr, V minvalue, V maxvalue) {
 Options SanitizeOptions(const std::string& dbname,
                         const InternalKeyComparator* icmp,
                         const InternalFilterPolicy* ipolicy,
+                        const InternalKeySliceTransform* iprefix,
                         const Options& src) {
   Options result = src;
   result.comparator = icmp;
   result.filter_policy = (src.filter_policy != nullptr) ? ipolicy : nullptr;
+  result.prefix_extractor =
+      (src.prefix_extractor != nullptr) ? iprefix : nullptr;
+  if (src.comparator != BytewiseComparator()) {
+    // The hash index equates user keys with equal bytes
+    result.data_block_hash_index = false;
+  }
   ClipToRange(&result.max_open_files, 64 + kNumNonTableCacheFiles, 50000);
   ClipToRange(&result.write_buffer_size, 64 << 10, 1 << 30);
   ClipToRange(&result.max_file_size, 1 << 20, 1 << 30);
   ClipToRange(&result.block_size, 1 << 10, 4 << 20);
+  ClipToRange(&result.max_recovery_threads, 1, 64);
+  ClipToRange(&result.level0_read_threads, 0, config::kL0_StopWritesTrigger);
+  ClipToRange(&result.max_background_compactions, 1, 64);
+  ClipToRange(&result.max_subcompactions, 1, 64);
+  ClipToRange(&result.compression_threads, 0, 64);
   if (result.info_log == nullptr) {
     // Open a log file in the same directory as the db
     src.env->CreateDir(dbname);  // In case it does not exist
@@ -116,7 +226,9 @@ Options SanitizeOptions(const std::string& dbname,
     }
   }
   if (result.block_cache == nullptr) {
-    result.block_cache = NewLRUCache(8 << 20);
+    result.block_cache = result.cache_index_and_filter_blocks
+                             ? NewLRUCache(8 << 20, 0.5)
+                             : NewLRUCache(8 << 20);
   }
   return result;
 }
@@ -130,12 +242,17 @@ DBImpl::DBImpl(const Options& raw_options, const std::string& dbname)
     : env_(raw_options.env),
       internal_comparator_(raw_options.comparator),
       internal_filter_policy_(raw_options.filter_policy),
+      internal_prefix_extractor_(raw_options.prefix_extractor),
       options_(SanitizeOptions(dbname, &internal_comparator_,
-                               &internal_filter_policy_, raw_options)),
+                               &internal_filter_policy_,
+                               &internal_prefix_extractor_, raw_options)),
       owns_info_log_(options_.info_log != raw_options.info_log),
       owns_cache_(options_.block_cache != raw_options.block_cache),
       dbname_(dbname),
       table_cache_(new TableCache(dbname_, options_, TableCacheSize(options_))),
+      compression_pool_(options_.compression_threads > 0
+                            ? new ThreadPool(env_, options_.compression_threads)
+                            : nullptr),
       db_lock_(nullptr),
       shutting_down_(false),
       background_work_finished_signal_(&mutex_),
@@ -146,8 +263,18 @@ DBImpl::DBImpl(const Options& raw_options, const std::string& dbname)
       logfile_number_(0),
       log_(nullptr),
       seed_(0),
+      super_version_(nullptr),
+      super_version_number_(0),
+      super_version_slots_(new SuperVersionSlot[kNumSuperVersionSlots]),
       tmp_batch_(new WriteBatch),
-      background_compaction_scheduled_(false),
+      min_recyclable_log_number_(0),
+      background_compactions_scheduled_(0),
+      background_compactions_running_(0),
+      compactions_blocked_(false),
+      background_flush_scheduled_(false),
+      flushing_imm_(false),
+      manifest_writing_(false),
+      manifest_write_done_(&mutex_),
       manual_compaction_(nullptr),
       versions_(new VersionSet(dbname_, &options_, table_cache_,
                                &internal_comparator_)) {}
@@ -156,15 +283,27 @@ DBImpl::~DBImpl() {
   // Wait for background work to finish.
   mutex_.Lock();
   shutting_down_.store(true, std::memory_order_release);
-  while (background_compaction_scheduled_) {
+  while (background_compactions_scheduled_ > 0 || background_flush_scheduled_) {
     background_work_finished_signal_.Wait();
   }
+  // Release the cached read views.  Iterators must already be deleted.
+  for (size_t i = 0; i < kNumSuperVersionSlots; i++) {
+    SuperVersion* cached = super_version_slots_[i].sv.load();
+    assert(cached != kSuperVersionInUse);
+    if (cached != nullptr && cached->Unref()) {
+      CleanupSuperVersion(cached);
+    }
+  }
+  if (super_version_ != nullptr && super_version_->Unref()) {
+    CleanupSuperVersion(super_version_);
+  }
   mutex_.Unlock();
 
   if (db_lock_ != nullptr) {
     env_->UnlockFile(db_lock_);
   }
 
+  delete[] super_version_slots_;
   delete versions_;
   if (mem_ != nullptr) mem_->Unref();
   if (imm_ != nullptr) imm_->Unref();
@@ -172,6 +311,7 @@ DBImpl::~DBImpl() {
   delete log_;
   delete logfile_;
   delete table_cache_;
+  delete compression_pool_;
 
   if (owns_info_log_) {
     delete options_.info_log;
@@ -250,6 +390,18 @@ void DBImpl::RemoveObsoleteFiles() {
         case kLogFile:
           keep = ((number >= versions_->LogNumber()) ||
                   (number == versions_->PrevLogNumber()));
+          if (!keep && min_recyclable_log_number_ != 0 &&
+              number >= min_recyclable_log_number_) {
+            if (std::find(recycled_logs_.begin(), recycled_logs_.end(),
+                          number) != recycled_logs_.end()) {
+              keep = true;
+            } else if (recycled_logs_.size() < options_.recycle_log_file_num) {
+              Log(options_.info_log, "Recycle log #%llu\n",
+                  static_cast<unsigned long long>(number));
+              recycled_logs_.push_back(number);
+              keep = true;
+            }
+          }
           break;
         case kDescriptorFile:
           // Keep my manifest file, and any newer incarnations'
@@ -365,17 +517,24 @@ Status DBImpl::Recover(VersionEdit* edit, bool* save_manifest) {
 
   // Recover in the order in which the logs were generated
   std::sort(logs.begin(), logs.end());
-  for (size_t i = 0; i < logs.size(); i++) {
-    s = RecoverLogFile(logs[i], (i == logs.size() - 1), save_manifest, edit,
-                       &max_sequence);
+  if (logs.size() > 1 && options_.max_recovery_threads > 1) {
+    s = RecoverLogFilesInParallel(logs, save_manifest, edit, &max_sequence);
     if (!s.ok()) {
       return s;
     }
+  } else {
+    for (size_t i = 0; i < logs.size(); i++) {
+      s = RecoverLogFile(logs[i], (i == logs.size() - 1), save_manifest, edit,
+                         &max_sequence);
+      if (!s.ok()) {
+        return s;
+      }
 
-    // The previous incarnation may not have written any MANIFEST
-    // records after allocating this log number.  So we manually
-    // update the file number allocation counter in VersionSet.
-    versions_->MarkFileNumberUsed(logs[i]);
+      // The previous incarnation may not have written any MANIFEST
+      // records after allocating this log number.  So we manually
+      // update the file number allocation counter in VersionSet.
+      versions_->MarkFileNumberUsed(logs[i]);
+    }
   }
 
   if (versions_->LastSequence() < max_sequence) {
@@ -385,22 +544,26 @@ Status DBImpl::Recover(VersionEdit* edit, bool* save_manifest) {
   return Status::OK();
 }
 
+namespace {
+
+struct LogReporter : public log::Reader::Reporter {
+  Env* env;
+  Logger* info_log;
+  const char* fname;
+  Status* status;  // null if options_.paranoid_checks==false
+  void Corruption(size_t bytes, const Status& s) override {
+    Log(info_log, "%s%s: dropping %d bytes; %s",
+        (this->status == nullptr ? "(ignoring error) " : ""), fname,
+        static_cast<int>(bytes), s.ToString().c_str());
+    if (this->status != nullptr && this->status->ok()) *this->status = s;
+  }
+};
+
+}  // namespace
+
 Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log,
                               bool* save_manifest, VersionEdit* edit,
                               SequenceNumber* max_sequence) {
-  struct LogReporter : public log::Reader::Reporter {
-    Env* env;
-    Logger* info_log;
-    const char* fname;
-    Status* status;  // null if options_.paranoid_checks==false
-    void Corruption(size_t bytes, const Status& s) override {
-      Log(info_log, "%s%s: dropping %d bytes; %s",
-          (this->status == nullptr ? "(ignoring error) " : ""), fname,
-          static_cast<int>(bytes), s.ToString().c_str());
-      if (this->status != nullptr && this->status->ok()) *this->status = s;
-    }
-  };
-
   mutex_.AssertHeld();
 
   // Open the log file
@@ -422,7 +585,8 @@ Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log,
   // paranoid_checks==false so that corruptions cause entire commits
   // to be skipped instead of propagating bad information (like overly
   // large sequence numbers).
-  log::Reader reader(file, &reporter, true /*checksum*/, 0 /*initial_offset*/);
+  log::Reader reader(file, &reporter, true /*checksum*/, 0 /*initial_offset*/,
+                     log_number);
   Log(options_.info_log, "Recovering log #%llu",
       (unsigned long long)log_number);
 
@@ -441,7 +605,8 @@ Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log,
     WriteBatchInternal::SetContents(&batch, record);
 
     if (mem == nullptr) {
-      mem = new TQMemTable(internal_comparator_, options_.write_buffer_size);
+      mem = new TQMemTable(internal_comparator_, options_.write_buffer_size,
+                           options_.memtable_huge_page_size);
       mem->Ref();
     }
     status = WriteBatchInternal::InsertInto(&batch, mem);
@@ -458,7 +623,7 @@ Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log,
     if (mem->ApproximateMemoryUsage() > options_.write_buffer_size) {
       compactions++;
       *save_manifest = true;
-      status = WriteLevel0Table(mem, edit, nullptr);
+      status = WriteLevel0Table(mem, edit);
       mem->Unref();
       mem = nullptr;
       if (!status.ok()) {
@@ -472,32 +637,15 @@ Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log,
   delete file;
 
   // See if we should keep reusing the last log file.
-  if (status.ok() && options_.reuse_logs && last_log && compactions == 0) {
-    assert(logfile_ == nullptr);
-    assert(log_ == nullptr);
-    assert(mem_ == nullptr);
-    uint64_t lfile_size;
-    if (env_->GetFileSize(fname, &lfile_size).ok() &&
-        env_->NewAppendableFile(fname, &logfile_).ok()) {
-      Log(options_.info_log, "Reusing old log %s \n", fname.c_str());
-      log_ = new log::Writer(logfile_, lfile_size);
-      logfile_number_ = log_number;
-      if (mem != nullptr) {
-        mem_ = mem;
-        mem = nullptr;
-      } else {
-        // mem can be nullptr if lognum exists but was empty.
-        mem_ = new TQMemTable(internal_comparator_, options_.write_buffer_size);
-        mem_->Ref();
-      }
-    }
+  if (status.ok() && last_log && compactions == 0) {
+    MaybeReuseLogFile(log_number, &mem);
   }
 
   if (mem != nullptr) {
     // mem did not get reused; compact it.
     if (status.ok()) {
       *save_manifest = true;
-      status = WriteLevel0Table(mem, edit, nullptr);
+      status = WriteLevel0Table(mem, edit);
     }
     mem->Unref();
   }
@@ -505,78 +653,364 @@ Status DBImpl::RecoverLogFile(uint64_t log_number, bool last_log,
   return status;
 }
 
-//修改为tqmemtable
-Status DBImpl::WriteLevel0Table(TQMemTable* mem, VersionEdit* edit,
-                                Version* base) {
+bool DBImpl::MaybeReuseLogFile(uint64_t log_number, TQMemTable** mem) {
   mutex_.AssertHeld();
-  const uint64_t start_micros = env_->NowMicros();
-  FileMetaData meta;
-  meta.number = versions_->NewFileNumber();
-  pending_outputs_.insert(meta.number);
-  Iterator* iter = mem->NewIterator();
-  Log(options_.info_log, "Level-0 table #%llu: started",
-      (unsigned long long)meta.number);
+  // A recycled log may hold stale records past its valid end, so it is
+  // never appended to.
+  if (!options_.reuse_logs || options_.recycle_log_file_num > 0) {
+    return false;
+  }
+  assert(logfile_ == nullptr);
+  assert(log_ == nullptr);
+  assert(mem_ == nullptr);
+  const std::string fname = LogFileName(dbname_, log_number);
+  uint64_t lfile_size;
+  if (!env_->GetFileSize(fname, &lfile_size).ok() ||
+      !env_->NewAppendableFile(fname, &logfile_).ok()) {
+    return false;
+  }
+  Log(options_.info_log, "Reusing old log %s \n", fname.c_str());
+  log_ = new log::Writer(logfile_, lfile_size);
+  log_->SetCompression(options_.log_compression);
+  logfile_number_ = log_number;
+  if (*mem != nullptr) {
+    mem_ = *mem;
+    *mem = nullptr;
+  } else {
+    // mem can be nullptr if lognum exists but was empty.
+    mem_ = new TQMemTable(internal_comparator_, options_.write_buffer_size,
+                          options_.memtable_huge_page_size);
+    mem_->Ref();
+  }
+  return true;
+}
 
-  Status s;
-  {
-    mutex_.Unlock();
-    s = BuildTable(dbname_, env_, options_, table_cache_, iter, &meta);
-    mutex_.Lock();
+// A log replayed by RecoverLogFilesInParallel().  Fields other than the
+// parameters are written by the replaying thread before "replayed" is set,
+// and read by the recovering thread after.
+struct DBImpl::LogRecovery {
+  DBImpl* db;
+  uint64_t number;
+  port::CondVar* done;  // Signalled under db->mutex_ as work finishes
+
+  bool replayed = false;
+  Status status;
+  SequenceNumber max_sequence = 0;
+  // Full memtables in the order they were filled, followed by the one the
+  // log ended in; none are empty.
+  std::vector<TQMemTable*> mems;
+  // True if a memtable filled up, so the log cannot be reused.
+  bool overflowed = false;
+
+  // Level-0 tables being built from "mems", and the number of those still
+  // in progress.
+  std::vector<FileMetaData> outputs;
+  std::vector<Status> output_status;
+  int pending_outputs = 0;
+
+  // Argument of BuildRecoveredTableWork().
+  struct TableBuild {
+    LogRecovery* job;
+    size_t index;  // Into job->mems and job->outputs
+  };
+};
+
+void DBImpl::ReplayLogFile(LogRecovery* job) {
+  std::string fname = LogFileName(dbname_, job->number);
+  SequentialFile* file;
+  Status status = env_->NewSequentialFile(fname, &file);
+  if (!status.ok()) {
+    MaybeIgnoreError(&status);
+    job->status = status;
+    return;
   }
 
-  Log(options_.info_log, "Level-0 table #%llu: %lld bytes %s",
-      (unsigned long long)meta.number, (unsigned long long)meta.file_size,
+  LogReporter reporter;
+  reporter.env = env_;
+  reporter.info_log = options_.info_log;
+  reporter.fname = fname.c_str();
+  reporter.status = (options_.paranoid_checks ? &status : nullptr);
+  log::Reader reader(file, &reporter, true /*checksum*/, 0 /*initial_offset*/,
+                     job->number);
+  Log(options_.info_log, "Recovering log #%llu",
+      (unsigned long long)job->number);
+
+  std::string scratch;
+  Slice record;
+  WriteBatch batch;
+  TQMemTable* mem = nullptr;
+  while (reader.ReadRecord(&record, &scratch) && status.ok()) {
+    if (record.size() < 12) {
+      reporter.Corruption(record.size(),
+                          Status::Corruption("log record too small"));
+      continue;
+    }
+    WriteBatchInternal::SetContents(&batch, record);
+
+    if (mem == nullptr) {
+      mem = new TQMemTable(internal_comparator_, options_.write_buffer_size,
+                           options_.memtable_huge_page_size);
+      mem->Ref();
+      job->mems.push_back(mem);
+    }
+    status = WriteBatchInternal::InsertInto(&batch, mem);
+    MaybeIgnoreError(&status);
+    if (!status.ok()) {
+      break;
+    }
+    const SequenceNumber last_seq = WriteBatchInternal::Sequence(&batch) +
+                                    WriteBatchInternal::Count(&batch) - 1;
+    if (last_seq > job->max_sequence) {
+      job->max_sequence = last_seq;
+    }
+
+    if (mem->ApproximateMemoryUsage() > options_.write_buffer_size) {
+      // Leave it to be flushed once the log has been replayed.
+      job->overflowed = true;
+      mem = nullptr;
+    }
+  }
+  delete file;
+  job->status = status;
+}
+
+void DBImpl::ReplayLogFileWork(void* arg) {
+  LogRecovery* job = reinterpret_cast<LogRecovery*>(arg);
+  job->db->ReplayLogFile(job);
+  MutexLock l(&job->db->mutex_);
+  job->replayed = true;
+  job->done->SignalAll();
+}
+
+void DBImpl::BuildRecoveredTableWork(void* arg) {
+  LogRecovery::TableBuild* build =
+      reinterpret_cast<LogRecovery::TableBuild*>(arg);
+  LogRecovery* job = build->job;
+  DBImpl* db = job->db;
+  FileMetaData* meta = &job->outputs[build->index];
+  Iterator* iter = job->mems[build->index]->NewIterator();
+  Log(db->options_.info_log, "Level-0 table #%llu: started",
+      (unsigned long long)meta->number);
+  Status s = BuildTable(db->dbname_, db->env_, db->options_, db->table_cache_,
+                        iter, meta, db->compression_pool_);
+  Log(db->options_.info_log, "Level-0 table #%llu: %lld bytes %s",
+      (unsigned long long)meta->number, (unsigned long long)meta->file_size,
       s.ToString().c_str());
   delete iter;
+
+  MutexLock l(&db->mutex_);
+  job->output_status[build->index] = s;
+  job->pending_outputs--;
+  job->done->SignalAll();
+  delete build;
+}
+
+Status DBImpl::RecoverLogFilesInParallel(const std::vector<uint64_t>& logs,
+                                         bool* save_manifest,
+                                         VersionEdit* edit,
+                                         SequenceNumber* max_sequence) {
+  mutex_.AssertHeld();
+  port::CondVar done(&mutex_);
+  std::vector<LogRecovery> jobs(logs.size());
+  for (size_t i = 0; i < logs.size(); i++) {
+    jobs[i].db = this;
+    jobs[i].number = logs[i];
+    jobs[i].done = &done;
+  }
+
+  // A log holds a slot from the moment it starts being replayed until its
+  // tables are built, which bounds both the threads and the memory used.
+  const size_t max_slots = options_.max_recovery_threads;
+  size_t started = 0;  // Logs handed to a replay thread
+  size_t finished = 0;  // Logs whose tables have all been built
+  auto start_replays = [&]() {
+    mutex_.AssertHeld();
+    while (finished < started && jobs[finished].replayed &&
+           jobs[finished].pending_outputs == 0 &&
+           jobs[finished].outputs.size() == jobs[finished].mems.size()) {
+      finished++;
+    }
+    while (started < jobs.size() && started - finished < max_slots) {
+      env_->StartThread(&DBImpl::ReplayLogFileWork, &jobs[started]);
+      started++;
+    }
+  };
+
+  Status status;
+  size_t i = 0;
+  for (; i < jobs.size(); i++) {
+    LogRecovery* job = &jobs[i];
+    start_replays();
+    while (!job->replayed) {
+      done.Wait();
+      start_replays();
+    }
+    status = job->status;
+    if (!status.ok()) {
+      break;
+    }
+    if (job->max_sequence > *max_sequence) {
+      *max_sequence = job->max_sequence;
+    }
+    // The previous incarnation may not have written any MANIFEST
+    // records after allocating this log number.  So we manually
+    // update the file number allocation counter in VersionSet.
+    versions_->MarkFileNumberUsed(job->number);
+
+    if (i == jobs.size() - 1 && !job->overflowed && job->mems.size() <= 1) {
+      TQMemTable* mem = job->mems.empty() ? nullptr : job->mems[0];
+      if (MaybeReuseLogFile(job->number, &mem)) {
+        job->mems.clear();
+        continue;
+      }
+    }
+
+    // Number the tables in log order, as a sequential recovery would, so
+    // that newer updates always end up in newer level-0 files.  Building
+    // them can then happen in any order.
+    job->outputs.resize(job->mems.size());
+    job->output_status.resize(job->mems.size());
+    for (size_t m = 0; m < job->mems.size(); m++) {
+      job->outputs[m].number = versions_->NewFileNumber();
+      pending_outputs_.insert(job->outputs[m].number);
+      *save_manifest = true;
+      job->pending_outputs++;
+      env_->StartThread(&DBImpl::BuildRecoveredTableWork,
+                        new LogRecovery::TableBuild{job, m});
+    }
+  }
+
+  // Wait for the threads still running, whether or not we failed.
+  for (size_t j = 0; j < started; j++) {
+    while (!jobs[j].replayed || jobs[j].pending_outputs > 0) {
+      done.Wait();
+    }
+  }
+
+  for (LogRecovery& job : jobs) {
+    for (size_t m = 0; m < job.outputs.size(); m++) {
+      const FileMetaData& meta = job.outputs[m];
+      pending_outputs_.erase(meta.number);
+      if (status.ok()) {
+        status = job.output_status[m];
+      }
+      // Note that if file_size is zero, the file has been deleted and
+      // should not be added to the manifest.
+      if (status.ok() && meta.file_size > 0) {
+        edit->AddFile(0, meta.number, meta.file_size, meta.smallest,
+                      meta.largest);
+        CompactionStats stats;
+        stats.bytes_written = meta.file_size;
+        stats_[0].Add(stats);
+      }
+    }
+    for (TQMemTable* mem : job.mems) {
+      mem->Unref();
+    }
+  }
+  return status;
+}
+
+//修改为tqmemtable
+Status DBImpl::WriteLevel0Table(TQMemTable* mem, VersionEdit* edit) {
+  mutex_.AssertHeld();
+  const uint64_t start_micros = env_->NowMicros();
+  FileMetaData meta;
+  Status s = BuildMemTableOutput(mem, &meta);
   pending_outputs_.erase(meta.number);
 
   // Note that if file_size is zero, the file has been deleted and
   // should not be added to the manifest.
-  int level = 0;
   if (s.ok() && meta.file_size > 0) {
-    const Slice min_user_key = meta.smallest.user_key();
-    const Slice max_user_key = meta.largest.user_key();
-    if (base != nullptr) {
-      level = base->PickLevelForMemTableOutput(min_user_key, max_user_key);
-    }
-    edit->AddFile(level, meta.number, meta.file_size, meta.smallest,
+    edit->AddFile(0, meta.number, meta.file_size, meta.smallest,
                   meta.largest);
   }
 
   CompactionStats stats;
   stats.micros = env_->NowMicros() - start_micros;
   stats.bytes_written = meta.file_size;
-  stats_[level].Add(stats);
+  stats_[0].Add(stats);
+  return s;
+}
+
+Status DBImpl::BuildMemTableOutput(TQMemTable* mem, FileMetaData* meta) {
+  mutex_.AssertHeld();
+  meta->number = versions_->NewFileNumber();
+  pending_outputs_.insert(meta->number);
+  Iterator* iter = mem->NewIterator();
+  Log(options_.info_log, "Level-0 table #%llu: started",
+      (unsigned long long)meta->number);
+
+  Status s;
+  {
+    mutex_.Unlock();
+    s = BuildTable(dbname_, env_, options_, table_cache_, iter, meta,
+                   compression_pool_);
+    mutex_.Lock();
+  }
+
+  Log(options_.info_log, "Level-0 table #%llu: %lld bytes %s",
+      (unsigned long long)meta->number, (unsigned long long)meta->file_size,
+      s.ToString().c_str());
+  delete iter;
   return s;
 }
 
 void DBImpl::CompactMemTable() {
   mutex_.AssertHeld();
   assert(imm_ != nullptr);
+  assert(!flushing_imm_);
+  flushing_imm_ = true;
 
   // Save the contents of the memtable as a new Table
-  VersionEdit edit;
-  Version* base = versions_->current();
-  base->Ref();
-  Status s = WriteLevel0Table(imm_, &edit, base);
-  base->Unref();
+  const uint64_t start_micros = env_->NowMicros();
+  FileMetaData meta;
+  Status s = BuildMemTableOutput(imm_, &meta);
 
   if (s.ok() && shutting_down_.load(std::memory_order_acquire)) {
     s = Status::IOError("Deleting DB during memtable compaction");
   }
 
   // Replace immutable memtable with the generated Table
+  int level = 0;
   if (s.ok()) {
+    VersionEdit edit;
     edit.SetPrevLogNumber(0);
     edit.SetLogNumber(logfile_number_);  // Earlier logs no longer needed
+    // The level is picked against the version the edit will apply to, so
+    // no other flush or compaction may install files in between.
+    AcquireManifestWriter();
+    // Note that if file_size is zero, the file has been deleted and
+    // should not be added to the manifest.
+    if (meta.file_size > 0) {
+      // Concurrent compactions may pick inputs from the current version
+      // before the edit lands, so their outputs could overlap the table
+      // anywhere past level 0.
+      if (options_.max_background_compactions == 1) {
+        level = versions_->current()->PickLevelForMemTableOutput(
+            meta.smallest.user_key(), meta.largest.user_key());
+      }
+      edit.AddFile(level, meta.number, meta.file_size, meta.smallest,
+                   meta.largest);
+    }
     s = versions_->LogAndApply(&edit, &mutex_);
+    ReleaseManifestWriter();
   }
+  // A compaction may remove obsolete files while the edit is being logged.
+  pending_outputs_.erase(meta.number);
+  flushing_imm_ = false;
+
+  CompactionStats stats;
+  stats.micros = env_->NowMicros() - start_micros;
+  stats.bytes_written = meta.file_size;
+  stats_[level].Add(stats);
 
   if (s.ok()) {
     // Commit to the new state
     imm_->Unref();
     imm_ = nullptr;
     has_imm_.store(false, std::memory_order_release);
+    InstallSuperVersion();
     RemoveObsoleteFiles();
   } else {
     RecordBackgroundError(s);
@@ -663,20 +1097,49 @@ void DBImpl::RecordBackgroundError(const Status& s) {
   }
 }
 
+Status DBImpl::LogAndApply(VersionEdit* edit) {
+  mutex_.AssertHeld();
+  AcquireManifestWriter();
+  Status s = versions_->LogAndApply(edit, &mutex_);
+  ReleaseManifestWriter();
+  return s;
+}
+
+void DBImpl::AcquireManifestWriter() {
+  mutex_.AssertHeld();
+  while (manifest_writing_) {
+    manifest_write_done_.Wait();
+  }
+  manifest_writing_ = true;
+}
+
+void DBImpl::ReleaseManifestWriter() {
+  mutex_.AssertHeld();
+  assert(manifest_writing_);
+  manifest_writing_ = false;
+  manifest_write_done_.SignalAll();
+  // The new version may have compactions that do not overlap running ones.
+  compactions_blocked_ = false;
+}
+
 void DBImpl::MaybeScheduleCompaction() {
   mutex_.AssertHeld();
-  if (background_compaction_scheduled_) {
-    // Already scheduled
-  } else if (shutting_down_.load(std::memory_order_acquire)) {
+  if (shutting_down_.load(std::memory_order_acquire)) {
     // DB is being deleted; no more background compactions
   } else if (!bg_error_.ok()) {
     // Already got an error; no more changes
-  } else if (imm_ == nullptr && manual_compaction_ == nullptr &&
-             !versions_->NeedsCompaction()) {
-    // No work to be done
   } else {
-    background_compaction_scheduled_ = true;
-    env_->Schedule(&DBImpl::BGWork, this);
+    if (imm_ != nullptr && !background_flush_scheduled_) {
+      background_flush_scheduled_ = true;
+      env_->Schedule(&DBImpl::BGFlushWork, this, Env::kHighPriority);
+    }
+    while (background_compactions_scheduled_ <
+               options_.max_background_compactions &&
+           !compactions_blocked_ &&
+           (manual_compaction_ != nullptr || versions_->NeedsCompaction())) {
+      background_compactions_scheduled_++;
+      env_->Schedule(&DBImpl::BGWork, this, Env::kLowPriority);
+    }
   }
 }
 
@@ -684,9 +1147,33 @@ void DBImpl::BGWork(void* db) {
   reinterpret_cast<DBImpl*>(db)->BackgroundCall();
 }
 
+void DBImpl::BGFlushWork(void* db) {
+  reinterpret_cast<DBImpl*>(db)->BackgroundFlushCall();
+}
+
+void DBImpl::BackgroundFlushCall() {
+  MutexLock l(&mutex_);
+  assert(background_flush_scheduled_);
+  if (shutting_down_.load(std::memory_order_acquire)) {
+    // No more background work when shutting down.
+  } else if (!bg_error_.ok()) {
+    // No more background work after a background error.
+  } else if (imm_ != nullptr && !flushing_imm_) {
+    CompactMemTable();
+  }
+
+  background_flush_scheduled_ = false;
+
+  // The new level-0 file may call for a compaction, and a memtable may
+  // have filled up in the meantime.
+  MaybeScheduleCompaction();
+  background_work_finished_signal_.SignalAll();
+}
+
 void DBImpl::BackgroundCall() {
   MutexLock l(&mutex_);
-  assert(background_compaction_scheduled_);
+  assert(background_compactions_scheduled_ > 0);
+  background_compactions_running_++;
   if (shutting_down_.load(std::memory_order_acquire)) {
     // No more background work when shutting down.
   } else if (!bg_error_.ok()) {
@@ -695,7 +1182,8 @@ void DBImpl::BackgroundCall() {
     BackgroundCompaction();
   }
 
-  background_compaction_scheduled_ = false;
+  background_compactions_running_--;
+  background_compactions_scheduled_--;
 
   // Previous compaction may have produced too many files in a level,
   // so reschedule another compaction if needed.
@@ -706,14 +1194,23 @@ void DBImpl::BackgroundCall() {
 void DBImpl::BackgroundCompaction() {
   mutex_.AssertHeld();
 
-  if (imm_ != nullptr) {
-    CompactMemTable();
-    return;
+  // Pick from the version that edits being written will produce.  A flush
+  // may be installing a table past level 0 that overlaps the inputs a
+  // compaction would pick from the current version.
+  while (manifest_writing_) {
+    manifest_write_done_.Wait();
   }
 
   Compaction* c;
   bool is_manual = (manual_compaction_ != nullptr);
   InternalKey manual_end;
+  if (is_manual && background_compactions_running_ > 1) {
+    // A manual compaction waits for the running compactions to finish,
+    // since its inputs may overlap theirs.  Automatic compactions in turn
+    // wait for it.
+    compactions_blocked_ = true;
+    return;
+  }
   if (is_manual) {
     ManualCompaction* m = manual_compaction_;
     c = versions_->CompactRange(m->level, m->begin, m->end);
@@ -732,7 +1229,10 @@ void DBImpl::BackgroundCompaction() {
 
   Status status;
   if (c == nullptr) {
-    // Nothing to do
+    // Nothing to do, or only work that overlaps running compactions
+    if (!is_manual && background_compactions_running_ > 1) {
+      compactions_blocked_ = true;
+    }
   } else if (!is_manual && c->IsTrivialMove()) {
     // Move file to next level
     assert(c->num_input_files(0) == 1);
@@ -740,8 +1240,10 @@ void DBImpl::BackgroundCompaction() {
     c->edit()->RemoveFile(c->level(), f->number);
     c->edit()->AddFile(c->level() + 1, f->number, f->file_size, f->smallest,
                        f->largest);
-    status = versions_->LogAndApply(c->edit(), &mutex_);
-    if (!status.ok()) {
+    status = LogAndApply(c->edit());
+    if (status.ok()) {
+      InstallSuperVersion();
+    } else {
       RecordBackgroundError(status);
     }
     VersionSet::LevelSummaryStorage tmp;
@@ -749,6 +1251,7 @@ void DBImpl::BackgroundCompaction() {
         static_cast<unsigned long long>(f->number), c->level() + 1,
         static_cast<unsigned long long>(f->file_size),
         status.ToString().c_str(), versions_->LevelSummary(&tmp));
+    versions_->ReleaseCompactionFiles(c);
   } else {
     CompactionState* compact = new CompactionState(c);
     status = DoCompactionWork(compact);
@@ -756,9 +1259,14 @@ void DBImpl::BackgroundCompaction() {
       RecordBackgroundError(status);
     }
     CleanupCompaction(compact);
+    versions_->ReleaseCompactionFiles(c);
     c->ReleaseInputs();
     RemoveObsoleteFiles();
   }
+  if (c != nullptr) {
+    // Compactions that overlapped this one may run now.
+    compactions_blocked_ = false;
+  }
   delete c;
 
   if (status.ok()) {
@@ -798,6 +1306,9 @@ void DBImpl::CleanupCompaction(CompactionState* compact) {
     const CompactionState::Output& out = compact->outputs[i];
     pending_outputs_.erase(out.number);
   }
+  for (CompactionState* sub : compact->subcompactions) {
+    CleanupCompaction(sub);
+  }
   delete compact;
 }
 
@@ -819,15 +1330,16 @@ Status DBImpl::OpenCompactionOutputFile(CompactionState* compact) {
 
   // Make the output file
   std::string fname = TableFileName(dbname_, file_number);
-  Status s = env_->NewWritableFile(fname, &compact->outfile);
+  Status s = NewTableFile(env_, options_, fname, &compact->outfile);
   if (s.ok()) {
-    compact->builder = new TableBuilder(options_, compact->outfile);
+    compact->builder = TableBuilderInternal::New(options_, compact->outfile,
+                                                 compression_pool_);
   }
   return s;
 }
 
 Status DBImpl::FinishCompactionOutputFile(CompactionState* compact,
-                                          Iterator* input) {
+                                          const Status& input_status) {
   assert(compact != nullptr);
   assert(compact->outfile != nullptr);
   assert(compact->builder != nullptr);
@@ -836,7 +1348,7 @@ Status DBImpl::FinishCompactionOutputFile(CompactionState* compact,
   assert(output_number != 0);
 
   // Check for iterator errors
-  Status s = input->status();
+  Status s = input_status;
   const uint64_t current_entries = compact->builder->NumEntries();
   if (s.ok()) {
     s = compact->builder->Finish();
@@ -875,6 +1387,59 @@ Status DBImpl::FinishCompactionOutputFile(CompactionState* compact,
   return s;
 }
 
+Status DBImpl::AddToCompactionOutput(CompactionState* compact,
+                                     const Slice& key, const Slice& value) {
+  // Open output file if necessary
+  if (compact->builder == nullptr) {
+    Status s = OpenCompactionOutputFile(compact);
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  if (compact->builder->NumEntries() == 0) {
+    compact->current_output()->smallest.DecodeFrom(key);
+  }
+  compact->current_output()->largest.DecodeFrom(key);
+  compact->builder->Add(key, value);
+
+  // Close output file if it is big enough
+  if (compact->builder->FileSize() >=
+      compact->compaction->MaxOutputFileSize()) {
+    return FinishCompactionOutputFile(compact, Status::OK());
+  }
+  return Status::OK();
+}
+
+void DBImpl::CompactionOutputWork(void* arg) {
+  CompactionOutputStage* stage = reinterpret_cast<CompactionOutputStage*>(arg);
+  DBImpl* db = stage->db;
+  CompactionState* compact = stage->compact;
+  Status s;
+  EntryBatch* batch;
+  while (s.ok() && (batch = stage->queue.Pop()) != nullptr) {
+    for (size_t i = 0; i < batch->size() && s.ok(); i++) {
+      const Slice key = batch->key(i);
+      if (compact->compaction->ShouldStopBefore(key, &compact->cursor) &&
+          compact->builder != nullptr) {
+        s = db->FinishCompactionOutputFile(compact, Status::OK());
+      }
+      if (s.ok()) {
+        s = db->AddToCompactionOutput(compact, key, batch->value(i));
+      }
+    }
+    delete batch;
+  }
+  if (!s.ok()) {
+    // Stop the merge
+    stage->queue.Cancel();
+  }
+
+  MutexLock l(&db->mutex_);
+  stage->status = s;
+  stage->done = true;
+  stage->cv.SignalAll();
+}
+
 Status DBImpl::InstallCompactionResults(CompactionState* compact) {
   mutex_.AssertHeld();
   Log(options_.info_log, "Compacted %d@%d + %d@%d files => %lld bytes",
@@ -890,7 +1455,11 @@ Status DBImpl::InstallCompactionResults(CompactionState* compact) {
     compact->compaction->edit()->AddFile(level + 1, out.number, out.file_size,
                                          out.smallest, out.largest);
   }
-  return versions_->LogAndApply(compact->compaction->edit(), &mutex_);
+  Status s = LogAndApply(compact->compaction->edit());
+  if (s.ok()) {
+    InstallSuperVersion();
+  }
+  return s;
 }
 
 Status DBImpl::DoCompactionWork(CompactionState* compact) {
@@ -911,35 +1480,150 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
     compact->smallest_snapshot = snapshots_.oldest()->sequence_number();
   }
 
-  Iterator* input = versions_->MakeInputIterator(compact->compaction);
-
   // Release mutex while we're actually doing the compaction work
   mutex_.Unlock();
 
-  input->SeekToFirst();
+  versions_->GetSubcompactionBoundaries(
+      compact->compaction, options_.max_subcompactions, &compact->boundaries);
+  const size_t num_subcompactions = compact->boundaries.size() + 1;
+  Status status;
+  if (num_subcompactions == 1) {
+    status = DoSubcompactionWork(compact, &imm_micros);
+    mutex_.Lock();
+  } else {
+    Log(options_.info_log, "Compaction split into %d subcompactions",
+        static_cast<int>(num_subcompactions));
+    // The first subcompaction runs on this thread, the others each on
+    // their own.
+    port::CondVar done(&mutex_);
+    std::vector<SubcompactionJob> jobs(num_subcompactions);
+    for (size_t i = 0; i < num_subcompactions; i++) {
+      CompactionState* sub = new CompactionState(compact->compaction);
+      sub->smallest_snapshot = compact->smallest_snapshot;
+      sub->start = (i == 0) ? nullptr : &compact->boundaries[i - 1];
+      sub->end =
+          (i == num_subcompactions - 1) ? nullptr : &compact->boundaries[i];
+      compact->subcompactions.push_back(sub);
+      jobs[i].db = this;
+      jobs[i].compact = sub;
+      jobs[i].done = false;
+      jobs[i].cv = &done;
+      if (i > 0) {
+        env_->StartThread(&DBImpl::SubcompactionWork, &jobs[i]);
+      }
+    }
+    jobs[0].status = DoSubcompactionWork(jobs[0].compact, &imm_micros);
+    mutex_.Lock();
+    for (size_t i = 1; i < num_subcompactions; i++) {
+      while (!jobs[i].done) {
+        done.Wait();
+      }
+    }
+
+    // Subcompactions cover increasing key ranges, so their outputs are in
+    // order.  CleanupCompaction() erases their pending outputs.
+    for (size_t i = 0; i < num_subcompactions; i++) {
+      const CompactionState* sub = compact->subcompactions[i];
+      compact->outputs.insert(compact->outputs.end(), sub->outputs.begin(),
+                              sub->outputs.end());
+      compact->total_bytes += sub->total_bytes;
+      if (status.ok()) {
+        status = jobs[i].status;
+      }
+    }
+  }
+
+  CompactionStats stats;
+  stats.micros = env_->NowMicros() - start_micros - imm_micros;
+  for (int which = 0; which < 2; which++) {
+    for (int i = 0; i < compact->compaction->num_input_files(which); i++) {
+      stats.bytes_read += compact->compaction->input(which, i)->file_size;
+    }
+  }
+  for (size_t i = 0; i < compact->outputs.size(); i++) {
+    stats.bytes_written += compact->outputs[i].file_size;
+  }
+  stats_[compact->compaction->level() + 1].Add(stats);
+
+  if (status.ok()) {
+    status = InstallCompactionResults(compact);
+  }
+  if (!status.ok()) {
+    RecordBackgroundError(status);
+  }
+  VersionSet::LevelSummaryStorage tmp;
+  Log(options_.info_log, "compacted to: %s", versions_->LevelSummary(&tmp));
+  return status;
+}
+
+void DBImpl::SubcompactionWork(void* arg) {
+  SubcompactionJob* job = reinterpret_cast<SubcompactionJob*>(arg);
+  Status s = job->db->DoSubcompactionWork(job->compact, nullptr);
+  MutexLock l(&job->db->mutex_);
+  job->status = s;
+  job->done = true;
+  job->cv->SignalAll();
+}
+
+Status DBImpl::DoSubcompactionWork(CompactionState* compact,
+                                   int64_t* imm_micros) {
+  const bool pipelined = options_.pipelined_compaction;
+  InternalKey limit;
+  if (compact->end != nullptr) {
+    limit.SetFrom(ParsedInternalKey(*compact->end, kMaxSequenceNumber,
+                                    kValueTypeForSeek));
+  }
+  Iterator* input = versions_->MakeInputIterator(
+      compact->compaction, pipelined,
+      compact->end != nullptr ? &limit : nullptr);
+  if (compact->start != nullptr) {
+    InternalKey start(*compact->start, kMaxSequenceNumber, kValueTypeForSeek);
+    input->Seek(start.Encode());
+  } else {
+    input->SeekToFirst();
+  }
+
+  // When pipelined, the inputs are read ahead on their own threads, and
+  // the entries that survive are batched up for a thread that builds the
+  // output tables.
+  CompactionOutputStage* output = nullptr;
+  EntryBatch* batch = nullptr;
+  if (pipelined) {
+    output = new CompactionOutputStage(this, compact);
+    batch = new EntryBatch;
+    env_->StartThread(&DBImpl::CompactionOutputWork, output);
+  }
+
   Status status;
   ParsedInternalKey ikey;
   std::string current_user_key;
   bool has_current_user_key = false;
   SequenceNumber last_sequence_for_key = kMaxSequenceNumber;
   while (input->Valid() && !shutting_down_.load(std::memory_order_acquire)) {
-    // Prioritize immutable compaction work
-    if (has_imm_.load(std::memory_order_relaxed)) {
+    // Prioritize immutable compaction work, in case the flush job is
+    // queued behind this one (e.g. on an Env with a single thread)
+    if (imm_micros != nullptr && has_imm_.load(std::memory_order_relaxed)) {
       const uint64_t imm_start = env_->NowMicros();
       mutex_.Lock();
-      if (imm_ != nullptr) {
+      if (imm_ != nullptr && !flushing_imm_) {
         CompactMemTable();
         // Wake up MakeRoomForWrite() if necessary.
         background_work_finished_signal_.SignalAll();
       }
       mutex_.Unlock();
-      imm_micros += (env_->NowMicros() - imm_start);
+      *imm_micros += (env_->NowMicros() - imm_start);
     }
 
     Slice key = input->key();
-    if (compact->compaction->ShouldStopBefore(key) &&
+    if (compact->end != nullptr && key.size() >= 8 &&
+        user_comparator()->Compare(ExtractUserKey(key), *compact->end) >= 0) {
+      // The rest belongs to the next subcompaction
+      break;
+    }
+    if (output == nullptr &&
+        compact->compaction->ShouldStopBefore(key, &compact->cursor) &&
         compact->builder != nullptr) {
-      status = FinishCompactionOutputFile(compact, input);
+      status = FinishCompactionOutputFile(compact, input->status());
       if (!status.ok()) {
         break;
       }
@@ -967,7 +1651,8 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
         drop = true;  // (A)
       } else if (ikey.type == kTypeDeletion &&
                  ikey.sequence <= compact->smallest_snapshot &&
-                 compact->compaction->IsBaseLevelForKey(ikey.user_key)) {
+                 compact->compaction->IsBaseLevelForKey(ikey.user_key,
+                                                        &compact->cursor)) {
         // For this user key:
         // (1) there is no data in higher levels
         // (2) data in lower levels will have larger sequence numbers
@@ -986,123 +1671,199 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
         "%d smallest_snapshot: %d",
         ikey.user_key.ToString().c_str(),
         (int)ikey.sequence, ikey.type, kTypeValue, drop,
-        compact->compaction->IsBaseLevelForKey(ikey.user_key),
+        compact->compaction->IsBaseLevelForKey(ikey.user_key,
+                                               &compact->cursor),
         (int)last_sequence_for_key, (int)compact->smallest_snapshot);
 #endif
 
-    if (!drop) {
-      // Open output file if necessary
-      if (compact->builder == nullptr) {
-        status = OpenCompactionOutputFile(compact);
-        if (!status.ok()) {
+    if (drop) {
+      // Nothing to write
+    } else if (output != nullptr) {
+      batch->Add(key, input->value());
+      if (batch->ApproximateBytes() >= kCompactionOutputBatchBytes) {
+        if (!output->queue.Push(batch)) {
+          // The output stage failed
+          batch = nullptr;
           break;
         }
+        batch = new EntryBatch;
       }
-      if (compact->builder->NumEntries() == 0) {
-        compact->current_output()->smallest.DecodeFrom(key);
-      }
-      compact->current_output()->largest.DecodeFrom(key);
-      compact->builder->Add(key, input->value());
-
-      // Close output file if it is big enough
-      if (compact->builder->FileSize() >=
-          compact->compaction->MaxOutputFileSize()) {
-        status = FinishCompactionOutputFile(compact, input);
-        if (!status.ok()) {
-          break;
-        }
+    } else {
+      status = AddToCompactionOutput(compact, key, input->value());
+      if (!status.ok()) {
+        break;
       }
     }
 
     input->Next();
   }
 
+  if (output != nullptr) {
+    if (batch != nullptr) {
+      if (batch->empty()) {
+        delete batch;
+      } else {
+        output->queue.Push(batch);
+      }
+    }
+    output->queue.Finish();
+    {
+      MutexLock l(&mutex_);
+      while (!output->done) {
+        output->cv.Wait();
+      }
+    }
+    if (status.ok()) {
+      status = output->status;
+    }
+    delete output;
+  }
+
   if (status.ok() && shutting_down_.load(std::memory_order_acquire)) {
     status = Status::IOError("Deleting DB during compaction");
   }
   if (status.ok() && compact->builder != nullptr) {
-    status = FinishCompactionOutputFile(compact, input);
+    status = FinishCompactionOutputFile(compact, input->status());
   }
   if (status.ok()) {
     status = input->status();
   }
   delete input;
-  input = nullptr;
+  return status;
+}
 
-  CompactionStats stats;
-  stats.micros = env_->NowMicros() - start_micros - imm_micros;
-  for (int which = 0; which < 2; which++) {
-    for (int i = 0; i < compact->compaction->num_input_files(which); i++) {
-      stats.bytes_read += compact->compaction->input(which, i)->file_size;
+void DBImpl::InstallSuperVersion() {
+  mutex_.AssertHeld();
+  SuperVersion* sv = new SuperVersion;
+  sv->mem = mem_;
+  sv->mem->Ref();
+  sv->imm = imm_;
+  if (sv->imm != nullptr) sv->imm->Ref();
+  sv->current = versions_->current();
+  sv->current->Ref();
+  sv->number = super_version_number_.load(std::memory_order_relaxed) + 1;
+  sv->Ref();
+
+  SuperVersion* old = super_version_;
+  super_version_ = sv;
+  super_version_number_.store(sv->number, std::memory_order_release);
+
+  // Drop the views threads have cached so that the memtables and files they
+  // pin are released promptly.  A slot that is in use is cleared too; its
+  // reader then releases the view itself in ReturnSuperVersion().
+  for (size_t i = 0; i < kNumSuperVersionSlots; i++) {
+    SuperVersion* cached =
+        super_version_slots_[i].sv.exchange(nullptr, std::memory_order_acq_rel);
+    if (cached != nullptr && cached != kSuperVersionInUse && cached->Unref()) {
+      CleanupSuperVersion(cached);
     }
   }
-  for (size_t i = 0; i < compact->outputs.size(); i++) {
-    stats.bytes_written += compact->outputs[i].file_size;
+  if (old != nullptr && old->Unref()) {
+    CleanupSuperVersion(old);
   }
 
-  mutex_.Lock();
-  stats_[compact->compaction->level() + 1].Add(stats);
-
-  if (status.ok()) {
-    status = InstallCompactionResults(compact);
+  // Let the rate limiter tune itself to the new version's compaction debt
+  if (options_.rate_limiter != nullptr) {
+    options_.rate_limiter->SetPendingCompactionBytes(
+        versions_->PendingCompactionBytes());
   }
-  if (!status.ok()) {
-    RecordBackgroundError(status);
+}
+
+DBImpl::SuperVersion* DBImpl::GetAndRefSuperVersion() {
+  SuperVersionSlot* slot = &super_version_slots_[SuperVersionSlotIndex()];
+  SuperVersion* sv =
+      slot->sv.exchange(static_cast<SuperVersion*>(kSuperVersionInUse),
+                        std::memory_order_acquire);
+  if (sv == kSuperVersionInUse) {
+    // Another thread sharing this slot has the cached view.
+    sv = nullptr;
+  } else if (sv != nullptr &&
+             sv->number !=
+                 super_version_number_.load(std::memory_order_acquire)) {
+    UnrefSuperVersion(sv);
+    sv = nullptr;
+  }
+  if (sv == nullptr) {
+    MutexLock l(&mutex_);
+    sv = super_version_;
+    sv->Ref();
   }
-  VersionSet::LevelSummaryStorage tmp;
-  Log(options_.info_log, "compacted to: %s", versions_->LevelSummary(&tmp));
-  return status;
+  return sv;
 }
 
-namespace {
+void DBImpl::ReturnSuperVersion(SuperVersion* sv) {
+  SuperVersionSlot* slot = &super_version_slots_[SuperVersionSlotIndex()];
+  SuperVersion* expected = static_cast<SuperVersion*>(kSuperVersionInUse);
+  if (!slot->sv.compare_exchange_strong(expected, sv,
+                                        std::memory_order_release)) {
+    // InstallSuperVersion() cleared the slot or it is already caching
+    // another view.
+    UnrefSuperVersion(sv);
+  }
+}
 
-struct IterState {
-  port::Mutex* const mu;
-  Version* const version GUARDED_BY(mu);
-  //修改为tqmemtable
-  TQMemTable* const mem GUARDED_BY(mu);
-  TQMemTable* const imm GUARDED_BY(mu);
+DBImpl::SuperVersion* DBImpl::GetReadView(const ReadOptions& options,
+                                          SequenceNumber* snapshot) {
+  while (true) {
+    SuperVersion* sv = GetAndRefSuperVersion();
+    if (options.snapshot != nullptr) {
+      *snapshot =
+          static_cast<const SnapshotImpl*>(options.snapshot)->sequence_number();
+      return sv;
+    }
+    // Writes up to the last sequence may already be in a memtable newer
+    // than sv->mem.  Switching memtables installs a new view before any
+    // such write, so if none appeared the view covers the sequence.
+    *snapshot = versions_->LastSequence();
+    if (sv->number == super_version_number_.load(std::memory_order_acquire)) {
+      return sv;
+    }
+    ReturnSuperVersion(sv);
+  }
+}
 
-  IterState(port::Mutex* mutex, TQMemTable* mem, TQMemTable* imm, Version* version)
-      : mu(mutex), version(version), mem(mem), imm(imm) {}
-};
+void DBImpl::UnrefSuperVersion(SuperVersion* sv) {
+  if (sv->Unref()) {
+    MutexLock l(&mutex_);
+    CleanupSuperVersion(sv);
+  }
+}
 
-static void CleanupIteratorState(void* arg1, void* arg2) {
-  IterState* state = reinterpret_cast<IterState*>(arg1);
-  state->mu->Lock();
-  state->mem->Unref();
-  if (state->imm != nullptr) state->imm->Unref();
-  state->version->Unref();
-  state->mu->Unlock();
-  delete state;
+void DBImpl::CleanupSuperVersion(SuperVersion* sv) {
+  mutex_.AssertHeld();
+  sv->mem->Unref();
+  if (sv->imm != nullptr) sv->imm->Unref();
+  sv->current->Unref();
+  delete sv;
 }
 
-}  // anonymous namespace
+void DBImpl::CleanupIteratorSuperVersion(void* db, void* sv) {
+  reinterpret_cast<DBImpl*>(db)->UnrefSuperVersion(
+      reinterpret_cast<SuperVersion*>(sv));
+}
 
 Iterator* DBImpl::NewInternalIterator(const ReadOptions& options,
                                       SequenceNumber* latest_snapshot,
                                       uint32_t* seed) {
-  mutex_.Lock();
-  *latest_snapshot = versions_->LastSequence();
+  SuperVersion* sv = GetReadView(options, latest_snapshot);
 
   // Collect together all needed child iterators
   std::vector<Iterator*> list;
-  list.push_back(mem_->NewIterator());
-  mem_->Ref();
-  if (imm_ != nullptr) {
-    list.push_back(imm_->NewIterator());
-    imm_->Ref();
+  list.push_back(sv->mem->NewIterator());
+  if (sv->imm != nullptr) {
+    list.push_back(sv->imm->NewIterator());
   }
-  versions_->current()->AddIterators(options, &list);
+  sv->current->AddIterators(options, &list);
   Iterator* internal_iter =
       NewMergingIterator(&internal_comparator_, &list[0], list.size());
-  versions_->current()->Ref();
 
-  IterState* cleanup = new IterState(&mutex_, mem_, imm_, versions_->current());
-  internal_iter->RegisterCleanup(CleanupIteratorState, cleanup, nullptr);
+  // The iterator may outlive this thread's use of the cached view, so it
+  // keeps a reference of its own.
+  sv->Ref();
+  internal_iter->RegisterCleanup(CleanupIteratorSuperVersion, this, sv);
+  ReturnSuperVersion(sv);
 
-  *seed = ++seed_;
-  mutex_.Unlock();
+  *seed = seed_.fetch_add(1, std::memory_order_relaxed) + 1;
   return internal_iter;
 }
 
@@ -1120,60 +1881,134 @@ int64_t DBImpl::TEST_MaxNextLevelOverlappingBytes() {
 Status DBImpl::Get(const ReadOptions& options, const Slice& key,
                    std::string* value) {
   Status s;
-  MutexLock l(&mutex_);
   SequenceNumber snapshot;
-  if (options.snapshot != nullptr) {
-    snapshot =
-        static_cast<const SnapshotImpl*>(options.snapshot)->sequence_number();
+  SuperVersion* sv = GetReadView(options, &snapshot);
+
+  Version::GetStats stats;
+  stats.seek_file = nullptr;
+
+  // First look in the memtable, then in the immutable memtable (if any).
+  LookupKey lkey(key, snapshot);
+  if (sv->mem->Get(lkey, value, &s)) {
+    // Done
+  } else if (sv->imm != nullptr && sv->imm->Get(lkey, value, &s)) {
+    // Done
   } else {
-    snapshot = versions_->LastSequence();
+    s = sv->current->Get(options, lkey, value, &stats);
+  }
+
+  // Only reads that needed more than one seek have stats to record.
+  if (stats.seek_file != nullptr) {
+    MutexLock l(&mutex_);
+    if (sv->current->UpdateStats(stats)) {
+      MaybeScheduleCompaction();
+    }
   }
+  ReturnSuperVersion(sv);
+  return s;
+}
 
-  TQMemTable* mem = mem_;
-  TQMemTable* imm = imm_;
-  Version* current = versions_->current();
-  mem->Ref();
-  if (imm != nullptr) imm->Ref();
-  current->Ref();
+void DBImpl::MultiGet(const ReadOptions& options, int n, const Slice* keys,
+                      std::string* values, Status* statuses) {
+  if (n <= 0) return;
 
-  bool have_stat_update = false;
-  Version::GetStats stats;
+  SequenceNumber snapshot;
+  SuperVersion* sv = GetReadView(options, &snapshot);
 
-  // Unlock while reading from files and memtables
-  {
-    mutex_.Unlock();
-    // First look in the memtable, then in the immutable memtable (if any).
-    LookupKey lkey(key, snapshot);
-    if (mem->Get(lkey, value, &s)) {
+  Version::GetStats stats;
+  stats.seek_file = nullptr;
+
+  // Visit the keys in sorted order so that neighbouring lookups touch the
+  // same memtable nodes, files and blocks.
+  const Comparator* ucmp = user_comparator();
+  std::vector<int> order(n);
+  for (int i = 0; i < n; i++) order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+    return ucmp->Compare(keys[a], keys[b]) < 0;
+  });
+
+  std::vector<LookupKey*> lkeys;
+  std::vector<const LookupKey*> table_keys;
+  std::vector<std::string*> table_values;
+  std::vector<Status*> table_statuses;
+  lkeys.reserve(n);
+  for (int i : order) {
+    LookupKey* lkey = new LookupKey(keys[i], snapshot);
+    lkeys.push_back(lkey);
+    statuses[i] = Status::OK();
+    if (sv->mem->Get(*lkey, &values[i], &statuses[i])) {
       // Done
-    } else if (imm != nullptr && imm->Get(lkey, value, &s)) {
+    } else if (sv->imm != nullptr &&
+               sv->imm->Get(*lkey, &values[i], &statuses[i])) {
       // Done
     } else {
-      s = current->Get(options, lkey, value, &stats);
-      have_stat_update = true;
+      table_keys.push_back(lkey);
+      table_values.push_back(&values[i]);
+      table_statuses.push_back(&statuses[i]);
     }
-    mutex_.Lock();
+  }
+  if (!table_keys.empty()) {
+    sv->current->MultiGet(options, static_cast<int>(table_keys.size()),
+                          table_keys.data(), table_values.data(),
+                          table_statuses.data(), &stats);
+  }
+  for (LookupKey* lkey : lkeys) {
+    delete lkey;
   }
 
-  if (have_stat_update && current->UpdateStats(stats)) {
-    MaybeScheduleCompaction();
+  if (stats.seek_file != nullptr) {
+    MutexLock l(&mutex_);
+    if (sv->current->UpdateStats(stats)) {
+      MaybeScheduleCompaction();
+    }
   }
-  mem->Unref();
-  if (imm != nullptr) imm->Unref();
-  current->Unref();
-  return s;
+  ReturnSuperVersion(sv);
 }
 
+namespace {
+
+// The upper bound handed to the table layer, as an internal key.
+struct InternalUpperBound {
+  explicit InternalUpperBound(const Slice& user_key)
+      : key(user_key, kMaxSequenceNumber, kValueTypeForSeek),
+        encoded(key.Encode()) {}
+
+  InternalKey key;
+  Slice encoded;
+};
+
+void DeleteInternalUpperBound(void* arg1, void* arg2) {
+  delete reinterpret_cast<InternalUpperBound*>(arg1);
+}
+
+}  // namespace
+
 Iterator* DBImpl::NewIterator(const ReadOptions& options) {
   SequenceNumber latest_snapshot;
   uint32_t seed;
-  Iterator* iter = NewInternalIterator(options, &latest_snapshot, &seed);
+  Iterator* iter;
+  if (options.iterate_upper_bound != nullptr) {
+    // The first internal key of the bound's user key is <= every entry
+    // with a user key >= the bound, and > every entry below it.
+    InternalUpperBound* bound =
+        new InternalUpperBound(*options.iterate_upper_bound);
+    ReadOptions internal_options = options;
+    internal_options.iterate_upper_bound = &bound->encoded;
+    iter = NewInternalIterator(internal_options, &latest_snapshot, &seed);
+    iter->RegisterCleanup(&DeleteInternalUpperBound, bound, nullptr);
+  } else {
+    iter = NewInternalIterator(options, &latest_snapshot, &seed);
+  }
   return NewDBIterator(this, user_comparator(), iter,
                        (options.snapshot != nullptr
                             ? static_cast<const SnapshotImpl*>(options.snapshot)
                                   ->sequence_number()
                             : latest_snapshot),
-                       seed);
+                       seed, options.iterate_upper_bound,
+                       (options.prefix_same_as_start &&
+                        options_.prefix_extractor != nullptr)
+                           ? internal_prefix_extractor_.user_transform()
+                           : nullptr);
 }
 
 void DBImpl::RecordReadSample(Slice key) {
@@ -1370,7 +2205,8 @@ Status DBImpl::MakeRoomForWrite(bool force) {
       assert(versions_->PrevLogNumber() == 0);
       uint64_t new_log_number = versions_->NewFileNumber();
       WritableFile* lfile = nullptr;
-      s = env_->NewWritableFile(LogFileName(dbname_, new_log_number), &lfile);
+      log::Writer* new_log = nullptr;
+      s = NewLogFile(new_log_number, &lfile, &new_log);
       if (!s.ok()) {
         // Avoid chewing through file number space in a tight loop.
         versions_->ReuseFileNumber(new_log_number);
@@ -1380,7 +2216,7 @@ Status DBImpl::MakeRoomForWrite(bool force) {
       delete logfile_;
       logfile_ = lfile;
       logfile_number_ = new_log_number;
-      log_ = new log::Writer(lfile);
+      log_ = new_log;
 
       //mem_转化为imm_，初始化新的mem_
       int has_cold_data = mem_->CreateNewAndImm();
@@ -1388,7 +2224,8 @@ Status DBImpl::MakeRoomForWrite(bool force) {
       TQMemTable* tmp_mem_ = mem_;
 
       //初始化新的memtable
-      mem_ = new TQMemTable(internal_comparator_, options_.write_buffer_size);
+      mem_ = new TQMemTable(internal_comparator_, options_.write_buffer_size,
+                            options_.memtable_huge_page_size);
 
       //将normal_nodes_中的键值对再次写入mem_ v2.0
       TQMemTableIterator* iter = tmp_mem_->GetTQMemTableIterator();
@@ -1408,6 +2245,7 @@ Status DBImpl::MakeRoomForWrite(bool force) {
       delete iter;
 
       mem_->Ref();
+      InstallSuperVersion();
       force = false;  // Do not force another compaction if have room
       MaybeScheduleCompaction();
     }
@@ -1415,6 +2253,50 @@ Status DBImpl::MakeRoomForWrite(bool force) {
   return s;
 }
 
+Status DBImpl::NewLogFile(uint64_t log_number, WritableFile** file,
+                          log::Writer** writer) {
+  mutex_.AssertHeld();
+  *file = nullptr;
+  *writer = nullptr;
+
+  FileOptions file_options;
+  file_options.use_direct_io = options_.use_direct_io_for_log;
+  file_options.use_data_sync = options_.use_dsync_for_log;
+  file_options.preallocation_block_size = options_.log_file_preallocation_size;
+  const bool recycle = options_.recycle_log_file_num > 0;
+
+  const std::string fname = LogFileName(dbname_, log_number);
+  Status s;
+  if (!recycled_logs_.empty()) {
+    const uint64_t old_log_number = recycled_logs_.front();
+    recycled_logs_.pop_front();
+    s = env_->ReuseWritableFile(fname, LogFileName(dbname_, old_log_number),
+                                file_options, file);
+    if (s.ok()) {
+      Log(options_.info_log, "Reusing log #%llu as #%llu\n",
+          static_cast<unsigned long long>(old_log_number),
+          static_cast<unsigned long long>(log_number));
+    }
+    // Otherwise the old file is left for RemoveObsoleteFiles() to delete.
+  }
+  if (*file == nullptr) {
+    if (recycle || file_options.use_direct_io || file_options.use_data_sync ||
+        file_options.preallocation_block_size > 0) {
+      s = env_->NewWritableFile(fname, file_options, file);
+    } else {
+      s = env_->NewWritableFile(fname, file);
+    }
+  }
+  if (s.ok()) {
+    if (recycle && min_recyclable_log_number_ == 0) {
+      min_recyclable_log_number_ = log_number;
+    }
+    *writer = new log::Writer(*file, log_number, recycle);
+    (*writer)->SetCompression(options_.log_compression);
+  }
+  return s;
+}
+
 bool DBImpl::GetProperty(const Slice& property, std::string* value) {
   value->clear();
 
@@ -1472,6 +2354,16 @@ bool DBImpl::GetProperty(const Slice& property, std::string* value) {
                   static_cast<unsigned long long>(total_usage));
     value->append(buf);
     return true;
+  } else if (in == "rate-limiter-bytes-per-sec") {
+    if (options_.rate_limiter == nullptr) {
+      return false;
+    }
+    char buf[50];
+    std::snprintf(buf, sizeof(buf), "%lld",
+                  static_cast<long long>(
+                      options_.rate_limiter->GetBytesPerSecond()));
+    value->append(buf);
+    return true;
   }
 
   return false;
@@ -1509,6 +2401,13 @@ Status DB::Delete(const WriteOptions& opt, const Slice& key) {
   return Write(opt, &batch);
 }
 
+void DB::MultiGet(const ReadOptions& options, int n, const Slice* keys,
+                  std::string* values, Status* statuses) {
+  for (int i = 0; i < n; i++) {
+    statuses[i] = Get(options, keys[i], &values[i]);
+  }
+}
+
 DB::~DB() = default;
 
 Status DB::Open(const Options& options, const std::string& dbname, DB** dbptr) {
@@ -1524,23 +2423,26 @@ Status DB::Open(const Options& options, const std::string& dbname, DB** dbptr) {
     // Create new log and a corresponding memtable.
     uint64_t new_log_number = impl->versions_->NewFileNumber();
     WritableFile* lfile;
-    s = options.env->NewWritableFile(LogFileName(dbname, new_log_number),
-                                     &lfile);
+    log::Writer* log;
+    s = impl->NewLogFile(new_log_number, &lfile, &log);
     if (s.ok()) {
       edit.SetLogNumber(new_log_number);
       impl->logfile_ = lfile;
       impl->logfile_number_ = new_log_number;
-      impl->log_ = new log::Writer(lfile);
-      impl->mem_ = new TQMemTable(impl->internal_comparator_, options.write_buffer_size);
+      impl->log_ = log;
+      impl->mem_ = new TQMemTable(impl->internal_comparator_,
+                                   impl->options_.write_buffer_size,
+                                   impl->options_.memtable_huge_page_size);
       impl->mem_->Ref();
     }
   }
   if (s.ok() && save_manifest) {
     edit.SetPrevLogNumber(0);  // No older logs needed after recovery.
     edit.SetLogNumber(impl->logfile_number_);
-    s = impl->versions_->LogAndApply(&edit, &impl->mutex_);
+    s = impl->LogAndApply(&edit);
   }
   if (s.ok()) {
+    impl->InstallSuperVersion();
     impl->RemoveObsoleteFiles();
     impl->MaybeScheduleCompaction();
   }
@@ -9,6 +9,7 @@
 #include <deque>
 #include <set>
 #include <string>
+#include <vector>
 
 #include "db/dbformat.h"
 #include "db/log_writer.h"
@@ -24,7 +25,9 @@ class MemTable;
 //修改为tqmemtable
 class TQMemTable;
 
+struct FileMetaData;
 class TableCache;
+class ThreadPool;
 class Version;
 class VersionEdit;
 class VersionSet;
@@ -45,6 +48,8 @@ class DBImpl : public DB {
   Status Write(const WriteOptions& options, WriteBatch* updates) override;
   Status Get(const ReadOptions& options, const Slice& key,
              std::string* value) override;
+  void MultiGet(const ReadOptions& options, int n, const Slice* keys,
+                std::string* values, Status* statuses) override;
   Iterator* NewIterator(const ReadOptions&) override;
   const Snapshot* GetSnapshot() override;
   void ReleaseSnapshot(const Snapshot* snapshot) override;
@@ -76,7 +81,12 @@ class DBImpl : public DB {
 
  private:
   friend class DB;
+  struct CompactionOutputStage;
   struct CompactionState;
+  struct LogRecovery;
+  struct SubcompactionJob;
+  struct SuperVersion;
+  struct SuperVersionSlot;
   struct Writer;
 
   // Information for a manual compaction
@@ -108,6 +118,27 @@ class DBImpl : public DB {
                                 SequenceNumber* latest_snapshot,
                                 uint32_t* seed);
 
+  // Publish mem_, imm_ and versions_->current() as the view new reads use.
+  // Must be called whenever any of them changes.
+  void InstallSuperVersion() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Return a referenced view for a read, usually without touching mutex_.
+  // Each thread caches the view in one of super_version_slots_; the caller
+  // must hand it back with ReturnSuperVersion() on the same thread.
+  SuperVersion* GetAndRefSuperVersion() LOCKS_EXCLUDED(mutex_);
+  void ReturnSuperVersion(SuperVersion* sv) LOCKS_EXCLUDED(mutex_);
+
+  // Like GetAndRefSuperVersion(), and also sets *snapshot to the sequence
+  // the read should use: the one in "options", or else the last sequence,
+  // taken so that every write it covers is in the returned view.
+  SuperVersion* GetReadView(const ReadOptions& options,
+                            SequenceNumber* snapshot) LOCKS_EXCLUDED(mutex_);
+
+  // Drop a reference to "sv" and free it if that was the last one.
+  void UnrefSuperVersion(SuperVersion* sv) LOCKS_EXCLUDED(mutex_);
+  void CleanupSuperVersion(SuperVersion* sv) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  static void CleanupIteratorSuperVersion(void* db, void* sv);
+
   Status NewDB();
 
   // Recover the descriptor from persistent storage.  May do a significant
@@ -124,37 +155,93 @@ class DBImpl : public DB {
   // Compact the in-memory write buffer to disk.  Switches to a new
   // log-file/memtable and writes a new descriptor iff successful.
   // Errors are recorded in bg_error_.
+  // REQUIRES: imm_ != nullptr && !flushing_imm_
   void CompactMemTable() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
+  // Applies "edit" through versions_->LogAndApply(), after waiting for any
+  // other thread doing so.  Flushes and compactions finish independently.
+  Status LogAndApply(VersionEdit* edit) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Waits until no other thread is applying an edit, then claims the right
+  // to do so until ReleaseManifestWriter().
+  void AcquireManifestWriter() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void ReleaseManifestWriter() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
   Status RecoverLogFile(uint64_t log_number, bool last_log, bool* save_manifest,
                         VersionEdit* edit, SequenceNumber* max_sequence)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
+  // Like calling RecoverLogFile() on each of "logs" in turn, but replays up
+  // to options_.max_recovery_threads logs at once and builds the resulting
+  // level-0 tables concurrently.
+  Status RecoverLogFilesInParallel(const std::vector<uint64_t>& logs,
+                                   bool* save_manifest, VersionEdit* edit,
+                                   SequenceNumber* max_sequence)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Reads "job"'s log into memtables.  Does not need mutex_.
+  void ReplayLogFile(LogRecovery* job);
+  static void ReplayLogFileWork(void* job);
+  static void BuildRecoveredTableWork(void* arg);
+
+  // Makes the last recovered log and "*mem" (which may be null) the current
+  // log and memtable if options_.reuse_logs allows it.  On success takes
+  // over "*mem" and sets it to null.
+  bool MaybeReuseLogFile(uint64_t log_number, TQMemTable** mem)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
   // Status WriteLevel0Table(MemTable* mem, VersionEdit* edit, Version* base)
   //     EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
   //使用TQMemTable版本的函数
-  Status WriteLevel0Table(TQMemTable* mem, VersionEdit* edit, Version* base)
+  Status WriteLevel0Table(TQMemTable* mem, VersionEdit* edit)
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Writes "mem" out as a new table described by "*meta".  The table's
+  // number is left in pending_outputs_, for the caller to erase once the
+  // table has been added to the version set.
+  Status BuildMemTableOutput(TQMemTable* mem, FileMetaData* meta)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
   Status MakeRoomForWrite(bool force /* compact even if there is room? */)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Create the log file numbered "log_number", reusing an obsolete log file
+  // if options_.recycle_log_file_num allows it, and a writer for it.
+  Status NewLogFile(uint64_t log_number, WritableFile** file,
+                    log::Writer** writer) EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   WriteBatch* BuildBatchGroup(Writer** last_writer)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
   void RecordBackgroundError(const Status& s);
 
+  // Schedules a memtable flush in the high priority background pool and a
+  // compaction in the low priority one, if there is work for them.
   void MaybeScheduleCompaction() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   static void BGWork(void* db);
+  static void BGFlushWork(void* db);
   void BackgroundCall();
+  void BackgroundFlushCall();
   void BackgroundCompaction() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   void CleanupCompaction(CompactionState* compact)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   Status DoCompactionWork(CompactionState* compact)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
+  // Merges the compaction inputs in compact's key range into new output
+  // files.  Does not need mutex_.  If imm_micros is non-null, flushes imm_
+  // when it fills up and adds the time spent to *imm_micros.
+  Status DoSubcompactionWork(CompactionState* compact, int64_t* imm_micros);
+  static void SubcompactionWork(void* job);
+
   Status OpenCompactionOutputFile(CompactionState* compact);
-  Status FinishCompactionOutputFile(CompactionState* compact, Iterator* input);
+  Status FinishCompactionOutputFile(CompactionState* compact,
+                                    const Status& input_status);
+  // Adds an entry that survived the compaction to compact's current output
+  // file, opening one if needed and finishing it once it is big enough.
+  Status AddToCompactionOutput(CompactionState* compact, const Slice& key,
+                               const Slice& value);
+  static void CompactionOutputWork(void* stage);
   Status InstallCompactionResults(CompactionState* compact)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
@@ -166,6 +253,7 @@ class DBImpl : public DB {
   Env* const env_;
   const InternalKeyComparator internal_comparator_;
   const InternalFilterPolicy internal_filter_policy_;
+  const InternalKeySliceTransform internal_prefix_extractor_;
   const Options options_;  // options_.comparator == &internal_comparator_
   const bool owns_info_log_;
   const bool owns_cache_;
@@ -174,6 +262,10 @@ class DBImpl : public DB {
   // table_cache_ provides its own synchronization
   TableCache* const table_cache_;
 
+  // Compresses the data blocks of the tables that flushes and compactions
+  // write.  Null unless options_.compression_threads is set.
+  ThreadPool* const compression_pool_;
+
   // Lock over the persistent DB state.  Non-null iff successfully acquired.
   FileLock* db_lock_;
 
@@ -189,7 +281,14 @@ class DBImpl : public DB {
   WritableFile* logfile_;
   uint64_t logfile_number_ GUARDED_BY(mutex_);
   log::Writer* log_;
-  uint32_t seed_ GUARDED_BY(mutex_);  // For sampling.
+  std::atomic<uint32_t> seed_;  // For sampling.
+
+  // The view installed by InstallSuperVersion().  super_version_number_ is
+  // bumped on every install so readers can spot a stale cached view without
+  // taking the lock.
+  SuperVersion* super_version_ GUARDED_BY(mutex_);
+  std::atomic<uint64_t> super_version_number_;
+  SuperVersionSlot* const super_version_slots_;
 
   // Queue of writers.
   std::deque<Writer*> writers_ GUARDED_BY(mutex_);
@@ -201,8 +300,34 @@ class DBImpl : public DB {
   // part of ongoing compactions.
   std::set<uint64_t> pending_outputs_ GUARDED_BY(mutex_);
 
-  // Has a background compaction been scheduled or is running?
-  bool background_compaction_scheduled_ GUARDED_BY(mutex_);
+  // Obsolete log files kept around to be reused by NewLogFile().
+  std::deque<uint64_t> recycled_logs_ GUARDED_BY(mutex_);
+
+  // Number of the first log file created by NewLogFile(), or 0.  Only logs
+  // written by this instance are known to use the recyclable record format,
+  // so older ones are never recycled.
+  uint64_t min_recyclable_log_number_ GUARDED_BY(mutex_);
+
+  // Background compactions that have been scheduled or are running, and
+  // those of them that are running.
+  int background_compactions_scheduled_ GUARDED_BY(mutex_);
+  int background_compactions_running_ GUARDED_BY(mutex_);
+
+  // Did a compaction find only work that overlaps running compactions?
+  // Then no more are scheduled until one of those finishes.
+  bool compactions_blocked_ GUARDED_BY(mutex_);
+
+  // Has a background memtable flush been scheduled or is running?
+  bool background_flush_scheduled_ GUARDED_BY(mutex_);
+
+  // Is CompactMemTable() writing out imm_?  Both the flush job and a
+  // running compaction may pick up a waiting imm_.
+  bool flushing_imm_ GUARDED_BY(mutex_);
+
+  // Is a thread in versions_->LogAndApply()?  Others wait for
+  // manifest_write_done_.
+  bool manifest_writing_ GUARDED_BY(mutex_);
+  port::CondVar manifest_write_done_ GUARDED_BY(mutex_);
 
   ManualCompaction* manual_compaction_ GUARDED_BY(mutex_);
 
@@ -219,6 +344,7 @@ class DBImpl : public DB {
 Options SanitizeOptions(const std::string& db,
                         const InternalKeyComparator* icmp,
                         const InternalFilterPolicy* ipolicy,
+                        const InternalKeySliceTransform* iprefix,
                         const Options& src);
 
 }  // namespace leveldb
@@ -9,6 +9,7 @@
 #include "db/filename.h"
 #include "leveldb/env.h"
 #include "leveldb/iterator.h"
+#include "leveldb/slice_transform.h"
 #include "port/port.h"
 #include "util/logging.h"
 #include "util/mutexlock.h"
@@ -46,7 +47,8 @@ class DBIter : public Iterator {
   enum Direction { kForward, kReverse };
 
   DBIter(DBImpl* db, const Comparator* cmp, Iterator* iter, SequenceNumber s,
-         uint32_t seed)
+         uint32_t seed, const Slice* upper_bound,
+         const SliceTransform* prefix_extractor)
       : db_(db),
         user_comparator_(cmp),
         iter_(iter),
@@ -54,7 +56,14 @@ class DBIter : public Iterator {
         direction_(kForward),
         valid_(false),
         rnd_(seed),
-        bytes_until_read_sampling_(RandomCompactionPeriod()) {}
+        bytes_until_read_sampling_(RandomCompactionPeriod()),
+        has_upper_bound_(upper_bound != nullptr),
+        prefix_extractor_(prefix_extractor),
+        prefix_active_(false) {
+    if (has_upper_bound_) {
+      upper_bound_ = upper_bound->ToString();
+    }
+  }
 
   DBIter(const DBIter&) = delete;
   DBIter& operator=(const DBIter&) = delete;
@@ -88,6 +97,18 @@ class DBIter : public Iterator {
   void FindPrevUserEntry();
   bool ParseKey(ParsedInternalKey* key);
 
+  // Returns true if "user_key" is at or past the upper bound, or outside
+  // the prefix of the last Seek() target.
+  bool OutOfRange(const Slice& user_key) const {
+    if (has_upper_bound_ &&
+        user_comparator_->Compare(user_key, upper_bound_) >= 0) {
+      return true;
+    }
+    return prefix_active_ && (!prefix_extractor_->InDomain(user_key) ||
+                              prefix_extractor_->Transform(user_key) !=
+                                  Slice(prefix_));
+  }
+
   inline void SaveKey(const Slice& k, std::string* dst) {
     dst->assign(k.data(), k.size());
   }
@@ -117,6 +138,12 @@ class DBIter : public Iterator {
   bool valid_;
   Random rnd_;
   size_t bytes_until_read_sampling_;
+
+  const bool has_upper_bound_;
+  std::string upper_bound_;
+  const SliceTransform* const prefix_extractor_;
+  bool prefix_active_;  // Set by Seek(); prefix_ holds the target's prefix
+  std::string prefix_;
 };
 
 inline bool DBIter::ParseKey(ParsedInternalKey* ikey) {
@@ -181,6 +208,9 @@ void DBIter::FindNextUserEntry(bool skipping, std::string* skip) {
   do {
     ParsedInternalKey ikey;
     if (ParseKey(&ikey) && ikey.sequence <= sequence_) {
+      if (OutOfRange(ikey.user_key)) {
+        break;
+      }
       switch (ikey.type) {
         case kTypeDeletion:
           // Arrange to skip all upcoming entries for this key since
@@ -241,6 +271,17 @@ void DBIter::FindPrevUserEntry() {
     do {
       ParsedInternalKey ikey;
       if (ParseKey(&ikey) && ikey.sequence <= sequence_) {
+        if (has_upper_bound_ &&
+            user_comparator_->Compare(ikey.user_key, upper_bound_) >= 0) {
+          // Entries at or past the bound precede every key in range when
+          // moving backwards, so skip them.
+          iter_->Prev();
+          continue;
+        }
+        if (prefix_active_ && OutOfRange(ikey.user_key)) {
+          // Every earlier key is outside the prefix too.
+          break;
+        }
         if ((value_type != kTypeDeletion) &&
             user_comparator_->Compare(ikey.user_key, saved_key_) < 0) {
           // We encountered a non-deleted value in entries for previous keys,
@@ -278,6 +319,12 @@ void DBIter::FindPrevUserEntry() {
 void DBIter::Seek(const Slice& target) {
   direction_ = kForward;
   ClearSavedValue();
+  prefix_active_ =
+      prefix_extractor_ != nullptr && prefix_extractor_->InDomain(target);
+  if (prefix_active_) {
+    Slice prefix = prefix_extractor_->Transform(target);
+    prefix_.assign(prefix.data(), prefix.size());
+  }
   saved_key_.clear();
   AppendInternalKey(&saved_key_,
                     ParsedInternalKey(target, sequence_, kValueTypeForSeek));
@@ -292,6 +339,7 @@ void DBIter::Seek(const Slice& target) {
 void DBIter::SeekToFirst() {
   direction_ = kForward;
   ClearSavedValue();
+  prefix_active_ = false;
   iter_->SeekToFirst();
   if (iter_->Valid()) {
     FindNextUserEntry(false, &saved_key_ /* temporary storage */);
@@ -303,7 +351,22 @@ void DBIter::SeekToFirst() {
 void DBIter::SeekToLast() {
   direction_ = kReverse;
   ClearSavedValue();
-  iter_->SeekToLast();
+  prefix_active_ = false;
+  if (has_upper_bound_) {
+    // Start from the last entry before the bound.
+    saved_key_.clear();
+    AppendInternalKey(&saved_key_, ParsedInternalKey(upper_bound_,
+                                                     kMaxSequenceNumber,
+                                                     kValueTypeForSeek));
+    iter_->Seek(saved_key_);
+    if (iter_->Valid()) {
+      iter_->Prev();
+    } else {
+      iter_->SeekToLast();
+    }
+  } else {
+    iter_->SeekToLast();
+  }
   FindPrevUserEntry();
 }
 
@@ -311,8 +374,10 @@ void DBIter::SeekToLast() {
 
 Iterator* NewDBIterator(DBImpl* db, const Comparator* user_key_comparator,
                         Iterator* internal_iter, SequenceNumber sequence,
-                        uint32_t seed) {
-  return new DBIter(db, user_key_comparator, internal_iter, sequence, seed);
+                        uint32_t seed, const Slice* upper_bound,
+                        const SliceTransform* prefix_extractor) {
+  return new DBIter(db, user_key_comparator, internal_iter, sequence, seed,
+                    upper_bound, prefix_extractor);
 }
 
 }  // namespace leveldb
@@ -16,10 +16,14 @@ class DBImpl;
 
 // Return a new iterator that converts internal keys (yielded by
 // "*internal_iter") that were live at the specified "sequence" number
-// into appropriate user keys.
+// into appropriate user keys.  If "upper_bound" is non-null the iterator
+// ends before the first user key >= *upper_bound.  If "prefix_extractor"
+// is non-null, an iterator positioned by Seek() ends at the first user key
+// whose prefix differs from the seek target's.
 Iterator* NewDBIterator(DBImpl* db, const Comparator* user_key_comparator,
                         Iterator* internal_iter, SequenceNumber sequence,
-                        uint32_t seed);
+                        uint32_t seed, const Slice* upper_bound = nullptr,
+                        const SliceTransform* prefix_extractor = nullptr);
 
 }  // namespace leveldb
 
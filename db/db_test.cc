@@ -4,8 +4,10 @@
 
 #include "leveldb/db.h"
 
+#include <algorithm>
 #include <atomic>
 #include <cinttypes>
+#include <map>
 #include <string>
 
 #include "gtest/gtest.h"
@@ -17,6 +19,8 @@
 #include "leveldb/cache.h"
 #include "leveldb/env.h"
 #include "leveldb/filter_policy.h"
+#include "leveldb/rate_limiter.h"
+#include "leveldb/slice_transform.h"
 #include "leveldb/table.h"
 #include "port/port.h"
 #include "port/thread_annotations.h"
@@ -121,6 +125,8 @@ class SpecialEnv : public EnvWrapper {
 
   bool count_random_reads_;
   AtomicCounter random_read_counter_;
+  AtomicCounter multi_read_counter_;
+  AtomicCounter prefetch_counter_;
 
   explicit SpecialEnv(Env* base)
       : EnvWrapper(base),
@@ -208,21 +214,38 @@ class SpecialEnv : public EnvWrapper {
      private:
       RandomAccessFile* target_;
       AtomicCounter* counter_;
+      AtomicCounter* multi_read_counter_;
+      AtomicCounter* prefetch_counter_;
 
      public:
-      CountingFile(RandomAccessFile* target, AtomicCounter* counter)
-          : target_(target), counter_(counter) {}
+      CountingFile(RandomAccessFile* target, AtomicCounter* counter,
+                   AtomicCounter* multi_read_counter,
+                   AtomicCounter* prefetch_counter)
+          : target_(target),
+            counter_(counter),
+            multi_read_counter_(multi_read_counter),
+            prefetch_counter_(prefetch_counter) {}
       ~CountingFile() override { delete target_; }
       Status Read(uint64_t offset, size_t n, Slice* result,
                   char* scratch) const override {
         counter_->Increment();
         return target_->Read(offset, n, result, scratch);
       }
+      Status MultiRead(ReadRequest* reqs, size_t n) const override {
+        counter_->IncrementBy(static_cast<int>(n));
+        multi_read_counter_->Increment();
+        return target_->MultiRead(reqs, n);
+      }
+      Status Prefetch(uint64_t offset, size_t n) const override {
+        prefetch_counter_->Increment();
+        return target_->Prefetch(offset, n);
+      }
     };
 
     Status s = target()->NewRandomAccessFile(f, r);
     if (s.ok() && count_random_reads_) {
-      *r = new CountingFile(*r, &random_read_counter_);
+      *r = new CountingFile(*r, &random_read_counter_, &multi_read_counter_,
+                            &prefetch_counter_);
     }
     return s;
   }
@@ -1075,6 +1098,161 @@ TEST_F(DBTest, MinorCompactionsHappen) {
   }
 }
 
+TEST_F(DBTest, MultiGet) {
+  Options options = CurrentOptions();
+  options.write_buffer_size = 64 << 10;
+  Reopen(&options);
+
+  // Spread several versions of each key over the memtables and table files.
+  Random rnd(301);
+  const int kNumKeys = 1000;
+  for (int i = 0; i < 6000; i++) {
+    std::string key = Key(rnd.Uniform(kNumKeys));
+    if (rnd.OneIn(5)) {
+      ASSERT_LEVELDB_OK(Delete(key));
+    } else {
+      ASSERT_LEVELDB_OK(Put(key, RandomString(&rnd, 100)));
+    }
+    if (i == 3000) {
+      Compact("a", "z");
+    }
+  }
+  const Snapshot* snapshot = db_->GetSnapshot();
+  for (int i = 0; i < 1000; i++) {
+    ASSERT_LEVELDB_OK(Put(Key(rnd.Uniform(kNumKeys)), RandomString(&rnd, 100)));
+  }
+  ASSERT_GT(TotalTableFiles(), 0);
+
+  // Unsorted keys with duplicates and keys that were never written.
+  std::vector<std::string> keys;
+  for (int i = 0; i < 200; i++) {
+    keys.push_back(Key(rnd.Uniform(kNumKeys + 100)));
+  }
+  keys.push_back(keys[0]);
+  std::vector<Slice> key_slices(keys.begin(), keys.end());
+  const int n = static_cast<int>(keys.size());
+
+  for (const Snapshot* s : {static_cast<const Snapshot*>(nullptr), snapshot}) {
+    ReadOptions read_options;
+    read_options.snapshot = s;
+    std::vector<std::string> values(n);
+    std::vector<Status> statuses(n);
+    db_->MultiGet(read_options, n, key_slices.data(), values.data(),
+                  statuses.data());
+    for (int i = 0; i < n; i++) {
+      std::string result = values[i];
+      if (statuses[i].IsNotFound()) {
+        result = "NOT_FOUND";
+      } else if (!statuses[i].ok()) {
+        result = statuses[i].ToString();
+      }
+      ASSERT_EQ(Get(keys[i], s), result) << keys[i];
+    }
+  }
+  db_->ReleaseSnapshot(snapshot);
+}
+
+TEST_F(DBTest, MultiGetBatchesBlockReads) {
+  env_->count_random_reads_ = true;
+  Options options = CurrentOptions();
+  options.env = env_;
+  options.block_cache = NewLRUCache(0);  // Prevent cache hits
+  options.write_buffer_size = 64 << 10;
+  Reopen(&options);
+
+  const int N = 5000;
+  for (int i = 0; i < N; i++) {
+    ASSERT_LEVELDB_OK(Put(Key(i), Key(i) + std::string(100, 'v')));
+  }
+  ASSERT_GT(TotalTableFiles(), 0);
+
+  // Prevent auto compactions triggered by seeks
+  env_->delay_data_sync_.store(true, std::memory_order_release);
+
+  // Keys far enough apart to be in different data blocks.
+  std::vector<std::string> keys;
+  for (int i = 0; i < N; i += 50) {
+    keys.push_back(Key(i));
+  }
+  std::vector<Slice> key_slices(keys.begin(), keys.end());
+  const int n = static_cast<int>(keys.size());
+  std::vector<std::string> values(n);
+  std::vector<Status> statuses(n);
+  env_->random_read_counter_.Reset();
+  env_->multi_read_counter_.Reset();
+  db_->MultiGet(ReadOptions(), n, key_slices.data(), values.data(),
+                statuses.data());
+  for (int i = 0; i < n; i++) {
+    ASSERT_LEVELDB_OK(statuses[i]);
+    ASSERT_EQ(keys[i] + std::string(100, 'v'), values[i]);
+  }
+  const int reads = env_->random_read_counter_.Read();
+  const int batches = env_->multi_read_counter_.Read();
+  std::fprintf(stderr, "%d keys => %d reads in %d batches\n", n, reads,
+               batches);
+  ASSERT_GT(batches, 0);
+  ASSERT_LT(batches, reads / 4);
+
+  env_->delay_data_sync_.store(false, std::memory_order_release);
+  Close();
+  delete options.block_cache;
+}
+
+TEST_F(DBTest, ReadViewFollowsMemtableSwitches) {
+  Options options = CurrentOptions();
+  options.write_buffer_size = 10000;
+  Reopen(&options);
+
+  // Every write must be visible to the next read even when it switched
+  // memtables, and iterators keep the view they were created with.
+  const int N = 2000;
+  Iterator* iter = nullptr;
+  for (int i = 0; i < N; i++) {
+    ASSERT_LEVELDB_OK(Put(Key(i), Key(i) + std::string(100, 'v')));
+    ASSERT_EQ(Key(i) + std::string(100, 'v'), Get(Key(i)));
+    ASSERT_EQ(Key(i / 2) + std::string(100, 'v'), Get(Key(i / 2)));
+    if (i == N / 2 - 1) {
+      iter = db_->NewIterator(ReadOptions());
+    }
+  }
+  ASSERT_GT(TotalTableFiles(), 0);
+
+  int count = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    ASSERT_EQ(Key(count), iter->key().ToString());
+    count++;
+  }
+  ASSERT_LEVELDB_OK(iter->status());
+  ASSERT_EQ(N / 2, count);
+  delete iter;
+}
+
+TEST_F(DBTest, ParallelLevel0Reads) {
+  Options options = CurrentOptions();
+  options.write_buffer_size = 64 << 10;
+  options.level0_read_threads = 3;
+  Reopen(&options);
+
+  // Each round writes every kRounds-th key across the whole key space, so
+  // the level-0 files of different rounds all overlap.
+  const int kRounds = 8;
+  const int kKeysPerRound = 1000;
+  int max_level0_files = 0;
+  for (int round = 0; round < kRounds; round++) {
+    for (int i = 0; i < kKeysPerRound; i++) {
+      const int k = i * kRounds + round;
+      ASSERT_LEVELDB_OK(Put(Key(k), Key(k) + std::string(100, 'v')));
+    }
+    max_level0_files = std::max(max_level0_files, NumTableFilesAtLevel(0));
+    for (int k = 0; k < kRounds * kKeysPerRound; k += 7) {
+      const bool written = (k % kRounds) <= round;
+      ASSERT_EQ(written ? Key(k) + std::string(100, 'v') : "NOT_FOUND",
+                Get(Key(k)));
+    }
+  }
+  ASSERT_GT(max_level0_files, 1);
+}
+
 TEST_F(DBTest, RecoverWithLargeLog) {
   {
     Options options = CurrentOptions();
@@ -1942,6 +2120,811 @@ TEST_F(DBTest, BloomFilter) {
   delete options.filter_policy;
 }
 
+TEST_F(DBTest, FullTableFilter) {
+  env_->count_random_reads_ = true;
+  Options options = CurrentOptions();
+  options.env = env_;
+  options.block_cache = NewLRUCache(0);  // Prevent cache hits
+  options.filter_policy = NewBloomFilterPolicy(10);
+  options.full_table_filter = true;
+  options.write_buffer_size = 64 << 10;
+  Reopen(&options);
+
+  const int N = 10000;
+  for (int i = 0; i < N; i++) {
+    ASSERT_LEVELDB_OK(Put(Key(i), Key(i) + std::string(100, 'v')));
+  }
+  int files = 0;
+  for (int level = 0; level < config::kNumLevels; level++) {
+    files += NumTableFilesAtLevel(level);
+  }
+  ASSERT_GT(files, 0);
+
+  // Prevent auto compactions triggered by seeks
+  env_->delay_data_sync_.store(true, std::memory_order_release);
+
+  for (int i = 0; i < N; i++) {
+    ASSERT_EQ(Key(i) + std::string(100, 'v'), Get(Key(i)));
+  }
+
+  // Missing keys should rarely get past the filters.
+  env_->random_read_counter_.Reset();
+  for (int i = 0; i < N; i++) {
+    ASSERT_EQ("NOT_FOUND", Get(Key(i) + ".missing"));
+  }
+  int reads = env_->random_read_counter_.Read();
+  std::fprintf(stderr, "%d missing => %d reads (%d files)\n", N, reads,
+               files);
+  ASSERT_LE(reads, 3 * N / 100);
+
+  // Tables keep the kind of filter they were written with.
+  env_->delay_data_sync_.store(false, std::memory_order_release);
+  options.full_table_filter = false;
+  Reopen(&options);
+  env_->delay_data_sync_.store(true, std::memory_order_release);
+  env_->random_read_counter_.Reset();
+  for (int i = 0; i < N; i++) {
+    ASSERT_EQ("NOT_FOUND", Get(Key(i) + ".missing"));
+  }
+  reads = env_->random_read_counter_.Read();
+  ASSERT_LE(reads, 3 * N / 100);
+
+  env_->delay_data_sync_.store(false, std::memory_order_release);
+  Close();
+  delete options.block_cache;
+  delete options.filter_policy;
+}
+
+TEST_F(DBTest, DataBlockHashIndex) {
+  Options options = CurrentOptions();
+  options.data_block_hash_index = true;
+  options.write_buffer_size = 64 << 10;
+  Reopen(&options);
+
+  const int N = 5000;
+  for (int i = 0; i < N; i += 2) {
+    ASSERT_LEVELDB_OK(Put(Key(i), Key(i) + std::string(100, 'v')));
+  }
+  int files = 0;
+  for (int level = 0; level < config::kNumLevels; level++) {
+    files += NumTableFilesAtLevel(level);
+  }
+  ASSERT_GT(files, 0);
+
+  for (int i = 0; i < N; i++) {
+    if (i % 2 == 0) {
+      ASSERT_EQ(Key(i) + std::string(100, 'v'), Get(Key(i)));
+    } else {
+      ASSERT_EQ("NOT_FOUND", Get(Key(i)));
+    }
+  }
+
+  // Scans do not use the index.
+  Iterator* iter = db_->NewIterator(ReadOptions());
+  int count = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    ASSERT_EQ(Key(2 * count), iter->key().ToString());
+    count++;
+  }
+  ASSERT_EQ(N / 2, count);
+  delete iter;
+}
+
+TEST_F(DBTest, PartitionedIndex) {
+  env_->count_random_reads_ = true;
+  Options options = CurrentOptions();
+  options.env = env_;
+  options.block_cache = NewLRUCache(0);  // Prevent cache hits
+  options.filter_policy = NewBloomFilterPolicy(10);
+  options.partitioned_index = true;
+  options.block_size = 256;  // Many small index partitions
+  options.write_buffer_size = 64 << 10;
+  Reopen(&options);
+
+  const int N = 5000;
+  for (int i = 0; i < N; i++) {
+    ASSERT_LEVELDB_OK(Put(Key(i), Key(i) + std::string(100, 'v')));
+  }
+  int files = 0;
+  for (int level = 0; level < config::kNumLevels; level++) {
+    files += NumTableFilesAtLevel(level);
+  }
+  ASSERT_GT(files, 0);
+
+  // Prevent auto compactions triggered by seeks
+  env_->delay_data_sync_.store(true, std::memory_order_release);
+
+  for (int i = 0; i < N; i++) {
+    ASSERT_EQ(Key(i) + std::string(100, 'v'), Get(Key(i)));
+  }
+
+  // A missing key costs one partition filter read per table it could be
+  // in, and rarely more.
+  env_->random_read_counter_.Reset();
+  for (int i = 0; i < N; i++) {
+    ASSERT_EQ("NOT_FOUND", Get(Key(i) + ".missing"));
+  }
+  int reads = env_->random_read_counter_.Read();
+  std::fprintf(stderr, "%d missing => %d reads (%d files)\n", N, reads,
+               files);
+  ASSERT_LE(reads, N + 3 * N / 100);
+
+  Iterator* iter = db_->NewIterator(ReadOptions());
+  int count = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    ASSERT_EQ(Key(count), iter->key().ToString());
+    count++;
+  }
+  ASSERT_EQ(N, count);
+  iter->Seek(Key(N / 2));
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ(Key(N / 2), iter->key().ToString());
+  iter->Prev();
+  ASSERT_EQ(Key(N / 2 - 1), iter->key().ToString());
+  ASSERT_LEVELDB_OK(iter->status());
+  delete iter;
+
+  env_->delay_data_sync_.store(false, std::memory_order_release);
+  Close();
+  delete options.block_cache;
+  delete options.filter_policy;
+}
+
+TEST_F(DBTest, CacheIndexAndFilterBlocks) {
+  for (int mode = 0; mode < 3; mode++) {
+    Options options = CurrentOptions();
+    options.env = env_;
+    options.block_cache = NewLRUCache(1 << 20, 0.5);
+    options.filter_policy = NewBloomFilterPolicy(10);
+    options.full_table_filter = (mode == 1);
+    options.partitioned_index = (mode == 2);
+    options.cache_index_and_filter_blocks = true;
+    options.pin_l0_filter_and_index_blocks_in_cache = true;
+    options.write_buffer_size = 64 << 10;
+    options.create_if_missing = true;
+    DestroyAndReopen(&options);
+
+    // Rounds that span the whole key range keep flushed tables overlapping,
+    // so some stay at level 0.
+    const int N = 3000;
+    const int kRounds = 6;
+    for (int r = 0; r < kRounds; r++) {
+      for (int i = r; i < N; i += kRounds) {
+        ASSERT_LEVELDB_OK(Put(Key(i), Key(i) + std::string(100, 'v')));
+      }
+    }
+    int files = 0;
+    for (int level = 0; level < config::kNumLevels; level++) {
+      files += NumTableFilesAtLevel(level);
+    }
+    ASSERT_GT(files, 0) << mode;
+
+    // Opening the new tables put their index and filter blocks in the
+    // cache, and they count towards the memory usage.
+    const size_t meta_charge = options.block_cache->TotalCharge();
+    ASSERT_GT(meta_charge, 0) << mode;
+    std::string usage;
+    ASSERT_TRUE(db_->GetProperty("leveldb.approximate-memory-usage", &usage));
+    ASSERT_GE(std::stoull(usage), meta_charge) << mode;
+
+    // Prevent auto compactions triggered by seeks
+    env_->delay_data_sync_.store(true, std::memory_order_release);
+    for (int i = 0; i < N; i++) {
+      ASSERT_EQ(Key(i) + std::string(100, 'v'), Get(Key(i))) << mode;
+      ASSERT_EQ("NOT_FOUND", Get(Key(i) + ".missing")) << mode;
+    }
+
+    // Level-0 tables have been read and pinned their blocks; the others
+    // read theirs back after a prune.
+    options.block_cache->Prune();
+    if (NumTableFilesAtLevel(0) > 0) {
+      ASSERT_GT(options.block_cache->TotalCharge(), 0) << mode;
+    }
+    for (int i = 0; i < N; i += 7) {
+      ASSERT_EQ(Key(i) + std::string(100, 'v'), Get(Key(i))) << mode;
+    }
+    Iterator* iter = db_->NewIterator(ReadOptions());
+    int count = 0;
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      count++;
+    }
+    ASSERT_LEVELDB_OK(iter->status());
+    ASSERT_EQ(N, count) << mode;
+    delete iter;
+
+    env_->delay_data_sync_.store(false, std::memory_order_release);
+    Close();
+    delete options.block_cache;
+    delete options.filter_policy;
+  }
+}
+
+TEST_F(DBTest, Readahead) {
+  env_->count_random_reads_ = true;
+  Options options = CurrentOptions();
+  options.env = env_;
+  options.block_cache = NewLRUCache(0);  // Prevent cache hits
+  options.write_buffer_size = 64 << 10;
+  Reopen(&options);
+
+  const int N = 5000;
+  for (int i = 0; i < N; i++) {
+    ASSERT_LEVELDB_OK(Put(Key(i), Key(i) + std::string(100, 'v')));
+  }
+
+  // Prevent auto compactions triggered by seeks
+  env_->delay_data_sync_.store(true, std::memory_order_release);
+
+  // Point lookups never prefetch.
+  env_->prefetch_counter_.Reset();
+  Random rnd(301);
+  for (int i = 0; i < 1000; i++) {
+    const int k = rnd.Uniform(N);
+    ASSERT_EQ(Key(k) + std::string(100, 'v'), Get(Key(k)));
+  }
+  ASSERT_EQ(0, env_->prefetch_counter_.Read());
+
+  // A scan prefetches once it turns out to be sequential, with a window
+  // that grows so that it takes far fewer prefetches than block reads.
+  env_->random_read_counter_.Reset();
+  env_->prefetch_counter_.Reset();
+  Iterator* iter = db_->NewIterator(ReadOptions());
+  int count = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    ASSERT_EQ(Key(count), iter->key().ToString());
+    count++;
+  }
+  ASSERT_EQ(N, count);
+  ASSERT_LEVELDB_OK(iter->status());
+  delete iter;
+  const int reads = env_->random_read_counter_.Read();
+  const int prefetches = env_->prefetch_counter_.Read();
+  std::fprintf(stderr, "scan => %d reads, %d prefetches\n", reads,
+               prefetches);
+  ASSERT_GT(prefetches, 0);
+  ASSERT_LT(prefetches, reads / 2);
+
+  // A short scan reads too few blocks to prefetch, unless asked to.
+  env_->prefetch_counter_.Reset();
+  ReadOptions read_options;
+  for (int explicit_size = 0; explicit_size < 2; explicit_size++) {
+    read_options.readahead_size = explicit_size ? (32 << 10) : 0;
+    iter = db_->NewIterator(read_options);
+    iter->Seek(Key(N / 2));
+    for (int i = 0; i < 5 && iter->Valid(); i++) {
+      ASSERT_EQ(Key(N / 2 + i), iter->key().ToString());
+      iter->Next();
+    }
+    ASSERT_LEVELDB_OK(iter->status());
+    delete iter;
+    if (explicit_size) {
+      ASSERT_GT(env_->prefetch_counter_.Read(), 0);
+    } else {
+      ASSERT_EQ(0, env_->prefetch_counter_.Read());
+    }
+  }
+
+  env_->delay_data_sync_.store(false, std::memory_order_release);
+  Close();
+  delete options.block_cache;
+}
+
+TEST_F(DBTest, DirectIO) {
+  Options options = CurrentOptions();
+  options.use_direct_reads = true;
+  options.use_direct_io_for_flush_and_compaction = true;
+  options.write_buffer_size = 64 << 10;
+  Reopen(&options);
+
+  Random rnd(301);
+  const int N = 3000;
+  std::vector<std::string> values;
+  for (int i = 0; i < N; i++) {
+    values.push_back(RandomString(&rnd, 50 + rnd.Uniform(200)));
+    ASSERT_LEVELDB_OK(Put(Key(i), values[i]));
+  }
+  ASSERT_GT(TotalTableFiles(), 0);
+  Compact(Key(0), Key(N));
+
+  for (int i = 0; i < N; i++) {
+    ASSERT_EQ(values[i], Get(Key(i)));
+  }
+  Iterator* iter = db_->NewIterator(ReadOptions());
+  int count = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    ASSERT_EQ(Key(count), iter->key().ToString());
+    ASSERT_EQ(values[count], iter->value().ToString());
+    count++;
+  }
+  ASSERT_EQ(N, count);
+  ASSERT_LEVELDB_OK(iter->status());
+  delete iter;
+}
+
+// Occupies a background pool until released.
+struct PoolBlocker {
+  port::Mutex mu;
+  port::CondVar cv{&mu};
+  bool running = false;
+  bool released = false;
+
+  static void Run(void* arg) {
+    PoolBlocker* b = reinterpret_cast<PoolBlocker*>(arg);
+    MutexLock l(&b->mu);
+    b->running = true;
+    b->cv.SignalAll();
+    while (!b->released) {
+      b->cv.Wait();
+    }
+  }
+
+  void WaitUntilRunning() {
+    MutexLock l(&mu);
+    while (!running) {
+      cv.Wait();
+    }
+  }
+
+  void Release() {
+    MutexLock l(&mu);
+    released = true;
+    cv.SignalAll();
+  }
+};
+
+TEST_F(DBTest, FlushWhileCompactionPoolBusy) {
+  Options options = CurrentOptions();
+  options.write_buffer_size = 64 << 10;
+  Reopen(&options);
+
+  PoolBlocker blocker;
+  env_->Schedule(&PoolBlocker::Run, &blocker, Env::kLowPriority);
+  blocker.WaitUntilRunning();
+
+  // Flushes go to the high priority pool, so writes that fill up several
+  // memtables do not wait for the blocked compaction pool.
+  Random rnd(301);
+  const int N = 1000;
+  std::vector<std::string> values;
+  for (int i = 0; i < N; i++) {
+    values.push_back(RandomString(&rnd, 200));
+    ASSERT_LEVELDB_OK(Put(Key(i), values[i]));
+  }
+  const int tables = TotalTableFiles();
+  blocker.Release();
+  ASSERT_GT(tables, 0);
+
+  for (int i = 0; i < N; i++) {
+    ASSERT_EQ(values[i], Get(Key(i)));
+  }
+}
+
+TEST_F(DBTest, FlushOutputLevel) {
+  for (int max_compactions = 1; max_compactions <= 2; max_compactions++) {
+    Options options = CurrentOptions();
+    options.write_buffer_size = 64 << 10;
+    options.create_if_missing = true;
+    options.max_background_compactions = max_compactions;
+    DestroyAndReopen(&options);
+
+    // Keep compactions from moving the flushed tables.
+    PoolBlocker blocker;
+    env_->Schedule(&PoolBlocker::Run, &blocker, Env::kLowPriority);
+    blocker.WaitUntilRunning();
+
+    // Ascending keys give tables that overlap nothing.
+    Random rnd(301);
+    const int N = 1000;
+    std::vector<std::string> values;
+    for (int i = 0; i < N; i++) {
+      values.push_back(RandomString(&rnd, 200));
+      ASSERT_LEVELDB_OK(Put(Key(i), values[i]));
+    }
+    const int tables = TotalTableFiles();
+    const int level0_tables = NumTableFilesAtLevel(0);
+    blocker.Release();
+    ASSERT_GT(tables, 0);
+    if (max_compactions == 1) {
+      // Flushes may push their tables past level 0.
+      ASSERT_LT(level0_tables, tables);
+    } else {
+      // Compactions running alongside each other could pick inputs that
+      // overlap a table before it is installed, so flushes stay at level 0.
+      ASSERT_EQ(level0_tables, tables);
+    }
+
+    for (int i = 0; i < N; i++) {
+      ASSERT_EQ(values[i], Get(Key(i)));
+    }
+  }
+}
+
+TEST_F(DBTest, ParallelCompactions) {
+  env_->SetBackgroundThreads(3, Env::kLowPriority);
+  Options options = CurrentOptions();
+  options.write_buffer_size = 64 << 10;
+  options.max_background_compactions = 3;
+  Reopen(&options);
+
+  Random rnd(301);
+  const int N = 20000;
+  std::vector<std::string> values;
+  for (int i = 0; i < N; i++) {
+    values.push_back(RandomString(&rnd, 100));
+    ASSERT_LEVELDB_OK(Put(Key(i), values[i]));
+  }
+  for (int i = 0; i < N; i += 7) {
+    ASSERT_EQ(values[i], Get(Key(i)));
+  }
+  Iterator* iter = db_->NewIterator(ReadOptions());
+  int count = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    ASSERT_EQ(Key(count), iter->key().ToString());
+    count++;
+  }
+  ASSERT_EQ(N, count);
+  ASSERT_LEVELDB_OK(iter->status());
+  delete iter;
+  Close();
+  env_->SetBackgroundThreads(1, Env::kLowPriority);
+}
+
+TEST_F(DBTest, Subcompactions) {
+  Options options = CurrentOptions();
+  options.write_buffer_size = 64 << 10;
+  options.max_subcompactions = 4;
+  Reopen(&options);
+
+  // Keys written in random order give overlapping level-0 files, and the
+  // deletions leave markers for the subcompactions to drop.
+  Random rnd(301);
+  const int N = 10000;
+  std::vector<int> order(N);
+  for (int i = 0; i < N; i++) {
+    order[i] = i;
+  }
+  for (int i = N - 1; i > 0; i--) {
+    std::swap(order[i], order[rnd.Uniform(i + 1)]);
+  }
+  std::map<std::string, std::string> model;
+  for (int i = 0; i < N; i++) {
+    const std::string value = RandomString(&rnd, 100);
+    ASSERT_LEVELDB_OK(Put(Key(order[i]), value));
+    model[Key(order[i])] = value;
+  }
+  for (int i = 0; i < N; i += 5) {
+    ASSERT_LEVELDB_OK(Delete(Key(order[i])));
+    model.erase(Key(order[i]));
+  }
+  db_->CompactRange(nullptr, nullptr);
+  ASSERT_EQ(0, NumTableFilesAtLevel(0));
+
+  Iterator* iter = db_->NewIterator(ReadOptions());
+  std::map<std::string, std::string>::const_iterator expected = model.begin();
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    ASSERT_TRUE(expected != model.end());
+    ASSERT_EQ(expected->first, iter->key().ToString());
+    ASSERT_EQ(expected->second, iter->value().ToString());
+    ++expected;
+  }
+  ASSERT_TRUE(expected == model.end());
+  ASSERT_LEVELDB_OK(iter->status());
+  delete iter;
+
+  for (int i = 0; i < N; i += 7) {
+    std::map<std::string, std::string>::const_iterator it = model.find(Key(i));
+    ASSERT_EQ(it == model.end() ? "NOT_FOUND" : it->second, Get(Key(i)));
+  }
+}
+
+TEST_F(DBTest, PipelinedCompaction) {
+  for (int subcompactions : {1, 3}) {
+    Options options = CurrentOptions();
+    options.write_buffer_size = 64 << 10;
+    options.create_if_missing = true;
+    options.pipelined_compaction = true;
+    options.max_subcompactions = subcompactions;
+    DestroyAndReopen(&options);
+
+    Random rnd(301);
+    const int N = 10000;
+    std::vector<int> order(N);
+    for (int i = 0; i < N; i++) {
+      order[i] = i;
+    }
+    for (int i = N - 1; i > 0; i--) {
+      std::swap(order[i], order[rnd.Uniform(i + 1)]);
+    }
+    std::map<std::string, std::string> model;
+    for (int i = 0; i < N; i++) {
+      const std::string value = RandomString(&rnd, 100);
+      ASSERT_LEVELDB_OK(Put(Key(order[i]), value));
+      model[Key(order[i])] = value;
+    }
+    for (int i = 0; i < N; i += 3) {
+      ASSERT_LEVELDB_OK(Delete(Key(order[i])));
+      model.erase(Key(order[i]));
+    }
+    db_->CompactRange(nullptr, nullptr);
+    ASSERT_EQ(0, NumTableFilesAtLevel(0));
+
+    Iterator* iter = db_->NewIterator(ReadOptions());
+    std::map<std::string, std::string>::const_iterator expected =
+        model.begin();
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      ASSERT_TRUE(expected != model.end());
+      ASSERT_EQ(expected->first, iter->key().ToString());
+      ASSERT_EQ(expected->second, iter->value().ToString());
+      ++expected;
+    }
+    ASSERT_TRUE(expected == model.end());
+    ASSERT_LEVELDB_OK(iter->status());
+    delete iter;
+  }
+}
+
+TEST_F(DBTest, CompressionThreads) {
+  Options options = CurrentOptions();
+  options.write_buffer_size = 64 << 10;
+  options.create_if_missing = true;
+  options.filter_policy = NewBloomFilterPolicy(10);
+  options.compression_threads = 2;
+  DestroyAndReopen(&options);
+
+  // Both flushes and compactions build their tables with the threads.
+  Random rnd(301);
+  const int N = 10000;
+  std::vector<int> order(N);
+  for (int i = 0; i < N; i++) {
+    order[i] = i;
+  }
+  for (int i = N - 1; i > 0; i--) {
+    std::swap(order[i], order[rnd.Uniform(i + 1)]);
+  }
+  std::map<std::string, std::string> model;
+  std::string value;
+  for (int i = 0; i < N; i++) {
+    test::CompressibleString(&rnd, 0.5, 100, &value);
+    ASSERT_LEVELDB_OK(Put(Key(order[i]), value));
+    model[Key(order[i])] = value;
+  }
+  db_->CompactRange(nullptr, nullptr);
+  ASSERT_EQ(0, NumTableFilesAtLevel(0));
+
+  Iterator* iter = db_->NewIterator(ReadOptions());
+  std::map<std::string, std::string>::const_iterator expected = model.begin();
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    ASSERT_TRUE(expected != model.end());
+    ASSERT_EQ(expected->first, iter->key().ToString());
+    ASSERT_EQ(expected->second, iter->value().ToString());
+    ++expected;
+  }
+  ASSERT_TRUE(expected == model.end());
+  ASSERT_LEVELDB_OK(iter->status());
+  delete iter;
+
+  for (int i = 0; i < N; i += 7) {
+    ASSERT_EQ(model[Key(i)], Get(Key(i)));
+    ASSERT_EQ("NOT_FOUND", Get(Key(i) + ".missing"));
+  }
+
+  Close();
+  delete options.filter_policy;
+}
+
+namespace {
+
+// Lets every request through at once, counting the bytes asked for.
+class CountingRateLimiter : public RateLimiter {
+ public:
+  CountingRateLimiter() : requested_bytes(0), debt_reports(0) {}
+
+  void Request(size_t bytes) override { requested_bytes += bytes; }
+  int64_t GetBytesPerSecond() const override { return 12345; }
+  void SetBytesPerSecond(int64_t /*bytes_per_second*/) override {}
+  void SetPendingCompactionBytes(uint64_t /*bytes*/) override {
+    debt_reports++;
+  }
+
+  std::atomic<uint64_t> requested_bytes;
+  std::atomic<int> debt_reports;
+};
+
+}  // namespace
+
+TEST_F(DBTest, RateLimiter) {
+  std::string rate;
+  ASSERT_TRUE(!db_->GetProperty("leveldb.rate-limiter-bytes-per-sec", &rate));
+
+  CountingRateLimiter limiter;
+  Options options = CurrentOptions();
+  options.write_buffer_size = 64 << 10;
+  options.create_if_missing = true;
+  options.rate_limiter = &limiter;
+  DestroyAndReopen(&options);
+
+  Random rnd(301);
+  const int N = 5000;
+  for (int i = 0; i < N; i++) {
+    ASSERT_LEVELDB_OK(Put(Key(i), RandomString(&rnd, 100)));
+  }
+  db_->CompactRange(nullptr, nullptr);
+
+  // The tables written by the flushes and compactions went through it.
+  ASSERT_GT(limiter.requested_bytes.load(), 0);
+  ASSERT_GT(limiter.debt_reports.load(), 0);
+  ASSERT_TRUE(db_->GetProperty("leveldb.rate-limiter-bytes-per-sec", &rate));
+  ASSERT_EQ("12345", rate);
+
+  for (int i = 0; i < N; i += 7) {
+    ASSERT_EQ(100u, Get(Key(i)).size());
+  }
+  Close();
+}
+
+static std::string PrefixKey(int tenant, int entity) {
+  char buf[100];
+  std::snprintf(buf, sizeof(buf), "t%04d/e%02d/f", tenant, entity);
+  return std::string(buf);
+}
+
+TEST_F(DBTest, PrefixSeek) {
+  const SliceTransform* extractor = NewDelimitedPrefixTransform('/', 1);
+  for (int full = 0; full < 2; full++) {
+    env_->count_random_reads_ = true;
+    Options options = CurrentOptions();
+    options.env = env_;
+    options.block_cache = NewLRUCache(0);  // Prevent cache hits
+    options.filter_policy = NewBloomFilterPolicy(10);
+    options.full_table_filter = (full != 0);
+    options.prefix_extractor = extractor;
+    options.write_buffer_size = 64 << 10;
+    options.create_if_missing = true;
+    DestroyAndReopen(&options);
+
+    // Only even tenants have keys.
+    const int kTenants = 500;
+    const int kEntities = 20;
+    for (int t = 0; t < kTenants; t += 2) {
+      for (int e = 0; e < kEntities; e++) {
+        ASSERT_LEVELDB_OK(Put(PrefixKey(t, e), std::string(100, 'v')));
+      }
+    }
+    int files = 0;
+    for (int level = 0; level < config::kNumLevels; level++) {
+      files += NumTableFilesAtLevel(level);
+    }
+    ASSERT_GT(files, 1);
+
+    // Prevent auto compactions triggered by seeks
+    env_->delay_data_sync_.store(true, std::memory_order_release);
+
+    ReadOptions ropts;
+    ropts.prefix_same_as_start = true;
+    Iterator* iter = db_->NewIterator(ropts);
+    for (int t = 0; t < kTenants; t += 50) {
+      int count = 0;
+      for (iter->Seek(PrefixKey(t, 0)); iter->Valid(); iter->Next()) {
+        ASSERT_EQ(PrefixKey(t, count), iter->key().ToString());
+        count++;
+      }
+      ASSERT_EQ(kEntities, count);
+    }
+
+    // The iterator stops at the end of the prefix in both directions.
+    iter->Seek(PrefixKey(100, 5));
+    ASSERT_TRUE(iter->Valid());
+    iter->Prev();
+    ASSERT_EQ(PrefixKey(100, 4), iter->key().ToString());
+    for (int e = 4; e >= 0; e--) {
+      ASSERT_TRUE(iter->Valid());
+      iter->Prev();
+    }
+    ASSERT_TRUE(!iter->Valid());
+
+    // Seeks to absent prefixes should rarely read a block.
+    env_->random_read_counter_.Reset();
+    for (int t = 1; t < kTenants; t += 2) {
+      iter->Seek(PrefixKey(t, 0));
+      ASSERT_TRUE(!iter->Valid());
+      ASSERT_LEVELDB_OK(iter->status());
+    }
+    int reads = env_->random_read_counter_.Read();
+    std::fprintf(stderr, "%d absent prefixes => %d reads (%d files)\n",
+                 kTenants / 2, reads, files);
+    ASSERT_LE(reads, kTenants / 10);
+
+    // Without prefix_same_as_start a seek continues into the next prefix.
+    delete iter;
+    iter = db_->NewIterator(ReadOptions());
+    iter->Seek(PrefixKey(1, 0));
+    ASSERT_TRUE(iter->Valid());
+    ASSERT_EQ(PrefixKey(2, 0), iter->key().ToString());
+    delete iter;
+
+    env_->delay_data_sync_.store(false, std::memory_order_release);
+    Close();
+    delete options.block_cache;
+    delete options.filter_policy;
+  }
+  delete extractor;
+}
+
+TEST_F(DBTest, IterateUpperBound) {
+  Options options = CurrentOptions();
+  options.write_buffer_size = 64 << 10;
+  Reopen(&options);
+
+  const int N = 2000;
+  for (int i = 0; i < N; i++) {
+    ASSERT_LEVELDB_OK(Put(Key(i), std::string(100, 'v')));
+  }
+  ASSERT_LEVELDB_OK(Delete(Key(999)));
+
+  const std::string bound_key = Key(1000);
+  const Slice bound(bound_key);
+  ReadOptions ropts;
+  ropts.iterate_upper_bound = &bound;
+  Iterator* iter = db_->NewIterator(ropts);
+  int count = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    ASSERT_LT(iter->key().compare(bound), 0);
+    count++;
+  }
+  ASSERT_EQ(999, count);
+
+  iter->SeekToLast();
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ(Key(998), iter->key().ToString());
+  iter->Prev();
+  ASSERT_EQ(Key(997), iter->key().ToString());
+  iter->Next();
+  iter->Next();
+  ASSERT_TRUE(!iter->Valid());
+
+  iter->Seek(Key(500));
+  ASSERT_EQ(Key(500), iter->key().ToString());
+  iter->Seek(Key(1500));
+  ASSERT_TRUE(!iter->Valid());
+  ASSERT_LEVELDB_OK(iter->status());
+  delete iter;
+}
+
+TEST_F(DBTest, IterateUpperBoundAtBlockSeparator) {
+  Options options = CurrentOptions();
+  options.create_if_missing = true;
+  options.write_buffer_size = 64 << 10;
+  DestroyAndReopen(&options);
+
+  // The index separator between the "a" and "d" keys is "b", the bound.
+  // The "z" keys push the others out of the memtable.
+  for (char c : {'a', 'd', 'z'}) {
+    for (int i = 0; i < (c == 'z' ? 500 : 25); i++) {
+      char buf[16];
+      std::snprintf(buf, sizeof(buf), "%c%04d", c, i);
+      ASSERT_LEVELDB_OK(Put(buf, std::string(1000, 'v')));
+    }
+  }
+  db_->CompactRange(nullptr, nullptr);
+  ASSERT_NE("", FilesPerLevel());
+
+  const Slice bound("b");
+  ReadOptions ropts;
+  ropts.iterate_upper_bound = &bound;
+  Iterator* iter = db_->NewIterator(ropts);
+  iter->SeekToLast();
+  ASSERT_TRUE(iter->Valid());
+  ASSERT_EQ("a0024", iter->key().ToString());
+  int count = 0;
+  for (; iter->Valid(); iter->Prev()) {
+    ASSERT_LT(iter->key().compare(bound), 0);
+    count++;
+  }
+  ASSERT_EQ(25, count);
+  ASSERT_LEVELDB_OK(iter->status());
+  delete iter;
+}
+
 // Multi-threaded test:
 namespace {
 
@@ -20,15 +20,38 @@ enum RecordType {
   // For fragments
   kFirstType = 2,
   kMiddleType = 3,
-  kLastType = 4
+  kLastType = 4,
+
+  // For recycled log files.  These carry the log number in their header so
+  // that records left behind by a previous use of the file can be told apart
+  // from new ones.
+  kRecyclableFullType = 5,
+  kRecyclableFirstType = 6,
+  kRecyclableMiddleType = 7,
+  kRecyclableLastType = 8
 };
-static const int kMaxRecordType = kLastType;
+static const int kMaxRecordType = kRecyclableLastType;
+
+// Set in the type of every fragment of a record whose payload has been
+// compressed with Options::log_compression.  The compressed payload is a
+// one byte CompressionType followed by the compressed data.
+static const int kCompressedRecordFlag = 0x10;
+static const int kMaxFlaggedRecordType =
+    kMaxRecordType | kCompressedRecordFlag;
 
 static const int kBlockSize = 32768;
 
 // Header is checksum (4 bytes), length (2 bytes), type (1 byte).
 static const int kHeaderSize = 4 + 2 + 1;
 
+// Recyclable header is checksum (4 bytes), length (2 bytes), type (1 byte),
+// log number (4 bytes).
+static const int kRecyclableHeaderSize = 4 + 2 + 1 + 4;
+
+inline bool IsRecyclableType(unsigned int type) {
+  return type >= kRecyclableFullType && type <= kRecyclableLastType;
+}
+
 }  // namespace log
 }  // namespace leveldb
 
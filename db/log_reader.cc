@@ -7,6 +7,8 @@
 #include <cstdio>
 
 #include "leveldb/env.h"
+#include "leveldb/options.h"
+#include "port/port.h"
 #include "util/coding.h"
 #include "util/crc32c.h"
 
@@ -17,6 +19,10 @@ Reader::Reporter::~Reporter() = default;
 
 Reader::Reader(SequentialFile* file, Reporter* reporter, bool checksum,
                uint64_t initial_offset)
+    : Reader(file, reporter, checksum, initial_offset, 0) {}
+
+Reader::Reader(SequentialFile* file, Reporter* reporter, bool checksum,
+               uint64_t initial_offset, uint64_t log_number)
     : file_(file),
       reporter_(reporter),
       checksum_(checksum),
@@ -26,7 +32,9 @@ Reader::Reader(SequentialFile* file, Reporter* reporter, bool checksum,
       last_record_offset_(0),
       end_of_buffer_offset_(0),
       initial_offset_(initial_offset),
-      resyncing_(initial_offset > 0) {}
+      resyncing_(initial_offset > 0),
+      log_number_(log_number),
+      recycled_(false) {}
 
 Reader::~Reader() { delete[] backing_store_; }
 
@@ -63,24 +71,30 @@ bool Reader::ReadRecord(Slice* record, std::string* scratch) {
   scratch->clear();
   record->clear();
   bool in_fragmented_record = false;
+  // Whether the fragmented record being assembled is compressed
+  bool compressed_record = false;
   // Record offset of the logical record that we're reading
   // 0 is a dummy value to make compilers happy
   uint64_t prospective_record_offset = 0;
 
   Slice fragment;
   while (true) {
-    const unsigned int record_type = ReadPhysicalRecord(&fragment);
+    int header_size;
+    unsigned int record_type = ReadPhysicalRecord(&fragment, &header_size);
+    const bool compressed = (record_type & kCompressedRecordFlag) != 0;
+    record_type &= ~kCompressedRecordFlag;
 
     // ReadPhysicalRecord may have only had an empty trailer remaining in its
     // internal buffer. Calculate the offset of the next physical record now
     // that it has returned, properly accounting for its header size.
     uint64_t physical_record_offset =
-        end_of_buffer_offset_ - buffer_.size() - kHeaderSize - fragment.size();
+        end_of_buffer_offset_ - buffer_.size() - header_size - fragment.size();
 
     if (resyncing_) {
-      if (record_type == kMiddleType) {
+      if (record_type == kMiddleType || record_type == kRecyclableMiddleType) {
         continue;
-      } else if (record_type == kLastType) {
+      } else if (record_type == kLastType ||
+                 record_type == kRecyclableLastType) {
         resyncing_ = false;
         continue;
       } else {
@@ -90,6 +104,7 @@ bool Reader::ReadRecord(Slice* record, std::string* scratch) {
 
     switch (record_type) {
       case kFullType:
+      case kRecyclableFullType:
         if (in_fragmented_record) {
           // Handle bug in earlier versions of log::Writer where
           // it could emit an empty kFirstType record at the tail end
@@ -101,11 +116,19 @@ bool Reader::ReadRecord(Slice* record, std::string* scratch) {
         }
         prospective_record_offset = physical_record_offset;
         scratch->clear();
-        *record = fragment;
+        in_fragmented_record = false;
+        if (compressed) {
+          if (!Uncompress(fragment, record)) {
+            break;
+          }
+        } else {
+          *record = fragment;
+        }
         last_record_offset_ = prospective_record_offset;
         return true;
 
       case kFirstType:
+      case kRecyclableFirstType:
         if (in_fragmented_record) {
           // Handle bug in earlier versions of log::Writer where
           // it could emit an empty kFirstType record at the tail end
@@ -118,9 +141,11 @@ bool Reader::ReadRecord(Slice* record, std::string* scratch) {
         prospective_record_offset = physical_record_offset;
         scratch->assign(fragment.data(), fragment.size());
         in_fragmented_record = true;
+        compressed_record = compressed;
         break;
 
       case kMiddleType:
+      case kRecyclableMiddleType:
         if (!in_fragmented_record) {
           ReportCorruption(fragment.size(),
                            "missing start of fragmented record(1)");
@@ -130,12 +155,21 @@ bool Reader::ReadRecord(Slice* record, std::string* scratch) {
         break;
 
       case kLastType:
+      case kRecyclableLastType:
         if (!in_fragmented_record) {
           ReportCorruption(fragment.size(),
                            "missing start of fragmented record(2)");
         } else {
           scratch->append(fragment.data(), fragment.size());
-          *record = Slice(*scratch);
+          in_fragmented_record = false;
+          if (compressed_record) {
+            if (!Uncompress(Slice(*scratch), record)) {
+              scratch->clear();
+              break;
+            }
+          } else {
+            *record = Slice(*scratch);
+          }
           last_record_offset_ = prospective_record_offset;
           return true;
         }
@@ -150,6 +184,11 @@ bool Reader::ReadRecord(Slice* record, std::string* scratch) {
         }
         return false;
 
+      case kOldRecord:
+        // The rest of this recycled log file predates the current log.
+        scratch->clear();
+        return false;
+
       case kBadRecord:
         if (in_fragmented_record) {
           ReportCorruption(scratch->size(), "error in middle of record");
@@ -175,6 +214,34 @@ bool Reader::ReadRecord(Slice* record, std::string* scratch) {
 
 uint64_t Reader::LastRecordOffset() { return last_record_offset_; }
 
+bool Reader::Uncompress(const Slice& input, Slice* record) {
+  if (input.empty()) {
+    ReportCorruption(input.size(), "empty compressed record");
+    return false;
+  }
+  const char* data = input.data() + 1;
+  const size_t n = input.size() - 1;
+  switch (static_cast<unsigned char>(input[0])) {
+    case kSnappyCompression: {
+      size_t ulength = 0;
+      if (!port::Snappy_GetUncompressedLength(data, n, &ulength)) {
+        ReportCorruption(input.size(), "corrupted compressed record");
+        return false;
+      }
+      uncompressed_.resize(ulength);
+      if (!port::Snappy_Uncompress(data, n, &uncompressed_[0])) {
+        ReportCorruption(input.size(), "corrupted compressed record");
+        return false;
+      }
+      *record = Slice(uncompressed_);
+      return true;
+    }
+    default:
+      ReportCorruption(input.size(), "unknown record compression type");
+      return false;
+  }
+}
+
 void Reader::ReportCorruption(uint64_t bytes, const char* reason) {
   ReportDrop(bytes, Status::Corruption(reason));
 }
@@ -186,7 +253,8 @@ void Reader::ReportDrop(uint64_t bytes, const Status& reason) {
   }
 }
 
-unsigned int Reader::ReadPhysicalRecord(Slice* result) {
+unsigned int Reader::ReadPhysicalRecord(Slice* result, int* header_size) {
+  *header_size = kHeaderSize;
   while (true) {
     if (buffer_.size() < kHeaderSize) {
       if (!eof_) {
@@ -217,12 +285,18 @@ unsigned int Reader::ReadPhysicalRecord(Slice* result) {
     const char* header = buffer_.data();
     const uint32_t a = static_cast<uint32_t>(header[4]) & 0xff;
     const uint32_t b = static_cast<uint32_t>(header[5]) & 0xff;
-    const unsigned int type = header[6];
+    const unsigned int type = static_cast<unsigned char>(header[6]);
     const uint32_t length = a | (b << 8);
-    if (kHeaderSize + length > buffer_.size()) {
+    if (IsRecyclableType(type & ~kCompressedRecordFlag)) {
+      *header_size = kRecyclableHeaderSize;
+    }
+    if (*header_size + length > buffer_.size()) {
       size_t drop_size = buffer_.size();
       buffer_.clear();
       if (!eof_) {
+        if (recycled_) {
+          return kOldRecord;
+        }
         ReportCorruption(drop_size, "bad record length");
         return kBadRecord;
       }
@@ -243,7 +317,8 @@ unsigned int Reader::ReadPhysicalRecord(Slice* result) {
     // Check crc
     if (checksum_) {
       uint32_t expected_crc = crc32c::Unmask(DecodeFixed32(header));
-      uint32_t actual_crc = crc32c::Value(header + 6, 1 + length);
+      uint32_t actual_crc =
+          crc32c::Value(header + 6, *header_size - 6 + length);
       if (actual_crc != expected_crc) {
         // Drop the rest of the buffer since "length" itself may have
         // been corrupted and if we trust it, we could find some
@@ -251,21 +326,40 @@ unsigned int Reader::ReadPhysicalRecord(Slice* result) {
         // like a valid log record.
         size_t drop_size = buffer_.size();
         buffer_.clear();
+        if (recycled_) {
+          // Most likely the middle of a record from the file's previous use.
+          return kOldRecord;
+        }
         ReportCorruption(drop_size, "checksum mismatch");
         return kBadRecord;
       }
     }
 
-    buffer_.remove_prefix(kHeaderSize + length);
+    if (IsRecyclableType(type & ~kCompressedRecordFlag)) {
+      const uint32_t log_number = DecodeFixed32(header + kHeaderSize);
+      if (log_number_ != 0 &&
+          log_number != static_cast<uint32_t>(log_number_)) {
+        buffer_.clear();
+        return kOldRecord;
+      }
+      recycled_ = true;
+    } else if (recycled_) {
+      // A recyclable log never mixes in legacy records, so this one was
+      // written by an earlier user of the file.
+      buffer_.clear();
+      return kOldRecord;
+    }
+
+    buffer_.remove_prefix(*header_size + length);
 
     // Skip physical record that started before initial_offset_
-    if (end_of_buffer_offset_ - buffer_.size() - kHeaderSize - length <
+    if (end_of_buffer_offset_ - buffer_.size() - *header_size - length <
         initial_offset_) {
       result->clear();
       return kBadRecord;
     }
 
-    *result = Slice(header + kHeaderSize, length);
+    *result = Slice(header + *header_size, length);
     return type;
   }
 }
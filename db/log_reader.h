@@ -6,6 +6,7 @@
 #define STORAGE_LEVELDB_DB_LOG_READER_H_
 
 #include <cstdint>
+#include <string>
 
 #include "db/log_format.h"
 #include "leveldb/slice.h"
@@ -43,6 +44,13 @@ class Reader {
   Reader(SequentialFile* file, Reporter* reporter, bool checksum,
          uint64_t initial_offset);
 
+  // Like the constructor above, for reading the log file numbered
+  // "log_number".  Records in the recyclable format that were written
+  // under a different log number are left over from an earlier use of a
+  // recycled file and mark the end of the log.
+  Reader(SequentialFile* file, Reporter* reporter, bool checksum,
+         uint64_t initial_offset, uint64_t log_number);
+
   Reader(const Reader&) = delete;
   Reader& operator=(const Reader&) = delete;
 
@@ -69,7 +77,11 @@ class Reader {
     // * The record has an invalid CRC (ReadPhysicalRecord reports a drop)
     // * The record is a 0-length record (No drop is reported)
     // * The record is below constructor's initial_offset (No drop is reported)
-    kBadRecord = kMaxRecordType + 2
+    kBadRecord = kMaxRecordType + 2,
+    // Returned when a recycled log file runs into data from its previous
+    // use: a record for another log number, or an unreadable record after
+    // records in the recyclable format were seen.  Treated like kEof.
+    kOldRecord = kMaxRecordType + 3
   };
 
   // Skips all blocks that are completely before "initial_offset_".
@@ -77,8 +89,15 @@ class Reader {
   // Returns true on success. Handles reporting.
   bool SkipToInitialBlock();
 
-  // Return type, or one of the preceding special values
-  unsigned int ReadPhysicalRecord(Slice* result);
+  // Return type, or one of the preceding special values.  Stores the size
+  // of the record's header in *header_size.  kCompressedRecordFlag is left
+  // set in the returned type.
+  unsigned int ReadPhysicalRecord(Slice* result, int* header_size);
+
+  // Decompresses the payload of a compressed record into uncompressed_ and
+  // points *record at it.  Reports a corruption and returns false if the
+  // payload cannot be decompressed.
+  bool Uncompress(const Slice& input, Slice* record);
 
   // Reports dropped bytes to the reporter.
   // buffer_ must be updated to remove the dropped bytes prior to invocation.
@@ -104,6 +123,14 @@ class Reader {
   // particular, a run of kMiddleType and kLastType records can be silently
   // skipped in this mode
   bool resyncing_;
+
+  // Number of the log being read, or 0 if unknown.
+  uint64_t const log_number_;
+  // True once a record in the recyclable format has been read.
+  bool recycled_;
+
+  // Holds the last record returned by ReadRecord if it was compressed.
+  std::string uncompressed_;
 };
 
 }  // namespace log
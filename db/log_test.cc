@@ -6,6 +6,7 @@
 #include "db/log_reader.h"
 #include "db/log_writer.h"
 #include "leveldb/env.h"
+#include "port/port.h"
 #include "util/coding.h"
 #include "util/crc32c.h"
 #include "util/random.h"
@@ -31,6 +32,12 @@ static std::string NumberString(int n) {
   return std::string(buf);
 }
 
+static bool SnappyCompressionSupported() {
+  std::string out;
+  Slice in = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa";
+  return port::Snappy_Compress(in.data(), in.size(), &out);
+}
+
 // Return a skewed potentially long string
 static std::string RandomSkewedString(int i, Random* rnd) {
   return BigString(NumberString(i), rnd->Skewed(17));
@@ -51,9 +58,24 @@ class LogTest : public testing::Test {
 
   void ReopenForAppend() {
     delete writer_;
+    dest_.pos_ = dest_.contents_.size();
     writer_ = new Writer(&dest_, dest_.contents_.size());
   }
 
+  // Simulates reusing the log file as log number "log_number": writes
+  // overwrite the existing contents from the start and leave the rest in
+  // place.
+  void RecycleAs(uint64_t log_number) {
+    delete writer_;
+    delete reader_;
+    dest_.pos_ = 0;
+    writer_ = new Writer(&dest_, log_number, true /*recycle_log_files*/);
+    reader_ = new Reader(&source_, &report_, true /*checksum*/,
+                         0 /*initial_offset*/, log_number);
+  }
+
+  void CompressWith(CompressionType type) { writer_->SetCompression(type); }
+
   void Write(const std::string& msg) {
     ASSERT_TRUE(!reading_) << "Write() after starting to read";
     writer_->AddRecord(Slice(msg));
@@ -94,6 +116,12 @@ class LogTest : public testing::Test {
     EncodeFixed32(&dest_.contents_[header_offset], crc);
   }
 
+  // Length of the payload of the legacy record at "header_offset".
+  size_t RecordLength(int header_offset) const {
+    return (dest_.contents_[header_offset + 4] & 0xff) |
+           (dest_.contents_[header_offset + 5] & 0xff) << 8;
+  }
+
   void ForceError() { source_.force_error_ = true; }
 
   size_t DroppedBytes() const { return report_.dropped_bytes_; }
@@ -165,11 +193,17 @@ class LogTest : public testing::Test {
     Status Flush() override { return Status::OK(); }
     Status Sync() override { return Status::OK(); }
     Status Append(const Slice& slice) override {
-      contents_.append(slice.data(), slice.size());
+      if (pos_ > contents_.size()) {
+        pos_ = contents_.size();
+      }
+      contents_.replace(pos_, std::min(slice.size(), contents_.size() - pos_),
+                        slice.data(), slice.size());
+      pos_ += slice.size();
       return Status::OK();
     }
 
     std::string contents_;
+    size_t pos_ = 0;  // Offset of the next write; past the end appends
   };
 
   class StringSource : public SequentialFile {
@@ -514,6 +548,116 @@ TEST_F(LogTest, ErrorJoinsRecords) {
   ASSERT_GE(dropped, 2 * kBlockSize);
 }
 
+TEST_F(LogTest, RecyclableReadWrite) {
+  RecycleAs(7);
+  Write("foo");
+  Write("");
+  Write(BigString("bar", 2 * kBlockSize));
+  // Leaves fewer than kRecyclableHeaderSize bytes in the block.
+  Write(BigString("baz", kBlockSize - 2 * kRecyclableHeaderSize - 5));
+  Write("xxxx");
+  ASSERT_EQ("foo", Read());
+  ASSERT_EQ("", Read());
+  ASSERT_EQ(BigString("bar", 2 * kBlockSize), Read());
+  ASSERT_EQ(BigString("baz", kBlockSize - 2 * kRecyclableHeaderSize - 5),
+            Read());
+  ASSERT_EQ("xxxx", Read());
+  ASSERT_EQ("EOF", Read());
+  ASSERT_EQ(0, DroppedBytes());
+}
+
+TEST_F(LogTest, RecycledLogIgnoresOldRecords) {
+  RecycleAs(7);
+  for (int i = 0; i < 1000; i++) {
+    Write(NumberString(i));
+  }
+  RecycleAs(8);
+  Write("foo");
+  Write("bar");
+  ASSERT_EQ("foo", Read());
+  ASSERT_EQ("bar", Read());
+  ASSERT_EQ("EOF", Read());
+  ASSERT_EQ(0, DroppedBytes());
+}
+
+TEST_F(LogTest, RecycledLogIgnoresOldFragments) {
+  RecycleAs(7);
+  Write(BigString("old", 3 * kBlockSize));
+  RecycleAs(8);
+  // Ends in the middle of the payload of the old record.
+  Write(BigString("new", kBlockSize / 2));
+  ASSERT_EQ(BigString("new", kBlockSize / 2), Read());
+  ASSERT_EQ("EOF", Read());
+  ASSERT_EQ(0, DroppedBytes());
+}
+
+TEST_F(LogTest, RecycledLogIgnoresLegacyRecords) {
+  for (int i = 0; i < 1000; i++) {
+    Write(NumberString(i));
+  }
+  RecycleAs(8);
+  Write("foo");
+  ASSERT_EQ("foo", Read());
+  ASSERT_EQ("EOF", Read());
+  ASSERT_EQ(0, DroppedBytes());
+}
+
+TEST_F(LogTest, CompressedReadWrite) {
+  // Without Snappy the writer falls back to uncompressed records.
+  CompressWith(kSnappyCompression);
+  Random rnd(301);
+  std::string incompressible;
+  for (int i = 0; i < 1000; i++) {
+    incompressible.push_back(static_cast<char>(rnd.Uniform(256)));
+  }
+  Write("foo");
+  Write("");
+  Write(BigString("bar", 3 * kBlockSize));
+  Write(incompressible);
+  Write(BigString("baz", 1000));
+  ASSERT_EQ("foo", Read());
+  ASSERT_EQ("", Read());
+  ASSERT_EQ(BigString("bar", 3 * kBlockSize), Read());
+  ASSERT_EQ(incompressible, Read());
+  ASSERT_EQ(BigString("baz", 1000), Read());
+  ASSERT_EQ("EOF", Read());
+  ASSERT_EQ(0, DroppedBytes());
+  if (SnappyCompressionSupported()) {
+    ASSERT_LT(WrittenBytes(), kBlockSize);
+  }
+}
+
+TEST_F(LogTest, CompressedRecyclableReadWrite) {
+  RecycleAs(7);
+  CompressWith(kSnappyCompression);
+  for (int i = 0; i < 100; i++) {
+    Write(BigString(NumberString(i), 10000));
+  }
+  for (int i = 0; i < 100; i++) {
+    ASSERT_EQ(BigString(NumberString(i), 10000), Read());
+  }
+  ASSERT_EQ("EOF", Read());
+  ASSERT_EQ(0, DroppedBytes());
+}
+
+TEST_F(LogTest, CorruptedCompressedRecord) {
+  if (!SnappyCompressionSupported()) {
+    std::fprintf(stderr, "skipping compression tests\n");
+    return;
+  }
+  CompressWith(kSnappyCompression);
+  Write(BigString("foo", 1000));
+  Write(BigString("bar", 1000));
+  const size_t first_length = RecordLength(0);
+  // Damage the compression type byte that starts the payload.
+  SetByte(kHeaderSize, 100);
+  FixChecksum(0, first_length);
+  ASSERT_EQ(BigString("bar", 1000), Read());
+  ASSERT_EQ("EOF", Read());
+  ASSERT_EQ(first_length, DroppedBytes());
+  ASSERT_EQ("OK", MatchError("unknown record compression type"));
+}
+
 TEST_F(LogTest, ReadStart) { CheckInitialOffsetRecord(0, 0); }
 
 TEST_F(LogTest, ReadSecondOneOff) { CheckInitialOffsetRecord(1, 1); }
@@ -7,7 +7,10 @@
 
 #include <cstdint>
 
+#include <string>
+
 #include "db/log_format.h"
+#include "leveldb/options.h"
 #include "leveldb/slice.h"
 #include "leveldb/status.h"
 
@@ -29,11 +32,23 @@ class Writer {
   // "*dest" must remain live while this Writer is in use.
   Writer(WritableFile* dest, uint64_t dest_length);
 
+  // Create a writer that will write data to "*dest" from its beginning.
+  // If "recycle_log_files" is true, records use the recyclable format,
+  // which tags each of them with the low 32 bits of "log_number" so that a
+  // Reader can ignore whatever a previous use of the file left behind.
+  // "*dest" must remain live while this Writer is in use.
+  Writer(WritableFile* dest, uint64_t log_number, bool recycle_log_files);
+
   Writer(const Writer&) = delete;
   Writer& operator=(const Writer&) = delete;
 
   ~Writer();
 
+  // Compress the payload of subsequent records with "type".  A record is
+  // stored uncompressed when compression is unavailable or does not save
+  // at least 12.5% of its size.
+  void SetCompression(CompressionType type) { compression_ = type; }
+
   Status AddRecord(const Slice& slice);
 
  private:
@@ -41,11 +56,15 @@ class Writer {
 
   WritableFile* dest_;
   int block_offset_;  // Current offset in block
+  const uint64_t log_number_;
+  const bool recycle_log_files_;
+  CompressionType compression_;
+  std::string compressed_;  // Scratch space for compressed payloads
 
   // crc32c values for all supported record types.  These are
   // pre-computed to reduce the overhead of computing the crc of the
   // record type stored in the header.
-  uint32_t type_crc_[kMaxRecordType + 1];
+  uint32_t type_crc_[kMaxFlaggedRecordType + 1];
 };
 
 }  // namespace log
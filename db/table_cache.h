@@ -31,20 +31,44 @@ class TableCache {
   // underlies the returned iterator.  The returned "*tableptr" object is owned
   // by the cache and should not be deleted, and is valid for as long as the
   // returned iterator is live.
+  //
+  // "level" is the level of the file in the current version, or -1 if not
+  // known.  Level-0 tables may pin their index and filter blocks (see
+  // Options::pin_l0_filter_and_index_blocks_in_cache).
   Iterator* NewIterator(const ReadOptions& options, uint64_t file_number,
-                        uint64_t file_size, Table** tableptr = nullptr);
+                        uint64_t file_size, Table** tableptr = nullptr,
+                        int level = -1);
 
   // If a seek to internal key "k" in specified file finds an entry,
-  // call (*handle_result)(arg, found_key, found_value).
+  // call (*handle_result)(arg, found_key, found_value).  "level" is as
+  // for NewIterator().
   Status Get(const ReadOptions& options, uint64_t file_number,
              uint64_t file_size, const Slice& k, void* arg,
-             void (*handle_result)(void*, const Slice&, const Slice&));
+             void (*handle_result)(void*, const Slice&, const Slice&),
+             int level = -1);
+
+  // Like Get() for the "n" sorted internal keys in keys[0,n-1].  Results
+  // for keys[i] are passed to (*handle_result)(args[i], ...).
+  Status MultiGet(const ReadOptions& options, uint64_t file_number,
+                  uint64_t file_size, int n, const Slice* keys, void** args,
+                  void (*handle_result)(void*, const Slice&, const Slice&),
+                  int level = -1);
+
+  // Returns false if the filters of the specified file show that no key at
+  // or after internal key "k" shares its prefix.  See Table::PrefixMayMatch.
+  bool PrefixMayMatch(uint64_t file_number, uint64_t file_size,
+                      const Slice& k);
 
   // Evict any entry for the specified file number
   void Evict(uint64_t file_number);
 
  private:
-  Status FindTable(uint64_t file_number, uint64_t file_size, Cache::Handle**);
+  Status FindTable(uint64_t file_number, uint64_t file_size, Cache::Handle**,
+                   int level = -1);
+
+  // Opens the table file "fname" for reading, with O_DIRECT if
+  // Options::use_direct_reads is set.
+  Status OpenTableFile(const std::string& fname, RandomAccessFile** file);
 
   Env* const env_;
   const std::string dbname_;
@@ -17,8 +17,10 @@ static Slice GetLengthPrefixedSlice(const char* data) {
   return Slice(p, len);
 }
 
-TQMemTable::TQMemTable(const InternalKeyComparator& comparator, const size_t& write_buffer_size)
-    : comparator_(comparator), refs_(0), tqtable_(comparator_, &arena_, write_buffer_size) {}
+TQMemTable::TQMemTable(const InternalKeyComparator& comparator, const size_t& write_buffer_size,
+                       size_t huge_page_size)
+    : comparator_(comparator), refs_(0), arena_(huge_page_size),
+      tqtable_(comparator_, &arena_, write_buffer_size) {}
 
 TQMemTable::~TQMemTable() { assert(refs_ == 0); }
 
@@ -106,7 +108,7 @@ void TQMemTable::Substitute(TQMemTableIterator* iter) {
 
 //最后插入到TwoQueueSkipList中
 void TQMemTable::Add(SequenceNumber s, ValueType type, const Slice& key,
-                            const Slice& value) {
+                            const Slice& value, bool sequential_hint) {
   size_t key_size = key.size();
   size_t val_size = value.size();
   size_t internal_key_size = key_size + 8;
@@ -122,7 +124,7 @@ void TQMemTable::Add(SequenceNumber s, ValueType type, const Slice& key,
   p = EncodeVarint32(p, val_size);
   std::memcpy(p, value.data(), val_size);
   assert(p + val_size == buf + encoded_len);
-  tqtable_.Insert(buf, encoded_len);                         
+  tqtable_.Insert(buf, encoded_len, sequential_hint);
 }
 
 bool TQMemTable::Get(const LookupKey& key, std::string* value, Status* s) {
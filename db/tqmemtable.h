@@ -6,7 +6,7 @@
 #include "db/dbformat.h"
 #include "db/twoqueueskiplist.h"
 #include "leveldb/db.h"
-#include "util/arena.h"
+#include "util/concurrent_arena.h"
 
 namespace leveldb
 {
@@ -18,7 +18,9 @@ class TQMemTable {
 
 public:
   //使用2Q跳表的MemTable
-  TQMemTable(const InternalKeyComparator& comparator, const size_t& write_buffer_size);
+  //huge_page_size非0时用大页分配内存，见Options::memtable_huge_page_size
+  TQMemTable(const InternalKeyComparator& comparator, const size_t& write_buffer_size,
+             size_t huge_page_size = 0);
 
   TQMemTable(const TQMemTable&) = delete;
   TQMemTable& operator=(const TQMemTable&) = delete;
@@ -52,8 +54,9 @@ public:
   TQMemTableIterator* GetTQMemTableIterator();
 
   //将一个entry添加到memtable的TwoQueueSkipList中，功能同Add()
+  //sequential_hint见Twoqueue_SkipList::Insert()
   void Add(SequenceNumber seq, ValueType type, const Slice& key,
-                    const Slice& value);
+                    const Slice& value, bool sequential_hint = false);
 
   bool Get(const LookupKey& key, std::string* value, Status* s);
 
@@ -74,7 +77,8 @@ private:
 
   KeyComparator comparator_;
   int refs_;
-  Arena arena_;
+  //可供多线程同时分配的arena
+  ConcurrentArena arena_;
 
   //2Q跳表
   TQTable tqtable_;
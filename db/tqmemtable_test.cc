@@ -0,0 +1,93 @@
+// Copyright (c) 2026 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "db/tqmemtable.h"
+
+#include <cstdio>
+#include <map>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "db/dbformat.h"
+#include "leveldb/comparator.h"
+#include "leveldb/iterator.h"
+#include "util/random.h"
+
+namespace leveldb {
+
+static std::string Key(int i) {
+  char buf[20];
+  std::snprintf(buf, sizeof(buf), "key%08d", i);
+  return std::string(buf);
+}
+
+class TQMemTableTest : public testing::Test {
+ public:
+  TQMemTableTest() : icmp_(BytewiseComparator()) {}
+
+  TQMemTable* NewMemTable() {
+    TQMemTable* mem = new TQMemTable(icmp_, 4 << 20);
+    mem->Ref();
+    return mem;
+  }
+
+  // Returns the memtable's contents as "user_key@seq=value" lines.
+  static std::string Contents(TQMemTable* mem) {
+    std::string result;
+    Iterator* iter = mem->NewIterator();
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      ParsedInternalKey ikey;
+      EXPECT_TRUE(ParseInternalKey(iter->key(), &ikey));
+      result += ikey.user_key.ToString() + "@" +
+                std::to_string(ikey.sequence) + "=" +
+                iter->value().ToString() + "\n";
+    }
+    delete iter;
+    return result;
+  }
+
+ private:
+  InternalKeyComparator icmp_;
+};
+
+TEST_F(TQMemTableTest, SequentialHint) {
+  TQMemTable* hinted = NewMemTable();
+  TQMemTable* plain = NewMemTable();
+  std::map<std::string, std::string> model;
+
+  // Mostly ascending runs, with jumps backwards and overwrites so that the
+  // hint is often wrong.
+  Random rnd(301);
+  SequenceNumber seq = 1;
+  int next = 0;
+  for (int i = 0; i < 20000; i++) {
+    if (rnd.OneIn(50)) {
+      next = rnd.Uniform(20000);
+    }
+    const std::string key = Key(next++);
+    const std::string value = "v" + std::to_string(i);
+    hinted->Add(seq, kTypeValue, key, value, true /*sequential_hint*/);
+    plain->Add(seq, kTypeValue, key, value);
+    model[key] = value;
+    seq++;
+  }
+
+  ASSERT_EQ(Contents(plain), Contents(hinted));
+  for (const auto& kv : model) {
+    std::string value;
+    Status s;
+    ASSERT_TRUE(hinted->Get(LookupKey(kv.first, seq), &value, &s));
+    ASSERT_EQ(kv.second, value);
+  }
+
+  hinted->Unref();
+  plain->Unref();
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
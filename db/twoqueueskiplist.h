@@ -13,7 +13,7 @@
 
 namespace leveldb
 {
-    class Arena;
+    class Allocator;
 
     template<typename Key, class Comparator>
     class Twoqueue_SkipList {
@@ -22,13 +22,16 @@ namespace leveldb
         struct Twoqueue_Node;//2qskiplist下的节点
         
     public:
-        explicit Twoqueue_SkipList(Comparator cmp, Arena* arena, const size_t& write_buffer_size);
+        explicit Twoqueue_SkipList(Comparator cmp, Allocator* arena, const size_t& write_buffer_size);
 
         Twoqueue_SkipList(const Twoqueue_SkipList&) = delete;
         Twoqueue_SkipList& operator=(const Twoqueue_SkipList&) = delete;
 
         //重定义insert()，在2qskiplist中插入2qNode
-        void Insert(const Key& key, const size_t& encoded_len);
+        //sequential_hint为true时说明key很可能紧跟在上一次插入的key之后，
+        //先尝试从缓存的splice_开始查找插入位置，顺序插入时只需O(1)的期望时间
+        void Insert(const Key& key, const size_t& encoded_len,
+                    bool sequential_hint = false);
         //Contains()函数没有变化
         bool Contains(const Key& key) const;
         
@@ -78,6 +81,9 @@ namespace leveldb
         Twoqueue_Node* FindGreaterOrEqual(const Key& key, Twoqueue_Node** prev) const;
         Twoqueue_Node* FindLessThan(const Key& key) const;
         Twoqueue_Node* FindLast() const;
+        //从splice_开始查找key的插入位置，结果同FindGreaterOrEqual(key, prev)
+        Twoqueue_Node* FindFromSplice(const Key& key, Twoqueue_Node** prev) const;
+
         //找到同一关键字最早的节点，若找不到则返回当前节点
         Twoqueue_Node* FindNoSmaller(Twoqueue_Node* node) const;
         //抽取存储在每个节点key中的Userkey
@@ -92,7 +98,7 @@ namespace leveldb
         Slice GetLengthPrefixedSlice(const char* data);
 
         Comparator const compare_;//同skiplist
-        Arena* const arena_;//同skiplist
+        Allocator* const arena_;//同skiplist
 
         Twoqueue_Node* const head_;
         Twoqueue_Node* normal_head_;//热数据区
@@ -103,6 +109,10 @@ namespace leveldb
         Twoqueue_Node* cur_cold_node_;//当前最新的冷数据
         Twoqueue_Node* cur_node_;//当前插入的最新数据
 
+        //上一次插入后各层中位于插入点之前的节点(splice)，
+        //低于新节点高度的层中即为新节点本身
+        Twoqueue_Node* splice_[kMaxHeight];
+
         std::atomic<int> max_height_;//同skiplist
         Random rnd_;//同skiplist
         size_t normal_area_size;//热数据区所占总空间
@@ -324,6 +334,46 @@ namespace leveldb
         }
     }
 
+    //splice_是上一次插入点在各层的前驱，高层的前驱不会位于低层的前驱之后。
+    //若key大于splice_[0]，找到最低的层l，使该层splice_[l]的后继不小于key，
+    //则l及以上各层的splice_都可直接作为prev；l以下各层从splice_出发向后查找。
+    //key小于上一次插入的key时退回到从head_开始的完整查找
+    template <typename Key, class Comparator>
+    typename Twoqueue_SkipList<Key, Comparator>::Twoqueue_Node*
+    Twoqueue_SkipList<Key, Comparator>::FindFromSplice(const Key& key, Twoqueue_Node** prev) const {
+        if (splice_[0] != head_ && !KeyIsAfterNode(key, splice_[0])) {
+            return FindGreaterOrEqual(key, prev);
+        }
+
+        const int max_height = GetMaxHeight();
+        int level = 0;
+        while (level < max_height && KeyIsAfterNode(key, splice_[level]->Next(level))) {
+            level++;
+        }
+        for (int i = level; i < max_height; i++) {
+            prev[i] = splice_[i];
+        }
+
+        //自level - 1层起逐层向下，每层从该层splice_与上一层结果中靠后的节点出发
+        Twoqueue_Node* x = (level < max_height) ? splice_[level] : head_;
+        Twoqueue_Node* next = nullptr;
+        for (int i = level - 1; i >= 0; i--) {
+            if (x == head_ || (splice_[i] != head_ && compare_(x->key, splice_[i]->key) < 0)) {
+                x = splice_[i];
+            }
+            next = x->Next(i);
+            while (KeyIsAfterNode(key, next)) {
+                x = next;
+                next = x->Next(i);
+            }
+            prev[i] = x;
+        }
+        if (level == 0) {
+            next = splice_[0]->Next(0);
+        }
+        return next;
+    }
+
     template <typename Key, class Comparator>
     typename Twoqueue_SkipList<Key, Comparator>::Twoqueue_Node*
     Twoqueue_SkipList<Key, Comparator>::FindLessThan(const Key& key) const {
@@ -392,7 +442,7 @@ namespace leveldb
     }
 
     template <typename Key, class Comparator>
-    Twoqueue_SkipList<Key, Comparator>::Twoqueue_SkipList(Comparator cmp, Arena* arena,
+    Twoqueue_SkipList<Key, Comparator>::Twoqueue_SkipList(Comparator cmp, Allocator* arena,
      const size_t& write_buffer_size) :
         compare_(cmp),
         arena_(arena),
@@ -410,14 +460,18 @@ namespace leveldb
         option_normal_size = factor * write_buffer_size;
         for (int i = 0; i < kMaxHeight; i++) {
             head_->SetNext(i, nullptr);
+            splice_[i] = head_;
         }
         normal_area_size += head_->GetSize();
     }
     
     template <typename Key, class Comparator>
-    void Twoqueue_SkipList<Key, Comparator>::Insert(const Key& key, const size_t& encoded_len) {
+    void Twoqueue_SkipList<Key, Comparator>::Insert(const Key& key, const size_t& encoded_len,
+                                                    bool sequential_hint) {
         Twoqueue_Node* prev[kMaxHeight];//存储要插入skiplist的节点的相邻的前一个节点
-        Twoqueue_Node* x = FindGreaterOrEqual(key, prev);//存储要插入skiplist的节点的相邻的后一个节点
+        //存储要插入skiplist的节点的相邻的后一个节点
+        Twoqueue_Node* x = sequential_hint ? FindFromSplice(key, prev)
+                                           : FindGreaterOrEqual(key, prev);
         bool is_new = false;
 
         //将节点插入2q链表中,比较新插入的节点的userkey和与它紧邻的后一userkey,
@@ -459,6 +513,14 @@ namespace leveldb
             prev[i]->SetNext(i, x);
         }
 
+        //记录本次插入的splice，供下一次顺序插入使用
+        for (int i = 0; i < height; i++) {
+            splice_[i] = x;
+        }
+        for (int i = height; i < GetMaxHeight(); i++) {
+            splice_[i] = prev[i];
+        }
+
         //插入2q链表，为cur_node_添加follow_和把x的precede_指向cur_node_
         cur_node_->SetFollow(x);
         x->SetPrecede(cur_node_);
@@ -487,6 +549,11 @@ namespace leveldb
         Twoqueue_Node* guard = normal_head_;
         Twoqueue_Node* iter_ = normal_head_;
         uint64_t guard_seq = GetSeqNumber(guard->key);
+
+        //最底层的链接会被改写，缓存的splice_不再可靠
+        for (int i = 0; i < kMaxHeight; i++) {
+            splice_[i] = head_;
+        }
         
         //首先确定head_是从冷数据区开始
         iter_ = head_->Next(0);
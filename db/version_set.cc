@@ -7,7 +7,9 @@
 #include <algorithm>
 #include <cstdio>
 #include <cmath>
+#include <utility>
 
+#include "db/compaction_pipeline.h"
 #include "db/filename.h"
 #include "db/log_reader.h"
 #include "db/log_writer.h"
@@ -19,6 +21,7 @@
 #include "table/two_level_iterator.h"
 #include "util/coding.h"
 #include "util/logging.h"
+#include "util/thread_pool.h"
 
 namespace leveldb {
 
@@ -39,6 +42,10 @@ static int64_t ExpandedCompactionByteSizeLimit(const Options* options) {
   return 25 * TargetFileSize(options);
 }
 
+// Size of the batches in which prefetched compaction inputs are handed to
+// the merge.
+static const size_t kPrefetchBatchBytes = 128 * 1024;
+
 static double MaxBytesForLevel(const Options* options, int level) {
   // Note: the result for level zero is not really used since we set
   // the level-0 compaction threshold based on number of files.
@@ -65,6 +72,30 @@ static int64_t TotalFileSize(const std::vector<FileMetaData*>& files) {
   return sum;
 }
 
+// Like TotalFileSize(), but leaves out the files that are being compacted.
+// Stores their number in *count.
+static int64_t CompactableFileSize(const std::vector<FileMetaData*>& files,
+                                   int* count) {
+  int64_t sum = 0;
+  *count = 0;
+  for (size_t i = 0; i < files.size(); i++) {
+    if (!files[i]->being_compacted) {
+      sum += files[i]->file_size;
+      (*count)++;
+    }
+  }
+  return sum;
+}
+
+static bool AnyBeingCompacted(const std::vector<FileMetaData*>& files) {
+  for (size_t i = 0; i < files.size(); i++) {
+    if (files[i]->being_compacted) {
+      return true;
+    }
+  }
+  return false;
+}
+
 Version::~Version() {
   assert(refs_ == 0);
 
@@ -220,19 +251,67 @@ static Iterator* GetFileIterator(void* arg, const ReadOptions& options,
   }
 }
 
+namespace {
+
+struct LevelPrefixState {
+  TableCache* table_cache;
+  const InternalKeyComparator* icmp;
+  const std::vector<FileMetaData*>* files;
+};
+
+// The first key at or after "key" in a sorted level is in the one file
+// that a seek to "key" lands in, so that file's filters decide for the
+// whole level.
+bool LevelPrefixMayMatch(void* arg, const Slice& key) {
+  LevelPrefixState* state = reinterpret_cast<LevelPrefixState*>(arg);
+  const int index = FindFile(*state->icmp, *state->files, key);
+  if (index >= static_cast<int>(state->files->size())) {
+    return false;
+  }
+  const FileMetaData* f = (*state->files)[index];
+  return state->table_cache->PrefixMayMatch(f->number, f->file_size, key);
+}
+
+void DeleteLevelPrefixState(void* arg1, void* arg2) {
+  delete reinterpret_cast<LevelPrefixState*>(arg1);
+}
+
+}  // namespace
+
 Iterator* Version::NewConcatenatingIterator(const ReadOptions& options,
                                             int level) const {
-  return NewTwoLevelIterator(
-      new LevelFileNumIterator(vset_->icmp_, &files_[level]), &GetFileIterator,
-      vset_->table_cache_, options);
+  Iterator* file_iter = new LevelFileNumIterator(vset_->icmp_, &files_[level]);
+  if (options.iterate_upper_bound != nullptr) {
+    file_iter = NewUpperBoundIndexIterator(file_iter, &vset_->icmp_,
+                                           *options.iterate_upper_bound);
+  }
+  Iterator* iter = NewTwoLevelIterator(file_iter, &GetFileIterator,
+                                       vset_->table_cache_, options);
+  if (options.prefix_same_as_start &&
+      vset_->options_->prefix_extractor != nullptr) {
+    // Otherwise a seek that the landing file's filters rule out would go
+    // on to read the first block of the next file.
+    LevelPrefixState* state = new LevelPrefixState;
+    state->table_cache = vset_->table_cache_;
+    state->icmp = &vset_->icmp_;
+    state->files = &files_[level];
+    iter = NewPrefixSeekIterator(iter, &LevelPrefixMayMatch, state);
+    iter->RegisterCleanup(&DeleteLevelPrefixState, state, nullptr);
+  }
+  return iter;
 }
 
 void Version::AddIterators(const ReadOptions& options,
                            std::vector<Iterator*>* iters) {
   // Merge all level zero files together since they may overlap
   for (size_t i = 0; i < files_[0].size(); i++) {
+    if (options.iterate_upper_bound != nullptr &&
+        vset_->icmp_.Compare(files_[0][i]->smallest.Encode(),
+                             *options.iterate_upper_bound) >= 0) {
+      continue;
+    }
     iters->push_back(vset_->table_cache_->NewIterator(
-        options, files_[0][i]->number, files_[0][i]->file_size));
+        options, files_[0][i]->number, files_[0][i]->file_size, nullptr, 0));
   }
 
   // For levels > 0, we can use a concatenating iterator that sequentially
@@ -279,26 +358,31 @@ static bool NewestFirst(FileMetaData* a, FileMetaData* b) {
   return a->number > b->number;
 }
 
-void Version::ForEachOverlapping(Slice user_key, Slice internal_key, void* arg,
-                                 bool (*func)(void*, int, FileMetaData*)) {
+void Version::OverlappingLevel0Files(Slice user_key,
+                                     std::vector<FileMetaData*>* files) const {
   const Comparator* ucmp = vset_->icmp_.user_comparator();
-
-  // Search level-0 in order from newest to oldest.
-  std::vector<FileMetaData*> tmp;
-  tmp.reserve(files_[0].size());
+  files->clear();
+  files->reserve(files_[0].size());
   for (uint32_t i = 0; i < files_[0].size(); i++) {
     FileMetaData* f = files_[0][i];
     if (ucmp->Compare(user_key, f->smallest.user_key()) >= 0 &&
         ucmp->Compare(user_key, f->largest.user_key()) <= 0) {
-      tmp.push_back(f);
+      files->push_back(f);
     }
   }
-  if (!tmp.empty()) {
-    std::sort(tmp.begin(), tmp.end(), NewestFirst);
-    for (uint32_t i = 0; i < tmp.size(); i++) {
-      if (!(*func)(arg, 0, tmp[i])) {
-        return;
-      }
+  std::sort(files->begin(), files->end(), NewestFirst);
+}
+
+void Version::ForEachOverlapping(Slice user_key, Slice internal_key, void* arg,
+                                 bool (*func)(void*, int, FileMetaData*)) {
+  const Comparator* ucmp = vset_->icmp_.user_comparator();
+
+  // Search level-0 in order from newest to oldest.
+  std::vector<FileMetaData*> tmp;
+  OverlappingLevel0Files(user_key, &tmp);
+  for (uint32_t i = 0; i < tmp.size(); i++) {
+    if (!(*func)(arg, 0, tmp[i])) {
+      return;
     }
   }
 
@@ -322,6 +406,92 @@ void Version::ForEachOverlapping(Slice user_key, Slice internal_key, void* arg,
   }
 }
 
+namespace {
+
+// A lookup in one level-0 file, run by GetFromLevel0InParallel().
+struct Level0Probe {
+  TableCache* table_cache;
+  const ReadOptions* options;
+  FileMetaData* file;
+  Slice ikey;
+  Saver saver;
+  std::string value;
+  Status status;
+  CountDownLatch* done;  // Null for the probe run by the reading thread
+};
+
+void RunLevel0Probe(void* arg) {
+  Level0Probe* probe = reinterpret_cast<Level0Probe*>(arg);
+  probe->status = probe->table_cache->Get(
+      *probe->options, probe->file->number, probe->file->file_size,
+      probe->ikey, &probe->saver, SaveValue, 0);
+  if (probe->done != nullptr) {
+    probe->done->CountDown();
+  }
+}
+
+}  // namespace
+
+bool Version::GetFromLevel0InParallel(const ReadOptions& options,
+                                      const LookupKey& k,
+                                      const std::vector<FileMetaData*>& files,
+                                      std::string* value, GetStats* stats,
+                                      Status* s) {
+  const size_t n = files.size();
+  std::vector<Level0Probe> probes(n);
+  CountDownLatch done(static_cast<int>(n - 1));
+  for (size_t i = 0; i < n; i++) {
+    Level0Probe* probe = &probes[i];
+    probe->table_cache = vset_->table_cache_;
+    probe->options = &options;
+    probe->file = files[i];
+    probe->ikey = k.internal_key();
+    probe->saver.state = kNotFound;
+    probe->saver.ucmp = vset_->icmp_.user_comparator();
+    probe->saver.user_key = k.user_key();
+    probe->saver.value = &probe->value;
+    probe->done = (i == 0) ? nullptr : &done;
+    if (i > 0) {
+      vset_->level0_read_pool_->Schedule(&RunLevel0Probe, probe);
+    }
+  }
+  // The newest file is the most likely to decide the lookup; probe it here
+  // while the pool handles the others.
+  RunLevel0Probe(&probes[0]);
+  done.Wait();
+
+  // Newer level-0 files hold newer entries, so the newest file with an
+  // answer decides.
+  for (size_t i = 0; i < n; i++) {
+    Level0Probe* probe = &probes[i];
+    if (i == 1) {
+      // The sequential search would have seeked more than once.  Charge
+      // the first file the same way.
+      stats->seek_file = files[0];
+      stats->seek_file_level = 0;
+    }
+    if (!probe->status.ok()) {
+      *s = probe->status;
+      return true;
+    }
+    switch (probe->saver.state) {
+      case kNotFound:
+        break;  // Try the next older file
+      case kFound:
+        value->swap(probe->value);
+        *s = Status::OK();
+        return true;
+      case kDeleted:
+        *s = Status::NotFound(Slice());
+        return true;
+      case kCorrupt:
+        *s = Status::Corruption("corrupted key for ", probe->saver.user_key);
+        return true;
+    }
+  }
+  return false;
+}
+
 Status Version::Get(const ReadOptions& options, const LookupKey& k,
                     std::string* value, GetStats* stats) {
   stats->seek_file = nullptr;
@@ -338,9 +508,13 @@ Status Version::Get(const ReadOptions& options, const LookupKey& k,
     VersionSet* vset;
     Status s;
     bool found;
+    bool skip_level0;  // Level-0 was already searched in parallel
 
     static bool Match(void* arg, int level, FileMetaData* f) {
       State* state = reinterpret_cast<State*>(arg);
+      if (level == 0 && state->skip_level0) {
+        return true;
+      }
 
       if (state->stats->seek_file == nullptr &&
           state->last_file_read != nullptr) {
@@ -352,9 +526,9 @@ Status Version::Get(const ReadOptions& options, const LookupKey& k,
       state->last_file_read = f;
       state->last_file_read_level = level;
 
-      state->s = state->vset->table_cache_->Get(*state->options, f->number,
-                                                f->file_size, state->ikey,
-                                                &state->saver, SaveValue);
+      state->s = state->vset->table_cache_->Get(
+          *state->options, f->number, f->file_size, state->ikey, &state->saver,
+          SaveValue, level);
       if (!state->s.ok()) {
         state->found = true;
         return false;
@@ -394,12 +568,166 @@ Status Version::Get(const ReadOptions& options, const LookupKey& k,
   state.saver.ucmp = vset_->icmp_.user_comparator();
   state.saver.user_key = k.user_key();
   state.saver.value = value;
+  state.skip_level0 = false;
+
+  if (vset_->level0_read_pool_ != nullptr && files_[0].size() > 1) {
+    std::vector<FileMetaData*> level0;
+    OverlappingLevel0Files(k.user_key(), &level0);
+    if (level0.size() > 1) {
+      Status s;
+      if (GetFromLevel0InParallel(options, k, level0, value, stats, &s)) {
+        return s;
+      }
+      state.skip_level0 = true;
+      state.last_file_read = level0.back();
+      state.last_file_read_level = 0;
+    }
+  }
 
   ForEachOverlapping(state.saver.user_key, state.ikey, &state, &State::Match);
 
   return state.found ? state.s : Status::NotFound(Slice());
 }
 
+void Version::MultiGet(const ReadOptions& options, int n,
+                       const LookupKey* const* keys,
+                       std::string* const* values, Status* const* statuses,
+                       GetStats* stats) {
+  stats->seek_file = nullptr;
+  stats->seek_file_level = -1;
+
+  const Comparator* ucmp = vset_->icmp_.user_comparator();
+  std::vector<Saver> savers(n);
+  // The last file each key was looked up in, for seek charging.
+  std::vector<FileMetaData*> last_file_read(n, nullptr);
+  std::vector<int> last_file_read_level(n, -1);
+  // Keys not yet resolved, in key order.
+  std::vector<int> pending;
+  pending.reserve(n);
+  for (int i = 0; i < n; i++) {
+    savers[i].state = kNotFound;
+    savers[i].ucmp = ucmp;
+    savers[i].user_key = keys[i]->user_key();
+    savers[i].value = values[i];
+    *statuses[i] = Status::NotFound(Slice());
+    pending.push_back(i);
+  }
+
+  std::vector<bool> done(n, false);
+  std::vector<Slice> batch_keys;
+  std::vector<void*> batch_args;
+  // Looks up the keys pending[begin,end) in "f" and marks the ones that
+  // were resolved.
+  auto probe = [&](int level, FileMetaData* f, size_t begin, size_t end) {
+    batch_keys.clear();
+    batch_args.clear();
+    for (size_t j = begin; j < end; j++) {
+      const int i = pending[j];
+      if (stats->seek_file == nullptr && last_file_read[i] != nullptr) {
+        // Some key needed more than one seek.  Charge its first file.
+        stats->seek_file = last_file_read[i];
+        stats->seek_file_level = last_file_read_level[i];
+      }
+      last_file_read[i] = f;
+      last_file_read_level[i] = level;
+      batch_keys.push_back(keys[i]->internal_key());
+      batch_args.push_back(&savers[i]);
+    }
+    Status s = vset_->table_cache_->MultiGet(
+        options, f->number, f->file_size, static_cast<int>(batch_keys.size()),
+        batch_keys.data(), batch_args.data(), SaveValue, level);
+    for (size_t j = begin; j < end; j++) {
+      const int i = pending[j];
+      if (!s.ok()) {
+        *statuses[i] = s;
+        done[i] = true;
+        continue;
+      }
+      switch (savers[i].state) {
+        case kNotFound:
+          break;  // Keep searching in other files
+        case kFound:
+          *statuses[i] = Status::OK();
+          done[i] = true;
+          break;
+        case kDeleted:
+          done[i] = true;
+          break;
+        case kCorrupt:
+          *statuses[i] =
+              Status::Corruption("corrupted key for ", savers[i].user_key);
+          done[i] = true;
+          break;
+      }
+    }
+  };
+  auto drop_done = [&]() {
+    size_t kept = 0;
+    for (size_t j = 0; j < pending.size(); j++) {
+      if (!done[pending[j]]) pending[kept++] = pending[j];
+    }
+    pending.resize(kept);
+  };
+
+  // Search level-0 in order from newest to oldest, each file once for all
+  // the keys inside its range.
+  std::vector<FileMetaData*> tmp(files_[0]);
+  std::sort(tmp.begin(), tmp.end(), NewestFirst);
+  for (size_t k = 0; k < tmp.size() && !pending.empty(); k++) {
+    // Keys are sorted, so the ones in range form one run.
+    size_t begin = 0;
+    while (begin < pending.size() &&
+           ucmp->Compare(savers[pending[begin]].user_key,
+                         tmp[k]->smallest.user_key()) < 0) {
+      begin++;
+    }
+    size_t end = begin;
+    while (end < pending.size() &&
+           ucmp->Compare(savers[pending[end]].user_key,
+                         tmp[k]->largest.user_key()) <= 0) {
+      end++;
+    }
+    if (begin < end) {
+      probe(0, tmp[k], begin, end);
+      drop_done();
+    }
+  }
+
+  // Search other levels, grouping the keys that fall in the same file.
+  for (int level = 1; level < config::kNumLevels && !pending.empty();
+       level++) {
+    const std::vector<FileMetaData*>& files = files_[level];
+    if (files.empty()) continue;
+
+    size_t j = 0;
+    while (j < pending.size()) {
+      uint32_t index =
+          FindFile(vset_->icmp_, files, keys[pending[j]]->internal_key());
+      if (index >= files.size()) {
+        break;  // This key and all later ones are past the last file
+      }
+      FileMetaData* f = files[index];
+      size_t begin = j;
+      while (begin < pending.size() &&
+             ucmp->Compare(savers[pending[begin]].user_key,
+                           f->smallest.user_key()) < 0) {
+        begin++;  // Before "f" and after the previous file
+      }
+      size_t end = begin;
+      while (end < pending.size() &&
+             vset_->icmp_.Compare(keys[pending[end]]->internal_key(),
+                                  f->largest.Encode()) <= 0) {
+        end++;
+      }
+      if (begin < end) {
+        probe(level, f, begin, end);
+      }
+      j = (end > j) ? end : j + 1;
+    }
+    drop_done();
+  }
+}
+
 bool Version::UpdateStats(const GetStats& stats) {
   FileMetaData* f = stats.seek_file;
   if (f != nullptr) {
@@ -481,6 +809,12 @@ int Version::PickLevelForMemTableOutput(const Slice& smallest_user_key,
       if (OverlapInLevel(level + 1, &smallest_user_key, &largest_user_key)) {
         break;
       }
+      // A running compaction out of "level" or "level + 1" may add files
+      // to "level + 1" that this version does not show yet.
+      if (AnyBeingCompacted(files_[level]) ||
+          AnyBeingCompacted(files_[level + 1])) {
+        break;
+      }
       if (level + 2 < config::kNumLevels) {
         // Check that file does not overlap too many grandparent bytes.
         GetOverlappingInputs(level + 2, &start, &limit, &overlaps);
@@ -739,6 +1073,10 @@ VersionSet::VersionSet(const std::string& dbname, const Options* options,
       options_(options),
       table_cache_(table_cache),
       icmp_(*cmp),
+      level0_read_pool_(options->level0_read_threads > 0
+                            ? new ThreadPool(options->env,
+                                             options->level0_read_threads)
+                            : nullptr),
       next_file_number_(2),
       manifest_file_number_(0),  // Filled by Recover()
       last_sequence_(0),
@@ -756,6 +1094,7 @@ VersionSet::~VersionSet() {
   assert(dummy_versions_.next_ == &dummy_versions_);  // List must be empty
   delete descriptor_log_;
   delete descriptor_file_;
+  delete level0_read_pool_;
 }
 
 void VersionSet::AppendVersion(Version* v) {
@@ -788,7 +1127,7 @@ Status VersionSet::LogAndApply(VersionEdit* edit, port::Mutex* mu) {
   }
 
   edit->SetNextFile(next_file_number_);
-  edit->SetLastSequence(last_sequence_);
+  edit->SetLastSequence(LastSequence());
 
   Version* v = new Version(this);
   {
@@ -796,7 +1135,6 @@ Status VersionSet::LogAndApply(VersionEdit* edit, port::Mutex* mu) {
     builder.Apply(edit);
     builder.SaveTo(v);
   }
-  Finalize(v);
 
   // Initialize new descriptor log file if necessary by creating
   // a temporary file that contains a snapshot of the current version.
@@ -843,6 +1181,9 @@ Status VersionSet::LogAndApply(VersionEdit* edit, port::Mutex* mu) {
 
   // Install the new version
   if (s.ok()) {
+    // Scored only now, since other compactions may have been picked or
+    // finished while *mu was unlocked.
+    Finalize(v);
     AppendVersion(v);
     log_number_ = edit->log_number_;
     prev_log_number_ = edit->prev_log_number_;
@@ -974,7 +1315,7 @@ Status VersionSet::Recover(bool* save_manifest) {
     AppendVersion(v);
     manifest_file_number_ = next_file;
     next_file_number_ = next_file + 1;
-    last_sequence_ = last_sequence;
+    SetLastSequence(last_sequence);
     log_number_ = log_number;
     prev_log_number_ = prev_log_number;
 
@@ -1031,10 +1372,11 @@ void VersionSet::MarkFileNumberUsed(uint64_t number) {
 }
 
 void VersionSet::Finalize(Version* v) {
-  // Precomputed best level for next compaction
-  int best_level = -1;
-  double best_score = -1;
-
+  // Files that are being compacted do not count towards the scores, so
+  // that the next compaction picked has work to do elsewhere.  They do
+  // count towards the pending compaction bytes, which would otherwise drop
+  // as soon as a compaction starts.
+  uint64_t pending_bytes = 0;
   for (int level = 0; level < config::kNumLevels - 1; level++) {
     double score;
     if (level == 0) {
@@ -1051,10 +1393,12 @@ void VersionSet::Finalize(Version* v) {
       // overwrites/deletions).
 
       //修改L0层打分函数，既根据文件个数又根据所用空间计算
-      const uint64_t level_bytes = TotalFileSize(v->files_[level]);
+      int num_files;
+      const uint64_t level_bytes =
+          CompactableFileSize(v->files_[level], &num_files);
 
       //文件个数得分
-      double number_score = pow(v->files_[level].size() / 
+      double number_score = pow(num_files / 
         static_cast<double>(config::kL0_CompactionTrigger), 2) / 2;
 
       //空间得分
@@ -1062,21 +1406,35 @@ void VersionSet::Finalize(Version* v) {
         MaxBytesForLevel(options_, level);
 
       score = number_score >= size_score ? number_score : size_score;
+      if (static_cast<int>(v->files_[level].size()) >=
+          config::kL0_CompactionTrigger) {
+        pending_bytes += TotalFileSize(v->files_[level]);
+      }
     } else {
       // Compute the ratio of current size to size limit.
-      const uint64_t level_bytes = TotalFileSize(v->files_[level]);
-      score =
-          static_cast<double>(level_bytes) / MaxBytesForLevel(options_, level);
+      int num_files;
+      const uint64_t level_bytes =
+          CompactableFileSize(v->files_[level], &num_files);
+      const double max_bytes = MaxBytesForLevel(options_, level);
+      score = static_cast<double>(level_bytes) / max_bytes;
+      const int64_t total_bytes = TotalFileSize(v->files_[level]);
+      if (total_bytes > max_bytes) {
+        pending_bytes += static_cast<uint64_t>(total_bytes - max_bytes);
+      }
     }
 
-    if (score > best_score) {
-      best_level = level;
-      best_score = score;
-    }
+    v->level_scores_[level] = score;
+    v->levels_by_score_[level] = level;
   }
 
-  v->compaction_level_ = best_level;
-  v->compaction_score_ = best_score;
+  // Precomputed best level for next compaction
+  const double* scores = v->level_scores_;
+  std::stable_sort(v->levels_by_score_,
+                   v->levels_by_score_ + config::kNumLevels - 1,
+                   [scores](int a, int b) { return scores[a] > scores[b]; });
+  v->compaction_level_ = v->levels_by_score_[0];
+  v->compaction_score_ = scores[v->compaction_level_];
+  v->pending_compaction_bytes_ = pending_bytes;
 }
 
 Status VersionSet::WriteSnapshot(log::Writer* log) {
@@ -1229,7 +1587,8 @@ void VersionSet::GetRange2(const std::vector<FileMetaData*>& inputs1,
   GetRange(all, smallest, largest);
 }
 
-Iterator* VersionSet::MakeInputIterator(Compaction* c) {
+Iterator* VersionSet::MakeInputIterator(Compaction* c, bool prefetch,
+                                        const InternalKey* limit) {
   ReadOptions options;
   options.verify_checksums = options_->paranoid_checks;
   options.fill_cache = false;
@@ -1257,51 +1616,151 @@ Iterator* VersionSet::MakeInputIterator(Compaction* c) {
     }
   }
   assert(num <= space);
+  if (prefetch) {
+    Slice limit_key;
+    if (limit != nullptr) {
+      limit_key = limit->Encode();
+    }
+    for (int i = 0; i < num; i++) {
+      list[i] = NewPrefetchingIterator(env_, list[i], &icmp_,
+                                       limit != nullptr ? &limit_key : nullptr,
+                                       kPrefetchBatchBytes);
+    }
+  }
   Iterator* result = NewMergingIterator(&icmp_, list, num);
   delete[] list;
   return result;
 }
 
-Compaction* VersionSet::PickCompaction() {
-  Compaction* c;
-  int level;
+void VersionSet::GetSubcompactionBoundaries(
+    Compaction* c, int max, std::vector<std::string>* boundaries) {
+  boundaries->clear();
+  if (max <= 1 || c->num_input_files(0) + c->num_input_files(1) < 2) {
+    return;
+  }
+  const Comparator* user_cmp = icmp_.user_comparator();
 
-  // We prefer compactions triggered by too much data in a level over
-  // the compactions triggered by seeks.
-  const bool size_compaction = (current_->compaction_score_ >= 1);
-  const bool seek_compaction = (current_->file_to_compact_ != nullptr);
-  if (size_compaction) {
-    level = current_->compaction_level_;
-    assert(level >= 0);
-    assert(level + 1 < config::kNumLevels);
-    c = new Compaction(options_, level);
-
-    // Pick the first file that comes after compact_pointer_[level]
-    for (size_t i = 0; i < current_->files_[level].size(); i++) {
-      FileMetaData* f = current_->files_[level][i];
-      if (compact_pointer_[level].empty() ||
-          icmp_.Compare(f->largest.Encode(), compact_pointer_[level]) > 0) {
-        c->inputs_[0].push_back(f);
-        break;
+  // Candidate boundaries are the input files' smallest and largest keys.
+  std::vector<Slice> keys;
+  uint64_t total = 0;
+  for (int which = 0; which < 2; which++) {
+    for (FileMetaData* f : c->inputs_[which]) {
+      keys.push_back(f->smallest.user_key());
+      keys.push_back(f->largest.user_key());
+      total += f->file_size;
+    }
+  }
+  std::sort(keys.begin(), keys.end(),
+            [user_cmp](const Slice& a, const Slice& b) {
+              return user_cmp->Compare(a, b) < 0;
+            });
+
+  // Like ApproximateOffsetOf(), but over the compaction inputs only.
+  auto input_before = [&](const Slice& user_key) {
+    const InternalKey ikey(user_key, kMaxSequenceNumber, kValueTypeForSeek);
+    uint64_t result = 0;
+    for (int which = 0; which < 2; which++) {
+      for (FileMetaData* f : c->inputs_[which]) {
+        if (icmp_.Compare(f->largest, ikey) <= 0) {
+          result += f->file_size;
+        } else if (icmp_.Compare(f->smallest, ikey) < 0) {
+          Table* tableptr;
+          Iterator* iter = table_cache_->NewIterator(
+              ReadOptions(), f->number, f->file_size, &tableptr);
+          if (tableptr != nullptr) {
+            result += tableptr->ApproximateOffsetOf(ikey.Encode());
+          }
+          delete iter;
+        }
       }
     }
-    if (c->inputs_[0].empty()) {
-      // Wrap-around to the beginning of the key space
-      c->inputs_[0].push_back(current_->files_[level][0]);
+    return result;
+  };
+
+  for (size_t i = 1; i < keys.size(); i++) {
+    const int pieces = static_cast<int>(boundaries->size()) + 1;
+    if (pieces == max) {
+      break;
+    }
+    // Pieces are never empty and never share a user key.
+    const Slice last = boundaries->empty() ? keys[0] : boundaries->back();
+    if (user_cmp->Compare(keys[i], keys[i - 1]) == 0 ||
+        user_cmp->Compare(keys[i], last) <= 0) {
+      continue;
+    }
+    // Start a new piece once the current one has its share of the input.
+    if (input_before(keys[i]) * max >= total * pieces) {
+      boundaries->push_back(keys[i].ToString());
+    }
+  }
+}
+
+Compaction* VersionSet::PickCompaction() {
+  Compaction* c = nullptr;
+
+  // We prefer compactions triggered by too much data in a level over
+  // the compactions triggered by seeks.  A level whose files all overlap
+  // running compactions gives way to the level with the next best score.
+  for (int i = 0; i < config::kNumLevels - 1 && c == nullptr; i++) {
+    const int level = current_->levels_by_score_[i];
+    if (current_->level_scores_[level] < 1) {
+      break;
     }
-  } else if (seek_compaction) {
-    level = current_->file_to_compact_level_;
-    c = new Compaction(options_, level);
+    c = PickLevelCompaction(level);
+  }
+
+  if (c == nullptr && current_->file_to_compact_ != nullptr &&
+      !current_->file_to_compact_->being_compacted) {
+    c = new Compaction(options_, current_->file_to_compact_level_);
     c->inputs_[0].push_back(current_->file_to_compact_);
-  } else {
-    return nullptr;
+    if (!SetupInputs(c)) {
+      delete c;
+      c = nullptr;
+    }
+  }
+
+  if (c != nullptr) {
+    RegisterCompaction(c);
+  }
+  return c;
+}
+
+Compaction* VersionSet::PickLevelCompaction(int level) {
+  assert(level >= 0);
+  assert(level + 1 < config::kNumLevels);
+  const std::vector<FileMetaData*>& files = current_->files_[level];
+
+  // Pick the first file that comes after compact_pointer_[level]
+  size_t start = 0;
+  while (start < files.size() && !compact_pointer_[level].empty() &&
+         icmp_.Compare(files[start]->largest.Encode(),
+                       compact_pointer_[level]) <= 0) {
+    start++;
   }
 
+  // Failing that, try the files after it, wrapping around to the
+  // beginning of the key space.
+  for (size_t i = 0; i < files.size(); i++) {
+    FileMetaData* f = files[(start + i) % files.size()];
+    if (f->being_compacted) {
+      continue;
+    }
+    Compaction* c = new Compaction(options_, level);
+    c->inputs_[0].push_back(f);
+    if (SetupInputs(c)) {
+      return c;
+    }
+    delete c;
+  }
+  return nullptr;
+}
+
+bool VersionSet::SetupInputs(Compaction* c) {
   c->input_version_ = current_;
   c->input_version_->Ref();
 
   // Files in level 0 may overlap each other, so pick up all overlapping ones
-  if (level == 0) {
+  if (c->level() == 0) {
     InternalKey smallest, largest;
     GetRange(c->inputs_[0], &smallest, &largest);
     // Note that the next call will discard the file we placed in
@@ -1313,7 +1772,39 @@ Compaction* VersionSet::PickCompaction() {
 
   SetupOtherInputs(c);
 
-  return c;
+  // Running compactions only ever write keys within the range of their
+  // inputs, so one whose inputs are disjoint from theirs cannot collide
+  // with their outputs either.
+  return !AnyBeingCompacted(c->inputs_[0]) &&
+         !AnyBeingCompacted(c->inputs_[1]);
+}
+
+void VersionSet::RegisterCompaction(Compaction* c) {
+  for (int which = 0; which < 2; which++) {
+    for (FileMetaData* f : c->inputs_[which]) {
+      f->being_compacted = true;
+    }
+  }
+
+  // Update the place where we will do the next compaction for this level.
+  // We update this immediately instead of waiting for the VersionEdit
+  // to be applied so that if the compaction fails, we will try a different
+  // key range next time.
+  InternalKey smallest, largest;
+  GetRange(c->inputs_[0], &smallest, &largest);
+  compact_pointer_[c->level()] = largest.Encode().ToString();
+  c->edit_.SetCompactPointer(c->level(), largest);
+
+  Finalize(current_);
+}
+
+void VersionSet::ReleaseCompactionFiles(Compaction* c) {
+  for (int which = 0; which < 2; which++) {
+    for (FileMetaData* f : c->inputs_[which]) {
+      f->being_compacted = false;
+    }
+  }
+  Finalize(current_);
 }
 
 // Finds the largest key in a vector of files. Returns true if files it not
@@ -1420,7 +1911,8 @@ void VersionSet::SetupOtherInputs(Compaction* c) {
     const int64_t expanded0_size = TotalFileSize(expanded0);
     if (expanded0.size() > c->inputs_[0].size() &&
         inputs1_size + expanded0_size <
-            ExpandedCompactionByteSizeLimit(options_)) {
+            ExpandedCompactionByteSizeLimit(options_) &&
+        !AnyBeingCompacted(expanded0)) {
       InternalKey new_start, new_limit;
       GetRange(expanded0, &new_start, &new_limit);
       std::vector<FileMetaData*> expanded1;
@@ -1432,8 +1924,6 @@ void VersionSet::SetupOtherInputs(Compaction* c) {
             level, int(c->inputs_[0].size()), int(c->inputs_[1].size()),
             long(inputs0_size), long(inputs1_size), int(expanded0.size()),
             int(expanded1.size()), long(expanded0_size), long(inputs1_size));
-        smallest = new_start;
-        largest = new_limit;
         c->inputs_[0] = expanded0;
         c->inputs_[1] = expanded1;
         GetRange2(c->inputs_[0], c->inputs_[1], &all_start, &all_limit);
@@ -1447,13 +1937,6 @@ void VersionSet::SetupOtherInputs(Compaction* c) {
     current_->GetOverlappingInputs(level + 2, &all_start, &all_limit,
                                    &c->grandparents_);
   }
-
-  // Update the place where we will do the next compaction for this level.
-  // We update this immediately instead of waiting for the VersionEdit
-  // to be applied so that if the compaction fails, we will try a different
-  // key range next time.
-  compact_pointer_[level] = largest.Encode().ToString();
-  c->edit_.SetCompactPointer(level, largest);
 }
 
 Compaction* VersionSet::CompactRange(int level, const InternalKey* begin,
@@ -1486,18 +1969,19 @@ Compaction* VersionSet::CompactRange(int level, const InternalKey* begin,
   c->input_version_->Ref();
   c->inputs_[0] = inputs;
   SetupOtherInputs(c);
+  RegisterCompaction(c);
   return c;
 }
 
 Compaction::Compaction(const Options* options, int level)
     : level_(level),
       max_output_file_size_(MaxFileSizeForLevel(options, level)),
-      input_version_(nullptr),
-      grandparent_index_(0),
-      seen_key_(false),
-      overlapped_bytes_(0) {
+      input_version_(nullptr) {}
+
+Compaction::Cursor::Cursor()
+    : grandparent_index(0), seen_key(false), overlapped_bytes(0) {
   for (int i = 0; i < config::kNumLevels; i++) {
-    level_ptrs_[i] = 0;
+    level_ptrs[i] = 0;
   }
 }
 
@@ -1525,13 +2009,14 @@ void Compaction::AddInputDeletions(VersionEdit* edit) {
   }
 }
 
-bool Compaction::IsBaseLevelForKey(const Slice& user_key) {
+bool Compaction::IsBaseLevelForKey(const Slice& user_key,
+                                   Cursor* cursor) const {
   // Maybe use binary search to find right entry instead of linear search?
   const Comparator* user_cmp = input_version_->vset_->icmp_.user_comparator();
   for (int lvl = level_ + 2; lvl < config::kNumLevels; lvl++) {
     const std::vector<FileMetaData*>& files = input_version_->files_[lvl];
-    while (level_ptrs_[lvl] < files.size()) {
-      FileMetaData* f = files[level_ptrs_[lvl]];
+    while (cursor->level_ptrs[lvl] < files.size()) {
+      FileMetaData* f = files[cursor->level_ptrs[lvl]];
       if (user_cmp->Compare(user_key, f->largest.user_key()) <= 0) {
         // We've advanced far enough
         if (user_cmp->Compare(user_key, f->smallest.user_key()) >= 0) {
@@ -1540,30 +2025,32 @@ bool Compaction::IsBaseLevelForKey(const Slice& user_key) {
         }
         break;
       }
-      level_ptrs_[lvl]++;
+      cursor->level_ptrs[lvl]++;
     }
   }
   return true;
 }
 
-bool Compaction::ShouldStopBefore(const Slice& internal_key) {
+bool Compaction::ShouldStopBefore(const Slice& internal_key,
+                                  Cursor* cursor) const {
   const VersionSet* vset = input_version_->vset_;
   // Scan to find earliest grandparent file that contains key.
   const InternalKeyComparator* icmp = &vset->icmp_;
-  while (grandparent_index_ < grandparents_.size() &&
+  while (cursor->grandparent_index < grandparents_.size() &&
          icmp->Compare(internal_key,
-                       grandparents_[grandparent_index_]->largest.Encode()) >
-             0) {
-    if (seen_key_) {
-      overlapped_bytes_ += grandparents_[grandparent_index_]->file_size;
+                       grandparents_[cursor->grandparent_index]
+                           ->largest.Encode()) > 0) {
+    if (cursor->seen_key) {
+      cursor->overlapped_bytes +=
+          grandparents_[cursor->grandparent_index]->file_size;
     }
-    grandparent_index_++;
+    cursor->grandparent_index++;
   }
-  seen_key_ = true;
+  cursor->seen_key = true;
 
-  if (overlapped_bytes_ > MaxGrandParentOverlapBytes(vset->options_)) {
+  if (cursor->overlapped_bytes > MaxGrandParentOverlapBytes(vset->options_)) {
     // Too much overlap for current output; start new output
-    overlapped_bytes_ = 0;
+    cursor->overlapped_bytes = 0;
     return true;
   } else {
     return false;
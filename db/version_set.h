@@ -15,8 +15,10 @@
 #ifndef STORAGE_LEVELDB_DB_VERSION_SET_H_
 #define STORAGE_LEVELDB_DB_VERSION_SET_H_
 
+#include <atomic>
 #include <map>
 #include <set>
+#include <string>
 #include <vector>
 
 #include "db/dbformat.h"
@@ -37,6 +39,7 @@ class MemTable;
 // class TQMemTable;
 class TableBuilder;
 class TableCache;
+class ThreadPool;
 class Version;
 class VersionSet;
 class WritableFile;
@@ -71,12 +74,22 @@ class Version {
 
   // Append to *iters a sequence of iterators that will
   // yield the contents of this Version when merged together.
+  // An options.iterate_upper_bound here is an internal key; files and
+  // blocks entirely at or past it are left out.
   // REQUIRES: This version has been saved (see VersionSet::SaveTo)
   void AddIterators(const ReadOptions&, std::vector<Iterator*>* iters);
 
   Status Get(const ReadOptions&, const LookupKey& key, std::string* val,
              GetStats* stats);
 
+  // Like Get() for the "n" keys in *keys[0,n-1], which must be sorted by
+  // user key and share one snapshot.  Sets *statuses[i] and, when found,
+  // *values[i].  Keys that land in the same file are looked up together.
+  // REQUIRES: lock is not held
+  void MultiGet(const ReadOptions&, int n, const LookupKey* const* keys,
+                std::string* const* values, Status* const* statuses,
+                GetStats* stats);
+
   // Adds "stats" into the current state.  Returns true if a new
   // compaction may need to be triggered, false otherwise.
   // REQUIRES: lock is held
@@ -108,6 +121,9 @@ class Version {
 
   // Return the level at which we should place a new memtable compaction
   // result that covers the range [smallest_user_key,largest_user_key].
+  // It is not pushed into or past a level that a running compaction reads
+  // from.
+  // REQUIRES: lock is held
   int PickLevelForMemTableOutput(const Slice& smallest_user_key,
                                  const Slice& largest_user_key);
 
@@ -130,7 +146,13 @@ class Version {
         file_to_compact_(nullptr),
         file_to_compact_level_(-1),
         compaction_score_(-1),
-        compaction_level_(-1) {}
+        compaction_level_(-1),
+        pending_compaction_bytes_(0) {
+    for (int level = 0; level < config::kNumLevels - 1; level++) {
+      level_scores_[level] = -1;
+      levels_by_score_[level] = level;
+    }
+  }
 
   Version(const Version&) = delete;
   Version& operator=(const Version&) = delete;
@@ -147,6 +169,19 @@ class Version {
   void ForEachOverlapping(Slice user_key, Slice internal_key, void* arg,
                           bool (*func)(void*, int, FileMetaData*));
 
+  // Store in *files the level-0 files that overlap user_key, newest first.
+  void OverlappingLevel0Files(Slice user_key,
+                              std::vector<FileMetaData*>* files) const;
+
+  // Look "k" up in the level-0 files "files" (newest first) at the same
+  // time, using vset_->level0_read_pool_.  Returns true and sets *s (and
+  // *value if found) if one of the files decided the lookup, false if the
+  // search should go on at level 1.
+  bool GetFromLevel0InParallel(const ReadOptions& options, const LookupKey& k,
+                               const std::vector<FileMetaData*>& files,
+                               std::string* value, GetStats* stats,
+                               Status* s);
+
   VersionSet* vset_;  // VersionSet to which this Version belongs
   Version* next_;     // Next version in linked list
   Version* prev_;     // Previous version in linked list
@@ -164,6 +199,16 @@ class Version {
   // are initialized by Finalize().
   double compaction_score_;
   int compaction_level_;
+
+  // The scores of all levels that can be compacted, and those levels from
+  // the highest score to the lowest.  Also set by Finalize(), which leaves
+  // out files that are being compacted.
+  double level_scores_[config::kNumLevels - 1];
+  int levels_by_score_[config::kNumLevels - 1];
+
+  // Bytes that compactions have to move before no level is over its
+  // limit, also set by Finalize().
+  uint64_t pending_compaction_bytes_;
 };
 
 class VersionSet {
@@ -210,13 +255,23 @@ class VersionSet {
   // Return the combined file size of all files at the specified level.
   int64_t NumLevelBytes(int level) const;
 
-  // Return the last sequence number.
-  uint64_t LastSequence() const { return last_sequence_; }
+  // Return an estimate of the bytes the current version's compactions are
+  // behind by: all of level 0 once it has enough files to be compacted,
+  // and the bytes over the limit of every other level.
+  uint64_t PendingCompactionBytes() const {
+    return current_->pending_compaction_bytes_;
+  }
+
+  // Return the last sequence number.  Safe to call without the lock; all
+  // writes up to the returned sequence are visible in the memtables.
+  uint64_t LastSequence() const {
+    return last_sequence_.load(std::memory_order_acquire);
+  }
 
   // Set the last sequence number to s.
   void SetLastSequence(uint64_t s) {
-    assert(s >= last_sequence_);
-    last_sequence_ = s;
+    assert(s >= last_sequence_.load(std::memory_order_relaxed));
+    last_sequence_.store(s, std::memory_order_release);
   }
 
   // Mark the specified file number as used.
@@ -230,30 +285,54 @@ class VersionSet {
   uint64_t PrevLogNumber() const { return prev_log_number_; }
 
   // Pick level and inputs for a new compaction.
-  // Returns nullptr if there is no compaction to be done.
+  // Returns nullptr if there is no compaction to be done, or none that
+  // can run alongside the compactions already running.
   // Otherwise returns a pointer to a heap-allocated object that
-  // describes the compaction.  Caller should delete the result.
+  // describes the compaction, whose input files are marked as being
+  // compacted.  Caller should call ReleaseCompactionFiles() and then
+  // delete the result.
   Compaction* PickCompaction();
 
   // Return a compaction object for compacting the range [begin,end] in
   // the specified level.  Returns nullptr if there is nothing in that
-  // level that overlaps the specified range.  Caller should delete
-  // the result.
+  // level that overlaps the specified range.  Caller should call
+  // ReleaseCompactionFiles() and then delete the result.
+  // REQUIRES: no other compaction is running.
   Compaction* CompactRange(int level, const InternalKey* begin,
                            const InternalKey* end);
 
+  // Clear the being-compacted marks of the inputs of "*c", once it has
+  // finished or failed, and recompute the compaction scores.
+  void ReleaseCompactionFiles(Compaction* c);
+
   // Return the maximum overlapping data (in bytes) at next level for any
   // file at a level >= 1.
   int64_t MaxNextLevelOverlappingBytes();
 
   // Create an iterator that reads over the compaction inputs for "*c".
+  // If "prefetch" is true, each level-0 file and each other input level is
+  // read ahead on a thread of its own, up to *limit if limit is non-null,
+  // and the result can only be positioned once (see
+  // NewPrefetchingIterator()).
   // The caller should delete the iterator when no longer needed.
-  Iterator* MakeInputIterator(Compaction* c);
+  Iterator* MakeInputIterator(Compaction* c, bool prefetch,
+                              const InternalKey* limit);
+
+  // Splits the key range of "*c" into at most "max" pieces holding about
+  // the same amount of input, at user keys where an input file starts or
+  // ends.  Stores the user keys that start the second and later pieces, in
+  // increasing order, in *boundaries; leaves it empty if the range is not
+  // worth splitting.
+  // REQUIRES: lock is not held
+  void GetSubcompactionBoundaries(Compaction* c, int max,
+                                  std::vector<std::string>* boundaries);
 
   // Returns true iff some level needs a compaction.
   bool NeedsCompaction() const {
     Version* v = current_;
-    return (v->compaction_score_ >= 1) || (v->file_to_compact_ != nullptr);
+    return (v->compaction_score_ >= 1) ||
+           (v->file_to_compact_ != nullptr &&
+            !v->file_to_compact_->being_compacted);
   }
 
   // Add all files listed in any live version to *live.
@@ -290,6 +369,19 @@ class VersionSet {
 
   void SetupOtherInputs(Compaction* c);
 
+  // Fills in the inputs of "*c" from its first input file, against
+  // current_.  Returns false if they include a file that is being
+  // compacted.
+  bool SetupInputs(Compaction* c);
+
+  // Returns a compaction of "level" whose inputs are not being compacted,
+  // or nullptr if there is none.
+  Compaction* PickLevelCompaction(int level);
+
+  // Marks the inputs of "*c" as being compacted and moves the compaction
+  // pointer of its level past them.
+  void RegisterCompaction(Compaction* c);
+
   // Save current contents to *log
   Status WriteSnapshot(log::Writer* log);
 
@@ -300,9 +392,11 @@ class VersionSet {
   const Options* const options_;
   TableCache* const table_cache_;
   const InternalKeyComparator icmp_;
+  // Threads for parallel level-0 lookups, or null.
+  ThreadPool* const level0_read_pool_;
   uint64_t next_file_number_;
   uint64_t manifest_file_number_;
-  uint64_t last_sequence_;
+  std::atomic<uint64_t> last_sequence_;
   uint64_t log_number_;
   uint64_t prev_log_number_;  // 0 or backing store for memtable being compacted
 
@@ -346,14 +440,32 @@ class Compaction {
   // Add all inputs to this compaction as delete operations to *edit.
   void AddInputDeletions(VersionEdit* edit);
 
+  // Position of a pass over the compaction's keys in increasing order,
+  // kept by IsBaseLevelForKey() and ShouldStopBefore().  Each subcompaction
+  // makes its own pass over its part of the key range.
+  struct Cursor {
+    Cursor();
+
+    size_t grandparent_index;  // Index in grandparents_
+    bool seen_key;             // Some output key has been seen
+    int64_t overlapped_bytes;  // Bytes of overlap between current output
+                               // and grandparent files
+
+    // level_ptrs holds indices into input_version_->levels_: our state
+    // is that we are positioned at one of the file ranges for each
+    // higher level than the ones involved in this compaction (i.e. for
+    // all L >= level_ + 2).
+    size_t level_ptrs[config::kNumLevels];
+  };
+
   // Returns true if the information we have available guarantees that
   // the compaction is producing data in "level+1" for which no data exists
   // in levels greater than "level+1".
-  bool IsBaseLevelForKey(const Slice& user_key);
+  bool IsBaseLevelForKey(const Slice& user_key, Cursor* cursor) const;
 
   // Returns true iff we should stop building the current output
   // before processing "internal_key".
-  bool ShouldStopBefore(const Slice& internal_key);
+  bool ShouldStopBefore(const Slice& internal_key, Cursor* cursor) const;
 
   // Release the input version for the compaction, once the compaction
   // is successful.
@@ -373,21 +485,9 @@ class Compaction {
   // Each compaction reads inputs from "level_" and "level_+1"
   std::vector<FileMetaData*> inputs_[2];  // The two sets of inputs
 
-  // State used to check for number of overlapping grandparent files
+  // Used to check for number of overlapping grandparent files
   // (parent == level_ + 1, grandparent == level_ + 2)
   std::vector<FileMetaData*> grandparents_;
-  size_t grandparent_index_;  // Index in grandparent_starts_
-  bool seen_key_;             // Some output key has been seen
-  int64_t overlapped_bytes_;  // Bytes of overlap between current output
-                              // and grandparent files
-
-  // State for implementing IsBaseLevelForKey
-
-  // level_ptrs_ holds indices into input_version_->levels_: our state
-  // is that we are positioned at one of the file ranges for each
-  // higher level than the ones involved in this compaction (i.e. for
-  // all L >= level_ + 2).
-  size_t level_ptrs_[config::kNumLevels];
 };
 
 }  // namespace leveldb
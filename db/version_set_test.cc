@@ -4,7 +4,14 @@
 
 #include "db/version_set.h"
 
+#include <string>
+#include <vector>
+
 #include "gtest/gtest.h"
+#include "db/table_cache.h"
+#include "leveldb/db.h"
+#include "leveldb/env.h"
+#include "port/port.h"
 #include "util/logging.h"
 #include "util/testutil.h"
 
@@ -328,6 +335,190 @@ TEST_F(AddBoundaryInputsTest, TestDisjoinFilePointers) {
   ASSERT_EQ(f3, compaction_files_[2]);
 }
 
+class PickCompactionTest : public testing::Test {
+ public:
+  PickCompactionTest()
+      : dbname_(testing::TempDir() + "pick_compaction_test"),
+        icmp_(BytewiseComparator()),
+        table_cache_(dbname_, options_, 100),
+        vset_(dbname_, &options_, &table_cache_, &icmp_) {
+    DestroyDB(dbname_, options_);
+    options_.env->CreateDir(dbname_);
+    mu_.Lock();
+  }
+
+  ~PickCompactionTest() {
+    mu_.Unlock();
+    DestroyDB(dbname_, options_);
+  }
+
+  void AddFile(int level, uint64_t number, const char* smallest,
+               const char* largest, uint64_t file_size) {
+    VersionEdit edit;
+    edit.AddFile(level, number, file_size,
+                 InternalKey(smallest, 100, kTypeValue),
+                 InternalKey(largest, 100, kTypeValue));
+    vset_.MarkFileNumberUsed(number);
+    ASSERT_LEVELDB_OK(vset_.LogAndApply(&edit, &mu_));
+  }
+
+  // Returns the numbers of the input files of "*c", level by level.
+  std::string Inputs(Compaction* c) {
+    std::string result;
+    for (int which = 0; which < 2; which++) {
+      if (which == 1) {
+        result += "|";
+      }
+      for (int i = 0; i < c->num_input_files(which); i++) {
+        if (i > 0) {
+          result += ",";
+        }
+        result += std::to_string(c->input(which, i)->number);
+      }
+    }
+    return result;
+  }
+
+  const std::string dbname_;
+  Options options_;
+  InternalKeyComparator icmp_;
+  TableCache table_cache_;
+  VersionSet vset_;
+  port::Mutex mu_;
+};
+
+static const uint64_t kMB = 1048576;
+
+TEST_F(PickCompactionTest, DisjointCompactionsOfOneLevel) {
+  // Level 1 holds 24MB, with room for 10MB.
+  AddFile(1, 10, "a", "b", 8 * kMB);
+  AddFile(1, 11, "c", "d", 8 * kMB);
+  AddFile(1, 12, "e", "f", 8 * kMB);
+
+  Compaction* c1 = vset_.PickCompaction();
+  ASSERT_TRUE(c1 != nullptr);
+  ASSERT_EQ("10|", Inputs(c1));
+  Compaction* c2 = vset_.PickCompaction();
+  ASSERT_TRUE(c2 != nullptr);
+  ASSERT_EQ("11|", Inputs(c2));
+
+  // The 8MB left is within the level's limit.
+  ASSERT_TRUE(!vset_.NeedsCompaction());
+  ASSERT_TRUE(vset_.PickCompaction() == nullptr);
+
+  // Scores are recomputed as compactions finish.
+  vset_.ReleaseCompactionFiles(c1);
+  delete c1;
+  ASSERT_TRUE(vset_.NeedsCompaction());
+  Compaction* c3 = vset_.PickCompaction();
+  ASSERT_TRUE(c3 != nullptr);
+  ASSERT_EQ("12|", Inputs(c3));
+
+  vset_.ReleaseCompactionFiles(c2);
+  vset_.ReleaseCompactionFiles(c3);
+  delete c2;
+  delete c3;
+}
+
+TEST_F(PickCompactionTest, OverlappingInputsWait) {
+  // Both level-1 files overlap the one level-2 file, and are too big to
+  // be compacted together.
+  AddFile(1, 10, "a", "c", 30 * kMB);
+  AddFile(1, 11, "e", "g", 30 * kMB);
+  AddFile(2, 12, "b", "f", 1 * kMB);
+
+  Compaction* c1 = vset_.PickCompaction();
+  ASSERT_TRUE(c1 != nullptr);
+  ASSERT_EQ("10|12", Inputs(c1));
+  ASSERT_TRUE(vset_.NeedsCompaction());
+  ASSERT_TRUE(vset_.PickCompaction() == nullptr);
+
+  vset_.ReleaseCompactionFiles(c1);
+  delete c1;
+  Compaction* c2 = vset_.PickCompaction();
+  ASSERT_TRUE(c2 != nullptr);
+  ASSERT_EQ("11|12", Inputs(c2));
+  vset_.ReleaseCompactionFiles(c2);
+  delete c2;
+}
+
+TEST_F(PickCompactionTest, NextBestLevel) {
+  // Level 1 is compacting its only file; level 2 is the next best.
+  AddFile(1, 10, "a", "b", 30 * kMB);
+  AddFile(2, 11, "x", "y", 150 * kMB);
+
+  Compaction* c1 = vset_.PickCompaction();
+  ASSERT_TRUE(c1 != nullptr);
+  ASSERT_EQ(1, c1->level());
+  Compaction* c2 = vset_.PickCompaction();
+  ASSERT_TRUE(c2 != nullptr);
+  ASSERT_EQ(2, c2->level());
+  ASSERT_EQ("11|", Inputs(c2));
+
+  vset_.ReleaseCompactionFiles(c1);
+  vset_.ReleaseCompactionFiles(c2);
+  delete c1;
+  delete c2;
+}
+
+TEST_F(PickCompactionTest, PendingCompactionBytes) {
+  // Level 1 holds 24MB, with room for 10MB.
+  AddFile(1, 10, "a", "b", 8 * kMB);
+  AddFile(1, 11, "c", "d", 8 * kMB);
+  AddFile(1, 12, "e", "f", 8 * kMB);
+  ASSERT_EQ(14 * kMB, vset_.PendingCompactionBytes());
+
+  // Level 0 counts in full once it has enough files to be compacted.
+  for (int i = 0; i < config::kL0_CompactionTrigger; i++) {
+    ASSERT_EQ(14 * kMB, vset_.PendingCompactionBytes());
+    AddFile(0, 20 + i, "a", "z", 1 * kMB);
+  }
+  const uint64_t expected = (14 + config::kL0_CompactionTrigger) * kMB;
+  ASSERT_EQ(expected, vset_.PendingCompactionBytes());
+
+  // Files being compacted still count.
+  Compaction* c = vset_.PickCompaction();
+  ASSERT_TRUE(c != nullptr);
+  ASSERT_EQ(expected, vset_.PendingCompactionBytes());
+  vset_.ReleaseCompactionFiles(c);
+  delete c;
+}
+
+TEST_F(PickCompactionTest, SubcompactionBoundaries) {
+  options_.max_file_size = 64 * kMB;  // Compact the whole level at once
+  AddFile(1, 10, "a", "b", 1 * kMB);
+  AddFile(1, 11, "c", "d", 1 * kMB);
+  AddFile(1, 12, "e", "f", 1 * kMB);
+  AddFile(1, 13, "g", "h", 1 * kMB);
+
+  Compaction* c = vset_.CompactRange(1, nullptr, nullptr);
+  ASSERT_TRUE(c != nullptr);
+  ASSERT_EQ("10,11,12,13|", Inputs(c));
+
+  std::vector<std::string> boundaries;
+  vset_.GetSubcompactionBoundaries(c, 1, &boundaries);
+  ASSERT_TRUE(boundaries.empty());
+  vset_.GetSubcompactionBoundaries(c, 2, &boundaries);
+  ASSERT_EQ(std::vector<std::string>({"e"}), boundaries);
+  vset_.GetSubcompactionBoundaries(c, 3, &boundaries);
+  ASSERT_EQ(std::vector<std::string>({"e", "g"}), boundaries);
+  vset_.GetSubcompactionBoundaries(c, 4, &boundaries);
+  ASSERT_EQ(std::vector<std::string>({"c", "e", "g"}), boundaries);
+  vset_.ReleaseCompactionFiles(c);
+  delete c;
+
+  // A single input file is never split.
+  InternalKey begin("a", kMaxSequenceNumber, kValueTypeForSeek);
+  InternalKey end("b", 0, kTypeValue);
+  c = vset_.CompactRange(1, &begin, &end);
+  ASSERT_TRUE(c != nullptr);
+  ASSERT_EQ("10|", Inputs(c));
+  vset_.GetSubcompactionBoundaries(c, 4, &boundaries);
+  ASSERT_TRUE(boundaries.empty());
+  vset_.ReleaseCompactionFiles(c);
+  delete c;
+}
+
 }  // namespace leveldb
 
 int main(int argc, char** argv) {
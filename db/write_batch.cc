@@ -38,6 +38,7 @@ WriteBatch::Handler::~Handler() = default;
 void WriteBatch::Clear() {
   rep_.clear();
   rep_.resize(kHeader);
+  presorted_ = false;
 }
 
 size_t WriteBatch::ApproximateSize() const { return rep_.size(); }
@@ -121,13 +122,14 @@ class MemTableInserter : public WriteBatch::Handler {
   SequenceNumber sequence_;
   //修改为tqmemtable
   TQMemTable* mem_;
+  bool presorted_;
 
   void Put(const Slice& key, const Slice& value) override {
-    mem_->Add(sequence_, kTypeValue, key, value);
+    mem_->Add(sequence_, kTypeValue, key, value, presorted_);
     sequence_++;
   }
   void Delete(const Slice& key) override {
-    mem_->Add(sequence_, kTypeDeletion, key, Slice());
+    mem_->Add(sequence_, kTypeDeletion, key, Slice(), presorted_);
     sequence_++;
   }
 };
@@ -138,6 +140,7 @@ Status WriteBatchInternal::InsertInto(const WriteBatch* b, TQMemTable* memtable)
   MemTableInserter inserter;
   inserter.sequence_ = WriteBatchInternal::Sequence(b);
   inserter.mem_ = memtable;
+  inserter.presorted_ = b->presorted_;
   return b->Iterate(&inserter);
 }
 
@@ -87,6 +87,14 @@ class LEVELDB_EXPORT DB {
   virtual Status Get(const ReadOptions& options, const Slice& key,
                      std::string* value) = 0;
 
+  // Look up the "n" keys in keys[0,n-1] against one consistent view of the
+  // database.  For each i, sets statuses[i] and values[i] as
+  // Get(options, keys[i], &values[i]) would.
+  //
+  // The default implementation calls Get() for each key.
+  virtual void MultiGet(const ReadOptions& options, int n, const Slice* keys,
+                        std::string* values, Status* statuses);
+
   // Return a heap-allocated iterator over the contents of the database.
   // The result of NewIterator() is initially invalid (caller must
   // call one of the Seek methods on the iterator before using it).
@@ -121,6 +129,8 @@ class LEVELDB_EXPORT DB {
   //     of the sstables that make up the db contents.
   //  "leveldb.approximate-memory-usage" - returns the approximate number of
   //     bytes of memory in use by the DB.
+  //  "leveldb.rate-limiter-bytes-per-sec" - returns the rate that
+  //     Options::rate_limiter currently lets through, if it is set.
   virtual bool GetProperty(const Slice& property, std::string* value) = 0;
 
   // For each i in [0,n-1], store in "sizes[i]", the approximate
@@ -14,6 +14,7 @@
 #define STORAGE_LEVELDB_INCLUDE_ENV_H_
 
 #include <cstdarg>
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <vector>
@@ -48,6 +49,30 @@ class SequentialFile;
 class Slice;
 class WritableFile;
 
+// Hints that control how a file is opened by the Env methods that accept
+// them.  An Env that does not support a hint ignores it, so callers must
+// not depend on any of them for correctness.
+struct LEVELDB_EXPORT FileOptions {
+  // Bypass the operating system's page cache (O_DIRECT).  Implementations
+  // fall back to buffered I/O when the file system rejects direct I/O.
+  bool use_direct_io = false;
+
+  // Open writable files so that every write is durable once it returns
+  // (O_DSYNC).  Sync() then has no outstanding data left to flush.
+  bool use_data_sync = false;
+
+  // If non-zero, writable files reserve disk space ahead of the write
+  // position in chunks of this many bytes, without changing the visible
+  // file size.
+  size_t preallocation_block_size = 0;
+
+  // Let WritableFile::Flush() keep appended data in the process until the
+  // buffer fills, Sync() or Close().  Only for files that are not read
+  // before they are synced or closed, such as tables.  Saves direct I/O
+  // from rewriting a partial page on every flush.
+  bool defer_flush = false;
+};
+
 class LEVELDB_EXPORT Env {
  public:
   Env();
@@ -85,6 +110,14 @@ class LEVELDB_EXPORT Env {
   virtual Status NewRandomAccessFile(const std::string& fname,
                                      RandomAccessFile** result) = 0;
 
+  // Like NewRandomAccessFile() above, but applies the hints in "options"
+  // that concern reading.
+  //
+  // The default implementation ignores "options".
+  virtual Status NewRandomAccessFile(const std::string& fname,
+                                     const FileOptions& options,
+                                     RandomAccessFile** result);
+
   // Create an object that writes to a new file with the specified
   // name.  Deletes any existing file with the same name and creates a
   // new file.  On success, stores a pointer to the new file in
@@ -95,6 +128,27 @@ class LEVELDB_EXPORT Env {
   virtual Status NewWritableFile(const std::string& fname,
                                  WritableFile** result) = 0;
 
+  // Like NewWritableFile() above, but applies the hints in "options".
+  //
+  // The default implementation ignores "options".
+  virtual Status NewWritableFile(const std::string& fname,
+                                 const FileOptions& options,
+                                 WritableFile** result);
+
+  // Create an object that writes to the file with the specified name by
+  // renaming the existing file "old_fname" and overwriting it from the
+  // beginning.  The old contents are not truncated; the caller must be able
+  // to tell stale trailing data from new data.  Overwriting blocks that are
+  // already allocated avoids the file-system metadata updates that make
+  // syncing a freshly created file expensive.
+  //
+  // The default implementation renames the file and then truncates it via
+  // NewWritableFile().
+  virtual Status ReuseWritableFile(const std::string& fname,
+                                   const std::string& old_fname,
+                                   const FileOptions& options,
+                                   WritableFile** result);
+
   // Create an object that either appends to an existing file, or
   // writes to a new file (if the file does not exist to begin with).
   // On success, stores a pointer to the new file in *result and
@@ -197,6 +251,23 @@ class LEVELDB_EXPORT Env {
   // serialized.
   virtual void Schedule(void (*function)(void* arg), void* arg) = 0;
 
+  // Background work is run by one thread pool per priority, so that short,
+  // urgent work such as memtable flushes does not queue behind long
+  // compactions.
+  enum Priority { kLowPriority, kHighPriority };
+
+  // Like Schedule() above, but runs "(*function)(arg)" in the thread pool
+  // for "pri".  Schedule(function, arg) uses the low priority pool.
+  //
+  // The default implementation calls Schedule(function, arg).
+  virtual void Schedule(void (*function)(void* arg), void* arg, Priority pri);
+
+  // Sets the number of threads in the pool for "pri".  Pools start with
+  // one thread each.
+  //
+  // The default implementation does nothing.
+  virtual void SetBackgroundThreads(int num, Priority pri);
+
   // Start a new thread, invoking "function(arg)" within the new thread.
   // When "function(arg)" returns, the thread will be destroyed.
   virtual void StartThread(void (*function)(void* arg), void* arg) = 0;
@@ -248,6 +319,17 @@ class LEVELDB_EXPORT SequentialFile {
   virtual Status Skip(uint64_t n) = 0;
 };
 
+// One of the reads of RandomAccessFile::MultiRead().
+struct LEVELDB_EXPORT ReadRequest {
+  uint64_t offset = 0;
+  size_t n = 0;
+  char* scratch = nullptr;  // Must have room for "n" bytes
+
+  // Set by MultiRead() as by RandomAccessFile::Read()
+  Slice result;
+  Status status;
+};
+
 // A file abstraction for randomly reading the contents of a file.
 class LEVELDB_EXPORT RandomAccessFile {
  public:
@@ -269,6 +351,22 @@ class LEVELDB_EXPORT RandomAccessFile {
   // Safe for concurrent use by multiple threads.
   virtual Status Read(uint64_t offset, size_t n, Slice* result,
                       char* scratch) const = 0;
+
+  // Hint that the "n" bytes starting at "offset" will be read soon, so
+  // that the implementation may start fetching them in the background.
+  // Returns without waiting for the data.  The default implementation
+  // does nothing.
+  //
+  // Safe for concurrent use by multiple threads.
+  virtual Status Prefetch(uint64_t offset, size_t n) const;
+
+  // Performs the "n" reads in "reqs[0..n-1]", as if by calling Read() for
+  // each, and sets their "result" and "status".  Implementations may
+  // issue the reads together, e.g. as one batch of asynchronous I/O.
+  // Returns the first non-OK request status, or OK if all succeeded.
+  //
+  // Safe for concurrent use by multiple threads.
+  virtual Status MultiRead(ReadRequest* reqs, size_t n) const;
 };
 
 // A file abstraction for sequential writing.  The implementation
@@ -349,9 +447,21 @@ class LEVELDB_EXPORT EnvWrapper : public Env {
                              RandomAccessFile** r) override {
     return target_->NewRandomAccessFile(f, r);
   }
+  Status NewRandomAccessFile(const std::string& f, const FileOptions& o,
+                             RandomAccessFile** r) override {
+    return target_->NewRandomAccessFile(f, o, r);
+  }
   Status NewWritableFile(const std::string& f, WritableFile** r) override {
     return target_->NewWritableFile(f, r);
   }
+  Status NewWritableFile(const std::string& f, const FileOptions& o,
+                         WritableFile** r) override {
+    return target_->NewWritableFile(f, o, r);
+  }
+  Status ReuseWritableFile(const std::string& f, const std::string& old_f,
+                           const FileOptions& o, WritableFile** r) override {
+    return target_->ReuseWritableFile(f, old_f, o, r);
+  }
   Status NewAppendableFile(const std::string& f, WritableFile** r) override {
     return target_->NewAppendableFile(f, r);
   }
@@ -384,6 +494,12 @@ class LEVELDB_EXPORT EnvWrapper : public Env {
   void Schedule(void (*f)(void*), void* a) override {
     return target_->Schedule(f, a);
   }
+  void Schedule(void (*f)(void*), void* a, Priority pri) override {
+    return target_->Schedule(f, a, pri);
+  }
+  void SetBackgroundThreads(int num, Priority pri) override {
+    target_->SetBackgroundThreads(num, pri);
+  }
   void StartThread(void (*f)(void*), void* a) override {
     return target_->StartThread(f, a);
   }
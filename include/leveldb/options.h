@@ -16,6 +16,9 @@ class Comparator;
 class Env;
 class FilterPolicy;
 class Logger;
+class RateLimiter;
+class Slice;
+class SliceTransform;
 class Snapshot;
 
 // DB contents are stored in a set of blocks, each of which holds a
@@ -93,6 +96,21 @@ struct LEVELDB_EXPORT Options {
   // If null, leveldb will automatically create and use an 8MB internal cache.
   Cache* block_cache = nullptr;
 
+  // If true, the index and filter blocks of tables are kept in block_cache
+  // at Cache::kHighPriority instead of being held by each open table.
+  // Their memory then counts against the cache's capacity and towards the
+  // "leveldb.approximate-memory-usage" property, at the cost of rereading
+  // them when they are evicted.  Give the cache a high priority pool (see
+  // NewLRUCache()) to keep them ahead of data blocks.  The internal cache
+  // used when block_cache is null has one.
+  bool cache_index_and_filter_blocks = false;
+
+  // If true along with cache_index_and_filter_blocks, level-0 tables keep
+  // their index and filter blocks in block_cache for as long as they stay
+  // open.  Each read may probe every level-0 table, so their blocks are
+  // the hottest.
+  bool pin_l0_filter_and_index_blocks_in_cache = false;
+
   // Approximate size of user data packed per block.  Note that the
   // block size specified here corresponds to uncompressed data.  The
   // actual size of the unit read from disk may be smaller if
@@ -136,10 +154,128 @@ struct LEVELDB_EXPORT Options {
   // Default: currently false, but may become true later.
   bool reuse_logs = false;
 
+  // If non-zero, memtables allocate their memory in blocks of this size
+  // backed by huge pages, which cuts TLB misses with large write buffers.
+  // Reserved huge pages (MAP_HUGETLB) are used when available, otherwise
+  // transparent huge pages are requested.  Should match the system's huge
+  // page size, typically 2MB.
+  size_t memtable_huge_page_size = 0;
+
+  // Maximum number of log files DB::Open() replays at the same time when
+  // it finds more than one to recover.  Tables built from the recovered
+  // data are written concurrently as well.  1, the default, recovers one
+  // log at a time.
+  int max_recovery_threads = 1;
+
+  // Number of obsolete log files to keep around and reuse for new logs
+  // instead of deleting them.  Overwriting blocks that a file already owns
+  // avoids the file-system metadata updates that make syncing a freshly
+  // created log expensive.  When non-zero, logs are written in a record
+  // format that lets recovery ignore what a previous use of the file left
+  // behind; older releases cannot read such logs.  Overrides reuse_logs.
+  size_t recycle_log_file_num = 0;
+
+  // If non-zero, log files reserve disk space in chunks of this many bytes
+  // ahead of the write position (fallocate() where available).
+  size_t log_file_preallocation_size = 0;
+
+  // If true, log files are opened with O_DSYNC so that each write is durable
+  // when it returns and WriteOptions::sync needs no separate fdatasync().
+  // Every write then waits for the disk, synced or not.
+  bool use_dsync_for_log = false;
+
+  // If true, log files are written with O_DIRECT, bypassing the operating
+  // system's page cache, where the file system supports it.
+  bool use_direct_io_for_log = false;
+
+  // If true, table files are read with O_DIRECT, bypassing the operating
+  // system's page cache, where the file system supports it.  Blocks are then
+  // cached only once, in block_cache, which should be sized accordingly.
+  bool use_direct_reads = false;
+
+  // If true, the table files written by memtable flushes and compactions
+  // are written with O_DIRECT, so that they do not evict pages that reads
+  // need from the page cache.
+  bool use_direct_io_for_flush_and_compaction = false;
+
+  // If non-null, the table files written by memtable flushes and
+  // compactions are written no faster than this limiter lets through (see
+  // leveldb/rate_limiter.h).  The database reports its compaction debt to
+  // the limiter, which may tune its rate from it.
+  RateLimiter* rate_limiter = nullptr;
+
+  // Compress write-ahead log records using the specified compression
+  // algorithm.  Records that do not compress well are stored as is, so this
+  // mostly costs CPU on the write path in exchange for less log I/O.  Logs
+  // containing compressed records cannot be read by older releases.
+  CompressionType log_compression = kNoCompression;
+
+  // Number of threads that look up a key in level-0 files in parallel.  A
+  // read that misses the memtables and overlaps several level-0 files then
+  // waits for the slowest file instead of for all of them in turn.  0 probes
+  // the files one after another.
+  int level0_read_threads = 0;
+
+  // Most compactions to run at the same time.  Compactions only run
+  // together when they share no input files, and so cover disjoint key
+  // ranges.  The Env must have at least as many low priority background
+  // threads (see Env::SetBackgroundThreads()) for them to run in parallel.
+  int max_background_compactions = 1;
+
+  // Most threads a single compaction is split across.  The compaction's key
+  // range is cut at input file boundaries into pieces of about the same
+  // size, which are merged and written concurrently and installed together.
+  // 1 runs every compaction on one thread.
+  int max_subcompactions = 1;
+
+  // If true, each compaction runs as a pipeline of threads: the input
+  // tables are read and decompressed ahead of the merge, which hands the
+  // entries it keeps to a thread that compresses and writes the output
+  // tables.  Each subcompaction starts one reader thread per level-0 input
+  // file plus one per other input level, and one output thread.
+  bool pipelined_compaction = false;
+
+  // Number of threads that compress and checksum the data blocks of the
+  // tables being written, while the next blocks are filled.  A database
+  // shares them between all its flushes and compactions; a TableBuilder
+  // created directly starts its own.  The blocks are still written in
+  // order.  0 compresses every block on the thread that builds the table.
+  int compression_threads = 0;
+
   // If non-null, use the specified filter policy to reduce disk reads.
   // Many applications will benefit from passing the result of
   // NewBloomFilterPolicy() here.
   const FilterPolicy* filter_policy = nullptr;
+
+  // If true, tables get one filter_policy filter covering all of their keys
+  // instead of one filter per 2KB of data.  A lookup checks it before the
+  // table's index, so a key the filter rules out costs no index or data
+  // block reads.  Tables keep whichever kind of filter they were written
+  // with; both kinds are read regardless of this setting.
+  bool full_table_filter = false;
+
+  // If non-null, tables built with a filter_policy also add the prefix of
+  // each key (as given by this transform) to their filters, so that reads
+  // with ReadOptions::prefix_same_as_start can skip tables and blocks that
+  // hold no key with the prefix being scanned.  Tables built without it,
+  // or with a transform of another name, are read without prefix filtering.
+  const SliceTransform* prefix_extractor = nullptr;
+
+  // If true, data blocks also get a small hash index from user keys to
+  // restart points, which point lookups use instead of a binary search.
+  // Costs about one byte per distinct key in each block.  Only takes
+  // effect when the comparator is BytewiseComparator().  Blocks with and
+  // without the index can be read either way, but only by releases that
+  // know of the index.
+  bool data_block_hash_index = false;
+
+  // If true, the index of each table is split into partitions of about
+  // block_size bytes under a small top-level index, and filters are built
+  // per index partition instead of for the whole table or per 2KB of data.
+  // Partitions are read through block_cache when needed, so opening a
+  // large table reads little and holds little memory.  Tables built this
+  // way can only be opened by releases that know of partitioned indexes.
+  bool partitioned_index = false;
 };
 
 // Options that control read operations
@@ -159,6 +295,27 @@ struct LEVELDB_EXPORT ReadOptions {
   // not have been released).  If "snapshot" is null, use an implicit
   // snapshot of the state at the beginning of this read operation.
   const Snapshot* snapshot = nullptr;
+
+  // If true, an iterator positioned by Seek() stops at the first key whose
+  // Options::prefix_extractor prefix differs from that of the seek target.
+  // Tables whose filters rule out the prefix are then skipped without
+  // reading their data.  Has no effect after SeekToFirst() or SeekToLast(),
+  // for targets outside the extractor's domain, or without a
+  // prefix_extractor.
+  bool prefix_same_as_start = false;
+
+  // If non-null, iterators stop before the first key >= *iterate_upper_bound
+  // and SeekToLast() starts from the last key below it.  Blocks and level
+  // files that hold only keys past the bound are not read.  The bound must
+  // stay live while any iterator created with these options is live.
+  const Slice* iterate_upper_bound = nullptr;
+
+  // Iterators ask the file system to prefetch table data ahead of where
+  // they are reading (see RandomAccessFile::Prefetch()).  If zero, each
+  // table iterator starts doing so after a few sequential block reads,
+  // with a window that doubles up to 256KB as the scan goes on.  Otherwise,
+  // they prefetch this many bytes at a time from the first read on.
+  size_t readahead_size = 0;
 };
 
 // Options that control write operations
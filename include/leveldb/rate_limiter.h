@@ -0,0 +1,71 @@
+// Copyright (c) 2026 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// A RateLimiter bounds how fast a database writes the tables built by its
+// memtable flushes and compactions (see Options::rate_limiter), so that
+// background I/O leaves the disk some room for foreground reads.  The
+// background threads ask it for every byte they append, and wait when the
+// budget for the moment is spent.
+//
+// The current rate is reported by the "leveldb.rate-limiter-bytes-per-sec"
+// property of the database.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_RATE_LIMITER_H_
+#define STORAGE_LEVELDB_INCLUDE_RATE_LIMITER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "leveldb/export.h"
+
+namespace leveldb {
+
+class LEVELDB_EXPORT RateLimiter {
+ public:
+  RateLimiter() = default;
+
+  RateLimiter(const RateLimiter&) = delete;
+  RateLimiter& operator=(const RateLimiter&) = delete;
+
+  virtual ~RateLimiter();
+
+  // Block until "bytes" more bytes may be written.  Safe to call from
+  // several threads at once.
+  virtual void Request(size_t bytes) = 0;
+
+  // Return the number of bytes per second currently let through.
+  virtual int64_t GetBytesPerSecond() const = 0;
+
+  // Change the rate.  For a limiter that tunes itself, this is the highest
+  // rate it may go up to.
+  virtual void SetBytesPerSecond(int64_t bytes_per_second) = 0;
+
+  // Called by a database whenever its set of tables changes, with the
+  // number of bytes its compactions are behind by.  A limiter that tunes
+  // itself sets its rate from the latest report.  The default
+  // implementation does nothing.
+  virtual void SetPendingCompactionBytes(uint64_t bytes);
+};
+
+// Return a new token bucket limiter that lets "bytes_per_second" bytes
+// through every second.
+//
+// Callers must delete the result after any database that is using it has
+// been closed.
+LEVELDB_EXPORT RateLimiter* NewRateLimiter(int64_t bytes_per_second);
+
+// Return a new token bucket limiter whose rate follows the compaction debt
+// reported by the database: it is "max_bytes_per_second" once the debt
+// reaches "target_pending_bytes", and falls in proportion to the debt
+// below that, to no less than a twentieth of the maximum.  Writes are then
+// slowed while compactions keep up, and sped up as they fall behind.
+//
+// Callers must delete the result after any database that is using it has
+// been closed.
+LEVELDB_EXPORT RateLimiter* NewAutoTunedRateLimiter(
+    int64_t max_bytes_per_second, uint64_t target_pending_bytes);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_RATE_LIMITER_H_
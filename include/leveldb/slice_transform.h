@@ -0,0 +1,63 @@
+// Copyright (c) 2026 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// A SliceTransform maps a key to a prefix of it.  A database configured
+// with Options::prefix_extractor adds the prefixes of its keys to its
+// filters, so that prefix-bounded scans (see
+// ReadOptions::prefix_same_as_start) can skip tables and blocks that hold
+// no key with the prefix being scanned.
+
+#ifndef STORAGE_LEVELDB_INCLUDE_SLICE_TRANSFORM_H_
+#define STORAGE_LEVELDB_INCLUDE_SLICE_TRANSFORM_H_
+
+#include <cstddef>
+
+#include "leveldb/export.h"
+#include "leveldb/slice.h"
+
+namespace leveldb {
+
+class LEVELDB_EXPORT SliceTransform {
+ public:
+  virtual ~SliceTransform();
+
+  // Return the name of this transform.  Tables record the name of the
+  // transform whose prefixes their filters hold; if the transform changes
+  // in an incompatible way, the name must change too.
+  virtual const char* Name() const = 0;
+
+  // Return the prefix of "key".
+  //
+  // REQUIRES: InDomain(key)
+  // The result must be a prefix of "key" (it may point into key's data),
+  // and all keys with the same prefix must sort next to each other in
+  // the database's comparator order.
+  virtual Slice Transform(const Slice& key) const = 0;
+
+  // Return true if "key" has a prefix.  Keys outside the domain are not
+  // added to filters as prefixes and never restrict an iterator.
+  virtual bool InDomain(const Slice& key) const = 0;
+};
+
+// Return a new transform whose prefix is the first "prefix_len" bytes of
+// the key.  Shorter keys are not in its domain.
+//
+// Callers must delete the result after any database that is using it has
+// been closed.
+LEVELDB_EXPORT const SliceTransform* NewFixedPrefixTransform(
+    size_t prefix_len);
+
+// Return a new transform whose prefix runs up to and including the
+// "count"-th occurrence of "delimiter".  Keys with fewer delimiters are not
+// in its domain.  For example, with delimiter '/' and count 2 the prefix
+// of "tenant/entity/field" is "tenant/entity/".
+//
+// Callers must delete the result after any database that is using it has
+// been closed.
+LEVELDB_EXPORT const SliceTransform* NewDelimitedPrefixTransform(
+    char delimiter, int count);
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_INCLUDE_SLICE_TRANSFORM_H_
@@ -7,6 +7,7 @@
 
 #include <cstdint>
 
+#include "leveldb/cache.h"
 #include "leveldb/export.h"
 #include "leveldb/iterator.h"
 
@@ -15,6 +16,7 @@ namespace leveldb {
 class Block;
 class BlockHandle;
 class Footer;
+class FullFilterBlockReader;
 struct Options;
 class RandomAccessFile;
 struct ReadOptions;
@@ -64,6 +66,32 @@ class LEVELDB_EXPORT Table {
 
   static Iterator* BlockReader(void*, const ReadOptions&, const Slice&);
 
+  // Like BlockReader(), but for point lookups; see
+  // Block::NewPointLookupIterator().
+  static Iterator* PointLookupBlockReader(void*, const ReadOptions&,
+                                          const Slice&);
+  // Like BlockReader(), but prefetches data for sequential reads.  "arg" is
+  // the iterator's readahead state.
+  static Iterator* ReadaheadBlockReader(void*, const ReadOptions&,
+                                        const Slice&);
+  // Like BlockReader(), but for index partitions.
+  static Iterator* IndexPartitionReader(void*, const ReadOptions&,
+                                        const Slice&);
+  static Iterator* NewBlockIterator(void*, const ReadOptions&, const Slice&,
+                                    bool point_lookup,
+                                    Cache::Priority priority);
+
+  // Sets iters[i] to PointLookupBlockReader(this, options, index_values[i])
+  // for i in [0,n-1], but reads the blocks that are not in the block cache
+  // with one RandomAccessFile::MultiRead() call.
+  void NewPointLookupIterators(const ReadOptions&, int n,
+                               const Slice* index_values,
+                               Iterator** iters) const;
+
+  // Returns false if the table's filters show that no key at or after
+  // "key" shares its Options::prefix_extractor prefix.  "arg" is the Table.
+  static bool PrefixMayMatch(void* arg, const Slice& key);
+
   explicit Table(Rep* rep) : rep_(rep) {}
 
   // Calls (*handle_result)(arg, ...) with the entry found after a call
@@ -73,8 +101,45 @@ class LEVELDB_EXPORT Table {
                      void (*handle_result)(void* arg, const Slice& k,
                                            const Slice& v));
 
+  // Like InternalGet() for the "n" internal keys in keys[0,n-1], which must
+  // be sorted.  Results for keys[i] are passed to (*handle_result)(args[i],
+  // ...).  Keys that fall in the same data block share one block read, and
+  // the uncached blocks of nearby keys are read with one batch of I/O.
+  Status InternalMultiGet(const ReadOptions&, int n, const Slice* keys,
+                          void** args,
+                          void (*handle_result)(void* arg, const Slice& k,
+                                                const Slice& v));
+
   void ReadMeta(const Footer& footer);
-  void ReadFilter(const Slice& filter_handle_value);
+  void ReadFilter(const Slice& filter_handle_value, bool full);
+
+  // Returns an iterator over the table's index block, which is the
+  // top-level index if the index is partitioned.
+  Iterator* NewIndexBlockIterator() const;
+
+  // Returns an iterator over the table's index entries, reading index
+  // partitions as needed if the index is partitioned.
+  Iterator* NewIndexIterator(const ReadOptions&) const;
+
+  // Returns the block cache priority of index and filter blocks.
+  Cache::Priority MetaBlockPriority() const;
+
+  // Keeps the table's index and filter blocks in the block cache for as
+  // long as the table is open.  Only has an effect with
+  // Options::cache_index_and_filter_blocks.
+  void PinMetaBlocks();
+
+  // Returns false if "full_filter" (the table's full filter, if it has
+  // one) or the filter of the index partition that "key" falls in rules
+  // out "key".
+  bool FilterMayMatch(const ReadOptions&, FullFilterBlockReader* full_filter,
+                      const Slice& key) const;
+
+  // Returns false if the filter of the index partition whose top-level
+  // index entry has value "top_index_value" rules out "filter_key".
+  bool PartitionFilterMayMatch(const ReadOptions&,
+                               const Slice& top_index_value,
+                               const Slice& filter_key) const;
 
   Rep* const rep_;
 };
@@ -75,16 +75,33 @@ class LEVELDB_EXPORT TableBuilder {
   // Number of calls to Add() so far.
   uint64_t NumEntries() const;
 
-  // Size of the file generated so far.  If invoked after a successful
-  // Finish() call, returns the size of the final generated file.
+  // Size of the file generated so far.  Blocks still being compressed by
+  // options.compression_threads count at their uncompressed size.  If
+  // invoked after a successful Finish() call, returns the size of the final
+  // generated file.
   uint64_t FileSize() const;
 
  private:
+  friend class TableBuilderInternal;
+
+  struct PendingBlock;
+  struct Rep;
+
+  explicit TableBuilder(Rep* rep);
+
+  static void CompressPendingBlock(void* block);
+
   bool ok() const { return status().ok(); }
+  void AddFilterKey(const Slice& key);
+  void AddIndexEntry(const Slice& key, const BlockHandle& handle);
   void WriteBlock(BlockBuilder* block, BlockHandle* handle);
   void WriteRawBlock(const Slice& data, CompressionType, BlockHandle* handle);
+  void AppendBlock(const Slice& data, const char* trailer, BlockHandle* handle);
+  void ScheduleDataBlock();
+  void WriteCompletedBlocks(bool wait_all);
+  void WritePendingBlock(PendingBlock* block);
+  void FlushIndexPartition(const Slice& last_key);
 
-  struct Rep;
   Rep* rep_;
 };
 
@@ -72,10 +72,18 @@ class LEVELDB_EXPORT WriteBatch {
   // Support for iterating over the contents of a batch.
   Status Iterate(Handler* handler) const;
 
+  // Hint that the keys in this batch are in increasing order and follow the
+  // keys of the previous write, as when loading data sequentially.  The
+  // memtable then looks for each key's position next to the previous insert
+  // instead of searching from the top.  A wrong hint only costs time.
+  // Cleared by Clear().
+  void SetPresorted(bool presorted) { presorted_ = presorted; }
+
  private:
   friend class WriteBatchInternal;
 
   std::string rep_;  // See comment in write_batch.cc for the format of rep_
+  bool presorted_;
 };
 
 }  // namespace leveldb
@@ -19,23 +19,41 @@ namespace leveldb {
 
 inline uint32_t Block::NumRestarts() const {
   assert(size_ >= sizeof(uint32_t));
-  return DecodeFixed32(data_ + size_ - sizeof(uint32_t));
+  return DecodeFixed32(data_ + size_ - sizeof(uint32_t)) & ~kBlockHashIndexFlag;
 }
 
 Block::Block(const BlockContents& contents)
     : data_(contents.data.data()),
       size_(contents.data.size()),
-      owned_(contents.heap_allocated) {
+      owned_(contents.heap_allocated),
+      hash_index_(nullptr),
+      num_buckets_(0) {
   if (size_ < sizeof(uint32_t)) {
     size_ = 0;  // Error marker
-  } else {
-    size_t max_restarts_allowed = (size_ - sizeof(uint32_t)) / sizeof(uint32_t);
-    if (NumRestarts() > max_restarts_allowed) {
-      // The size is too small for NumRestarts()
+    return;
+  }
+  // Bytes before the restart array
+  size_t trailer = sizeof(uint32_t);
+  if (DecodeFixed32(data_ + size_ - sizeof(uint32_t)) & kBlockHashIndexFlag) {
+    trailer += sizeof(uint32_t);
+    if (size_ < trailer) {
       size_ = 0;
-    } else {
-      restart_offset_ = size_ - (1 + NumRestarts()) * sizeof(uint32_t);
+      return;
+    }
+    num_buckets_ = DecodeFixed32(data_ + size_ - trailer);
+    if (num_buckets_ == 0 || num_buckets_ > size_ - trailer) {
+      size_ = 0;
+      return;
     }
+    trailer += num_buckets_;
+    hash_index_ = data_ + size_ - trailer;
+  }
+  size_t max_restarts_allowed = (size_ - trailer) / sizeof(uint32_t);
+  if (NumRestarts() > max_restarts_allowed) {
+    // The size is too small for NumRestarts()
+    size_ = 0;
+  } else {
+    restart_offset_ = size_ - trailer - NumRestarts() * sizeof(uint32_t);
   }
 }
 
@@ -84,6 +102,8 @@ class Block::Iter : public Iterator {
   // current_ is offset in data_ of current entry.  >= restarts_ if !Valid
   uint32_t current_;
   uint32_t restart_index_;  // Index of restart block in which current_ falls
+  const uint8_t* const hash_index_;  // Used by Seek() if non-null
+  uint32_t const num_buckets_;
   std::string key_;
   Slice value_;
   Status status_;
@@ -114,13 +134,15 @@ class Block::Iter : public Iterator {
 
  public:
   Iter(const Comparator* comparator, const char* data, uint32_t restarts,
-       uint32_t num_restarts)
+       uint32_t num_restarts, const char* hash_index, uint32_t num_buckets)
       : comparator_(comparator),
         data_(data),
         restarts_(restarts),
         num_restarts_(num_restarts),
         current_(restarts_),
-        restart_index_(num_restarts_) {
+        restart_index_(num_restarts_),
+        hash_index_(reinterpret_cast<const uint8_t*>(hash_index)),
+        num_buckets_(num_buckets) {
     assert(num_restarts_ > 0);
   }
 
@@ -162,6 +184,10 @@ class Block::Iter : public Iterator {
   }
 
   void Seek(const Slice& target) override {
+    if (hash_index_ != nullptr && HashSeek(target)) {
+      return;
+    }
+
     // Binary search in restart array to find the last restart point
     // with a key < target
     uint32_t left = 0;
@@ -247,6 +273,44 @@ class Block::Iter : public Iterator {
     value_.clear();
   }
 
+  // Seeks using the hash index.  Returns false if the index cannot tell
+  // where "target" is.
+  bool HashSeek(const Slice& target) {
+    if (target.size() < 8) {
+      return false;
+    }
+    const Slice user_key(target.data(), target.size() - 8);
+    const uint8_t entry = hash_index_[BlockHash(user_key) % num_buckets_];
+    if (entry == kBlockHashNoEntry) {
+      // No entry for user_key
+      current_ = restarts_;
+      restart_index_ = num_restarts_;
+      return true;
+    }
+    if (entry >= num_restarts_) {
+      return false;  // kBlockHashCollision
+    }
+
+    // The first entry for user_key, if any, is in the run starting at
+    // restart point "entry"; later entries for it may spill past the run.
+    SeekToRestartPoint(entry);
+    const uint32_t run_limit =
+        (static_cast<uint32_t>(entry) + 1 < num_restarts_)
+            ? GetRestartPoint(entry + 1)
+            : restarts_;
+    while (ParseNextKey()) {
+      if (Compare(key_, target) >= 0) {
+        break;
+      }
+      if (current_ >= run_limit &&
+          (key_.size() < 8 ||
+           Slice(key_.data(), key_.size() - 8) != user_key)) {
+        break;
+      }
+    }
+    return true;
+  }
+
   bool ParseNextKey() {
     current_ = NextEntryOffset();
     const char* p = data_ + current_;
@@ -285,7 +349,21 @@ Iterator* Block::NewIterator(const Comparator* comparator) {
   if (num_restarts == 0) {
     return NewEmptyIterator();
   } else {
-    return new Iter(comparator, data_, restart_offset_, num_restarts);
+    return new Iter(comparator, data_, restart_offset_, num_restarts, nullptr,
+                    0);
+  }
+}
+
+Iterator* Block::NewPointLookupIterator(const Comparator* comparator) {
+  if (size_ < sizeof(uint32_t)) {
+    return NewErrorIterator(Status::Corruption("bad block contents"));
+  }
+  const uint32_t num_restarts = NumRestarts();
+  if (num_restarts == 0) {
+    return NewEmptyIterator();
+  } else {
+    return new Iter(comparator, data_, restart_offset_, num_restarts,
+                    hash_index_, num_buckets_);
   }
 }
 
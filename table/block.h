@@ -28,6 +28,13 @@ class Block {
   size_t size() const { return size_; }
   Iterator* NewIterator(const Comparator* comparator);
 
+  // Like NewIterator(), but Seek() uses the block's hash index, if it has
+  // one.  The block's keys must be internal keys.  After Seek(target) the
+  // iterator is at the first entry >= target if the block holds an entry
+  // for target's user key; otherwise it is invalid or at an entry for
+  // another user key.  Only meant for point lookups.
+  Iterator* NewPointLookupIterator(const Comparator* comparator);
+
  private:
   class Iter;
 
@@ -37,6 +44,8 @@ class Block {
   size_t size_;
   uint32_t restart_offset_;  // Offset in data_ of restart array
   bool owned_;               // Block owns data_[]
+  const char* hash_index_;   // Hash index buckets, or nullptr
+  uint32_t num_buckets_;
 };
 
 }  // namespace leveldb
@@ -25,6 +25,17 @@
 //     restarts: uint32[num_restarts]
 //     num_restarts: uint32
 // restarts[i] contains the offset within the block of the ith restart point.
+//
+// A block built with a hash index instead ends with
+//     restarts: uint32[num_restarts]
+//     buckets: uint8[num_buckets]
+//     num_buckets: uint32
+//     num_restarts | kBlockHashIndexFlag: uint32
+// Bucket BlockHash(user_key) % num_buckets holds the index of the restart point
+// whose run holds the first entry for each user key hashed to it,
+// kBlockHashCollision if two such restart points differ, or
+// kBlockHashNoEntry.  Blocks with more restart points than fit in a
+// bucket are written without the index.
 
 #include "table/block_builder.h"
 
@@ -33,12 +44,21 @@
 
 #include "leveldb/comparator.h"
 #include "leveldb/options.h"
+#include "table/format.h"
 #include "util/coding.h"
 
 namespace leveldb {
 
-BlockBuilder::BlockBuilder(const Options* options)
-    : options_(options), restarts_(), counter_(0), finished_(false) {
+// Buckets per distinct user key is 1 / kHashUtilRatio.
+static const double kHashUtilRatio = 0.75;
+
+BlockBuilder::BlockBuilder(const Options* options, bool hash_index)
+    : options_(options),
+      restarts_(),
+      counter_(0),
+      finished_(false),
+      hash_index_(hash_index),
+      hash_index_usable_(true) {
   assert(options->block_restart_interval >= 1);
   restarts_.push_back(0);  // First restart point is at offset 0
 }
@@ -50,12 +70,20 @@ void BlockBuilder::Reset() {
   counter_ = 0;
   finished_ = false;
   last_key_.clear();
+  hash_index_usable_ = true;
+  hashes_.clear();
+  hash_restarts_.clear();
 }
 
 size_t BlockBuilder::CurrentSizeEstimate() const {
-  return (buffer_.size() +                       // Raw data buffer
-          restarts_.size() * sizeof(uint32_t) +  // Restart array
-          sizeof(uint32_t));                     // Restart array length
+  size_t estimate = (buffer_.size() +                       // Raw data buffer
+                     restarts_.size() * sizeof(uint32_t) +  // Restart array
+                     sizeof(uint32_t));  // Restart array length
+  if (hash_index_) {
+    estimate += static_cast<size_t>(hashes_.size() / kHashUtilRatio) +
+                sizeof(uint32_t);
+  }
+  return estimate;
 }
 
 Slice BlockBuilder::Finish() {
@@ -63,7 +91,26 @@ Slice BlockBuilder::Finish() {
   for (size_t i = 0; i < restarts_.size(); i++) {
     PutFixed32(&buffer_, restarts_[i]);
   }
-  PutFixed32(&buffer_, restarts_.size());
+  if (hash_index_ && hash_index_usable_ && !hashes_.empty() &&
+      restarts_.size() < kBlockHashCollision) {
+    const uint32_t num_buckets =
+        static_cast<uint32_t>(hashes_.size() / kHashUtilRatio) | 1;
+    const size_t buckets_offset = buffer_.size();
+    buffer_.append(num_buckets, static_cast<char>(kBlockHashNoEntry));
+    uint8_t* buckets = reinterpret_cast<uint8_t*>(&buffer_[buckets_offset]);
+    for (size_t i = 0; i < hashes_.size(); i++) {
+      uint8_t* bucket = &buckets[hashes_[i] % num_buckets];
+      if (*bucket == kBlockHashNoEntry) {
+        *bucket = static_cast<uint8_t>(hash_restarts_[i]);
+      } else if (*bucket != hash_restarts_[i]) {
+        *bucket = kBlockHashCollision;
+      }
+    }
+    PutFixed32(&buffer_, num_buckets);
+    PutFixed32(&buffer_, restarts_.size() | kBlockHashIndexFlag);
+  } else {
+    PutFixed32(&buffer_, restarts_.size());
+  }
   finished_ = true;
   return Slice(buffer_);
 }
@@ -88,6 +135,21 @@ void BlockBuilder::Add(const Slice& key, const Slice& value) {
   }
   const size_t non_shared = key.size() - shared;
 
+  if (hash_index_ && hash_index_usable_) {
+    if (key.size() < 8) {
+      hash_index_usable_ = false;
+    } else {
+      // Only the first entry of each user key goes in the index
+      const Slice user_key(key.data(), key.size() - 8);
+      if (buffer_.empty() || last_key_piece.size() < 8 ||
+          Slice(last_key_piece.data(), last_key_piece.size() - 8) !=
+              user_key) {
+        hashes_.push_back(BlockHash(user_key));
+        hash_restarts_.push_back(restarts_.size() - 1);
+      }
+    }
+  }
+
   // Add "<shared><non_shared><value_size>" to buffer_
   PutVarint32(&buffer_, shared);
   PutVarint32(&buffer_, non_shared);
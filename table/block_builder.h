@@ -16,7 +16,10 @@ struct Options;
 
 class BlockBuilder {
  public:
-  explicit BlockBuilder(const Options* options);
+  // If "hash_index" is true, the keys added must be internal keys, and
+  // Finish() appends an index from user keys to restart points when the
+  // block has few enough restart points.
+  explicit BlockBuilder(const Options* options, bool hash_index = false);
 
   BlockBuilder(const BlockBuilder&) = delete;
   BlockBuilder& operator=(const BlockBuilder&) = delete;
@@ -47,6 +50,11 @@ class BlockBuilder {
   int counter_;                     // Number of entries emitted since restart
   bool finished_;                   // Has Finish() been called?
   std::string last_key_;
+
+  const bool hash_index_;
+  bool hash_index_usable_;        // All keys so far are internal keys
+  std::vector<uint32_t> hashes_;  // Hash of each distinct user key
+  std::vector<uint32_t> hash_restarts_;  // Its first restart index
 };
 
 }  // namespace leveldb
@@ -0,0 +1,143 @@
+// Copyright (c) 2026 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "table/block.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "db/dbformat.h"
+#include "leveldb/comparator.h"
+#include "leveldb/options.h"
+#include "table/block_builder.h"
+#include "table/format.h"
+#include "util/coding.h"
+#include "util/testutil.h"
+
+namespace leveldb {
+
+static std::string UserKey(int i) {
+  char buf[100];
+  std::snprintf(buf, sizeof(buf), "key%06d", i);
+  return std::string(buf);
+}
+
+static std::string IKey(const std::string& user_key, SequenceNumber seq) {
+  std::string result;
+  AppendInternalKey(&result, ParsedInternalKey(user_key, seq, kTypeValue));
+  return result;
+}
+
+class BlockHashIndexTest : public testing::Test {
+ public:
+  BlockHashIndexTest() : icmp_(BytewiseComparator()), block_(nullptr) {
+    options_.comparator = &icmp_;
+    options_.block_restart_interval = 4;
+  }
+
+  ~BlockHashIndexTest() { delete block_; }
+
+  // Adds "versions" entries for each even user key in [0, 2 * n).
+  void Build(int n, int versions, bool hash_index) {
+    BlockBuilder builder(&options_, hash_index);
+    for (int i = 0; i < 2 * n; i += 2) {
+      for (int v = versions; v > 0; v--) {
+        builder.Add(IKey(UserKey(i), 10 * v), "value" + std::to_string(v));
+      }
+    }
+    contents_ = builder.Finish().ToString();
+    BlockContents contents;
+    contents.data = contents_;
+    contents.cachable = false;
+    contents.heap_allocated = false;
+    delete block_;
+    block_ = new Block(contents);
+  }
+
+  bool HasHashIndex() const {
+    return (DecodeFixed32(contents_.data() + contents_.size() - 4) &
+            kBlockHashIndexFlag) != 0;
+  }
+
+  InternalKeyComparator icmp_;
+  Options options_;
+  std::string contents_;
+  Block* block_;
+};
+
+TEST_F(BlockHashIndexTest, MatchesBinarySearch) {
+  const int kKeys = 100;
+  const int kVersions = 3;
+  Build(kKeys, kVersions, true);
+  ASSERT_TRUE(HasHashIndex());
+
+  Iterator* scan = block_->NewIterator(&icmp_);
+  Iterator* lookup = block_->NewPointLookupIterator(&icmp_);
+  for (int i = 0; i < 2 * kKeys; i += 2) {
+    // Seeks between, at, and past every version.
+    for (SequenceNumber seq = 5; seq <= 10 * kVersions + 5; seq += 5) {
+      const std::string target = IKey(UserKey(i), seq);
+      scan->Seek(target);
+      lookup->Seek(target);
+      ASSERT_EQ(scan->Valid(), lookup->Valid()) << i << "@" << seq;
+      if (scan->Valid()) {
+        ASSERT_EQ(scan->key().ToString(), lookup->key().ToString());
+        ASSERT_EQ(scan->value().ToString(), lookup->value().ToString());
+      }
+    }
+  }
+
+  // Absent user keys never land on an entry for themselves.
+  for (int i = 1; i < 2 * kKeys; i += 2) {
+    lookup->Seek(IKey(UserKey(i), kMaxSequenceNumber));
+    if (lookup->Valid()) {
+      ASSERT_NE(UserKey(i), ExtractUserKey(lookup->key()).ToString());
+    }
+  }
+  ASSERT_LEVELDB_OK(lookup->status());
+  delete scan;
+  delete lookup;
+}
+
+TEST_F(BlockHashIndexTest, IteratorsIgnoreIndex) {
+  Build(50, 2, false);
+  std::string plain = contents_;
+  Build(50, 2, true);
+  ASSERT_GT(contents_.size(), plain.size());
+
+  Iterator* iter = block_->NewIterator(&icmp_);
+  int count = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    count++;
+  }
+  ASSERT_EQ(100, count);
+  count = 0;
+  for (iter->SeekToLast(); iter->Valid(); iter->Prev()) {
+    count++;
+  }
+  ASSERT_EQ(100, count);
+  ASSERT_LEVELDB_OK(iter->status());
+  delete iter;
+}
+
+TEST_F(BlockHashIndexTest, TooManyRestarts) {
+  // Restart indexes past what a bucket holds leave the block unindexed.
+  options_.block_restart_interval = 1;
+  Build(300, 1, true);
+  ASSERT_TRUE(!HasHashIndex());
+
+  Iterator* lookup = block_->NewPointLookupIterator(&icmp_);
+  lookup->Seek(IKey(UserKey(200), kMaxSequenceNumber));
+  ASSERT_TRUE(lookup->Valid());
+  ASSERT_EQ(UserKey(200), ExtractUserKey(lookup->key()).ToString());
+  delete lookup;
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -74,6 +74,30 @@ void FilterBlockBuilder::GenerateFilter() {
   start_.clear();
 }
 
+FullFilterBlockBuilder::FullFilterBlockBuilder(const FilterPolicy* policy)
+    : policy_(policy) {}
+
+void FullFilterBlockBuilder::AddKey(const Slice& key) {
+  start_.push_back(keys_.size());
+  keys_.append(key.data(), key.size());
+}
+
+Slice FullFilterBlockBuilder::Finish() {
+  result_.clear();
+  const size_t num_keys = start_.size();
+  if (num_keys > 0) {
+    std::vector<Slice> keys(num_keys);
+    start_.push_back(keys_.size());  // Simplify length computation
+    for (size_t i = 0; i < num_keys; i++) {
+      keys[i] = Slice(keys_.data() + start_[i], start_[i + 1] - start_[i]);
+    }
+    policy_->CreateFilter(&keys[0], static_cast<int>(num_keys), &result_);
+  }
+  keys_.clear();
+  start_.clear();
+  return Slice(result_);
+}
+
 FilterBlockReader::FilterBlockReader(const FilterPolicy* policy,
                                      const Slice& contents)
     : policy_(policy), data_(nullptr), offset_(nullptr), num_(0), base_lg_(0) {
@@ -103,4 +127,16 @@ bool FilterBlockReader::KeyMayMatch(uint64_t block_offset, const Slice& key) {
   return true;  // Errors are treated as potential matches
 }
 
+FullFilterBlockReader::FullFilterBlockReader(const FilterPolicy* policy,
+                                             const Slice& contents)
+    : policy_(policy), contents_(contents) {}
+
+bool FullFilterBlockReader::KeyMayMatch(const Slice& key) {
+  if (contents_.empty()) {
+    // Empty filters do not match any keys
+    return false;
+  }
+  return policy_->KeyMayMatch(key, contents_);
+}
+
 }  // namespace leveldb
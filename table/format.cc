@@ -4,6 +4,8 @@
 
 #include "table/format.h"
 
+#include <vector>
+
 #include "leveldb/env.h"
 #include "port/port.h"
 #include "table/block.h"
@@ -33,8 +35,10 @@ void Footer::EncodeTo(std::string* dst) const {
   metaindex_handle_.EncodeTo(dst);
   index_handle_.EncodeTo(dst);
   dst->resize(2 * BlockHandle::kMaxEncodedLength);  // Padding
-  PutFixed32(dst, static_cast<uint32_t>(kTableMagicNumber & 0xffffffffu));
-  PutFixed32(dst, static_cast<uint32_t>(kTableMagicNumber >> 32));
+  const uint64_t magic = partitioned_index_ ? kPartitionedIndexTableMagicNumber
+                                            : kTableMagicNumber;
+  PutFixed32(dst, static_cast<uint32_t>(magic & 0xffffffffu));
+  PutFixed32(dst, static_cast<uint32_t>(magic >> 32));
   assert(dst->size() == original_size + kEncodedLength);
   (void)original_size;  // Disable unused variable warning.
 }
@@ -45,7 +49,11 @@ Status Footer::DecodeFrom(Slice* input) {
   const uint32_t magic_hi = DecodeFixed32(magic_ptr + 4);
   const uint64_t magic = ((static_cast<uint64_t>(magic_hi) << 32) |
                           (static_cast<uint64_t>(magic_lo)));
-  if (magic != kTableMagicNumber) {
+  if (magic == kPartitionedIndexTableMagicNumber) {
+    partitioned_index_ = true;
+  } else if (magic == kTableMagicNumber) {
+    partitioned_index_ = false;
+  } else {
     return Status::Corruption("not an sstable (bad magic number)");
   }
 
@@ -61,22 +69,16 @@ Status Footer::DecodeFrom(Slice* input) {
   return result;
 }
 
-Status ReadBlock(RandomAccessFile* file, const ReadOptions& options,
-                 const BlockHandle& handle, BlockContents* result) {
+// Checks and uncompresses the block identified by "handle", which was read
+// into "contents" using "buf" as scratch space.  Takes ownership of "buf".
+static Status DecodeBlock(const ReadOptions& options,
+                          const BlockHandle& handle, char* buf,
+                          const Slice& contents, BlockContents* result) {
   result->data = Slice();
   result->cachable = false;
   result->heap_allocated = false;
 
-  // Read the block contents as well as the type/crc footer.
-  // See table_builder.cc for the code that built this structure.
   size_t n = static_cast<size_t>(handle.size());
-  char* buf = new char[n + kBlockTrailerSize];
-  Slice contents;
-  Status s = file->Read(handle.offset(), n + kBlockTrailerSize, &contents, buf);
-  if (!s.ok()) {
-    delete[] buf;
-    return s;
-  }
   if (contents.size() != n + kBlockTrailerSize) {
     delete[] buf;
     return Status::Corruption("truncated block read");
@@ -89,8 +91,7 @@ Status ReadBlock(RandomAccessFile* file, const ReadOptions& options,
     const uint32_t actual = crc32c::Value(data, n + 1);
     if (actual != crc) {
       delete[] buf;
-      s = Status::Corruption("block checksum mismatch");
-      return s;
+      return Status::Corruption("block checksum mismatch");
     }
   }
 
@@ -138,4 +139,43 @@ Status ReadBlock(RandomAccessFile* file, const ReadOptions& options,
   return Status::OK();
 }
 
+Status ReadBlock(RandomAccessFile* file, const ReadOptions& options,
+                 const BlockHandle& handle, BlockContents* result) {
+  // Read the block contents as well as the type/crc footer.
+  // See table_builder.cc for the code that built this structure.
+  size_t n = static_cast<size_t>(handle.size());
+  char* buf = new char[n + kBlockTrailerSize];
+  Slice contents;
+  Status s = file->Read(handle.offset(), n + kBlockTrailerSize, &contents, buf);
+  if (!s.ok()) {
+    delete[] buf;
+    result->data = Slice();
+    result->cachable = false;
+    result->heap_allocated = false;
+    return s;
+  }
+  return DecodeBlock(options, handle, buf, contents, result);
+}
+
+void ReadBlocks(RandomAccessFile* file, const ReadOptions& options, int n,
+                const BlockHandle* handles, BlockContents* results,
+                Status* statuses) {
+  std::vector<ReadRequest> reqs(n);
+  for (int i = 0; i < n; i++) {
+    reqs[i].offset = handles[i].offset();
+    reqs[i].n = static_cast<size_t>(handles[i].size()) + kBlockTrailerSize;
+    reqs[i].scratch = new char[reqs[i].n];
+  }
+  file->MultiRead(reqs.data(), reqs.size());
+  for (int i = 0; i < n; i++) {
+    if (reqs[i].status.ok()) {
+      statuses[i] = DecodeBlock(options, handles[i], reqs[i].scratch,
+                                reqs[i].result, &results[i]);
+    } else {
+      delete[] reqs[i].scratch;
+      statuses[i] = reqs[i].status;
+    }
+  }
+}
+
 }  // namespace leveldb
@@ -11,6 +11,7 @@
 #include "leveldb/slice.h"
 #include "leveldb/status.h"
 #include "leveldb/table_builder.h"
+#include "util/hash.h"
 
 namespace leveldb {
 
@@ -62,12 +63,18 @@ class Footer {
   const BlockHandle& index_handle() const { return index_handle_; }
   void set_index_handle(const BlockHandle& h) { index_handle_ = h; }
 
+  // True if the index block is a top-level index over index partitions.
+  // Such tables carry a different magic number.
+  bool partitioned_index() const { return partitioned_index_; }
+  void set_partitioned_index(bool p) { partitioned_index_ = p; }
+
   void EncodeTo(std::string* dst) const;
   Status DecodeFrom(Slice* input);
 
  private:
   BlockHandle metaindex_handle_;
   BlockHandle index_handle_;
+  bool partitioned_index_ = false;
 };
 
 // kTableMagicNumber was picked by running
@@ -75,9 +82,27 @@ class Footer {
 // and taking the leading 64 bits.
 static const uint64_t kTableMagicNumber = 0xdb4775248b80fb57ull;
 
+// Magic number of tables with a partitioned index, which readers that
+// predate them must not open.
+static const uint64_t kPartitionedIndexTableMagicNumber =
+    0xdb4775248b80fb58ull;
+
 // 1-byte type + 32-bit crc
 static const size_t kBlockTrailerSize = 5;
 
+// A block whose restart count has this bit set ends with a hash index
+// (see block_builder.cc).
+static const uint32_t kBlockHashIndexFlag = 1u << 31;
+
+// Hash index buckets hold a restart index, or one of these.
+static const uint8_t kBlockHashNoEntry = 255;
+static const uint8_t kBlockHashCollision = 254;
+
+// The hash index bucket of a user key is BlockHash(user_key) % num_buckets.
+inline uint32_t BlockHash(const Slice& user_key) {
+  return Hash(user_key.data(), user_key.size(), 0x5bd1e995);
+}
+
 struct BlockContents {
   Slice data;           // Actual contents of data
   bool cachable;        // True iff data can be cached
@@ -89,6 +114,13 @@ struct BlockContents {
 Status ReadBlock(RandomAccessFile* file, const ReadOptions& options,
                  const BlockHandle& handle, BlockContents* result);
 
+// Like ReadBlock() for the "n" blocks identified by "handles[0..n-1]", but
+// reads them all with one RandomAccessFile::MultiRead() call.  Sets
+// statuses[i], and if it is OK, results[i].
+void ReadBlocks(RandomAccessFile* file, const ReadOptions& options, int n,
+                const BlockHandle* handles, BlockContents* results,
+                Status* statuses);
+
 // Implementation details follow.  Clients should ignore,
 
 inline BlockHandle::BlockHandle()
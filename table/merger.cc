@@ -4,6 +4,8 @@
 
 #include "table/merger.h"
 
+#include <vector>
+
 #include "leveldb/comparator.h"
 #include "leveldb/iterator.h"
 #include "table/iterator_wrapper.h"
@@ -13,15 +15,20 @@ namespace leveldb {
 namespace {
 class MergingIterator : public Iterator {
  public:
-  MergingIterator(const Comparator* comparator, Iterator** children, int n)
+  MergingIterator(const Comparator* comparator, Iterator** children, int n,
+                  bool use_heap)
       : comparator_(comparator),
         children_(new IteratorWrapper[n]),
         n_(n),
+        use_heap_(use_heap),
         current_(nullptr),
         direction_(kForward) {
     for (int i = 0; i < n; i++) {
       children_[i].Set(children[i]);
     }
+    if (use_heap_) {
+      heap_.reserve(n);
+    }
   }
 
   ~MergingIterator() override { delete[] children_; }
@@ -32,24 +39,24 @@ class MergingIterator : public Iterator {
     for (int i = 0; i < n_; i++) {
       children_[i].SeekToFirst();
     }
-    FindSmallest();
     direction_ = kForward;
+    FindSmallest();
   }
 
   void SeekToLast() override {
     for (int i = 0; i < n_; i++) {
       children_[i].SeekToLast();
     }
-    FindLargest();
     direction_ = kReverse;
+    FindLargest();
   }
 
   void Seek(const Slice& target) override {
     for (int i = 0; i < n_; i++) {
       children_[i].Seek(target);
     }
-    FindSmallest();
     direction_ = kForward;
+    FindSmallest();
   }
 
   void Next() override {
@@ -72,10 +79,17 @@ class MergingIterator : public Iterator {
         }
       }
       direction_ = kForward;
+      current_->Next();
+      FindSmallest();
+      return;
     }
 
     current_->Next();
-    FindSmallest();
+    if (use_heap_) {
+      ReplaceTop();
+    } else {
+      FindSmallest();
+    }
   }
 
   void Prev() override {
@@ -101,10 +115,17 @@ class MergingIterator : public Iterator {
         }
       }
       direction_ = kReverse;
+      current_->Prev();
+      FindLargest();
+      return;
     }
 
     current_->Prev();
-    FindLargest();
+    if (use_heap_) {
+      ReplaceTop();
+    } else {
+      FindLargest();
+    }
   }
 
   Slice key() const override {
@@ -132,20 +153,94 @@ class MergingIterator : public Iterator {
   // Which direction is the iterator moving?
   enum Direction { kForward, kReverse };
 
+  // Point current_ at the child with the smallest (largest) key.  With a
+  // heap, these rebuild it for the current direction.
   void FindSmallest();
   void FindLargest();
 
-  // We might want to use a heap in case there are lots of children.
-  // For now we use a simple array since we expect a very small number
-  // of children in leveldb.
+  // Heap maintenance.  heap_ holds the valid children, with the one whose
+  // key comes first in the current direction at heap_[0].
+  bool Before(const IteratorWrapper* a, const IteratorWrapper* b) const;
+  void BuildHeap();
+  void SiftDown(size_t i);
+  void ReplaceTop();  // After heap_[0] has moved one step
+
+  // With few children, a linear scan over all of them is cheaper than
+  // maintaining a heap; see NewMergingIterator().
   const Comparator* comparator_;
   IteratorWrapper* children_;
   int n_;
+  const bool use_heap_;
+  std::vector<IteratorWrapper*> heap_;
   IteratorWrapper* current_;
   Direction direction_;
 };
 
+// Ties go to the lower-numbered child when moving forward and to the
+// higher-numbered one in reverse, as in the linear scans.
+bool MergingIterator::Before(const IteratorWrapper* a,
+                             const IteratorWrapper* b) const {
+  const int r = comparator_->Compare(a->key(), b->key());
+  if (direction_ == kForward) {
+    return r < 0 || (r == 0 && a < b);
+  } else {
+    return r > 0 || (r == 0 && a > b);
+  }
+}
+
+void MergingIterator::BuildHeap() {
+  heap_.clear();
+  for (int i = 0; i < n_; i++) {
+    if (children_[i].Valid()) {
+      heap_.push_back(&children_[i]);
+    }
+  }
+  for (size_t i = heap_.size() / 2; i > 0; i--) {
+    SiftDown(i - 1);
+  }
+  current_ = heap_.empty() ? nullptr : heap_[0];
+}
+
+void MergingIterator::SiftDown(size_t i) {
+  const size_t size = heap_.size();
+  IteratorWrapper* item = heap_[i];
+  while (true) {
+    size_t child = 2 * i + 1;
+    if (child >= size) {
+      break;
+    }
+    if (child + 1 < size && Before(heap_[child + 1], heap_[child])) {
+      child++;
+    }
+    if (!Before(heap_[child], item)) {
+      break;
+    }
+    heap_[i] = heap_[child];
+    i = child;
+  }
+  heap_[i] = item;
+}
+
+void MergingIterator::ReplaceTop() {
+  assert(!heap_.empty() && heap_[0] == current_);
+  if (!current_->Valid()) {
+    heap_[0] = heap_.back();
+    heap_.pop_back();
+  }
+  if (heap_.empty()) {
+    current_ = nullptr;
+  } else {
+    SiftDown(0);
+    current_ = heap_[0];
+  }
+}
+
 void MergingIterator::FindSmallest() {
+  if (use_heap_) {
+    assert(direction_ == kForward);
+    BuildHeap();
+    return;
+  }
   IteratorWrapper* smallest = nullptr;
   for (int i = 0; i < n_; i++) {
     IteratorWrapper* child = &children_[i];
@@ -161,6 +256,11 @@ void MergingIterator::FindSmallest() {
 }
 
 void MergingIterator::FindLargest() {
+  if (use_heap_) {
+    assert(direction_ == kReverse);
+    BuildHeap();
+    return;
+  }
   IteratorWrapper* largest = nullptr;
   for (int i = n_ - 1; i >= 0; i--) {
     IteratorWrapper* child = &children_[i];
@@ -178,13 +278,18 @@ void MergingIterator::FindLargest() {
 
 Iterator* NewMergingIterator(const Comparator* comparator, Iterator** children,
                              int n) {
+  return NewMergingIterator(comparator, children, n, n > kMaxLinearChildren);
+}
+
+Iterator* NewMergingIterator(const Comparator* comparator, Iterator** children,
+                             int n, bool use_heap) {
   assert(n >= 0);
   if (n == 0) {
     return NewEmptyIterator();
   } else if (n == 1) {
     return children[0];
   } else {
-    return new MergingIterator(comparator, children, n);
+    return new MergingIterator(comparator, children, n, use_heap);
   }
 }
 
@@ -21,6 +21,15 @@ class Iterator;
 Iterator* NewMergingIterator(const Comparator* comparator, Iterator** children,
                              int n);
 
+// Merging iterators over more children than this keep them in a heap, so
+// that each step costs O(log n) key comparisons instead of n.
+static const int kMaxLinearChildren = 4;
+
+// Like NewMergingIterator(), but uses a heap if and only if "use_heap" is
+// true.  For tests and benchmarks.
+Iterator* NewMergingIterator(const Comparator* comparator, Iterator** children,
+                             int n, bool use_heap);
+
 }  // namespace leveldb
 
 #endif  // STORAGE_LEVELDB_TABLE_MERGER_H_
@@ -0,0 +1,156 @@
+// Copyright (c) 2026 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "table/merger.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "leveldb/comparator.h"
+#include "leveldb/iterator.h"
+#include "leveldb/options.h"
+#include "table/block.h"
+#include "table/block_builder.h"
+#include "table/format.h"
+#include "util/random.h"
+#include "util/testutil.h"
+
+namespace leveldb {
+
+static std::string RandomKey(Random* rnd) {
+  std::string key;
+  const int len = 1 + rnd->Uniform(8);
+  for (int i = 0; i < len; i++) {
+    key.push_back(static_cast<char>('a' + rnd->Uniform(4)));
+  }
+  return key;
+}
+
+// Holds "n" blocks that split a set of unique keys between them, and the
+// sorted keys for reference.
+class Children {
+ public:
+  ~Children() {
+    for (Block* block : blocks_) {
+      delete block;
+    }
+  }
+
+  void Build(Random* rnd, int n, int num_keys) {
+    std::vector<std::vector<std::string>> child_keys(n);
+    for (int i = 0; i < num_keys; i++) {
+      std::string key = RandomKey(rnd);
+      if (std::find(keys_.begin(), keys_.end(), key) != keys_.end()) {
+        continue;
+      }
+      keys_.push_back(key);
+      child_keys[rnd->Uniform(n)].push_back(key);
+    }
+    std::sort(keys_.begin(), keys_.end());
+
+    for (int c = 0; c < n; c++) {
+      std::sort(child_keys[c].begin(), child_keys[c].end());
+      BlockBuilder builder(&options_);
+      for (const std::string& key : child_keys[c]) {
+        builder.Add(key, "v" + key);
+      }
+      contents_.push_back(builder.Finish().ToString());
+    }
+    for (const std::string& data : contents_) {
+      BlockContents contents;
+      contents.data = data;
+      contents.cachable = false;
+      contents.heap_allocated = false;
+      blocks_.push_back(new Block(contents));
+    }
+  }
+
+  Iterator* NewMerger(bool use_heap) {
+    std::vector<Iterator*> children;
+    for (Block* block : blocks_) {
+      children.push_back(block->NewIterator(BytewiseComparator()));
+    }
+    return NewMergingIterator(BytewiseComparator(), children.data(),
+                              static_cast<int>(children.size()), use_heap);
+  }
+
+  Options options_;
+  std::vector<std::string> contents_;
+  std::vector<Block*> blocks_;
+  std::vector<std::string> keys_;
+};
+
+TEST(MergerTest, MatchesSortedKeys) {
+  Random rnd(301);
+  for (int n : {2, 3, 5, 8, 17, 40}) {
+    Children t;
+    t.Build(&rnd, n, 300);
+    const std::vector<std::string>& keys = t.keys_;
+    for (bool use_heap : {false, true}) {
+      Iterator* iter = t.NewMerger(use_heap);
+      // Index into keys of the expected position; keys.size() if invalid.
+      size_t pos = keys.size();
+      for (int step = 0; step < 2000; step++) {
+        const int op = rnd.Uniform(10);
+        if (op == 0) {
+          iter->SeekToFirst();
+          pos = 0;
+        } else if (op == 1) {
+          iter->SeekToLast();
+          pos = keys.empty() ? 0 : keys.size() - 1;
+        } else if (op == 2) {
+          const std::string target = RandomKey(&rnd);
+          iter->Seek(target);
+          pos = std::lower_bound(keys.begin(), keys.end(), target) -
+                keys.begin();
+        } else if (pos >= keys.size()) {
+          continue;  // Next() and Prev() need a valid iterator
+        } else if (op < 6) {
+          iter->Next();
+          pos++;
+        } else {
+          iter->Prev();
+          pos = (pos == 0) ? keys.size() : pos - 1;
+        }
+
+        ASSERT_EQ(pos < keys.size(), iter->Valid())
+            << "n=" << n << " heap=" << use_heap << " step=" << step;
+        if (iter->Valid()) {
+          ASSERT_EQ(keys[pos], iter->key().ToString());
+          ASSERT_EQ("v" + keys[pos], iter->value().ToString());
+        }
+      }
+      ASSERT_LEVELDB_OK(iter->status());
+      delete iter;
+    }
+  }
+}
+
+TEST(MergerTest, FullScans) {
+  Random rnd(17);
+  Children t;
+  t.Build(&rnd, 25, 1000);
+  Iterator* iter = t.NewMerger(true);
+  size_t count = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    ASSERT_EQ(t.keys_[count], iter->key().ToString());
+    count++;
+  }
+  ASSERT_EQ(t.keys_.size(), count);
+  for (iter->SeekToLast(); iter->Valid(); iter->Prev()) {
+    count--;
+    ASSERT_EQ(t.keys_[count], iter->key().ToString());
+  }
+  ASSERT_EQ(0, count);
+  delete iter;
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
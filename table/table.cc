@@ -4,11 +4,17 @@
 
 #include "leveldb/table.h"
 
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+
 #include "leveldb/cache.h"
 #include "leveldb/comparator.h"
 #include "leveldb/env.h"
 #include "leveldb/filter_policy.h"
 #include "leveldb/options.h"
+#include "leveldb/slice_transform.h"
 #include "table/block.h"
 #include "table/filter_block.h"
 #include "table/format.h"
@@ -17,19 +23,168 @@
 
 namespace leveldb {
 
+namespace {
+
+// A filter block kept in the block cache, with its reader.
+struct CachedFilter {
+  ~CachedFilter() {
+    delete filter;
+    delete full_filter;
+    delete[] data;
+  }
+
+  // Exactly one of filter and full_filter is set.
+  FilterBlockReader* filter;
+  FullFilterBlockReader* full_filter;
+  const char* data;  // Heap-allocated contents, if any
+};
+
+}  // namespace
+
+static void DeleteCachedBlock(const Slice& key, void* value);
+static void DeleteCachedFilter(const Slice& key, void* value);
+
 struct Table::Rep {
   ~Rep() {
+    if (pinned_index != nullptr) {
+      options.block_cache->Release(pinned_index);
+    }
+    if (pinned_filter != nullptr) {
+      options.block_cache->Release(pinned_filter);
+    }
     delete filter;
+    delete full_filter;
     delete[] filter_data;
     delete index_block;
   }
 
+  ReadOptions MetaReadOptions() const {
+    ReadOptions opt;
+    if (options.paranoid_checks) {
+      opt.verify_checksums = true;
+    }
+    return opt;
+  }
+
+  Slice CacheKey(uint64_t offset, char* buffer) const {
+    EncodeFixed64(buffer, cache_id);
+    EncodeFixed64(buffer + 8, offset);
+    return Slice(buffer, 16);
+  }
+
+  // Returns a handle on the index block in block_cache, reading it from
+  // the file if needed, or nullptr (and sets *s) on error.
+  // REQUIRES: cache_meta_blocks
+  Cache::Handle* CachedIndexBlock(Status* s) {
+    char buffer[16];
+    const Slice key = CacheKey(index_handle.offset(), buffer);
+    Cache::Handle* handle = options.block_cache->Lookup(key);
+    if (handle == nullptr) {
+      BlockContents contents;
+      *s = ReadBlock(file, MetaReadOptions(), index_handle, &contents);
+      if (s->ok()) {
+        handle = InsertIndexBlock(new Block(contents));
+      }
+    }
+    return handle;
+  }
+
+  Cache::Handle* InsertIndexBlock(Block* block) {
+    char buffer[16];
+    return options.block_cache->Insert(CacheKey(index_handle.offset(), buffer),
+                                       block, block->size(),
+                                       &DeleteCachedBlock,
+                                       Cache::kHighPriority);
+  }
+
+  // Returns a handle on the CachedFilter in block_cache, reading it from the
+  // file if needed, or nullptr if the filter cannot be read.
+  // REQUIRES: cache_meta_blocks && has_cached_filter
+  Cache::Handle* CachedFilterBlock() {
+    char buffer[16];
+    const Slice key = CacheKey(filter_handle.offset(), buffer);
+    Cache::Handle* handle = options.block_cache->Lookup(key);
+    if (handle == nullptr) {
+      BlockContents contents;
+      if (ReadBlock(file, MetaReadOptions(), filter_handle, &contents).ok()) {
+        handle = InsertFilter(contents);
+      }
+    }
+    return handle;
+  }
+
+  Cache::Handle* InsertFilter(const BlockContents& contents) {
+    CachedFilter* f = new CachedFilter;
+    f->filter = nullptr;
+    f->full_filter = nullptr;
+    f->data = contents.heap_allocated ? contents.data.data() : nullptr;
+    if (full_cached_filter) {
+      f->full_filter =
+          new FullFilterBlockReader(options.filter_policy, contents.data);
+    } else {
+      f->filter = new FilterBlockReader(options.filter_policy, contents.data);
+    }
+    char buffer[16];
+    return options.block_cache->Insert(
+        CacheKey(filter_handle.offset(), buffer), f, contents.data.size(),
+        &DeleteCachedFilter, Cache::kHighPriority);
+  }
+
+  // Sets *f and *ff to the table's filter readers (see filter and
+  // full_filter below).  If the result is non-null, they live in
+  // block_cache and the caller must release it when done with them.
+  Cache::Handle* GetFilters(FilterBlockReader** f, FullFilterBlockReader** ff) {
+    *f = filter;
+    *ff = full_filter;
+    Cache::Handle* handle = nullptr;
+    if (has_cached_filter) {
+      handle = CachedFilterBlock();
+      if (handle != nullptr) {
+        CachedFilter* cached =
+            reinterpret_cast<CachedFilter*>(options.block_cache->Value(handle));
+        *f = cached->filter;
+        *ff = cached->full_filter;
+      }
+    }
+    return handle;
+  }
+
+  void ReleaseFilters(Cache::Handle* handle) {
+    if (handle != nullptr) {
+      options.block_cache->Release(handle);
+    }
+  }
+
   Options options;
   Status status;
   RandomAccessFile* file;
   uint64_t cache_id;
+  // At most one of filter, full_filter and partitioned_filter is set, and
+  // neither filter nor full_filter if the filter is in the block cache.
   FilterBlockReader* filter;
+  FullFilterBlockReader* full_filter;
   const char* filter_data;
+  // With options.cache_index_and_filter_blocks, the index block and the
+  // filter block (if any) live in block_cache under their offsets, and
+  // index_block, filter and full_filter are null.
+  bool cache_meta_blocks;
+  BlockHandle index_handle;
+  bool has_cached_filter;
+  bool full_cached_filter;  // Whether the cached filter is a full filter
+  BlockHandle filter_handle;
+  // Set once PinMetaBlocks() has been called.  The handles keep the cached
+  // index and filter blocks from being evicted.
+  std::atomic<bool> pinned;
+  Cache::Handle* pinned_index;
+  Cache::Handle* pinned_filter;
+  // True if index_block is a top-level index over index partitions.
+  bool partitioned_index;
+  // True if each index partition has a filter, found through the
+  // top-level index.
+  bool partitioned_filter;
+  // True if the filter also holds the key prefixes of
+  // options.prefix_extractor.
+  bool prefix_filtered;
 
   BlockHandle metaindex_handle;  // Handle to metaindex_block: saved from footer
   Block* index_block;
@@ -72,6 +227,22 @@ Status Table::Open(const Options& options, RandomAccessFile* file,
     rep->cache_id = (options.block_cache ? options.block_cache->NewId() : 0);
     rep->filter_data = nullptr;
     rep->filter = nullptr;
+    rep->full_filter = nullptr;
+    rep->cache_meta_blocks =
+        options.cache_index_and_filter_blocks && options.block_cache != nullptr;
+    rep->index_handle = footer.index_handle();
+    rep->has_cached_filter = false;
+    rep->full_cached_filter = false;
+    rep->pinned = false;
+    rep->pinned_index = nullptr;
+    rep->pinned_filter = nullptr;
+    if (rep->cache_meta_blocks) {
+      rep->options.block_cache->Release(rep->InsertIndexBlock(index_block));
+      rep->index_block = nullptr;
+    }
+    rep->partitioned_index = footer.partitioned_index();
+    rep->partitioned_filter = false;
+    rep->prefix_filtered = false;
     *table = new Table(rep);
     (*table)->ReadMeta(footer);
   }
@@ -98,17 +269,41 @@ void Table::ReadMeta(const Footer& footer) {
   Block* meta = new Block(contents);
 
   Iterator* iter = meta->NewIterator(BytewiseComparator());
-  std::string key = "filter.";
-  key.append(rep_->options.filter_policy->Name());
-  iter->Seek(key);
-  if (iter->Valid() && iter->key() == Slice(key)) {
-    ReadFilter(iter->value());
+  std::string key;
+  if (rep_->partitioned_index) {
+    // Partition filters are read along with their index partitions
+    key = "partitionedfilter.";
+    key.append(rep_->options.filter_policy->Name());
+    iter->Seek(key);
+    rep_->partitioned_filter = iter->Valid() && iter->key() == Slice(key);
+  } else {
+    key = "fullfilter.";
+    key.append(rep_->options.filter_policy->Name());
+    iter->Seek(key);
+    if (iter->Valid() && iter->key() == Slice(key)) {
+      ReadFilter(iter->value(), true);
+    } else {
+      key = "filter.";
+      key.append(rep_->options.filter_policy->Name());
+      iter->Seek(key);
+      if (iter->Valid() && iter->key() == Slice(key)) {
+        ReadFilter(iter->value(), false);
+      }
+    }
+  }
+  if (rep_->options.prefix_extractor != nullptr &&
+      (rep_->filter != nullptr || rep_->full_filter != nullptr ||
+       rep_->has_cached_filter || rep_->partitioned_filter)) {
+    key = "prefix.";
+    key.append(rep_->options.prefix_extractor->Name());
+    iter->Seek(key);
+    rep_->prefix_filtered = iter->Valid() && iter->key() == Slice(key);
   }
   delete iter;
   delete meta;
 }
 
-void Table::ReadFilter(const Slice& filter_handle_value) {
+void Table::ReadFilter(const Slice& filter_handle_value, bool full) {
   Slice v = filter_handle_value;
   BlockHandle filter_handle;
   if (!filter_handle.DecodeFrom(&v).ok()) {
@@ -125,14 +320,38 @@ void Table::ReadFilter(const Slice& filter_handle_value) {
   if (!ReadBlock(rep_->file, opt, filter_handle, &block).ok()) {
     return;
   }
+  if (rep_->cache_meta_blocks) {
+    rep_->has_cached_filter = true;
+    rep_->full_cached_filter = full;
+    rep_->filter_handle = filter_handle;
+    rep_->options.block_cache->Release(rep_->InsertFilter(block));
+    return;
+  }
   if (block.heap_allocated) {
     rep_->filter_data = block.data.data();  // Will need to delete later
   }
-  rep_->filter = new FilterBlockReader(rep_->options.filter_policy, block.data);
+  if (full) {
+    rep_->full_filter =
+        new FullFilterBlockReader(rep_->options.filter_policy, block.data);
+  } else {
+    rep_->filter =
+        new FilterBlockReader(rep_->options.filter_policy, block.data);
+  }
 }
 
 Table::~Table() { delete rep_; }
 
+void Table::PinMetaBlocks() {
+  if (!rep_->cache_meta_blocks || rep_->pinned.exchange(true)) {
+    return;
+  }
+  Status s;
+  rep_->pinned_index = rep_->CachedIndexBlock(&s);
+  if (rep_->has_cached_filter) {
+    rep_->pinned_filter = rep_->CachedFilterBlock();
+  }
+}
+
 static void DeleteBlock(void* arg, void* ignored) {
   delete reinterpret_cast<Block*>(arg);
 }
@@ -142,6 +361,49 @@ static void DeleteCachedBlock(const Slice& key, void* value) {
   delete block;
 }
 
+static void DeleteFilterPartition(BlockContents* contents) {
+  if (contents->heap_allocated) {
+    delete[] contents->data.data();
+  }
+  delete contents;
+}
+
+static void DeleteCachedFilterPartition(const Slice& key, void* value) {
+  DeleteFilterPartition(reinterpret_cast<BlockContents*>(value));
+}
+
+static void DeleteCachedFilter(const Slice& key, void* value) {
+  delete reinterpret_cast<CachedFilter*>(value);
+}
+
+namespace {
+
+// InternalMultiGet() reads the uncached data blocks of up to this many keys
+// with one ReadBlocks() call.
+const size_t kMultiGetBatch = 32;
+
+// Readahead for a sequential scan starts after this many consecutive data
+// blocks, with a window of kInitialReadahead bytes that doubles on every
+// prefetch up to kMaxReadahead.
+const int kReadaheadTrigger = 2;
+const size_t kInitialReadahead = 8 * 1024;
+const size_t kMaxReadahead = 256 * 1024;
+
+// Readahead state of one table iterator; see Table::ReadaheadBlockReader().
+struct ReadaheadState {
+  Table* table;
+  uint64_t next_offset;       // Offset of the block after the last one read
+  int num_sequential;         // Consecutive blocks read so far
+  size_t window;              // Next adaptive prefetch size
+  uint64_t prefetched_until;  // End of the data prefetched so far
+};
+
+void DeleteReadaheadState(void* arg, void* ignored) {
+  delete reinterpret_cast<ReadaheadState*>(arg);
+}
+
+}  // namespace
+
 static void ReleaseBlock(void* arg, void* h) {
   Cache* cache = reinterpret_cast<Cache*>(arg);
   Cache::Handle* handle = reinterpret_cast<Cache::Handle*>(h);
@@ -152,6 +414,52 @@ static void ReleaseBlock(void* arg, void* h) {
 // into an iterator over the contents of the corresponding block.
 Iterator* Table::BlockReader(void* arg, const ReadOptions& options,
                              const Slice& index_value) {
+  return NewBlockIterator(arg, options, index_value, false,
+                          Cache::kLowPriority);
+}
+
+Iterator* Table::ReadaheadBlockReader(void* arg, const ReadOptions& options,
+                                       const Slice& index_value) {
+  ReadaheadState* state = reinterpret_cast<ReadaheadState*>(arg);
+  BlockHandle handle;
+  Slice input = index_value;
+  if (handle.DecodeFrom(&input).ok()) {
+    if (handle.offset() == state->next_offset) {
+      state->num_sequential++;
+    } else {
+      state->num_sequential = 0;
+      state->window = kInitialReadahead;
+      state->prefetched_until = 0;
+    }
+    const uint64_t end = handle.offset() + handle.size() + kBlockTrailerSize;
+    state->next_offset = end;
+
+    size_t window = 0;
+    if (options.readahead_size > 0) {
+      window = options.readahead_size;
+    } else if (state->num_sequential >= kReadaheadTrigger) {
+      window = state->window;
+    }
+    if (window > 0 && end > state->prefetched_until) {
+      // Errors only cost the hint
+      state->table->rep_->file->Prefetch(handle.offset(), window);
+      state->prefetched_until = handle.offset() + window;
+      state->window = std::min(2 * state->window, kMaxReadahead);
+    }
+  }
+  return NewBlockIterator(state->table, options, index_value, false,
+                          Cache::kLowPriority);
+}
+
+Iterator* Table::PointLookupBlockReader(void* arg, const ReadOptions& options,
+                                        const Slice& index_value) {
+  return NewBlockIterator(arg, options, index_value, true,
+                          Cache::kLowPriority);
+}
+
+Iterator* Table::NewBlockIterator(void* arg, const ReadOptions& options,
+                                  const Slice& index_value, bool point_lookup,
+                                  Cache::Priority priority) {
   Table* table = reinterpret_cast<Table*>(arg);
   Cache* block_cache = table->rep_->options.block_cache;
   Block* block = nullptr;
@@ -179,7 +487,7 @@ Iterator* Table::BlockReader(void* arg, const ReadOptions& options,
           block = new Block(contents);
           if (contents.cachable && options.fill_cache) {
             cache_handle = block_cache->Insert(key, block, block->size(),
-                                               &DeleteCachedBlock);
+                                               &DeleteCachedBlock, priority);
           }
         }
       }
@@ -193,7 +501,9 @@ Iterator* Table::BlockReader(void* arg, const ReadOptions& options,
 
   Iterator* iter;
   if (block != nullptr) {
-    iter = block->NewIterator(table->rep_->options.comparator);
+    iter = point_lookup
+               ? block->NewPointLookupIterator(table->rep_->options.comparator)
+               : block->NewIterator(table->rep_->options.comparator);
     if (cache_handle == nullptr) {
       iter->RegisterCleanup(&DeleteBlock, block, nullptr);
     } else {
@@ -205,27 +515,266 @@ Iterator* Table::BlockReader(void* arg, const ReadOptions& options,
   return iter;
 }
 
+void Table::NewPointLookupIterators(const ReadOptions& options, int n,
+                                    const Slice* index_values,
+                                    Iterator** iters) const {
+  Cache* block_cache = rep_->options.block_cache;
+  const Comparator* comparator = rep_->options.comparator;
+  std::vector<BlockHandle> handles(n);
+  std::vector<int> to_read;  // Indexes of the blocks to read
+  for (int i = 0; i < n; i++) {
+    iters[i] = nullptr;
+    Slice input = index_values[i];
+    Status s = handles[i].DecodeFrom(&input);
+    if (!s.ok()) {
+      iters[i] = NewErrorIterator(s);
+      continue;
+    }
+    if (block_cache != nullptr) {
+      char cache_key_buffer[16];
+      Cache::Handle* cache_handle = block_cache->Lookup(
+          rep_->CacheKey(handles[i].offset(), cache_key_buffer));
+      if (cache_handle != nullptr) {
+        Block* block =
+            reinterpret_cast<Block*>(block_cache->Value(cache_handle));
+        iters[i] = block->NewPointLookupIterator(comparator);
+        iters[i]->RegisterCleanup(&ReleaseBlock, block_cache, cache_handle);
+        continue;
+      }
+    }
+    to_read.push_back(i);
+  }
+  if (to_read.empty()) {
+    return;
+  }
+
+  std::vector<BlockHandle> read_handles;
+  for (int i : to_read) {
+    read_handles.push_back(handles[i]);
+  }
+  std::vector<BlockContents> contents(to_read.size());
+  std::vector<Status> statuses(to_read.size());
+  ReadBlocks(rep_->file, options, static_cast<int>(to_read.size()),
+             read_handles.data(), contents.data(), statuses.data());
+  for (size_t r = 0; r < to_read.size(); r++) {
+    const int i = to_read[r];
+    if (!statuses[r].ok()) {
+      iters[i] = NewErrorIterator(statuses[r]);
+      continue;
+    }
+    Block* block = new Block(contents[r]);
+    Cache::Handle* cache_handle = nullptr;
+    if (block_cache != nullptr && contents[r].cachable && options.fill_cache) {
+      char cache_key_buffer[16];
+      cache_handle = block_cache->Insert(
+          rep_->CacheKey(handles[i].offset(), cache_key_buffer), block,
+          block->size(), &DeleteCachedBlock, Cache::kLowPriority);
+    }
+    iters[i] = block->NewPointLookupIterator(comparator);
+    if (cache_handle == nullptr) {
+      iters[i]->RegisterCleanup(&DeleteBlock, block, nullptr);
+    } else {
+      iters[i]->RegisterCleanup(&ReleaseBlock, block_cache, cache_handle);
+    }
+  }
+}
+
+Iterator* Table::IndexPartitionReader(void* arg, const ReadOptions& options,
+                                       const Slice& index_value) {
+  return NewBlockIterator(arg, options, index_value, false,
+                          reinterpret_cast<Table*>(arg)->MetaBlockPriority());
+}
+
+Cache::Priority Table::MetaBlockPriority() const {
+  return rep_->cache_meta_blocks ? Cache::kHighPriority : Cache::kLowPriority;
+}
+
+Iterator* Table::NewIndexBlockIterator() const {
+  if (!rep_->cache_meta_blocks) {
+    return rep_->index_block->NewIterator(rep_->options.comparator);
+  }
+  Status s;
+  Cache::Handle* handle = rep_->CachedIndexBlock(&s);
+  if (handle == nullptr) {
+    return NewErrorIterator(s);
+  }
+  Cache* block_cache = rep_->options.block_cache;
+  Block* block = reinterpret_cast<Block*>(block_cache->Value(handle));
+  Iterator* iter = block->NewIterator(rep_->options.comparator);
+  iter->RegisterCleanup(&ReleaseBlock, block_cache, handle);
+  return iter;
+}
+
+Iterator* Table::NewIndexIterator(const ReadOptions& options) const {
+  Iterator* iter = NewIndexBlockIterator();
+  if (rep_->partitioned_index) {
+    // Index partitions are blocks like any other
+    iter = NewTwoLevelIterator(iter, &Table::IndexPartitionReader,
+                               const_cast<Table*>(this), options);
+  }
+  return iter;
+}
+
+bool Table::FilterMayMatch(const ReadOptions& options,
+                           FullFilterBlockReader* full_filter,
+                           const Slice& key) const {
+  if (full_filter != nullptr) {
+    return full_filter->KeyMayMatch(key);
+  }
+  if (!rep_->partitioned_filter) {
+    return true;
+  }
+  Iterator* top_iter = NewIndexBlockIterator();
+  top_iter->Seek(key);
+  bool may_match;
+  if (top_iter->Valid()) {
+    may_match = PartitionFilterMayMatch(options, top_iter->value(), key);
+  } else {
+    may_match = !top_iter->status().ok();  // Past the last key otherwise
+  }
+  delete top_iter;
+  return may_match;
+}
+
+bool Table::PartitionFilterMayMatch(const ReadOptions& options,
+                                    const Slice& top_index_value,
+                                    const Slice& filter_key) const {
+  Slice input = top_index_value;
+  BlockHandle index_handle, filter_handle;
+  if (!index_handle.DecodeFrom(&input).ok() ||
+      !filter_handle.DecodeFrom(&input).ok()) {
+    return true;  // Errors are treated as potential matches
+  }
+
+  Cache* block_cache = rep_->options.block_cache;
+  Cache::Handle* cache_handle = nullptr;
+  BlockContents* contents = nullptr;
+  char cache_key_buffer[16];
+  const Slice cache_key(cache_key_buffer, sizeof(cache_key_buffer));
+  if (block_cache != nullptr) {
+    EncodeFixed64(cache_key_buffer, rep_->cache_id);
+    EncodeFixed64(cache_key_buffer + 8, filter_handle.offset());
+    cache_handle = block_cache->Lookup(cache_key);
+    if (cache_handle != nullptr) {
+      contents =
+          reinterpret_cast<BlockContents*>(block_cache->Value(cache_handle));
+    }
+  }
+  if (contents == nullptr) {
+    contents = new BlockContents;
+    if (!ReadBlock(rep_->file, options, filter_handle, contents).ok()) {
+      delete contents;
+      return true;
+    }
+    if (block_cache != nullptr && contents->cachable && options.fill_cache) {
+      cache_handle = block_cache->Insert(
+          cache_key, contents, contents->data.size(),
+          &DeleteCachedFilterPartition, MetaBlockPriority());
+    }
+  }
+
+  const bool may_match =
+      FullFilterBlockReader(rep_->options.filter_policy, contents->data)
+          .KeyMayMatch(filter_key);
+  if (cache_handle != nullptr) {
+    block_cache->Release(cache_handle);
+  } else {
+    DeleteFilterPartition(contents);
+  }
+  return may_match;
+}
+
 Iterator* Table::NewIterator(const ReadOptions& options) const {
-  return NewTwoLevelIterator(
-      rep_->index_block->NewIterator(rep_->options.comparator),
-      &Table::BlockReader, const_cast<Table*>(this), options);
+  Iterator* index_iter = NewIndexIterator(options);
+  if (options.iterate_upper_bound != nullptr) {
+    index_iter = NewUpperBoundIndexIterator(
+        index_iter, rep_->options.comparator, *options.iterate_upper_bound);
+  }
+  ReadaheadState* readahead = new ReadaheadState;
+  readahead->table = const_cast<Table*>(this);
+  readahead->next_offset = ~static_cast<uint64_t>(0);
+  readahead->num_sequential = 0;
+  readahead->window = kInitialReadahead;
+  readahead->prefetched_until = 0;
+  Iterator* iter = NewTwoLevelIterator(
+      index_iter, &Table::ReadaheadBlockReader, readahead, options);
+  iter->RegisterCleanup(&DeleteReadaheadState, readahead, nullptr);
+  if (options.prefix_same_as_start && rep_->prefix_filtered) {
+    iter = NewPrefixSeekIterator(iter, &Table::PrefixMayMatch,
+                                 const_cast<Table*>(this));
+  }
+  return iter;
+}
+
+bool Table::PrefixMayMatch(void* arg, const Slice& key) {
+  Table* table = reinterpret_cast<Table*>(arg);
+  Rep* r = table->rep_;
+  const SliceTransform* extractor = r->options.prefix_extractor;
+  if (!r->prefix_filtered || !extractor->InDomain(key)) {
+    return true;
+  }
+  // See TableBuilder::Rep for the padding.
+  std::string probe = extractor->Transform(key).ToString();
+  probe.append(8, '\0');
+  FilterBlockReader* filter;
+  FullFilterBlockReader* full_filter;
+  Cache::Handle* filter_handle = r->GetFilters(&filter, &full_filter);
+  bool may_match = false;
+  if (full_filter != nullptr) {
+    may_match = full_filter->KeyMayMatch(probe);
+  } else if (filter == nullptr && !r->partitioned_filter) {
+    may_match = true;  // The cached filter could not be read
+  } else {
+    // Keys sharing a prefix are adjacent, so only the first key at or after
+    // "key" can start a run with the prefix.  It is in the block (or index
+    // partition) a seek to "key" lands in, or (if "key" sorts between that
+    // block's last key and its index key) in the next one.
+    Iterator* iiter = table->NewIndexBlockIterator();
+    iiter->Seek(key);
+    for (int i = 0; i < 2 && !may_match && iiter->Valid(); i++) {
+      if (r->partitioned_filter) {
+        may_match = table->PartitionFilterMayMatch(ReadOptions(),
+                                                   iiter->value(), probe);
+      } else {
+        Slice handle_value = iiter->value();
+        BlockHandle handle;
+        may_match = !handle.DecodeFrom(&handle_value).ok() ||
+                    filter->KeyMayMatch(handle.offset(), probe);
+      }
+      iiter->Next();
+    }
+    if (!iiter->status().ok()) {
+      may_match = true;
+    }
+    delete iiter;
+  }
+  r->ReleaseFilters(filter_handle);
+  return may_match;
 }
 
 Status Table::InternalGet(const ReadOptions& options, const Slice& k, void* arg,
                           void (*handle_result)(void*, const Slice&,
                                                 const Slice&)) {
+  FilterBlockReader* filter;
+  FullFilterBlockReader* full_filter;
+  Cache::Handle* filter_handle = rep_->GetFilters(&filter, &full_filter);
+  if (!FilterMayMatch(options, full_filter, k)) {
+    rep_->ReleaseFilters(filter_handle);
+    return Status::OK();  // Not found, without looking at the index
+  }
+
   Status s;
-  Iterator* iiter = rep_->index_block->NewIterator(rep_->options.comparator);
+  Iterator* iiter = NewIndexIterator(options);
   iiter->Seek(k);
   if (iiter->Valid()) {
     Slice handle_value = iiter->value();
-    FilterBlockReader* filter = rep_->filter;
     BlockHandle handle;
     if (filter != nullptr && handle.DecodeFrom(&handle_value).ok() &&
         !filter->KeyMayMatch(handle.offset(), k)) {
       // Not found
     } else {
-      Iterator* block_iter = BlockReader(this, options, iiter->value());
+      Iterator* block_iter =
+          PointLookupBlockReader(this, options, iiter->value());
       block_iter->Seek(k);
       if (block_iter->Valid()) {
         (*handle_result)(arg, block_iter->key(), block_iter->value());
@@ -238,12 +787,83 @@ Status Table::InternalGet(const ReadOptions& options, const Slice& k, void* arg,
     s = iiter->status();
   }
   delete iiter;
+  rep_->ReleaseFilters(filter_handle);
+  return s;
+}
+
+Status Table::InternalMultiGet(const ReadOptions& options, int n,
+                               const Slice* keys, void** args,
+                               void (*handle_result)(void*, const Slice&,
+                                                     const Slice&)) {
+  Status s;
+  FilterBlockReader* filter;
+  FullFilterBlockReader* full_filter;
+  Cache::Handle* filter_handle = rep_->GetFilters(&filter, &full_filter);
+  Iterator* iiter = NewIndexIterator(options);
+  bool past_last_block = false;
+  int start = 0;
+  while (start < n && !past_last_block && s.ok()) {
+    // Find the data blocks of the next keys.  Sorted keys that map to the
+    // same index entry share a block.
+    std::vector<std::string> index_values;
+    std::vector<int> key_blocks;  // Index into index_values, or -1
+    int end = start;
+    while (end < n && index_values.size() < kMultiGetBatch) {
+      const Slice& k = keys[end];
+      int b = -1;
+      if (FilterMayMatch(options, full_filter, k)) {
+        iiter->Seek(k);
+        if (!iiter->Valid()) {
+          // This key and all later ones are past the last block.
+          past_last_block = true;
+          break;
+        }
+        Slice handle_value = iiter->value();
+        BlockHandle handle;
+        if (filter == nullptr || !handle.DecodeFrom(&handle_value).ok() ||
+            filter->KeyMayMatch(handle.offset(), k)) {
+          if (index_values.empty() || iiter->value() != index_values.back()) {
+            index_values.push_back(iiter->value().ToString());
+          }
+          b = static_cast<int>(index_values.size()) - 1;
+        }
+      }
+      key_blocks.push_back(b);
+      end++;
+    }
+
+    // Read the blocks that are not cached together.
+    std::vector<Slice> block_values(index_values.begin(), index_values.end());
+    std::vector<Iterator*> block_iters(index_values.size());
+    NewPointLookupIterators(options, static_cast<int>(block_values.size()),
+                            block_values.data(), block_iters.data());
+    for (int i = start; i < end && s.ok(); i++) {
+      const int b = key_blocks[i - start];
+      if (b < 0) {
+        continue;  // Not found
+      }
+      Iterator* block_iter = block_iters[b];
+      block_iter->Seek(keys[i]);
+      if (block_iter->Valid()) {
+        (*handle_result)(args[i], block_iter->key(), block_iter->value());
+      }
+      s = block_iter->status();
+    }
+    for (Iterator* block_iter : block_iters) {
+      delete block_iter;
+    }
+    start = end;
+  }
+  if (s.ok()) {
+    s = iiter->status();
+  }
+  delete iiter;
+  rep_->ReleaseFilters(filter_handle);
   return s;
 }
 
 uint64_t Table::ApproximateOffsetOf(const Slice& key) const {
-  Iterator* index_iter =
-      rep_->index_block->NewIterator(rep_->options.comparator);
+  Iterator* index_iter = NewIndexIterator(ReadOptions());
   index_iter->Seek(key);
   uint64_t result;
   if (index_iter->Valid()) {
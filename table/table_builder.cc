@@ -5,33 +5,113 @@
 #include "leveldb/table_builder.h"
 
 #include <cassert>
+#include <deque>
+#include <vector>
 
 #include "leveldb/comparator.h"
 #include "leveldb/env.h"
 #include "leveldb/filter_policy.h"
 #include "leveldb/options.h"
+#include "leveldb/slice_transform.h"
 #include "table/block_builder.h"
 #include "table/filter_block.h"
 #include "table/format.h"
+#include "table/table_builder_internal.h"
 #include "util/coding.h"
 #include "util/crc32c.h"
+#include "util/mutexlock.h"
+#include "util/thread_pool.h"
 
 namespace leveldb {
 
+// Data blocks queued per compression thread before the builder waits for
+// the oldest one to be written.
+static const int kPendingBlocksPerThread = 2;
+
+// Compresses "raw" into *compressed as "type" asks.  Returns the type the
+// block is stored with, which is kNoCompression, leaving *compressed
+// unused, when the compression does not pay off.
+static CompressionType CompressBlock(const Slice& raw, CompressionType type,
+                                     std::string* compressed) {
+  switch (type) {
+    case kNoCompression:
+      break;
+
+    case kSnappyCompression:
+      if (port::Snappy_Compress(raw.data(), raw.size(), compressed) &&
+          compressed->size() < raw.size() - (raw.size() / 8u)) {
+        return kSnappyCompression;
+      }
+      // Snappy not supported, or compressed less than 12.5%, so just
+      // store uncompressed form
+      break;
+  }
+  return kNoCompression;
+}
+
+static void EncodeBlockTrailer(const Slice& block_contents,
+                               CompressionType type, char* trailer) {
+  trailer[0] = type;
+  uint32_t crc = crc32c::Value(block_contents.data(), block_contents.size());
+  crc = crc32c::Extend(crc, trailer, 1);  // Extend crc to cover block type
+  EncodeFixed32(trailer + 1, crc32c::Mask(crc));
+}
+
+// A finished data block handed to the compression threads.
+struct TableBuilder::PendingBlock {
+  PendingBlock(port::Mutex* mu, port::CondVar* cv)
+      : mu(mu), cv(cv), has_index_key(false), done(false) {}
+
+  port::Mutex* const mu;
+  port::CondVar* const cv;
+
+  std::string raw;
+  CompressionType type;  // Asked for, then the one the block is stored with
+  std::string compressed;
+  Slice contents;  // Points into raw or compressed
+  char trailer[kBlockTrailerSize];
+
+  // Keys for the filter, added when the block is written.  Which filter
+  // they go to depends on where the block ends up.
+  std::string filter_keys;
+  std::vector<size_t> filter_key_starts;
+
+  // Key of the block's index entry, known once the next block starts
+  bool has_index_key;
+  std::string index_key;
+
+  bool done;  // Guarded by *mu; contents and trailer are set
+};
+
 struct TableBuilder::Rep {
-  Rep(const Options& opt, WritableFile* f)
+  Rep(const Options& opt, WritableFile* f, ThreadPool* pool, bool own_pool)
       : options(opt),
         index_block_options(opt),
         file(f),
         offset(0),
-        data_block(&options),
+        data_block(&options, opt.data_block_hash_index),
         index_block(&index_block_options),
         num_entries(0),
         closed(false),
-        filter_block(opt.filter_policy == nullptr
+        top_index_block(&index_block_options),
+        partitioned(opt.partitioned_index),
+        filter_block(opt.filter_policy == nullptr || opt.full_table_filter ||
+                             opt.partitioned_index
                          ? nullptr
                          : new FilterBlockBuilder(opt.filter_policy)),
-        pending_index_entry(false) {
+        full_filter_block(opt.filter_policy == nullptr ||
+                                  !(opt.full_table_filter ||
+                                    opt.partitioned_index)
+                              ? nullptr
+                              : new FullFilterBlockBuilder(opt.filter_policy)),
+        prefix_extractor(opt.filter_policy == nullptr ? nullptr
+                                                      : opt.prefix_extractor),
+        has_last_prefix(false),
+        pending_index_entry(false),
+        own_compression_pool(own_pool ? pool : nullptr),
+        compression_pool(pool),
+        pending_bytes(0),
+        pending_cv(&pending_mu) {
     index_block_options.block_restart_interval = 1;
   }
 
@@ -45,7 +125,24 @@ struct TableBuilder::Rep {
   std::string last_key;
   int64_t num_entries;
   bool closed;  // Either Finish() or Abandon() has been called.
+
+  // With a partitioned index, index_block holds the current partition and
+  // top_index_block maps the last key of each partition to its handle,
+  // followed by the handle of its filter (built in full_filter_block).
+  BlockBuilder top_index_block;
+  const bool partitioned;
+
   FilterBlockBuilder* filter_block;
+  FullFilterBlockBuilder* full_filter_block;
+
+  // Key prefixes are added to the filter once per data block (or once per
+  // table for a full filter), each followed by eight zero bytes.  The
+  // padding lets filter policies that strip the 8-byte suffix of internal
+  // keys see the bare prefix.
+  const SliceTransform* prefix_extractor;
+  bool has_last_prefix;
+  std::string last_prefix;
+  std::string prefix_filter_key;
 
   // We do not emit the index entry for a block until we have seen the
   // first key for the next data block.  This allows us to use shorter
@@ -60,18 +157,65 @@ struct TableBuilder::Rep {
   BlockHandle pending_handle;  // Handle to add to index block
 
   std::string compressed_output;
+
+  // With a compression_pool, each finished data block goes to
+  // compression_pool and waits in pending_blocks, in file order, until it
+  // is compressed and the key of its index entry is known.  Only then is
+  // it written, and its keys added to the filter, so that the index and
+  // the filters see the block at its final offset.  filter_keys and
+  // filter_key_starts collect the filter keys of the block being built.
+  // compression_pool is own_compression_pool, if the builder started one,
+  // or a pool shared with other builders.  pending_bytes is what
+  // pending_blocks would take up in the file uncompressed.
+  ThreadPool* const own_compression_pool;
+  ThreadPool* const compression_pool;
+  uint64_t pending_bytes;
+  port::Mutex pending_mu;
+  port::CondVar pending_cv;
+  std::deque<PendingBlock*> pending_blocks;
+  std::string filter_keys;
+  std::vector<size_t> filter_key_starts;
 };
 
+static ThreadPool* NewCompressionPool(const Options& options) {
+  return options.compression_threads > 0
+             ? new ThreadPool(options.env, options.compression_threads)
+             : nullptr;
+}
+
 TableBuilder::TableBuilder(const Options& options, WritableFile* file)
-    : rep_(new Rep(options, file)) {
+    : TableBuilder(new Rep(options, file, NewCompressionPool(options), true)) {}
+
+TableBuilder::TableBuilder(Rep* rep) : rep_(rep) {
   if (rep_->filter_block != nullptr) {
     rep_->filter_block->StartBlock(0);
   }
 }
 
+TableBuilder* TableBuilderInternal::New(const Options& options,
+                                        WritableFile* file,
+                                        ThreadPool* compression_pool) {
+  return new TableBuilder(
+      new TableBuilder::Rep(options, file, compression_pool, false));
+}
+
 TableBuilder::~TableBuilder() {
   assert(rep_->closed);  // Catch errors where caller forgot to call Finish()
+  // Waits for the blocks still being compressed
+  {
+    MutexLock l(&rep_->pending_mu);
+    for (PendingBlock* block : rep_->pending_blocks) {
+      while (!block->done) {
+        rep_->pending_cv.Wait();
+      }
+    }
+  }
+  delete rep_->own_compression_pool;
+  for (PendingBlock* block : rep_->pending_blocks) {
+    delete block;
+  }
   delete rep_->filter_block;
+  delete rep_->full_filter_block;
   delete rep_;
 }
 
@@ -82,6 +226,14 @@ Status TableBuilder::ChangeOptions(const Options& options) {
   if (options.comparator != rep_->options.comparator) {
     return Status::InvalidArgument("changing comparator while building table");
   }
+  if (options.partitioned_index != rep_->partitioned) {
+    return Status::InvalidArgument(
+        "changing partitioned_index while building table");
+  }
+  if (options.compression_threads != rep_->options.compression_threads) {
+    return Status::InvalidArgument(
+        "changing compression_threads while building table");
+  }
 
   // Note that any live BlockBuilders point to rep_->options and therefore
   // will automatically pick up the updated options.
@@ -102,14 +254,29 @@ void TableBuilder::Add(const Slice& key, const Slice& value) {
   if (r->pending_index_entry) {
     assert(r->data_block.empty());
     r->options.comparator->FindShortestSeparator(&r->last_key, key);
-    std::string handle_encoding;
-    r->pending_handle.EncodeTo(&handle_encoding);
-    r->index_block.Add(r->last_key, Slice(handle_encoding));
     r->pending_index_entry = false;
+    if (r->compression_pool == nullptr) {
+      AddIndexEntry(r->last_key, r->pending_handle);
+    } else {
+      PendingBlock* block = r->pending_blocks.back();
+      block->index_key = r->last_key;
+      block->has_index_key = true;
+    }
   }
 
-  if (r->filter_block != nullptr) {
-    r->filter_block->AddKey(key);
+  if (r->filter_block != nullptr || r->full_filter_block != nullptr) {
+    AddFilterKey(key);
+  }
+
+  if (r->prefix_extractor != nullptr && r->prefix_extractor->InDomain(key)) {
+    const Slice prefix = r->prefix_extractor->Transform(key);
+    if (!r->has_last_prefix || prefix != Slice(r->last_prefix)) {
+      r->has_last_prefix = true;
+      r->last_prefix.assign(prefix.data(), prefix.size());
+      r->prefix_filter_key = r->last_prefix;
+      r->prefix_filter_key.append(8, '\0');
+      AddFilterKey(r->prefix_filter_key);
+    }
   }
 
   r->last_key.assign(key.data(), key.size());
@@ -122,12 +289,44 @@ void TableBuilder::Add(const Slice& key, const Slice& value) {
   }
 }
 
+void TableBuilder::AddFilterKey(const Slice& key) {
+  Rep* r = rep_;
+  if (r->compression_pool != nullptr) {
+    r->filter_key_starts.push_back(r->filter_keys.size());
+    r->filter_keys.append(key.data(), key.size());
+  } else if (r->filter_block != nullptr) {
+    r->filter_block->AddKey(key);
+  } else {
+    r->full_filter_block->AddKey(key);
+  }
+}
+
+void TableBuilder::AddIndexEntry(const Slice& key, const BlockHandle& handle) {
+  Rep* r = rep_;
+  std::string handle_encoding;
+  handle.EncodeTo(&handle_encoding);
+  r->index_block.Add(key, Slice(handle_encoding));
+  if (r->partitioned &&
+      r->index_block.CurrentSizeEstimate() >= r->options.block_size) {
+    FlushIndexPartition(key);
+  }
+}
+
 void TableBuilder::Flush() {
   Rep* r = rep_;
   assert(!r->closed);
   if (!ok()) return;
   if (r->data_block.empty()) return;
   assert(!r->pending_index_entry);
+  if (r->compression_pool != nullptr) {
+    ScheduleDataBlock();
+    r->pending_index_entry = true;
+    // The filter that gets the block's keys is only known once it is
+    // written, so every block repeats its first prefix.
+    r->has_last_prefix = false;
+    WriteCompletedBlocks(false);
+    return;
+  }
   WriteBlock(&r->data_block, &r->pending_handle);
   if (ok()) {
     r->pending_index_entry = true;
@@ -135,6 +334,7 @@ void TableBuilder::Flush() {
   }
   if (r->filter_block != nullptr) {
     r->filter_block->StartBlock(r->offset);
+    r->has_last_prefix = false;
   }
 }
 
@@ -147,28 +347,11 @@ void TableBuilder::WriteBlock(BlockBuilder* block, BlockHandle* handle) {
   Rep* r = rep_;
   Slice raw = block->Finish();
 
-  Slice block_contents;
-  CompressionType type = r->options.compression;
   // TODO(postrelease): Support more compression options: zlib?
-  switch (type) {
-    case kNoCompression:
-      block_contents = raw;
-      break;
-
-    case kSnappyCompression: {
-      std::string* compressed = &r->compressed_output;
-      if (port::Snappy_Compress(raw.data(), raw.size(), compressed) &&
-          compressed->size() < raw.size() - (raw.size() / 8u)) {
-        block_contents = *compressed;
-      } else {
-        // Snappy not supported, or compressed less than 12.5%, so just
-        // store uncompressed form
-        block_contents = raw;
-        type = kNoCompression;
-      }
-      break;
-    }
-  }
+  const CompressionType type =
+      CompressBlock(raw, r->options.compression, &r->compressed_output);
+  const Slice block_contents =
+      type == kNoCompression ? raw : Slice(r->compressed_output);
   WriteRawBlock(block_contents, type, handle);
   r->compressed_output.clear();
   block->Reset();
@@ -176,16 +359,18 @@ void TableBuilder::WriteBlock(BlockBuilder* block, BlockHandle* handle) {
 
 void TableBuilder::WriteRawBlock(const Slice& block_contents,
                                  CompressionType type, BlockHandle* handle) {
+  char trailer[kBlockTrailerSize];
+  EncodeBlockTrailer(block_contents, type, trailer);
+  AppendBlock(block_contents, trailer, handle);
+}
+
+void TableBuilder::AppendBlock(const Slice& block_contents,
+                               const char* trailer, BlockHandle* handle) {
   Rep* r = rep_;
   handle->set_offset(r->offset);
   handle->set_size(block_contents.size());
   r->status = r->file->Append(block_contents);
   if (r->status.ok()) {
-    char trailer[kBlockTrailerSize];
-    trailer[0] = type;
-    uint32_t crc = crc32c::Value(block_contents.data(), block_contents.size());
-    crc = crc32c::Extend(crc, trailer, 1);  // Extend crc to cover block type
-    EncodeFixed32(trailer + 1, crc32c::Mask(crc));
     r->status = r->file->Append(Slice(trailer, kBlockTrailerSize));
     if (r->status.ok()) {
       r->offset += block_contents.size() + kBlockTrailerSize;
@@ -193,6 +378,115 @@ void TableBuilder::WriteRawBlock(const Slice& block_contents,
   }
 }
 
+void TableBuilder::CompressPendingBlock(void* arg) {
+  PendingBlock* block = reinterpret_cast<PendingBlock*>(arg);
+  block->type = CompressBlock(block->raw, block->type, &block->compressed);
+  block->contents = block->type == kNoCompression ? Slice(block->raw)
+                                                  : Slice(block->compressed);
+  EncodeBlockTrailer(block->contents, block->type, block->trailer);
+
+  MutexLock l(block->mu);
+  block->done = true;
+  block->cv->SignalAll();
+}
+
+// Hands the data block being built, with its filter keys, to the
+// compression threads.
+void TableBuilder::ScheduleDataBlock() {
+  Rep* r = rep_;
+  PendingBlock* block = new PendingBlock(&r->pending_mu, &r->pending_cv);
+  block->raw = r->data_block.Finish().ToString();
+  block->type = r->options.compression;
+  block->filter_keys.swap(r->filter_keys);
+  block->filter_key_starts.swap(r->filter_key_starts);
+  r->data_block.Reset();
+  r->pending_blocks.push_back(block);
+  r->pending_bytes += block->raw.size() + kBlockTrailerSize;
+  r->compression_pool->Schedule(&TableBuilder::CompressPendingBlock, block);
+}
+
+// Writes the pending blocks at the front of the queue that are ready.
+// Waits for the oldest block while more than kPendingBlocksPerThread per
+// thread are queued, or while any are if "wait_all".
+void TableBuilder::WriteCompletedBlocks(bool wait_all) {
+  Rep* r = rep_;
+  const size_t max_pending =
+      wait_all ? 0
+               : r->compression_pool->num_threads() * kPendingBlocksPerThread;
+  while (ok() && !r->pending_blocks.empty()) {
+    PendingBlock* block = r->pending_blocks.front();
+    if (!block->has_index_key) {
+      // The last block, still waiting for the first key of the next one
+      assert(!wait_all && r->pending_blocks.size() == 1);
+      break;
+    }
+    {
+      MutexLock l(&r->pending_mu);
+      if (!block->done && r->pending_blocks.size() <= max_pending) {
+        break;
+      }
+      while (!block->done) {
+        r->pending_cv.Wait();
+      }
+    }
+    r->pending_blocks.pop_front();
+    r->pending_bytes -= block->raw.size() + kBlockTrailerSize;
+    WritePendingBlock(block);
+    delete block;
+  }
+}
+
+// Does what Flush() and the following Add() do for a block written on the
+// builder's own thread.
+void TableBuilder::WritePendingBlock(PendingBlock* block) {
+  Rep* r = rep_;
+  const std::vector<size_t>& starts = block->filter_key_starts;
+  for (size_t i = 0; i < starts.size(); i++) {
+    const size_t limit =
+        i + 1 < starts.size() ? starts[i + 1] : block->filter_keys.size();
+    const Slice key(block->filter_keys.data() + starts[i], limit - starts[i]);
+    if (r->filter_block != nullptr) {
+      r->filter_block->AddKey(key);
+    } else {
+      r->full_filter_block->AddKey(key);
+    }
+  }
+
+  BlockHandle handle;
+  AppendBlock(block->contents, block->trailer, &handle);
+  if (ok()) {
+    r->status = r->file->Flush();
+  }
+  if (r->filter_block != nullptr) {
+    r->filter_block->StartBlock(r->offset);
+  }
+  if (ok()) {
+    AddIndexEntry(block->index_key, handle);
+  }
+}
+
+// Ends the current index partition, whose last entry is for "last_key",
+// along with its filter.
+void TableBuilder::FlushIndexPartition(const Slice& last_key) {
+  Rep* r = rep_;
+  assert(r->partitioned && !r->index_block.empty());
+  if (!ok()) return;
+  BlockHandle index_handle;
+  WriteBlock(&r->index_block, &index_handle);
+  std::string handle_encoding;
+  index_handle.EncodeTo(&handle_encoding);
+  if (ok() && r->full_filter_block != nullptr) {
+    BlockHandle filter_handle;
+    WriteRawBlock(r->full_filter_block->Finish(), kNoCompression,
+                  &filter_handle);
+    filter_handle.EncodeTo(&handle_encoding);
+    r->has_last_prefix = false;
+  }
+  if (ok()) {
+    r->top_index_block.Add(last_key, Slice(handle_encoding));
+  }
+}
+
 Status TableBuilder::status() const { return rep_->status; }
 
 Status TableBuilder::Finish() {
@@ -201,12 +495,27 @@ Status TableBuilder::Finish() {
   assert(!r->closed);
   r->closed = true;
 
+  // Write the data blocks still being compressed
+  if (ok() && r->compression_pool != nullptr) {
+    if (r->pending_index_entry) {
+      r->options.comparator->FindShortSuccessor(&r->last_key);
+      PendingBlock* block = r->pending_blocks.back();
+      block->index_key = r->last_key;
+      block->has_index_key = true;
+      r->pending_index_entry = false;
+    }
+    WriteCompletedBlocks(true);
+  }
+
   BlockHandle filter_block_handle, metaindex_block_handle, index_block_handle;
 
   // Write filter block
   if (ok() && r->filter_block != nullptr) {
     WriteRawBlock(r->filter_block->Finish(), kNoCompression,
                   &filter_block_handle);
+  } else if (ok() && r->full_filter_block != nullptr && !r->partitioned) {
+    WriteRawBlock(r->full_filter_block->Finish(), kNoCompression,
+                  &filter_block_handle);
   }
 
   // Write metaindex block
@@ -219,6 +528,24 @@ Status TableBuilder::Finish() {
       std::string handle_encoding;
       filter_block_handle.EncodeTo(&handle_encoding);
       meta_index_block.Add(key, handle_encoding);
+    } else if (r->full_filter_block != nullptr && !r->partitioned) {
+      // Add mapping from "fullfilter.Name" to location of filter data
+      std::string key = "fullfilter.";
+      key.append(r->options.filter_policy->Name());
+      std::string handle_encoding;
+      filter_block_handle.EncodeTo(&handle_encoding);
+      meta_index_block.Add(key, handle_encoding);
+    } else if (r->full_filter_block != nullptr) {
+      // The filters are found through the top-level index
+      std::string key = "partitionedfilter.";
+      key.append(r->options.filter_policy->Name());
+      meta_index_block.Add(key, Slice());
+    }
+    if (r->prefix_extractor != nullptr) {
+      // Record which prefixes the filter holds
+      std::string key = "prefix.";
+      key.append(r->prefix_extractor->Name());
+      meta_index_block.Add(key, Slice());
     }
 
     // TODO(postrelease): Add stats and other meta blocks
@@ -234,7 +561,16 @@ Status TableBuilder::Finish() {
       r->index_block.Add(r->last_key, Slice(handle_encoding));
       r->pending_index_entry = false;
     }
-    WriteBlock(&r->index_block, &index_block_handle);
+    if (!r->partitioned) {
+      WriteBlock(&r->index_block, &index_block_handle);
+    } else {
+      if (!r->index_block.empty()) {
+        FlushIndexPartition(r->last_key);
+      }
+      if (ok()) {
+        WriteBlock(&r->top_index_block, &index_block_handle);
+      }
+    }
   }
 
   // Write footer
@@ -242,6 +578,7 @@ Status TableBuilder::Finish() {
     Footer footer;
     footer.set_metaindex_handle(metaindex_block_handle);
     footer.set_index_handle(index_block_handle);
+    footer.set_partitioned_index(r->partitioned);
     std::string footer_encoding;
     footer.EncodeTo(&footer_encoding);
     r->status = r->file->Append(footer_encoding);
@@ -260,6 +597,8 @@ void TableBuilder::Abandon() {
 
 uint64_t TableBuilder::NumEntries() const { return rep_->num_entries; }
 
-uint64_t TableBuilder::FileSize() const { return rep_->offset; }
+uint64_t TableBuilder::FileSize() const {
+  return rep_->offset + rep_->pending_bytes;
+}
 
 }  // namespace leveldb
@@ -0,0 +1,29 @@
+// Copyright (c) 2026 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef STORAGE_LEVELDB_TABLE_TABLE_BUILDER_INTERNAL_H_
+#define STORAGE_LEVELDB_TABLE_TABLE_BUILDER_INTERNAL_H_
+
+#include "leveldb/table_builder.h"
+
+namespace leveldb {
+
+class ThreadPool;
+
+// TableBuilderInternal provides static methods for building tables that
+// we don't want in the public TableBuilder interface.
+class TableBuilderInternal {
+ public:
+  // Return a builder like new TableBuilder(options, file), except that
+  // data blocks are compressed on "compression_pool", which builders may
+  // share, instead of on options.compression_threads threads of the
+  // builder's own.  A null pool compresses every block on the thread that
+  // builds the table.  The pool must outlive the builder.
+  static TableBuilder* New(const Options& options, WritableFile* file,
+                           ThreadPool* compression_pool);
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_TABLE_TABLE_BUILDER_INTERNAL_H_
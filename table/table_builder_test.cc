@@ -0,0 +1,137 @@
+// Copyright (c) 2026 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "leveldb/table_builder.h"
+
+#include <cstdio>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "leveldb/env.h"
+#include "leveldb/filter_policy.h"
+#include "leveldb/options.h"
+#include "table/table_builder_internal.h"
+#include "util/random.h"
+#include "util/testutil.h"
+#include "util/thread_pool.h"
+
+namespace leveldb {
+
+namespace {
+
+class StringSink : public WritableFile {
+ public:
+  ~StringSink() override = default;
+
+  const std::string& contents() const { return contents_; }
+
+  Status Close() override { return Status::OK(); }
+  Status Flush() override { return Status::OK(); }
+  Status Sync() override { return Status::OK(); }
+
+  Status Append(const Slice& data) override {
+    contents_.append(data.data(), data.size());
+    return Status::OK();
+  }
+
+ private:
+  std::string contents_;
+};
+
+}  // namespace
+
+static const int kNumKeys = 5000;
+
+static void AddKey(TableBuilder* builder, Random* rnd, int i,
+                   std::string* value) {
+  char key[20];
+  std::snprintf(key, sizeof(key), "key%06d", i);
+  builder->Add(key, test::CompressibleString(rnd, 0.5, 100, value));
+}
+
+static std::string BuildTable(const Options& options) {
+  Random rnd(301);
+  StringSink sink;
+  TableBuilder builder(options, &sink);
+  std::string value;
+  for (int i = 0; i < kNumKeys; i++) {
+    AddKey(&builder, &rnd, i, &value);
+  }
+  EXPECT_LEVELDB_OK(builder.Finish());
+  return sink.contents();
+}
+
+TEST(TableBuilderTest, CompressionThreadsBuildSameTable) {
+  const FilterPolicy* policy = NewBloomFilterPolicy(10);
+  for (int mode = 0; mode < 4; mode++) {
+    Options options;
+    options.block_size = 512;
+    if (mode > 0) {
+      options.filter_policy = policy;
+    }
+    options.full_table_filter = (mode == 2);
+    options.partitioned_index = (mode == 3);
+
+    const std::string expected = BuildTable(options);
+    for (int threads = 1; threads <= 4; threads += 3) {
+      options.compression_threads = threads;
+      ASSERT_TRUE(expected == BuildTable(options))
+          << "mode " << mode << ", " << threads << " threads";
+    }
+  }
+  delete policy;
+}
+
+TEST(TableBuilderTest, SharedCompressionPool) {
+  Options options;
+  options.block_size = 512;
+  const std::string expected = BuildTable(options);
+
+  // Two builders compressing on the same pool at once.
+  ThreadPool pool(Env::Default(), 3);
+  Random rnd1(301), rnd2(301);
+  StringSink sink1, sink2;
+  TableBuilder* builder1 = TableBuilderInternal::New(options, &sink1, &pool);
+  TableBuilder* builder2 = TableBuilderInternal::New(options, &sink2, &pool);
+  std::string value;
+  for (int i = 0; i < kNumKeys; i++) {
+    AddKey(builder1, &rnd1, i, &value);
+    AddKey(builder2, &rnd2, i, &value);
+  }
+  ASSERT_LEVELDB_OK(builder1->Finish());
+  ASSERT_LEVELDB_OK(builder2->Finish());
+  delete builder1;
+  delete builder2;
+  ASSERT_TRUE(expected == sink1.contents());
+  ASSERT_TRUE(expected == sink2.contents());
+}
+
+TEST(TableBuilderTest, FileSizeCountsPendingBlocks) {
+  Options options;
+  options.block_size = 512;
+  options.compression = kNoCompression;
+  Options threaded_options = options;
+  threaded_options.compression_threads = 2;
+
+  Random rnd1(301), rnd2(301);
+  StringSink sink1, sink2;
+  TableBuilder builder1(options, &sink1);
+  TableBuilder builder2(threaded_options, &sink2);
+  std::string value;
+  for (int i = 0; i < kNumKeys; i++) {
+    AddKey(&builder1, &rnd1, i, &value);
+    AddKey(&builder2, &rnd2, i, &value);
+    ASSERT_EQ(builder1.FileSize(), builder2.FileSize()) << "key " << i;
+  }
+  ASSERT_LEVELDB_OK(builder1.Finish());
+  ASSERT_LEVELDB_OK(builder2.Finish());
+  ASSERT_EQ(sink1.contents().size(), builder2.FileSize());
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -4,6 +4,7 @@
 
 #include "leveldb/table.h"
 
+#include <cstdio>
 #include <map>
 #include <string>
 
@@ -376,6 +377,7 @@ struct TestArgs {
   TestType type;
   bool reverse_compare;
   int restart_interval;
+  int compression_threads;
 };
 
 static const TestArgs kTestArgList[] = {
@@ -386,6 +388,10 @@ static const TestArgs kTestArgList[] = {
     {TABLE_TEST, true, 1},
     {TABLE_TEST, true, 1024},
 
+    // Data blocks compressed on other threads
+    {TABLE_TEST, false, 16, 3},
+    {TABLE_TEST, true, 16, 3},
+
     {BLOCK_TEST, false, 16},
     {BLOCK_TEST, false, 1},
     {BLOCK_TEST, false, 1024},
@@ -413,6 +419,7 @@ class Harness : public testing::Test {
     options_ = Options();
 
     options_.block_restart_interval = args.restart_interval;
+    options_.compression_threads = args.compression_threads;
     // Use shorter block size for tests to exercise block boundary
     // conditions more.
     options_.block_size = 256;
@@ -4,6 +4,7 @@
 
 #include "table/two_level_iterator.h"
 
+#include "leveldb/comparator.h"
 #include "leveldb/table.h"
 #include "table/block.h"
 #include "table/format.h"
@@ -160,6 +161,92 @@ void TwoLevelIterator::InitDataBlock() {
   }
 }
 
+class UpperBoundIndexIterator : public Iterator {
+ public:
+  UpperBoundIndexIterator(Iterator* index_iter, const Comparator* comparator,
+                          const Slice& upper_bound)
+      : index_iter_(index_iter),
+        comparator_(comparator),
+        upper_bound_(upper_bound),
+        past_bound_(false) {}
+
+  ~UpperBoundIndexIterator() override { delete index_iter_; }
+
+  bool Valid() const override { return !past_bound_ && index_iter_->Valid(); }
+  Slice key() const override { return index_iter_->key(); }
+  Slice value() const override { return index_iter_->value(); }
+  Status status() const override { return index_iter_->status(); }
+
+  void Seek(const Slice& target) override {
+    past_bound_ = false;
+    index_iter_->Seek(target);
+  }
+  void SeekToFirst() override {
+    past_bound_ = false;
+    index_iter_->SeekToFirst();
+  }
+  void SeekToLast() override {
+    past_bound_ = false;
+    index_iter_->SeekToLast();
+  }
+  void Next() override {
+    assert(Valid());
+    // Every block after this one starts past its index key.
+    if (comparator_->Compare(index_iter_->key(), upper_bound_) >= 0) {
+      past_bound_ = true;
+    } else {
+      index_iter_->Next();
+    }
+  }
+  void Prev() override {
+    assert(Valid());
+    index_iter_->Prev();
+  }
+
+ private:
+  Iterator* const index_iter_;
+  const Comparator* const comparator_;
+  const Slice upper_bound_;
+  bool past_bound_;
+};
+
+class PrefixSeekIterator : public Iterator {
+ public:
+  PrefixSeekIterator(Iterator* iter, bool (*may_match)(void*, const Slice&),
+                     void* arg)
+      : iter_(iter), may_match_(may_match), arg_(arg), filtered_(false) {}
+
+  ~PrefixSeekIterator() override { delete iter_; }
+
+  bool Valid() const override { return !filtered_ && iter_->Valid(); }
+  Slice key() const override { return iter_->key(); }
+  Slice value() const override { return iter_->value(); }
+  Status status() const override { return iter_->status(); }
+
+  void Seek(const Slice& target) override {
+    filtered_ = !(*may_match_)(arg_, target);
+    if (!filtered_) {
+      iter_->Seek(target);
+    }
+  }
+  void SeekToFirst() override {
+    filtered_ = false;
+    iter_->SeekToFirst();
+  }
+  void SeekToLast() override {
+    filtered_ = false;
+    iter_->SeekToLast();
+  }
+  void Next() override { iter_->Next(); }
+  void Prev() override { iter_->Prev(); }
+
+ private:
+  Iterator* const iter_;
+  bool (*const may_match_)(void*, const Slice&);
+  void* const arg_;
+  bool filtered_;
+};
+
 }  // namespace
 
 Iterator* NewTwoLevelIterator(Iterator* index_iter,
@@ -168,4 +255,17 @@ Iterator* NewTwoLevelIterator(Iterator* index_iter,
   return new TwoLevelIterator(index_iter, block_function, arg, options);
 }
 
+Iterator* NewUpperBoundIndexIterator(Iterator* index_iter,
+                                     const Comparator* comparator,
+                                     const Slice& upper_bound) {
+  return new UpperBoundIndexIterator(index_iter, comparator, upper_bound);
+}
+
+Iterator* NewPrefixSeekIterator(Iterator* iter,
+                                bool (*may_match)(void* arg,
+                                                  const Slice& key),
+                                void* arg) {
+  return new PrefixSeekIterator(iter, may_match, arg);
+}
+
 }  // namespace leveldb
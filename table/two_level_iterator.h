@@ -9,6 +9,7 @@
 
 namespace leveldb {
 
+class Comparator;
 struct ReadOptions;
 
 // Return a new two level iterator.  A two-level iterator contains an
@@ -26,6 +27,25 @@ Iterator* NewTwoLevelIterator(
                                 const Slice& index_value),
     void* arg, const ReadOptions& options);
 
+// Return an index iterator for NewTwoLevelIterator() that ends after the
+// first entry whose key is >= "upper_bound", so that a forward scan never
+// opens the blocks after it.  Each index key must be >= every key of its
+// own block and < every key of the blocks that follow, as with table index
+// blocks and the file lists of sorted levels.  Takes ownership of
+// "index_iter".  "upper_bound" must stay live while the result is live.
+Iterator* NewUpperBoundIndexIterator(Iterator* index_iter,
+                                     const Comparator* comparator,
+                                     const Slice& upper_bound);
+
+// Return an iterator over "iter" for ReadOptions::prefix_same_as_start.  A
+// Seek() to a target for which (*may_match)(arg, target) returns false,
+// meaning no key at or after the target shares its prefix, leaves the
+// iterator invalid without touching "iter".  Takes ownership of "iter".
+Iterator* NewPrefixSeekIterator(Iterator* iter,
+                                bool (*may_match)(void* arg,
+                                                  const Slice& key),
+                                void* arg);
+
 }  // namespace leveldb
 
 #endif  // STORAGE_LEVELDB_TABLE_TWO_LEVEL_ITERATOR_H_
@@ -0,0 +1,31 @@
+// Copyright (c) 2026 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef STORAGE_LEVELDB_UTIL_ALLOCATOR_H_
+#define STORAGE_LEVELDB_UTIL_ALLOCATOR_H_
+
+#include <cstddef>
+
+namespace leveldb {
+
+// Interface for the memory pools memtables allocate their entries from.
+// Memory is owned by the allocator and released when it is destroyed.
+class Allocator {
+ public:
+  virtual ~Allocator();
+
+  // Return a pointer to a newly allocated memory block of "bytes" bytes.
+  virtual char* Allocate(size_t bytes) = 0;
+
+  // Allocate memory with the normal alignment guarantees provided by malloc.
+  virtual char* AllocateAligned(size_t bytes) = 0;
+
+  // Returns an estimate of the total memory usage of data allocated
+  // by the allocator.
+  virtual size_t MemoryUsage() const = 0;
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_UTIL_ALLOCATOR_H_
@@ -4,21 +4,43 @@
 
 #include "util/arena.h"
 
+#if defined(LEVELDB_PLATFORM_POSIX)
+#include <sys/mman.h>
+#endif  // defined(LEVELDB_PLATFORM_POSIX)
+
 namespace leveldb {
 
 static const int kBlockSize = 4096;
 
-Arena::Arena()
-    : alloc_ptr_(nullptr), alloc_bytes_remaining_(0), memory_usage_(0) {}
+Allocator::~Allocator() = default;
+
+Arena::Arena() : Arena(kBlockSize, 0) {}
+
+Arena::Arena(size_t block_size, size_t huge_page_size)
+    : block_size_(huge_page_size == 0
+                      ? block_size
+                      : (block_size + huge_page_size - 1) / huge_page_size *
+                            huge_page_size),
+      huge_page_size_(huge_page_size),
+      alloc_ptr_(nullptr),
+      alloc_bytes_remaining_(0),
+      memory_usage_(0) {
+  assert(block_size > 0);
+}
 
 Arena::~Arena() {
   for (size_t i = 0; i < blocks_.size(); i++) {
     delete[] blocks_[i];
   }
+#if defined(LEVELDB_PLATFORM_POSIX)
+  for (const auto& block : huge_blocks_) {
+    ::munmap(block.first, block.second);
+  }
+#endif  // defined(LEVELDB_PLATFORM_POSIX)
 }
 
 char* Arena::AllocateFallback(size_t bytes) {
-  if (bytes > kBlockSize / 4) {
+  if (bytes > block_size_ / 4) {
     // Object is more than a quarter of our block size.  Allocate it separately
     // to avoid wasting too much space in leftover bytes.
     char* result = AllocateNewBlock(bytes);
@@ -26,8 +48,14 @@ char* Arena::AllocateFallback(size_t bytes) {
   }
 
   // We waste the remaining space in the current block.
-  alloc_ptr_ = AllocateNewBlock(kBlockSize);
-  alloc_bytes_remaining_ = kBlockSize;
+  alloc_ptr_ = nullptr;
+  if (huge_page_size_ != 0) {
+    alloc_ptr_ = AllocateHugePageBlock(block_size_);
+  }
+  if (alloc_ptr_ == nullptr) {
+    alloc_ptr_ = AllocateNewBlock(block_size_);
+  }
+  alloc_bytes_remaining_ = block_size_;
 
   char* result = alloc_ptr_;
   alloc_ptr_ += bytes;
@@ -55,6 +83,45 @@ char* Arena::AllocateAligned(size_t bytes) {
   return result;
 }
 
+char* Arena::AllocateHugePageBlock(size_t block_bytes) {
+#if defined(LEVELDB_PLATFORM_POSIX)
+  void* addr = MAP_FAILED;
+#if defined(MAP_HUGETLB)
+  // Explicitly reserved huge pages (vm.nr_hugepages).  Most systems reserve
+  // none, so stop asking after the first failure.
+  static std::atomic<bool> hugetlb_failed(false);
+  if (!hugetlb_failed.load(std::memory_order_relaxed)) {
+    addr = ::mmap(nullptr, block_bytes, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (addr == MAP_FAILED) {
+      hugetlb_failed.store(true, std::memory_order_relaxed);
+    }
+  }
+#endif  // defined(MAP_HUGETLB)
+#if defined(MADV_HUGEPAGE)
+  if (addr == MAP_FAILED) {
+    // Otherwise ask for transparent huge pages.  The mapping is usable even
+    // if the kernel declines.
+    addr = ::mmap(nullptr, block_bytes, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (addr != MAP_FAILED) {
+      ::madvise(addr, block_bytes, MADV_HUGEPAGE);
+    }
+  }
+#endif  // defined(MADV_HUGEPAGE)
+  if (addr == MAP_FAILED) {
+    return nullptr;
+  }
+  char* result = reinterpret_cast<char*>(addr);
+  huge_blocks_.emplace_back(result, block_bytes);
+  memory_usage_.fetch_add(block_bytes, std::memory_order_relaxed);
+  return result;
+#else
+  (void)block_bytes;
+  return nullptr;
+#endif  // defined(LEVELDB_PLATFORM_POSIX)
+}
+
 char* Arena::AllocateNewBlock(size_t block_bytes) {
   char* result = new char[block_bytes];
   blocks_.push_back(result);
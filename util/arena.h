@@ -9,34 +9,54 @@
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <utility>
 #include <vector>
 
+#include "util/allocator.h"
+
 namespace leveldb {
 
-class Arena {
+class Arena final : public Allocator {
  public:
   Arena();
 
+  // Create an arena that carves small allocations out of blocks of
+  // "block_size" bytes.  If "huge_page_size" is non-zero, those blocks are
+  // rounded up to a multiple of it and backed by huge pages where the
+  // platform allows it, falling back to ordinary memory otherwise.
+  Arena(size_t block_size, size_t huge_page_size);
+
   Arena(const Arena&) = delete;
   Arena& operator=(const Arena&) = delete;
 
   ~Arena();
 
   // Return a pointer to a newly allocated memory block of "bytes" bytes.
-  char* Allocate(size_t bytes);
+  char* Allocate(size_t bytes) override;
 
   // Allocate memory with the normal alignment guarantees provided by malloc.
-  char* AllocateAligned(size_t bytes);
+  char* AllocateAligned(size_t bytes) override;
 
   // Returns an estimate of the total memory usage of data allocated
   // by the arena.
-  size_t MemoryUsage() const {
+  size_t MemoryUsage() const override {
     return memory_usage_.load(std::memory_order_relaxed);
   }
 
+  size_t block_size() const { return block_size_; }
+
+  // Bytes of the current block not yet handed out.  Like the allocation
+  // methods, this must not race with them.
+  size_t RemainingBytes() const { return alloc_bytes_remaining_; }
+
  private:
   char* AllocateFallback(size_t bytes);
   char* AllocateNewBlock(size_t block_bytes);
+  // Returns null if no huge page could be had.
+  char* AllocateHugePageBlock(size_t block_bytes);
+
+  const size_t block_size_;
+  const size_t huge_page_size_;
 
   // Allocation state
   char* alloc_ptr_;
@@ -45,6 +65,9 @@ class Arena {
   // Array of new[] allocated memory blocks
   std::vector<char*> blocks_;
 
+  // Blocks mapped by AllocateHugePageBlock(), with their sizes
+  std::vector<std::pair<char*, size_t>> huge_blocks_;
+
   // Total memory usage of the arena.
   //
   // TODO(costan): This member is accessed via atomics, but the others are
@@ -4,7 +4,12 @@
 
 #include "util/arena.h"
 
+#include <cstring>
+#include <thread>
+#include <vector>
+
 #include "gtest/gtest.h"
+#include "util/concurrent_arena.h"
 #include "util/random.h"
 
 namespace leveldb {
@@ -58,6 +63,71 @@ TEST(ArenaTest, Simple) {
   }
 }
 
+TEST(ArenaTest, HugePages) {
+  const size_t kHugePageSize = 2 << 20;
+  Arena arena(4096, kHugePageSize);
+  ASSERT_EQ(kHugePageSize, arena.block_size());
+  // Whether or not huge pages are available, the memory must be usable.
+  char* first = arena.Allocate(100);
+  std::memset(first, 1, 100);
+  for (int i = 0; i < 1000; i++) {
+    char* r = arena.AllocateAligned(1000);
+    ASSERT_EQ(0, reinterpret_cast<uintptr_t>(r) & 7);
+    std::memset(r, i % 256, 1000);
+  }
+  ASSERT_GE(arena.MemoryUsage(), 1000 * 1000 + 100);
+  ASSERT_LE(arena.MemoryUsage(), 2 * kHugePageSize);
+}
+
+TEST(ConcurrentArenaTest, Empty) { ConcurrentArena arena; }
+
+TEST(ConcurrentArenaTest, ConcurrentAllocations) {
+  ConcurrentArena arena;
+  const int kThreads = 8;
+  const int kAllocations = 20000;
+  std::vector<std::vector<std::pair<size_t, char*>>> allocated(kThreads);
+  std::vector<size_t> bytes(kThreads, 0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([&, t]() {
+      Random rnd(301 + t);
+      for (int i = 0; i < kAllocations; i++) {
+        size_t s = rnd.OneIn(1000) ? rnd.Uniform(6000) + 1
+                                   : rnd.Uniform(100) + 1;
+        char* r = rnd.OneIn(10) ? arena.AllocateAligned(s) : arena.Allocate(s);
+        std::memset(r, t, s);
+        allocated[t].emplace_back(s, r);
+        bytes[t] += s;
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  size_t total = 0;
+  for (int t = 0; t < kThreads; t++) {
+    for (const auto& allocation : allocated[t]) {
+      for (size_t b = 0; b < allocation.first; b++) {
+        ASSERT_EQ(t, allocation.second[b]);
+      }
+    }
+    total += bytes[t];
+  }
+  ASSERT_GE(arena.MemoryUsage(), total);
+  ASSERT_LE(arena.MemoryUsage(), total * 1.10);
+}
+
+TEST(ConcurrentArenaTest, HugePageMemoryUsage) {
+  // Only the part of a huge page that has been handed out counts as used.
+  const size_t kHugePageSize = 2 << 20;
+  ConcurrentArena arena(kHugePageSize);
+  std::memset(arena.Allocate(100), 1, 100);
+  std::memset(arena.AllocateAligned(1000), 2, 1000);
+  ASSERT_GE(arena.MemoryUsage(), 1100);
+  ASSERT_LE(arena.MemoryUsage(), 4 * 4096);
+}
+
 }  // namespace leveldb
 
 int main(int argc, char** argv) {
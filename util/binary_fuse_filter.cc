@@ -0,0 +1,248 @@
+// Copyright (c) 2026 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// A binary fuse filter with 8-bit fingerprints [Graf, Lemire 2022].  Each
+// key maps to three slots in nearby segments of a fingerprint array, and
+// the array is solved so that the three slots of every key xor to the
+// key's fingerprint.  A lookup reads three bytes; false positives happen
+// with probability 2^-8, at about 9 bits per key for large key sets.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "leveldb/filter_policy.h"
+#include "leveldb/slice.h"
+#include "util/coding.h"
+#include "util/hash.h"
+
+namespace leveldb {
+
+namespace {
+
+// A filter is laid out as
+//
+//    fingerprints                 (segment_count + 2) << segment_length_bits
+//    seed                         fixed64
+//    segment_count                fixed32
+//    segment_length_bits          1 byte
+//    kBinaryFuseTag               1 byte
+const size_t kTrailerSize = 8 + 4 + 1 + 1;
+const char kBinaryFuseTag = 0x46;
+const int kMaxSegmentLengthBits = 18;
+
+// Construction fails with small probability for a given seed; after this
+// many seeds the array is made a segment longer, which only makes it
+// easier to solve.
+const int kAttemptsPerSize = 64;
+
+uint64_t KeyHash(const Slice& key) {
+  return (static_cast<uint64_t>(Hash(key.data(), key.size(), 0xbc9f1d34))
+          << 32) |
+         Hash(key.data(), key.size(), 0x6a09e667);
+}
+
+// Bijective 64-bit mixer (the MurmurHash3 finalizer).  Since it is a
+// bijection, distinct key hashes stay distinct under every seed.
+uint64_t Mix(uint64_t h, uint64_t seed) {
+  h += seed;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ull;
+  h ^= h >> 33;
+  return h;
+}
+
+// High 64 bits of a * b.
+uint64_t MulHi(uint64_t a, uint64_t b) {
+  const uint64_t a_lo = a & 0xffffffff, a_hi = a >> 32;
+  const uint64_t b_lo = b & 0xffffffff, b_hi = b >> 32;
+  const uint64_t lo_lo = a_lo * b_lo;
+  const uint64_t hi_lo = a_hi * b_lo;
+  const uint64_t lo_hi = a_lo * b_hi;
+  const uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xffffffff) + lo_hi;
+  return a_hi * b_hi + (hi_lo >> 32) + (cross >> 32);
+}
+
+uint8_t Fingerprint(uint64_t h) { return static_cast<uint8_t>(h ^ (h >> 32)); }
+
+struct Geometry {
+  uint32_t segment_length_bits;
+  uint32_t segment_count;
+
+  uint32_t segment_length() const { return 1u << segment_length_bits; }
+  size_t array_length() const {
+    return static_cast<size_t>(segment_count + 2) << segment_length_bits;
+  }
+
+  // The three slots of hash "h": one in each of three consecutive
+  // segments, starting at a segment picked by the high bits of h.
+  void Slots(uint64_t h, uint32_t slots[3]) const {
+    const uint32_t mask = segment_length() - 1;
+    const uint64_t segment_count_length =
+        static_cast<uint64_t>(segment_count) << segment_length_bits;
+    slots[0] = static_cast<uint32_t>(MulHi(h, segment_count_length));
+    slots[1] = (slots[0] + segment_length()) ^ (static_cast<uint32_t>(h >> 18) &
+                                                mask);
+    slots[2] =
+        (slots[0] + 2 * segment_length()) ^ (static_cast<uint32_t>(h) & mask);
+  }
+};
+
+Geometry ChooseGeometry(size_t n) {
+  // Parameters from the paper's reference implementation for arity 3.
+  Geometry g;
+  const double log_n = std::log(static_cast<double>(std::max<size_t>(n, 2)));
+  int bits = static_cast<int>(std::floor(log_n / std::log(3.33) + 2.25));
+  g.segment_length_bits =
+      static_cast<uint32_t>(std::min(std::max(bits, 2), kMaxSegmentLengthBits));
+  const double size_factor =
+      std::max(1.125, 0.875 + 0.25 * std::log(1000000.0) / log_n);
+  const size_t capacity = static_cast<size_t>(std::round(n * size_factor));
+  const size_t segments =
+      (capacity + g.segment_length() - 1) >> g.segment_length_bits;
+  g.segment_count = static_cast<uint32_t>(segments > 3 ? segments - 2 : 1);
+  return g;
+}
+
+// Solves "fingerprints" for the distinct hashes in "hashes" under "seed".
+// Returns false if the slots form a cycle that peeling cannot break.
+bool Solve(const std::vector<uint64_t>& hashes, const Geometry& g,
+           uint64_t seed, uint8_t* fingerprints) {
+  const size_t array_length = g.array_length();
+  // For each slot: 4 * (number of keys using it) | (which of a key's three
+  // slots it is, for the last key left), and the xor of those keys' hashes.
+  std::vector<uint8_t> count(array_length, 0);
+  std::vector<uint64_t> xor_hash(array_length, 0);
+  uint32_t slots[3];
+  for (uint64_t key_hash : hashes) {
+    const uint64_t h = Mix(key_hash, seed);
+    g.Slots(h, slots);
+    for (int j = 0; j < 3; j++) {
+      if (count[slots[j]] >= 252) return false;  // Counter would overflow
+      count[slots[j]] += 4;
+      count[slots[j]] ^= j;
+      xor_hash[slots[j]] ^= h;
+    }
+  }
+
+  // Peel keys that are alone in one of their slots; that slot is then
+  // free to fix up the key's fingerprint last.
+  std::vector<uint32_t> alone;
+  for (size_t i = 0; i < array_length; i++) {
+    if ((count[i] >> 2) == 1) alone.push_back(static_cast<uint32_t>(i));
+  }
+  std::vector<uint64_t> stack_hash;
+  std::vector<uint8_t> stack_slot;
+  stack_hash.reserve(hashes.size());
+  stack_slot.reserve(hashes.size());
+  while (!alone.empty()) {
+    const uint32_t index = alone.back();
+    alone.pop_back();
+    if ((count[index] >> 2) != 1) continue;
+    const uint64_t h = xor_hash[index];
+    const int found = count[index] & 3;
+    stack_hash.push_back(h);
+    stack_slot.push_back(static_cast<uint8_t>(found));
+    g.Slots(h, slots);
+    for (int j = 0; j < 3; j++) {
+      const uint32_t other = slots[j];
+      count[other] -= 4;
+      count[other] ^= j;
+      xor_hash[other] ^= h;
+      if (j != found && (count[other] >> 2) == 1) alone.push_back(other);
+    }
+  }
+  if (stack_hash.size() != hashes.size()) return false;
+
+  std::fill(fingerprints, fingerprints + array_length, 0);
+  for (size_t i = stack_hash.size(); i-- > 0;) {
+    const uint64_t h = stack_hash[i];
+    const int found = stack_slot[i];
+    g.Slots(h, slots);
+    fingerprints[slots[found]] = Fingerprint(h) ^
+                                 fingerprints[slots[(found + 1) % 3]] ^
+                                 fingerprints[slots[(found + 2) % 3]];
+  }
+  return true;
+}
+
+class BinaryFuseFilterPolicy : public FilterPolicy {
+ public:
+  const char* Name() const override { return "leveldb.BinaryFuse8Filter"; }
+
+  void CreateFilter(const Slice* keys, int n, std::string* dst) const override {
+    // A table may add the same user key several times.
+    std::vector<uint64_t> hashes(n);
+    for (int i = 0; i < n; i++) {
+      hashes[i] = KeyHash(keys[i]);
+    }
+    std::sort(hashes.begin(), hashes.end());
+    hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+
+    Geometry g = ChooseGeometry(hashes.size());
+    uint64_t seed = 0;
+    const size_t init_size = dst->size();
+    if (hashes.empty()) {
+      g.segment_count = 0;
+    } else {
+      // Seeds are a fixed sequence so that the same keys always produce
+      // the same filter.
+      for (int attempt = 0;; attempt++) {
+        if (attempt > 0 && attempt % kAttemptsPerSize == 0) {
+          g.segment_count++;
+        }
+        seed = Mix(attempt, 0x9e3779b97f4a7c15ull);
+        dst->resize(init_size + g.array_length());
+        if (Solve(hashes, g, seed,
+                  reinterpret_cast<uint8_t*>(&(*dst)[init_size]))) {
+          break;
+        }
+      }
+    }
+    PutFixed64(dst, seed);
+    PutFixed32(dst, g.segment_count);
+    dst->push_back(static_cast<char>(g.segment_length_bits));
+    dst->push_back(kBinaryFuseTag);
+  }
+
+  bool KeyMayMatch(const Slice& key, const Slice& filter) const override {
+    const size_t len = filter.size();
+    if (len == 0) return false;
+
+    if (len < kTrailerSize || filter[len - 1] != kBinaryFuseTag) {
+      // Not a filter we know how to read.  Consider it a match.
+      return true;
+    }
+
+    const char* trailer = filter.data() + len - kTrailerSize;
+    Geometry g;
+    g.segment_count = DecodeFixed32(trailer + 8);
+    g.segment_length_bits = static_cast<unsigned char>(trailer[12]);
+    if (g.segment_count == 0) return false;  // Built from no keys
+    if (g.segment_length_bits > kMaxSegmentLengthBits ||
+        g.array_length() != len - kTrailerSize) {
+      return true;
+    }
+
+    const uint8_t* fingerprints =
+        reinterpret_cast<const uint8_t*>(filter.data());
+    const uint64_t h = Mix(KeyHash(key), DecodeFixed64(trailer));
+    uint32_t slots[3];
+    g.Slots(h, slots);
+    return Fingerprint(h) ==
+           (fingerprints[slots[0]] ^ fingerprints[slots[1]] ^
+            fingerprints[slots[2]]);
+  }
+};
+
+}  // namespace
+
+const FilterPolicy* NewBinaryFuseFilterPolicy() {
+  return new BinaryFuseFilterPolicy();
+}
+
+}  // namespace leveldb
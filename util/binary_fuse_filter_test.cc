@@ -0,0 +1,173 @@
+// Copyright (c) 2026 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "leveldb/filter_policy.h"
+#include "util/coding.h"
+
+namespace leveldb {
+
+static const int kVerbose = 1;
+
+static Slice Key(int i, char* buffer) {
+  EncodeFixed32(buffer, i);
+  return Slice(buffer, sizeof(uint32_t));
+}
+
+class BinaryFuseFilterTest : public testing::Test {
+ public:
+  BinaryFuseFilterTest() : policy_(NewBinaryFuseFilterPolicy()) {}
+
+  ~BinaryFuseFilterTest() { delete policy_; }
+
+  void Reset() {
+    keys_.clear();
+    filter_.clear();
+  }
+
+  void Add(const Slice& s) { keys_.push_back(s.ToString()); }
+
+  void Build() {
+    std::vector<Slice> key_slices(keys_.begin(), keys_.end());
+    filter_.clear();
+    policy_->CreateFilter(key_slices.data(),
+                          static_cast<int>(key_slices.size()), &filter_);
+    keys_.clear();
+  }
+
+  size_t FilterSize() const { return filter_.size(); }
+
+  bool Matches(const Slice& s) {
+    if (!keys_.empty()) {
+      Build();
+    }
+    return policy_->KeyMayMatch(s, filter_);
+  }
+
+  double FalsePositiveRate(int probes) {
+    char buffer[sizeof(int)];
+    int result = 0;
+    for (int i = 0; i < probes; i++) {
+      if (Matches(Key(i + 1000000000, buffer))) {
+        result++;
+      }
+    }
+    return result / static_cast<double>(probes);
+  }
+
+ private:
+  const FilterPolicy* policy_;
+  std::string filter_;
+  std::vector<std::string> keys_;
+};
+
+TEST_F(BinaryFuseFilterTest, EmptyFilter) {
+  ASSERT_TRUE(!Matches("hello"));
+  Build();
+  ASSERT_TRUE(!Matches("hello"));
+  ASSERT_TRUE(!Matches("world"));
+}
+
+TEST_F(BinaryFuseFilterTest, Small) {
+  Add("hello");
+  Add("world");
+  ASSERT_TRUE(Matches("hello"));
+  ASSERT_TRUE(Matches("world"));
+  ASSERT_TRUE(!Matches("x"));
+  ASSERT_TRUE(!Matches("foo"));
+}
+
+TEST_F(BinaryFuseFilterTest, DuplicateKeys) {
+  for (int i = 0; i < 100; i++) {
+    Add("dup");
+    Add("other" + std::to_string(i % 7));
+  }
+  ASSERT_TRUE(Matches("dup"));
+  for (int i = 0; i < 7; i++) {
+    ASSERT_TRUE(Matches("other" + std::to_string(i)));
+  }
+}
+
+static int NextLength(int length) {
+  if (length < 10) {
+    length += 1;
+  } else if (length < 100) {
+    length += 10;
+  } else if (length < 1000) {
+    length += 100;
+  } else {
+    length += 1000;
+  }
+  return length;
+}
+
+TEST_F(BinaryFuseFilterTest, VaryingLengths) {
+  char buffer[sizeof(int)];
+
+  for (int length = 1; length <= 10000; length = NextLength(length)) {
+    Reset();
+    for (int i = 0; i < length; i++) {
+      Add(Key(i, buffer));
+    }
+    Build();
+
+    // All added keys must match
+    for (int i = 0; i < length; i++) {
+      ASSERT_TRUE(Matches(Key(i, buffer)))
+          << "Length " << length << "; key " << i;
+    }
+
+    double rate = FalsePositiveRate(10000);
+    if (kVerbose >= 1) {
+      std::fprintf(stderr,
+                   "False positives: %5.2f%% @ length = %6d ; bytes = %6d\n",
+                   rate * 100.0, length, static_cast<int>(FilterSize()));
+    }
+    ASSERT_LE(rate, 0.01);
+  }
+}
+
+TEST_F(BinaryFuseFilterTest, SmallerThanBloom) {
+  // With many keys the filter is under 10 bits per key at a false positive
+  // rate well below the ~1% of a 10 bits per key bloom filter.
+  const int kKeys = 100000;
+  char buffer[sizeof(int)];
+  for (int i = 0; i < kKeys; i++) {
+    Add(Key(i, buffer));
+  }
+  Build();
+  const double bits_per_key = FilterSize() * 8.0 / kKeys;
+  const double rate = FalsePositiveRate(100000);
+  if (kVerbose >= 1) {
+    std::fprintf(stderr, "%.2f bits/key, %.3f%% false positives\n",
+                 bits_per_key, rate * 100.0);
+  }
+  ASSERT_LE(bits_per_key, 10.0);
+  ASSERT_LE(rate, 0.006);
+}
+
+TEST(BinaryFuseFilterPolicyTest, ForeignFiltersMatch) {
+  const FilterPolicy* bloom = NewBloomFilterPolicy(10);
+  const FilterPolicy* fuse = NewBinaryFuseFilterPolicy();
+
+  Slice key("hello");
+  std::string bloom_filter, fuse_filter;
+  bloom->CreateFilter(&key, 1, &bloom_filter);
+  fuse->CreateFilter(&key, 1, &fuse_filter);
+  ASSERT_TRUE(fuse->KeyMayMatch("foo", bloom_filter));
+  ASSERT_TRUE(bloom->KeyMayMatch("foo", fuse_filter));
+
+  delete bloom;
+  delete fuse;
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
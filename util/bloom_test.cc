@@ -19,7 +19,9 @@ static Slice Key(int i, char* buffer) {
 
 class BloomTest : public testing::Test {
  public:
-  BloomTest() : policy_(NewBloomFilterPolicy(10)) {}
+  BloomTest() : BloomTest(NewBloomFilterPolicy(10)) {}
+
+  explicit BloomTest(const FilterPolicy* policy) : policy_(policy) {}
 
   ~BloomTest() { delete policy_; }
 
@@ -149,6 +151,90 @@ TEST_F(BloomTest, VaryingLengths) {
   ASSERT_LE(mediocre_filters, good_filters / 5);
 }
 
+class BlockedBloomTest : public BloomTest {
+ public:
+  BlockedBloomTest() : BloomTest(NewBlockedBloomFilterPolicy(10)) {}
+};
+
+TEST_F(BlockedBloomTest, EmptyFilter) {
+  ASSERT_TRUE(!Matches("hello"));
+  ASSERT_TRUE(!Matches("world"));
+}
+
+TEST_F(BlockedBloomTest, Small) {
+  Add("hello");
+  Add("world");
+  ASSERT_TRUE(Matches("hello"));
+  ASSERT_TRUE(Matches("world"));
+  ASSERT_TRUE(!Matches("x"));
+  ASSERT_TRUE(!Matches("foo"));
+}
+
+TEST_F(BlockedBloomTest, VaryingLengths) {
+  char buffer[sizeof(int)];
+
+  // Blocking costs some accuracy, so the limits are a little looser than
+  // for the classic filter.
+  int mediocre_filters = 0;
+  int good_filters = 0;
+
+  for (int length = 1; length <= 10000; length = NextLength(length)) {
+    Reset();
+    for (int i = 0; i < length; i++) {
+      Add(Key(i, buffer));
+    }
+    Build();
+
+    // One partially filled block plus the two trailer bytes.
+    ASSERT_LE(FilterSize(), static_cast<size_t>((length * 10 / 8) + 64 + 2))
+        << length;
+    ASSERT_EQ(0, (FilterSize() - 2) % 64) << length;
+
+    // All added keys must match
+    for (int i = 0; i < length; i++) {
+      ASSERT_TRUE(Matches(Key(i, buffer)))
+          << "Length " << length << "; key " << i;
+    }
+
+    double rate = FalsePositiveRate();
+    if (kVerbose >= 1) {
+      std::fprintf(stderr,
+                   "False positives: %5.2f%% @ length = %6d ; bytes = %6d\n",
+                   rate * 100.0, length, static_cast<int>(FilterSize()));
+    }
+    ASSERT_LE(rate, 0.03);
+    if (rate > 0.02)
+      mediocre_filters++;
+    else
+      good_filters++;
+  }
+  if (kVerbose >= 1) {
+    std::fprintf(stderr, "Filters: %d good, %d mediocre\n", good_filters,
+                 mediocre_filters);
+  }
+  ASSERT_LE(mediocre_filters, good_filters / 5);
+}
+
+TEST(BlockedBloomFilterTest, ForeignFiltersMatch) {
+  // Each policy must treat the other's filters as "may match" rather than
+  // misreading them.
+  const FilterPolicy* classic = NewBloomFilterPolicy(10);
+  const FilterPolicy* blocked = NewBlockedBloomFilterPolicy(10);
+  ASSERT_NE(std::string(classic->Name()), std::string(blocked->Name()));
+
+  Slice key("hello");
+  std::string classic_filter, blocked_filter;
+  classic->CreateFilter(&key, 1, &classic_filter);
+  blocked->CreateFilter(&key, 1, &blocked_filter);
+  ASSERT_TRUE(!classic->KeyMayMatch("foo", classic_filter));
+  ASSERT_TRUE(!blocked->KeyMayMatch("foo", blocked_filter));
+  ASSERT_TRUE(classic->KeyMayMatch("foo", blocked_filter));
+  ASSERT_TRUE(blocked->KeyMayMatch("foo", classic_filter));
+
+  delete classic;
+  delete blocked;
+}
+
 // Different bits-per-byte
 
 }  // namespace leveldb
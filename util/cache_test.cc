@@ -194,6 +194,47 @@ TEST_F(CacheTest, HeavyEntries) {
   ASSERT_LE(cached_weight, kCacheSize + kCacheSize / 10);
 }
 
+TEST_F(CacheTest, HighPriorityPool) {
+  delete cache_;
+  cache_ = NewLRUCache(kCacheSize, 0.5);
+
+  // A scan of low priority entries leaves the high priority ones alone.
+  for (int i = 0; i < 10; i++) {
+    cache_->Release(cache_->Insert(EncodeKey(i), EncodeValue(100 + i), 1,
+                                   &CacheTest::Deleter, Cache::kHighPriority));
+  }
+  for (int i = 0; i < 2 * kCacheSize; i++) {
+    Insert(1000 + i, 2000 + i);
+  }
+  for (int i = 0; i < 10; i++) {
+    ASSERT_EQ(100 + i, Lookup(i));
+  }
+  ASSERT_EQ(-1, Lookup(1000));
+  ASSERT_LE(cache_->TotalCharge(), kCacheSize + kCacheSize / 10);
+}
+
+TEST_F(CacheTest, HighPriorityPoolOverflow) {
+  delete cache_;
+  cache_ = NewLRUCache(kCacheSize, 0.5);
+
+  // High priority entries beyond the pool compete with low priority ones.
+  for (int i = 0; i < kCacheSize; i++) {
+    cache_->Release(cache_->Insert(EncodeKey(i), EncodeValue(100 + i), 1,
+                                   &CacheTest::Deleter, Cache::kHighPriority));
+  }
+  for (int i = 0; i < 2 * kCacheSize; i++) {
+    Insert(10000 + i, 20000 + i);
+  }
+  int high_pri_left = 0;
+  for (int i = 0; i < kCacheSize; i++) {
+    if (Lookup(i) >= 0) {
+      high_pri_left++;
+    }
+  }
+  ASSERT_LE(high_pri_left, kCacheSize / 2);
+  ASSERT_GE(high_pri_left, kCacheSize / 4);
+}
+
 TEST_F(CacheTest, NewId) {
   uint64_t a = cache_->NewId();
   uint64_t b = cache_->NewId();
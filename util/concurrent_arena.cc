@@ -0,0 +1,116 @@
+// Copyright (c) 2026 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "util/concurrent_arena.h"
+
+#include <cassert>
+#include <cstdint>
+#include <thread>
+
+#include "util/mutexlock.h"
+
+namespace leveldb {
+
+namespace {
+
+// Number of shards: the number of hardware threads rounded up to a power of
+// two, so that threads running at the same time mostly get shards of their
+// own.
+size_t ShardCount() {
+  size_t threads = std::thread::hardware_concurrency();
+  size_t count = 1;
+  while (count < threads && count < 256) {
+    count <<= 1;
+  }
+  return count;
+}
+
+// Allocations this large bypass the shards.
+const size_t kLargeAllocation = 512;
+
+}  // namespace
+
+void ConcurrentArena::SpinMutex::Lock() {
+  while (true) {
+    if (!locked_.exchange(true, std::memory_order_acquire)) {
+      return;
+    }
+    while (locked_.load(std::memory_order_relaxed)) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+ConcurrentArena::ConcurrentArena() : ConcurrentArena(0) {}
+
+ConcurrentArena::ConcurrentArena(size_t huge_page_size)
+    : shard_mask_(ShardCount() - 1),
+      shards_(new Shard[shard_mask_ + 1]),
+      // With huge pages the shared arena maps whole huge pages and the
+      // shards carve their chunks out of them.
+      arena_(huge_page_size == 0 ? kShardBlockSize : huge_page_size,
+             huge_page_size),
+      arena_unused_(0) {}
+
+ConcurrentArena::~ConcurrentArena() = default;
+
+size_t ConcurrentArena::MemoryUsage() const {
+  size_t unused = arena_unused_.load(std::memory_order_relaxed);
+  for (size_t i = 0; i <= shard_mask_; i++) {
+    unused += shards_[i].unused.load(std::memory_order_relaxed);
+  }
+  const size_t total = arena_.MemoryUsage();
+  return total > unused ? total - unused : 0;
+}
+
+ConcurrentArena::Shard* ConcurrentArena::ThreadShard() {
+  // Threads are spread over the shards round-robin on first use.
+  static std::atomic<size_t> next_shard(0);
+  thread_local size_t shard_index =
+      next_shard.fetch_add(1, std::memory_order_relaxed);
+  return &shards_[shard_index & shard_mask_];
+}
+
+char* ConcurrentArena::AllocateShared(size_t bytes, bool aligned) {
+  char* result =
+      aligned ? arena_.AllocateAligned(bytes) : arena_.Allocate(bytes);
+  arena_unused_.store(arena_.RemainingBytes(), std::memory_order_relaxed);
+  return result;
+}
+
+char* ConcurrentArena::AllocateImpl(size_t bytes, bool aligned) {
+  assert(bytes > 0);
+  if (bytes > kLargeAllocation) {
+    MutexLock l(&mu_);
+    return AllocateShared(bytes, aligned);
+  }
+
+  const size_t align = (sizeof(void*) > 8) ? sizeof(void*) : 8;
+  Shard* shard = ThreadShard();
+  shard->mu.Lock();
+  size_t unused = shard->unused.load(std::memory_order_relaxed);
+  size_t slop = 0;
+  if (aligned) {
+    const size_t current_mod =
+        reinterpret_cast<uintptr_t>(shard->free_begin) & (align - 1);
+    slop = (current_mod == 0 ? 0 : align - current_mod);
+  }
+  if (bytes + slop > unused) {
+    // We waste the remaining space in the shard's current chunk.
+    {
+      MutexLock l(&mu_);
+      shard->free_begin = AllocateShared(kShardBlockSize, true /*aligned*/);
+    }
+    unused = kShardBlockSize;
+    slop = 0;
+  }
+  char* result = shard->free_begin + slop;
+  shard->free_begin += bytes + slop;
+  shard->unused.store(unused - bytes - slop, std::memory_order_relaxed);
+  shard->mu.Unlock();
+  assert(!aligned || (reinterpret_cast<uintptr_t>(result) & (align - 1)) == 0);
+  return result;
+}
+
+}  // namespace leveldb
@@ -0,0 +1,96 @@
+// Copyright (c) 2026 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef STORAGE_LEVELDB_UTIL_CONCURRENT_ARENA_H_
+#define STORAGE_LEVELDB_UTIL_CONCURRENT_ARENA_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+#include "port/port.h"
+#include "port/thread_annotations.h"
+#include "util/allocator.h"
+#include "util/arena.h"
+
+namespace leveldb {
+
+// An Allocator that many threads may use at once.  Each thread allocates
+// from one of several shards, which refill in small chunks from a shared
+// Arena.  Threads rarely contend on the same shard, and only refills and
+// large allocations take the shared lock.
+class ConcurrentArena final : public Allocator {
+ public:
+  ConcurrentArena();
+
+  // See Arena::Arena(size_t, size_t) for "huge_page_size".
+  explicit ConcurrentArena(size_t huge_page_size);
+
+  ConcurrentArena(const ConcurrentArena&) = delete;
+  ConcurrentArena& operator=(const ConcurrentArena&) = delete;
+
+  ~ConcurrentArena() override;
+
+  char* Allocate(size_t bytes) override {
+    return AllocateImpl(bytes, false /*aligned*/);
+  }
+
+  char* AllocateAligned(size_t bytes) override {
+    return AllocateImpl(bytes, true /*aligned*/);
+  }
+
+  // Bytes taken from the system, less what the shards and the current block
+  // of the shared arena hold in reserve.
+  size_t MemoryUsage() const override;
+
+ private:
+  // Minimal test-and-test-and-set lock.  Shard critical sections are a few
+  // instructions long, so spinning beats sleeping.
+  class SpinMutex {
+   public:
+    SpinMutex() : locked_(false) {}
+    void Lock();
+    void Unlock() { locked_.store(false, std::memory_order_release); }
+
+   private:
+    std::atomic<bool> locked_;
+  };
+
+  struct Shard {
+    Shard() : free_begin(nullptr), unused(0) {}
+
+    SpinMutex mu;
+    char* free_begin;
+    // Bytes left at free_begin.  Atomic so MemoryUsage() can read it
+    // without locking.
+    std::atomic<size_t> unused;
+    // Keeps neighbouring shards off each other's cache lines.
+    char padding[64];
+  };
+
+  char* AllocateImpl(size_t bytes, bool aligned);
+  Shard* ThreadShard();
+  // Allocates from arena_ and records what is left of its current block.
+  char* AllocateShared(size_t bytes, bool aligned)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Size of the chunks shards take from arena_.
+  static const size_t kShardBlockSize = 4096;
+
+  size_t shard_mask_;
+  std::unique_ptr<Shard[]> shards_;
+
+  // Only allocating from arena_ needs mu_; its MemoryUsage() is safe to
+  // call without it.
+  port::Mutex mu_;
+  Arena arena_;
+  // arena_.RemainingBytes() as of the last allocation.  With huge pages the
+  // shared arena maps a whole huge page at once, and all but the part handed
+  // out so far is still in reserve.
+  std::atomic<size_t> arena_unused_;
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_UTIL_CONCURRENT_ARENA_H_
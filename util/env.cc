@@ -22,6 +22,37 @@ Status Env::NewAppendableFile(const std::string& fname, WritableFile** result) {
   return Status::NotSupported("NewAppendableFile", fname);
 }
 
+Status Env::NewRandomAccessFile(const std::string& fname,
+                                const FileOptions& /*options*/,
+                                RandomAccessFile** result) {
+  return NewRandomAccessFile(fname, result);
+}
+
+Status Env::NewWritableFile(const std::string& fname,
+                            const FileOptions& /*options*/,
+                            WritableFile** result) {
+  return NewWritableFile(fname, result);
+}
+
+Status Env::ReuseWritableFile(const std::string& fname,
+                              const std::string& old_fname,
+                              const FileOptions& options,
+                              WritableFile** result) {
+  Status s = RenameFile(old_fname, fname);
+  if (!s.ok()) {
+    *result = nullptr;
+    return s;
+  }
+  return NewWritableFile(fname, options, result);
+}
+
+void Env::Schedule(void (*function)(void* arg), void* arg,
+                   Priority /*pri*/) {
+  Schedule(function, arg);
+}
+
+void Env::SetBackgroundThreads(int /*num*/, Priority /*pri*/) {}
+
 Status Env::RemoveDir(const std::string& dirname) { return DeleteDir(dirname); }
 Status Env::DeleteDir(const std::string& dirname) { return RemoveDir(dirname); }
 
@@ -32,6 +63,22 @@ SequentialFile::~SequentialFile() = default;
 
 RandomAccessFile::~RandomAccessFile() = default;
 
+Status RandomAccessFile::Prefetch(uint64_t /*offset*/, size_t /*n*/) const {
+  return Status::OK();
+}
+
+Status RandomAccessFile::MultiRead(ReadRequest* reqs, size_t n) const {
+  Status result;
+  for (size_t i = 0; i < n; i++) {
+    reqs[i].status =
+        Read(reqs[i].offset, reqs[i].n, &reqs[i].result, reqs[i].scratch);
+    if (result.ok()) {
+      result = reqs[i].status;
+    }
+  }
+  return result;
+}
+
 WritableFile::~WritableFile() = default;
 
 Logger::~Logger() = default;
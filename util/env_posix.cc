@@ -12,6 +12,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <atomic>
 #include <cerrno>
 #include <cstddef>
@@ -35,6 +36,10 @@
 #include "util/env_posix_test_helper.h"
 #include "util/posix_logger.h"
 
+#if HAVE_LIBURING
+#include <liburing.h>
+#endif  // HAVE_LIBURING
+
 namespace leveldb {
 
 namespace {
@@ -57,6 +62,10 @@ constexpr const int kOpenBaseFlags = 0;
 
 constexpr const size_t kWritableFileBufferSize = 65536;
 
+// Direct I/O requires buffers, file offsets and transfer sizes to be
+// multiples of this.
+constexpr const size_t kDirectIOAlignment = 4096;
+
 Status PosixError(const std::string& context, int error_number) {
   if (error_number == ENOENT) {
     return Status::NotFound(context, std::strerror(error_number));
@@ -140,6 +149,127 @@ class PosixSequentialFile final : public SequentialFile {
   const std::string filename_;
 };
 
+// Completes a read that returned fewer than "req->n" bytes before the end
+// of the file, as reads other than pread() may.
+Status PreadRemainder(int fd, const std::string& filename, ReadRequest* req) {
+  size_t done = req->result.size();
+  while (done < req->n) {
+    ssize_t read_size = ::pread(fd, req->scratch + done, req->n - done,
+                                static_cast<off_t>(req->offset + done));
+    if (read_size < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return PosixError(filename, errno);
+    }
+    if (read_size == 0) {
+      break;  // End of file
+    }
+    done += read_size;
+  }
+  req->result = Slice(req->scratch, done);
+  return Status::OK();
+}
+
+#if HAVE_LIBURING
+// Submits the reads of PosixRandomAccessFile::MultiRead() to io_uring, up to
+// kQueueDepth of them per system call.  Each thread has its own instance, so
+// no locking is needed.
+class PosixIoUring {
+ public:
+  static constexpr unsigned kQueueDepth = 64;
+
+  PosixIoUring()
+      : initialized_(::io_uring_queue_init(kQueueDepth, &ring_, 0) == 0),
+        usable_(initialized_) {}
+
+  PosixIoUring(const PosixIoUring&) = delete;
+  PosixIoUring& operator=(const PosixIoUring&) = delete;
+
+  ~PosixIoUring() { Shutdown(); }
+
+  // Returns the calling thread's instance, or nullptr if io_uring is not
+  // available.
+  static PosixIoUring* ForCurrentThread() {
+    static thread_local PosixIoUring ring;
+    return ring.usable_ ? &ring : nullptr;
+  }
+
+  // Performs reads from "reqs[0..n-1]" in order, and returns how many of
+  // them were performed, successfully or not.  The caller must perform the
+  // rest some other way; this only happens if the ring fails, after which it
+  // is not used again.
+  size_t Read(int fd, const std::string& filename, ReadRequest* reqs,
+              size_t n) {
+    size_t done = 0;
+    while (done < n) {
+      const unsigned batch =
+          static_cast<unsigned>(std::min<size_t>(n - done, kQueueDepth));
+      for (unsigned i = 0; i < batch; i++) {
+        ReadRequest* req = &reqs[done + i];
+        // Overwritten when the read completes.
+        req->result = Slice(req->scratch, 0);
+        req->status = Status::IOError(filename, "io_uring read not completed");
+        struct io_uring_sqe* sqe = ::io_uring_get_sqe(&ring_);
+        ::io_uring_prep_read(sqe, fd, req->scratch,
+                             static_cast<unsigned>(req->n), req->offset);
+        ::io_uring_sqe_set_data(sqe, req);
+      }
+
+      int submitted = ::io_uring_submit(&ring_);
+      if (submitted != static_cast<int>(batch)) {
+        // Entries left in the submission queue would go out with some later
+        // batch, so give up on the ring.
+        usable_ = false;
+      }
+      for (int i = 0; i < submitted; i++) {
+        struct io_uring_cqe* cqe;
+        int result;
+        do {
+          result = ::io_uring_wait_cqe(&ring_, &cqe);
+        } while (result == -EINTR);
+        if (result < 0) {
+          // The reads not yet reaped keep their IOError, and tearing the
+          // ring down cancels whatever of them is still in flight.
+          Shutdown();
+          return done + batch;
+        }
+        ReadRequest* req =
+            reinterpret_cast<ReadRequest*>(::io_uring_cqe_get_data(cqe));
+        if (cqe->res < 0) {
+          req->result = Slice(req->scratch, 0);
+          req->status = PosixError(filename, -cqe->res);
+        } else {
+          req->result = Slice(req->scratch, cqe->res);
+          req->status = (static_cast<size_t>(cqe->res) < req->n)
+                            ? PreadRemainder(fd, filename, req)
+                            : Status::OK();
+        }
+        ::io_uring_cqe_seen(&ring_, cqe);
+      }
+      if (!usable_) {
+        break;
+      }
+      done += batch;
+    }
+    return done;
+  }
+
+ private:
+  void Shutdown() {
+    if (initialized_) {
+      ::io_uring_queue_exit(&ring_);
+      initialized_ = false;
+    }
+    usable_ = false;
+  }
+
+  bool initialized_;
+  bool usable_;
+  struct io_uring ring_;
+};
+#endif  // HAVE_LIBURING
+
 // Implements random read access in a file using pread().
 //
 // Instances of this class are thread-safe, as required by the RandomAccessFile
@@ -148,9 +278,12 @@ class PosixSequentialFile final : public SequentialFile {
 class PosixRandomAccessFile final : public RandomAccessFile {
  public:
   // The new instance takes ownership of |fd|. |fd_limiter| must outlive this
-  // instance, and will be used to determine if .
-  PosixRandomAccessFile(std::string filename, int fd, Limiter* fd_limiter)
+  // instance, and will be used to determine if .  If |direct_io| is true,
+  // |fd| was opened with O_DIRECT, and reads use aligned buffers.
+  PosixRandomAccessFile(std::string filename, int fd, Limiter* fd_limiter,
+                        bool direct_io = false)
       : has_permanent_fd_(fd_limiter->Acquire()),
+        direct_io_(direct_io),
         fd_(has_permanent_fd_ ? fd : -1),
         fd_limiter_(fd_limiter),
         filename_(std::move(filename)) {
@@ -172,7 +305,7 @@ class PosixRandomAccessFile final : public RandomAccessFile {
               char* scratch) const override {
     int fd = fd_;
     if (!has_permanent_fd_) {
-      fd = ::open(filename_.c_str(), O_RDONLY | kOpenBaseFlags);
+      fd = ::open(filename_.c_str(), OpenFlags());
       if (fd < 0) {
         return PosixError(filename_, errno);
       }
@@ -181,11 +314,15 @@ class PosixRandomAccessFile final : public RandomAccessFile {
     assert(fd != -1);
 
     Status status;
-    ssize_t read_size = ::pread(fd, scratch, n, static_cast<off_t>(offset));
-    *result = Slice(scratch, (read_size < 0) ? 0 : read_size);
-    if (read_size < 0) {
-      // An error: return a non-ok status.
-      status = PosixError(filename_, errno);
+    if (direct_io_) {
+      status = DirectRead(fd, offset, n, result, scratch);
+    } else {
+      ssize_t read_size = ::pread(fd, scratch, n, static_cast<off_t>(offset));
+      *result = Slice(scratch, (read_size < 0) ? 0 : read_size);
+      if (read_size < 0) {
+        // An error: return a non-ok status.
+        status = PosixError(filename_, errno);
+      }
     }
     if (!has_permanent_fd_) {
       // Close the temporary file descriptor opened earlier.
@@ -195,8 +332,131 @@ class PosixRandomAccessFile final : public RandomAccessFile {
     return status;
   }
 
+  Status MultiRead(ReadRequest* reqs, size_t n) const override {
+    if (direct_io_) {
+      // Each read needs its own aligned buffer.
+      return RandomAccessFile::MultiRead(reqs, n);
+    }
+
+    int fd = fd_;
+    if (!has_permanent_fd_) {
+      fd = ::open(filename_.c_str(), O_RDONLY | kOpenBaseFlags);
+      if (fd < 0) {
+        Status status = PosixError(filename_, errno);
+        for (size_t i = 0; i < n; i++) {
+          reqs[i].result = Slice(reqs[i].scratch, 0);
+          reqs[i].status = status;
+        }
+        return status;
+      }
+    }
+
+    size_t done = 0;
+#if HAVE_LIBURING
+    PosixIoUring* ring = PosixIoUring::ForCurrentThread();
+    if (ring != nullptr) {
+      done = ring->Read(fd, filename_, reqs, n);
+    }
+#endif  // HAVE_LIBURING
+    for (size_t i = done; i < n; i++) {
+      reqs[i].result = Slice(reqs[i].scratch, 0);
+      reqs[i].status = PreadRemainder(fd, filename_, &reqs[i]);
+    }
+
+    if (!has_permanent_fd_) {
+      ::close(fd);
+    }
+    for (size_t i = 0; i < n; i++) {
+      if (!reqs[i].status.ok()) {
+        return reqs[i].status;
+      }
+    }
+    return Status::OK();
+  }
+
+  Status Prefetch(uint64_t offset, size_t n) const override {
+#if defined(POSIX_FADV_WILLNEED)
+    if (direct_io_) {
+      return Status::OK();  // Reads bypass the page cache
+    }
+
+    int fd = fd_;
+    if (!has_permanent_fd_) {
+      fd = ::open(filename_.c_str(), O_RDONLY | kOpenBaseFlags);
+      if (fd < 0) {
+        return PosixError(filename_, errno);
+      }
+    }
+
+    // Starts asynchronous readahead into the page cache.
+    const int result = ::posix_fadvise(fd, static_cast<off_t>(offset),
+                                       static_cast<off_t>(n),
+                                       POSIX_FADV_WILLNEED);
+    if (!has_permanent_fd_) {
+      ::close(fd);
+    }
+    if (result != 0) {
+      return PosixError(filename_, result);
+    }
+#endif  // defined(POSIX_FADV_WILLNEED)
+    return Status::OK();
+  }
+
  private:
+  int OpenFlags() const {
+    int flags = O_RDONLY | kOpenBaseFlags;
+#if defined(O_DIRECT)
+    if (direct_io_) {
+      flags |= O_DIRECT;
+    }
+#endif  // defined(O_DIRECT)
+    return flags;
+  }
+
+  // Reads the aligned pages that cover [offset, offset + n) into a
+  // temporary buffer, and copies the requested part to "scratch".
+  Status DirectRead(int fd, uint64_t offset, size_t n, Slice* result,
+                    char* scratch) const {
+    *result = Slice(scratch, 0);
+    const uint64_t aligned_offset = offset - offset % kDirectIOAlignment;
+    const size_t aligned_size =
+        (offset + n - aligned_offset + kDirectIOAlignment - 1) /
+        kDirectIOAlignment * kDirectIOAlignment;
+    void* buf = nullptr;
+    if (::posix_memalign(&buf, kDirectIOAlignment, aligned_size) != 0) {
+      return Status::IOError(filename_, "cannot allocate read buffer");
+    }
+
+    Status status;
+    char* data = reinterpret_cast<char*>(buf);
+    size_t done = 0;
+    while (done < aligned_size) {
+      ssize_t read_size = ::pread(fd, data + done, aligned_size - done,
+                                  static_cast<off_t>(aligned_offset + done));
+      if (read_size < 0) {
+        if (errno == EINTR) {
+          continue;  // Retry
+        }
+        status = PosixError(filename_, errno);
+        break;
+      }
+      if (read_size == 0) {
+        break;  // End of file
+      }
+      done += read_size;
+    }
+    const size_t skip = static_cast<size_t>(offset - aligned_offset);
+    if (status.ok() && done > skip) {
+      const size_t size = std::min(n, done - skip);
+      std::memcpy(scratch, data + skip, size);
+      *result = Slice(scratch, size);
+    }
+    std::free(buf);
+    return status;
+  }
+
   const bool has_permanent_fd_;  // If false, the file is opened on every read.
+  const bool direct_io_;
   const int fd_;                 // -1 if has_permanent_fd_ is false.
   Limiter* const fd_limiter_;
   const std::string filename_;
@@ -239,6 +499,24 @@ class PosixMmapReadableFile final : public RandomAccessFile {
     return Status::OK();
   }
 
+  Status Prefetch(uint64_t offset, size_t n) const override {
+#if defined(MADV_WILLNEED)
+    if (offset >= length_) {
+      return Status::OK();
+    }
+    n = std::min<uint64_t>(n, length_ - offset);
+    // madvise() wants a page-aligned start.
+    static const uintptr_t page_size = ::sysconf(_SC_PAGESIZE);
+    const uintptr_t start = reinterpret_cast<uintptr_t>(mmap_base_ + offset);
+    const uintptr_t aligned_start = start & ~(page_size - 1);
+    if (::madvise(reinterpret_cast<void*>(aligned_start),
+                  n + (start - aligned_start), MADV_WILLNEED) != 0) {
+      return PosixError(filename_, errno);
+    }
+#endif  // defined(MADV_WILLNEED)
+    return Status::OK();
+  }
+
  private:
   char* const mmap_base_;
   const size_t length_;
@@ -246,14 +524,105 @@ class PosixMmapReadableFile final : public RandomAccessFile {
   const std::string filename_;
 };
 
+// Ensures that all the caches associated with the given file descriptor's
+// data are flushed all the way to durable media, and can withstand power
+// failures.
+//
+// The path argument is only used to populate the description string in the
+// returned Status if an error occurs.
+Status SyncFd(int fd, const std::string& fd_path) {
+#if HAVE_FULLFSYNC
+  // On macOS and iOS, fsync() doesn't guarantee durability past power
+  // failures. fcntl(F_FULLFSYNC) is required for that purpose. Some
+  // filesystems don't support fcntl(F_FULLFSYNC), and require a fallback to
+  // fsync().
+  if (::fcntl(fd, F_FULLFSYNC) == 0) {
+    return Status::OK();
+  }
+#endif  // HAVE_FULLFSYNC
+
+#if HAVE_FDATASYNC
+  bool sync_success = ::fdatasync(fd) == 0;
+#else
+  bool sync_success = ::fsync(fd) == 0;
+#endif  // HAVE_FDATASYNC
+
+  if (sync_success) {
+    return Status::OK();
+  }
+  return PosixError(fd_path, errno);
+}
+
+// Returns the directory name in a path pointing to a file.
+//
+// Returns "." if the path does not contain any directory separator.
+std::string Dirname(const std::string& filename) {
+  std::string::size_type separator_pos = filename.rfind('/');
+  if (separator_pos == std::string::npos) {
+    return std::string(".");
+  }
+  // The filename component should not contain a path separator. If it does,
+  // the splitting was done incorrectly.
+  assert(filename.find('/', separator_pos + 1) == std::string::npos);
+
+  return filename.substr(0, separator_pos);
+}
+
+// Reserves disk space for a file ahead of its write position.
+//
+// Preallocation is only an optimization, so failures are swallowed; after the
+// first failure the file system is assumed not to support it and no further
+// attempts are made.
+class Preallocator {
+ public:
+  explicit Preallocator(size_t block_size)
+      : block_size_(block_size), allocated_(0) {}
+
+  // Makes sure that the bytes before "end_offset" are backed by disk space,
+  // without changing the file size reported by stat().
+  void EnsureAllocated(int fd, uint64_t end_offset) {
+#if HAVE_FALLOCATE
+    if (block_size_ == 0 || end_offset <= allocated_) {
+      return;
+    }
+    const uint64_t new_allocated =
+        (end_offset + block_size_ - 1) / block_size_ * block_size_;
+    if (::fallocate(fd, FALLOC_FL_KEEP_SIZE, static_cast<off_t>(allocated_),
+                    static_cast<off_t>(new_allocated - allocated_)) == 0) {
+      allocated_ = new_allocated;
+    } else {
+      block_size_ = 0;
+    }
+#else
+    (void)fd;
+    (void)end_offset;
+#endif  // HAVE_FALLOCATE
+  }
+
+  // True if space past "file_size" may have been reserved.
+  bool AllocatedPast(uint64_t file_size) const {
+    return allocated_ > file_size;
+  }
+
+ private:
+  size_t block_size_;
+  uint64_t allocated_;
+};
+
 class PosixWritableFile final : public WritableFile {
  public:
   PosixWritableFile(std::string filename, int fd)
+      : PosixWritableFile(std::move(filename), fd, FileOptions()) {}
+
+  PosixWritableFile(std::string filename, int fd, const FileOptions& options)
       : pos_(0),
         fd_(fd),
+        file_size_(0),
         is_manifest_(IsManifest(filename)),
+        data_sync_(options.use_data_sync),
         filename_(std::move(filename)),
-        dirname_(Dirname(filename_)) {}
+        dirname_(Dirname(filename_)),
+        preallocator_(options.preallocation_block_size) {}
 
   ~PosixWritableFile() override {
     if (fd_ >= 0) {
@@ -293,6 +662,12 @@ class PosixWritableFile final : public WritableFile {
 
   Status Close() override {
     Status status = FlushBuffer();
+    if (status.ok() && preallocator_.AllocatedPast(file_size_)) {
+      // Give back the space reserved past the data that was written.
+      if (::ftruncate(fd_, static_cast<off_t>(file_size_)) != 0) {
+        status = PosixError(filename_, errno);
+      }
+    }
     const int close_result = ::close(fd_);
     if (close_result < 0 && status.ok()) {
       status = PosixError(filename_, errno);
@@ -315,7 +690,8 @@ class PosixWritableFile final : public WritableFile {
     }
 
     status = FlushBuffer();
-    if (!status.ok()) {
+    if (!status.ok() || data_sync_) {
+      // With O_DSYNC every completed write is already durable.
       return status;
     }
 
@@ -330,6 +706,7 @@ class PosixWritableFile final : public WritableFile {
   }
 
   Status WriteUnbuffered(const char* data, size_t size) {
+    preallocator_.EnsureAllocated(fd_, file_size_ + size);
     while (size > 0) {
       ssize_t write_result = ::write(fd_, data, size);
       if (write_result < 0) {
@@ -340,6 +717,7 @@ class PosixWritableFile final : public WritableFile {
       }
       data += write_result;
       size -= write_result;
+      file_size_ += write_result;
     }
     return Status::OK();
   }
@@ -360,50 +738,6 @@ class PosixWritableFile final : public WritableFile {
     return status;
   }
 
-  // Ensures that all the caches associated with the given file descriptor's
-  // data are flushed all the way to durable media, and can withstand power
-  // failures.
-  //
-  // The path argument is only used to populate the description string in the
-  // returned Status if an error occurs.
-  static Status SyncFd(int fd, const std::string& fd_path) {
-#if HAVE_FULLFSYNC
-    // On macOS and iOS, fsync() doesn't guarantee durability past power
-    // failures. fcntl(F_FULLFSYNC) is required for that purpose. Some
-    // filesystems don't support fcntl(F_FULLFSYNC), and require a fallback to
-    // fsync().
-    if (::fcntl(fd, F_FULLFSYNC) == 0) {
-      return Status::OK();
-    }
-#endif  // HAVE_FULLFSYNC
-
-#if HAVE_FDATASYNC
-    bool sync_success = ::fdatasync(fd) == 0;
-#else
-    bool sync_success = ::fsync(fd) == 0;
-#endif  // HAVE_FDATASYNC
-
-    if (sync_success) {
-      return Status::OK();
-    }
-    return PosixError(fd_path, errno);
-  }
-
-  // Returns the directory name in a path pointing to a file.
-  //
-  // Returns "." if the path does not contain any directory separator.
-  static std::string Dirname(const std::string& filename) {
-    std::string::size_type separator_pos = filename.rfind('/');
-    if (separator_pos == std::string::npos) {
-      return std::string(".");
-    }
-    // The filename component should not contain a path separator. If it does,
-    // the splitting was done incorrectly.
-    assert(filename.find('/', separator_pos + 1) == std::string::npos);
-
-    return filename.substr(0, separator_pos);
-  }
-
   // Extracts the file name from a path pointing to a file.
   //
   // The returned Slice points to |filename|'s data buffer, so it is only valid
@@ -430,11 +764,150 @@ class PosixWritableFile final : public WritableFile {
   char buf_[kWritableFileBufferSize];
   size_t pos_;
   int fd_;
+  uint64_t file_size_;  // Bytes written to fd_ through this object.
 
   const bool is_manifest_;  // True if the file's name starts with MANIFEST.
+  const bool data_sync_;    // True if fd_ was opened with O_DSYNC.
   const std::string filename_;
   const std::string dirname_;  // The directory of filename_.
+  Preallocator preallocator_;
+};
+
+#if defined(O_DIRECT)
+// Implements sequential writing through O_DIRECT.
+//
+// Direct I/O requires the buffer, the file offset and the transfer size to be
+// aligned, so appends collect in a page-aligned buffer.  Flush() writes every
+// page holding data, zero-padding the last partial page, and keeps that page
+// buffered so that later appends rewrite it in place.  Close() trims the
+// padding.  Readers of files written this way may thus observe zeroed bytes
+// past the last flushed record; the log format already treats zero-filled
+// regions as padding.
+//
+// Files opened with FileOptions::defer_flush skip Flush() and are only
+// written out when the buffer fills, on Sync() and on Close(), so that
+// frequent flushes do not rewrite the same partial page over and over.
+class PosixDirectWritableFile final : public WritableFile {
+ public:
+  PosixDirectWritableFile(std::string filename, int fd, char* aligned_buf,
+                          const FileOptions& options)
+      : buf_(aligned_buf),
+        pos_(0),
+        buf_offset_(0),
+        fd_(fd),
+        data_sync_(options.use_data_sync),
+        defer_flush_(options.defer_flush),
+        filename_(std::move(filename)),
+        preallocator_(options.preallocation_block_size) {}
+
+  ~PosixDirectWritableFile() override {
+    if (fd_ >= 0) {
+      // Ignoring any potential errors
+      Close();
+    }
+    std::free(buf_);
+  }
+
+  Status Append(const Slice& data) override {
+    const char* src = data.data();
+    size_t left = data.size();
+    while (left > 0) {
+      const size_t copy_size = std::min(left, kWritableFileBufferSize - pos_);
+      std::memcpy(buf_ + pos_, src, copy_size);
+      src += copy_size;
+      left -= copy_size;
+      pos_ += copy_size;
+      if (pos_ == kWritableFileBufferSize) {
+        Status status = FlushBuffer();
+        if (!status.ok()) {
+          return status;
+        }
+      }
+    }
+    return Status::OK();
+  }
+
+  Status Close() override {
+    Status status = FlushBuffer();
+    if (status.ok() &&
+        ::ftruncate(fd_, static_cast<off_t>(buf_offset_ + pos_)) != 0) {
+      status = PosixError(filename_, errno);
+    }
+    const int close_result = ::close(fd_);
+    if (close_result < 0 && status.ok()) {
+      status = PosixError(filename_, errno);
+    }
+    fd_ = -1;
+    return status;
+  }
+
+  // With defer_flush_, data stays in buf_; see the class comment.
+  Status Flush() override {
+    return defer_flush_ ? Status::OK() : FlushBuffer();
+  }
+
+  Status Sync() override {
+    Status status = FlushBuffer();
+    if (!status.ok() || data_sync_) {
+      return status;
+    }
+    // O_DIRECT bypasses the page cache but not the device's write cache, and
+    // the file size still needs to reach the disk.
+    return SyncFd(fd_, filename_);
+  }
+
+  // Alignment required for buffers, offsets and sizes.
+  static constexpr size_t kAlignment = kDirectIOAlignment;
+
+ private:
+  Status FlushBuffer() {
+    if (pos_ == 0) {
+      return Status::OK();
+    }
+    const size_t padded_size =
+        (pos_ + kAlignment - 1) / kAlignment * kAlignment;
+    std::memset(buf_ + pos_, 0, padded_size - pos_);
+    preallocator_.EnsureAllocated(fd_, buf_offset_ + padded_size);
+
+    const char* data = buf_;
+    size_t size = padded_size;
+    uint64_t offset = buf_offset_;
+    while (size > 0) {
+      ssize_t write_result =
+          ::pwrite(fd_, data, size, static_cast<off_t>(offset));
+      if (write_result < 0) {
+        if (errno == EINTR) {
+          continue;  // Retry
+        }
+        return PosixError(filename_, errno);
+      }
+      data += write_result;
+      size -= write_result;
+      offset += write_result;
+    }
+
+    // Keep the trailing partial page so that it is rewritten together with
+    // the data appended after it.
+    const size_t full_pages_size = pos_ - pos_ % kAlignment;
+    std::memmove(buf_, buf_ + full_pages_size, pos_ - full_pages_size);
+    pos_ -= full_pages_size;
+    buf_offset_ += full_pages_size;
+    return Status::OK();
+  }
+
+  // buf_[0, pos_ - 1] holds the data that belongs at buf_offset_ in the file.
+  // buf_offset_ is always a multiple of kAlignment.
+  char* const buf_;
+  size_t pos_;
+  uint64_t buf_offset_;
+  int fd_;
+
+  const bool data_sync_;    // True if fd_ was opened with O_DSYNC.
+  const bool defer_flush_;  // True if Flush() leaves data in buf_.
+  const std::string filename_;
+  Preallocator preallocator_;
 };
+#endif  // defined(O_DIRECT)
 
 int LockOrUnlock(int fd, bool lock) {
   errno = 0;
@@ -542,6 +1015,27 @@ class PosixEnv : public Env {
     return status;
   }
 
+  Status NewRandomAccessFile(const std::string& filename,
+                             const FileOptions& options,
+                             RandomAccessFile** result) override {
+#if defined(O_DIRECT)
+    if (options.use_direct_io) {
+      *result = nullptr;
+      int fd = ::open(filename.c_str(), O_RDONLY | O_DIRECT | kOpenBaseFlags);
+      if (fd >= 0) {
+        *result = new PosixRandomAccessFile(filename, fd, &fd_limiter_,
+                                            /*direct_io=*/true);
+        return Status::OK();
+      } else if (errno != EINVAL) {
+        return PosixError(filename, errno);
+      }
+      // The file system does not support direct I/O (e.g. tmpfs); fall back
+      // to buffered reads.
+    }
+#endif  // defined(O_DIRECT)
+    return NewRandomAccessFile(filename, result);
+  }
+
   Status NewWritableFile(const std::string& filename,
                          WritableFile** result) override {
     int fd = ::open(filename.c_str(),
@@ -555,6 +1049,39 @@ class PosixEnv : public Env {
     return Status::OK();
   }
 
+  Status NewWritableFile(const std::string& filename,
+                         const FileOptions& options,
+                         WritableFile** result) override {
+    return OpenWritableFile(filename, O_TRUNC | O_WRONLY | O_CREAT, options,
+                            result);
+  }
+
+  Status ReuseWritableFile(const std::string& filename,
+                           const std::string& old_filename,
+                           const FileOptions& options,
+                           WritableFile** result) override {
+    *result = nullptr;
+    if (std::rename(old_filename.c_str(), filename.c_str()) != 0) {
+      return PosixError(old_filename, errno);
+    }
+
+    // Persist the rename before any data is synced to the reused file.
+    // Otherwise a crash could leave that data under the old name, which
+    // recovery no longer looks at.
+    const std::string dirname = Dirname(filename);
+    int dir_fd = ::open(dirname.c_str(), O_RDONLY | kOpenBaseFlags);
+    if (dir_fd < 0) {
+      return PosixError(dirname, errno);
+    }
+    Status status = SyncFd(dir_fd, dirname);
+    ::close(dir_fd);
+    if (!status.ok()) {
+      return status;
+    }
+
+    return OpenWritableFile(filename, O_WRONLY | O_CREAT, options, result);
+  }
+
   Status NewAppendableFile(const std::string& filename,
                            WritableFile** result) override {
     int fd = ::open(filename.c_str(),
@@ -661,7 +1188,14 @@ class PosixEnv : public Env {
   }
 
   void Schedule(void (*background_work_function)(void* background_work_arg),
-                void* background_work_arg) override;
+                void* background_work_arg) override {
+    Schedule(background_work_function, background_work_arg, kLowPriority);
+  }
+
+  void Schedule(void (*background_work_function)(void* background_work_arg),
+                void* background_work_arg, Priority pri) override;
+
+  void SetBackgroundThreads(int num, Priority pri) override;
 
   void StartThread(void (*thread_main)(void* thread_main_arg),
                    void* thread_main_arg) override {
@@ -717,10 +1251,50 @@ class PosixEnv : public Env {
   }
 
  private:
-  void BackgroundThreadMain();
+  // Opens "filename" with the open(2) "flags" and wraps it in the
+  // WritableFile implementation that matches "options".
+  Status OpenWritableFile(const std::string& filename, int flags,
+                          const FileOptions& options, WritableFile** result) {
+    *result = nullptr;
+#if defined(O_DSYNC)
+    if (options.use_data_sync) {
+      flags |= O_DSYNC;
+    }
+#endif  // defined(O_DSYNC)
+
+#if defined(O_DIRECT)
+    if (options.use_direct_io) {
+      int fd =
+          ::open(filename.c_str(), flags | O_DIRECT | kOpenBaseFlags, 0644);
+      if (fd >= 0) {
+        void* buf = nullptr;
+        if (::posix_memalign(&buf, PosixDirectWritableFile::kAlignment,
+                             kWritableFileBufferSize) == 0) {
+          *result = new PosixDirectWritableFile(
+              filename, fd, reinterpret_cast<char*>(buf), options);
+          return Status::OK();
+        }
+        ::close(fd);
+      } else if (errno != EINVAL) {
+        return PosixError(filename, errno);
+      }
+      // The file system does not support direct I/O (e.g. tmpfs); fall back
+      // to buffered writes.
+    }
+#endif  // defined(O_DIRECT)
 
-  static void BackgroundThreadEntryPoint(PosixEnv* env) {
-    env->BackgroundThreadMain();
+    int fd = ::open(filename.c_str(), flags | kOpenBaseFlags, 0644);
+    if (fd < 0) {
+      return PosixError(filename, errno);
+    }
+    *result = new PosixWritableFile(filename, fd, options);
+    return Status::OK();
+  }
+
+  void BackgroundThreadMain(Priority pri);
+
+  static void BackgroundThreadEntryPoint(PosixEnv* env, Priority pri) {
+    env->BackgroundThreadMain(pri);
   }
 
   // Stores the work item data in a Schedule() call.
@@ -737,12 +1311,18 @@ class PosixEnv : public Env {
     void* const arg;
   };
 
-  port::Mutex background_work_mutex_;
-  port::CondVar background_work_cv_ GUARDED_BY(background_work_mutex_);
-  bool started_background_thread_ GUARDED_BY(background_work_mutex_);
+  // The threads and queued work of one Env::Priority.
+  struct BackgroundPool {
+    BackgroundPool(port::Mutex* mu) : cv(mu) {}
 
-  std::queue<BackgroundWorkItem> background_work_queue_
-      GUARDED_BY(background_work_mutex_);
+    port::CondVar cv;
+    int max_threads = 1;  // Set by SetBackgroundThreads()
+    int num_threads = 0;  // Started and not yet exited
+    std::queue<BackgroundWorkItem> queue;
+  };
+
+  port::Mutex background_work_mutex_;
+  BackgroundPool background_pools_[2] GUARDED_BY(background_work_mutex_);
 
   PosixLockTable locks_;  // Thread-safe.
   Limiter mmap_limiter_;  // Thread-safe.
@@ -773,49 +1353,65 @@ int MaxOpenFiles() {
 }  // namespace
 
 PosixEnv::PosixEnv()
-    : background_work_cv_(&background_work_mutex_),
-      started_background_thread_(false),
+    : background_pools_{{&background_work_mutex_}, {&background_work_mutex_}},
       mmap_limiter_(MaxMmaps()),
       fd_limiter_(MaxOpenFiles()) {}
 
 void PosixEnv::Schedule(
     void (*background_work_function)(void* background_work_arg),
-    void* background_work_arg) {
+    void* background_work_arg, Priority pri) {
   background_work_mutex_.Lock();
+  BackgroundPool* pool = &background_pools_[pri];
 
-  // Start the background thread, if we haven't done so already.
-  if (!started_background_thread_) {
-    started_background_thread_ = true;
-    std::thread background_thread(PosixEnv::BackgroundThreadEntryPoint, this);
+  // Start the pool's threads, if we haven't done so already.
+  while (pool->num_threads < pool->max_threads) {
+    pool->num_threads++;
+    std::thread background_thread(PosixEnv::BackgroundThreadEntryPoint, this,
+                                  pri);
     background_thread.detach();
   }
 
-  // If the queue is empty, the background thread may be waiting for work.
-  if (background_work_queue_.empty()) {
-    background_work_cv_.Signal();
-  }
+  pool->queue.emplace(background_work_function, background_work_arg);
+  pool->cv.Signal();
+  background_work_mutex_.Unlock();
+}
 
-  background_work_queue_.emplace(background_work_function, background_work_arg);
+void PosixEnv::SetBackgroundThreads(int num, Priority pri) {
+  background_work_mutex_.Lock();
+  BackgroundPool* pool = &background_pools_[pri];
+  pool->max_threads = std::max(num, 1);
+  // Surplus threads exit when they wake up; missing ones start with the
+  // next Schedule().
+  pool->cv.SignalAll();
   background_work_mutex_.Unlock();
 }
 
-void PosixEnv::BackgroundThreadMain() {
+void PosixEnv::BackgroundThreadMain(Priority pri) {
+  background_work_mutex_.Lock();
+  BackgroundPool* pool = &background_pools_[pri];
   while (true) {
-    background_work_mutex_.Lock();
-
-    // Wait until there is work to be done.
-    while (background_work_queue_.empty()) {
-      background_work_cv_.Wait();
+    // Wait until there is work to be done, or this thread is not needed.
+    while (pool->queue.empty() && pool->num_threads <= pool->max_threads) {
+      pool->cv.Wait();
+    }
+    if (pool->num_threads > pool->max_threads) {
+      pool->num_threads--;
+      if (!pool->queue.empty()) {
+        pool->cv.Signal();  // Hand the work to a remaining thread
+      }
+      break;
     }
 
-    assert(!background_work_queue_.empty());
-    auto background_work_function = background_work_queue_.front().function;
-    void* background_work_arg = background_work_queue_.front().arg;
-    background_work_queue_.pop();
+    assert(!pool->queue.empty());
+    auto background_work_function = pool->queue.front().function;
+    void* background_work_arg = pool->queue.front().arg;
+    pool->queue.pop();
 
     background_work_mutex_.Unlock();
     background_work_function(background_work_arg);
+    background_work_mutex_.Lock();
   }
+  background_work_mutex_.Unlock();
 }
 
 namespace {
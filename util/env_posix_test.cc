@@ -212,6 +212,145 @@ TEST_F(EnvPosixTest, TestOpenOnRead) {
   ASSERT_LEVELDB_OK(env_->RemoveFile(test_file));
 }
 
+TEST_F(EnvPosixTest, TestMultiRead) {
+  std::string test_dir;
+  ASSERT_LEVELDB_OK(env_->GetTestDirectory(&test_dir));
+  std::string test_file = test_dir + "/multi_read.txt";
+  const char kFileData[] = "abcdefghijklmnopqrstuvwxyz";
+  ASSERT_LEVELDB_OK(WriteStringToFile(env_, kFileData, test_file));
+
+  // Covers mmap()ed files, files with a permanent descriptor, and files
+  // opened on every read.
+  const int kNumFiles = kReadOnlyFileLimit + kMMapLimit + 2;
+  leveldb::RandomAccessFile* files[kNumFiles] = {0};
+  for (int i = 0; i < kNumFiles; i++) {
+    ASSERT_LEVELDB_OK(env_->NewRandomAccessFile(test_file, &files[i]));
+  }
+  for (int i = 0; i < kNumFiles; i++) {
+    const uint64_t offsets[] = {0, 10, 20, 23};
+    const size_t sizes[] = {5, 3, 0, 3};
+    char scratch[4][5];
+    ReadRequest reqs[4];
+    for (int r = 0; r < 4; r++) {
+      reqs[r].offset = offsets[r];
+      reqs[r].n = sizes[r];
+      reqs[r].scratch = scratch[r];
+    }
+    ASSERT_LEVELDB_OK(files[i]->MultiRead(reqs, 4));
+    ASSERT_EQ("abcde", reqs[0].result.ToString());
+    ASSERT_EQ("klm", reqs[1].result.ToString());
+    ASSERT_EQ("", reqs[2].result.ToString());
+    ASSERT_EQ("xyz", reqs[3].result.ToString());
+    for (int r = 0; r < 4; r++) {
+      ASSERT_LEVELDB_OK(reqs[r].status);
+    }
+  }
+  for (int i = 0; i < kNumFiles; i++) {
+    delete files[i];
+  }
+  ASSERT_LEVELDB_OK(env_->RemoveFile(test_file));
+}
+
+TEST_F(EnvPosixTest, TestDirectRandomAccessFile) {
+  std::string test_dir;
+  ASSERT_LEVELDB_OK(env_->GetTestDirectory(&test_dir));
+  std::string test_file = test_dir + "/direct_read.txt";
+  std::string data;
+  for (int i = 0; data.size() < 3 * 4096 + 100; i++) {
+    data.push_back(static_cast<char>('a' + i % 26));
+  }
+  ASSERT_LEVELDB_OK(WriteStringToFile(env_, data, test_file));
+
+  // Falls back to buffered reads where the file system has no O_DIRECT.
+  FileOptions options;
+  options.use_direct_io = true;
+  RandomAccessFile* file;
+  ASSERT_LEVELDB_OK(env_->NewRandomAccessFile(test_file, options, &file));
+
+  // Unaligned reads, reads across pages, and reads past the end of file.
+  const uint64_t offsets[] = {0, 7, 4090, 4096, 8000, 12200, 20000};
+  const size_t sizes[] = {10, 4096, 20, 4096, 5000, 100, 10};
+  char scratch[5000];
+  for (int i = 0; i < 7; i++) {
+    Slice result;
+    ASSERT_LEVELDB_OK(file->Read(offsets[i], sizes[i], &result, scratch));
+    const std::string expected = (offsets[i] < data.size())
+                                     ? data.substr(offsets[i], sizes[i])
+                                     : std::string();
+    ASSERT_EQ(expected, result.ToString()) << offsets[i];
+  }
+  delete file;
+  ASSERT_LEVELDB_OK(env_->RemoveFile(test_file));
+}
+
+TEST_F(EnvPosixTest, TestWritableFileFlush) {
+  std::string test_dir;
+  ASSERT_LEVELDB_OK(env_->GetTestDirectory(&test_dir));
+  std::string test_file = test_dir + "/flush.txt";
+
+  // Flush() must hand appended bytes to the file system, buffered or
+  // direct, so that they survive the process.  Direct files may show zero
+  // padding after them.
+  for (int direct = 0; direct <= 1; direct++) {
+    FileOptions options;
+    options.use_direct_io = (direct == 1);
+    WritableFile* file;
+    ASSERT_LEVELDB_OK(env_->NewWritableFile(test_file, options, &file));
+    std::string data;
+    for (int i = 0; i < 3; i++) {
+      const std::string piece(100 + i, static_cast<char>('a' + i));
+      ASSERT_LEVELDB_OK(file->Append(piece));
+      ASSERT_LEVELDB_OK(file->Flush());
+      data += piece;
+
+      std::string contents;
+      ASSERT_LEVELDB_OK(ReadFileToString(env_, test_file, &contents));
+      ASSERT_GE(contents.size(), data.size());
+      ASSERT_EQ(data, contents.substr(0, data.size())) << direct;
+    }
+    ASSERT_LEVELDB_OK(file->Close());
+    delete file;
+  }
+  ASSERT_LEVELDB_OK(env_->RemoveFile(test_file));
+}
+
+TEST_F(EnvPosixTest, TestDirectWritableFile) {
+  std::string test_dir;
+  ASSERT_LEVELDB_OK(env_->GetTestDirectory(&test_dir));
+  std::string test_file = test_dir + "/direct_write.txt";
+
+  // Falls back to buffered writes where the file system has no O_DIRECT.
+  FileOptions options;
+  options.use_direct_io = true;
+  WritableFile* file;
+  ASSERT_LEVELDB_OK(env_->NewWritableFile(test_file, options, &file));
+
+  // Unaligned appends, each flushed, spanning several pages.
+  std::string data;
+  for (int i = 0; data.size() < 3 * 4096 + 100; i++) {
+    const std::string piece(1 + i % 700, static_cast<char>('a' + i % 26));
+    ASSERT_LEVELDB_OK(file->Append(piece));
+    ASSERT_LEVELDB_OK(file->Flush());
+    data += piece;
+  }
+
+  // Sync() writes everything out, possibly followed by zero padding.
+  ASSERT_LEVELDB_OK(file->Sync());
+  std::string contents;
+  ASSERT_LEVELDB_OK(ReadFileToString(env_, test_file, &contents));
+  ASSERT_GE(contents.size(), data.size());
+  ASSERT_EQ(data, contents.substr(0, data.size()));
+
+  // Close() trims the padding.
+  ASSERT_LEVELDB_OK(file->Append("tail"));
+  data += "tail";
+  ASSERT_LEVELDB_OK(file->Close());
+  delete file;
+  ASSERT_LEVELDB_OK(ReadFileToString(env_, test_file, &contents));
+  ASSERT_EQ(data, contents);
+  ASSERT_LEVELDB_OK(env_->RemoveFile(test_file));
+}
+
 #if HAVE_O_CLOEXEC
 
 TEST_F(EnvPosixTest, TestCloseOnExecSequentialFile) {
@@ -134,6 +134,82 @@ TEST_F(EnvTest, RunMany) {
   }
 }
 
+TEST_F(EnvTest, HighPriorityRunsBesideLowPriority) {
+  struct RunState {
+    port::Mutex mu;
+    port::CondVar cvar{&mu};
+    bool low_started = false;
+    bool high_done = false;
+
+    static void RunLow(void* arg) {
+      RunState* state = reinterpret_cast<RunState*>(arg);
+      MutexLock l(&state->mu);
+      state->low_started = true;
+      state->cvar.SignalAll();
+      // Holds up the low priority pool until the high priority job ran.
+      while (!state->high_done) {
+        state->cvar.Wait();
+      }
+    }
+
+    static void RunHigh(void* arg) {
+      RunState* state = reinterpret_cast<RunState*>(arg);
+      MutexLock l(&state->mu);
+      state->high_done = true;
+      state->cvar.SignalAll();
+    }
+  };
+
+  RunState state;
+  env_->Schedule(&RunState::RunLow, &state, Env::kLowPriority);
+  {
+    MutexLock l(&state.mu);
+    while (!state.low_started) {
+      state.cvar.Wait();
+    }
+  }
+  env_->Schedule(&RunState::RunHigh, &state, Env::kHighPriority);
+
+  MutexLock l(&state.mu);
+  while (!state.high_done) {
+    state.cvar.Wait();
+  }
+}
+
+TEST_F(EnvTest, SetBackgroundThreads) {
+  struct RunState {
+    port::Mutex mu;
+    port::CondVar cvar{&mu};
+    int running = 0;
+    int finished = 0;
+
+    // Each job waits for the other, so both need a thread of their own.
+    static void Run(void* arg) {
+      RunState* state = reinterpret_cast<RunState*>(arg);
+      MutexLock l(&state->mu);
+      state->running++;
+      state->cvar.SignalAll();
+      while (state->running < 2) {
+        state->cvar.Wait();
+      }
+      state->finished++;
+      state->cvar.SignalAll();
+    }
+  };
+
+  env_->SetBackgroundThreads(2, Env::kLowPriority);
+  RunState state;
+  env_->Schedule(&RunState::Run, &state, Env::kLowPriority);
+  env_->Schedule(&RunState::Run, &state, Env::kLowPriority);
+  {
+    MutexLock l(&state.mu);
+    while (state.finished != 2) {
+      state.cvar.Wait();
+    }
+  }
+  env_->SetBackgroundThreads(1, Env::kLowPriority);
+}
+
 struct State {
   port::Mutex mu;
   port::CondVar cvar{&mu};
@@ -0,0 +1,152 @@
+// Copyright (c) 2026 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "leveldb/rate_limiter.h"
+
+#include <algorithm>
+
+#include "leveldb/env.h"
+#include "port/port.h"
+#include "port/thread_annotations.h"
+#include "util/mutexlock.h"
+
+namespace leveldb {
+
+RateLimiter::~RateLimiter() = default;
+
+void RateLimiter::SetPendingCompactionBytes(uint64_t /*bytes*/) {}
+
+namespace {
+
+// The bucket holds at most this long's worth of bytes, which bounds the
+// burst after an idle spell.
+static const uint64_t kBurstMicros = 100 * 1000;
+
+// The shortest wait for more bytes, so that small requests do not spin
+static const uint64_t kMinWaitMicros = 1000;
+
+// An auto-tuned limiter runs at no less than its maximum over this
+static const int kMinRateDivisor = 20;
+
+class TokenBucketRateLimiter : public RateLimiter {
+ public:
+  // A "target_pending_bytes" of zero keeps the rate fixed.
+  TokenBucketRateLimiter(Env* env, int64_t max_bytes_per_second,
+                         uint64_t target_pending_bytes)
+      : env_(env),
+        target_pending_bytes_(target_pending_bytes),
+        max_bytes_per_second_(std::max<int64_t>(max_bytes_per_second, 1)),
+        bytes_per_second_(0),
+        pending_bytes_(0),
+        available_(0),
+        last_refill_micros_(env->NowMicros()) {
+    UpdateRate();
+  }
+
+  void Request(size_t bytes) override {
+    MutexLock l(&mu_);
+    while (bytes > 0) {
+      Refill();
+      if (available_ > 0) {
+        const uint64_t n = std::min<uint64_t>(available_, bytes);
+        available_ -= n;
+        bytes -= n;
+        continue;
+      }
+      // Sleep until the bucket holds enough for the rest of the request,
+      // or a full burst if that is less.
+      const uint64_t wanted =
+          std::min<uint64_t>(bytes, BurstBytes(bytes_per_second_));
+      const uint64_t wait = std::max<uint64_t>(
+          kMinWaitMicros, wanted * 1000000 / bytes_per_second_);
+      mu_.Unlock();
+      env_->SleepForMicroseconds(static_cast<int>(wait));
+      mu_.Lock();
+    }
+  }
+
+  int64_t GetBytesPerSecond() const override {
+    MutexLock l(&mu_);
+    return bytes_per_second_;
+  }
+
+  void SetBytesPerSecond(int64_t bytes_per_second) override {
+    MutexLock l(&mu_);
+    Refill();
+    max_bytes_per_second_ = std::max<int64_t>(bytes_per_second, 1);
+    UpdateRate();
+  }
+
+  void SetPendingCompactionBytes(uint64_t bytes) override {
+    if (target_pending_bytes_ == 0) {
+      return;
+    }
+    MutexLock l(&mu_);
+    Refill();
+    pending_bytes_ = bytes;
+    UpdateRate();
+  }
+
+ private:
+  static uint64_t BurstBytes(int64_t bytes_per_second) {
+    return std::max<uint64_t>(bytes_per_second * kBurstMicros / 1000000, 1);
+  }
+
+  // Adds the bytes earned since the last refill.
+  void Refill() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    const uint64_t now = env_->NowMicros();
+    const uint64_t burst = BurstBytes(bytes_per_second_);
+    if (now > last_refill_micros_) {
+      // A second's worth fills any bucket, and clamping the interval to it
+      // keeps the product below overflow.
+      const uint64_t elapsed =
+          std::min<uint64_t>(now - last_refill_micros_, 1000000);
+      const uint64_t earned = elapsed * bytes_per_second_ / 1000000;
+      // Calls closer together than a byte's worth of time must not lose
+      // the time between them.
+      if (earned > 0) {
+        available_ = std::min(available_ + earned, burst);
+        last_refill_micros_ = now;
+      }
+    }
+  }
+
+  void UpdateRate() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    if (target_pending_bytes_ == 0 ||
+        pending_bytes_ >= target_pending_bytes_) {
+      bytes_per_second_ = max_bytes_per_second_;
+    } else {
+      const double fraction = static_cast<double>(pending_bytes_) /
+                              static_cast<double>(target_pending_bytes_);
+      bytes_per_second_ = std::max<int64_t>(
+          static_cast<int64_t>(max_bytes_per_second_ * fraction),
+          max_bytes_per_second_ / kMinRateDivisor);
+      bytes_per_second_ = std::max<int64_t>(bytes_per_second_, 1);
+    }
+  }
+
+  Env* const env_;
+  const uint64_t target_pending_bytes_;
+
+  mutable port::Mutex mu_;
+  int64_t max_bytes_per_second_ GUARDED_BY(mu_);
+  int64_t bytes_per_second_ GUARDED_BY(mu_);
+  uint64_t pending_bytes_ GUARDED_BY(mu_);
+  uint64_t available_ GUARDED_BY(mu_);
+  uint64_t last_refill_micros_ GUARDED_BY(mu_);
+};
+
+}  // namespace
+
+RateLimiter* NewRateLimiter(int64_t bytes_per_second) {
+  return new TokenBucketRateLimiter(Env::Default(), bytes_per_second, 0);
+}
+
+RateLimiter* NewAutoTunedRateLimiter(int64_t max_bytes_per_second,
+                                     uint64_t target_pending_bytes) {
+  return new TokenBucketRateLimiter(Env::Default(), max_bytes_per_second,
+                                    target_pending_bytes);
+}
+
+}  // namespace leveldb
@@ -0,0 +1,76 @@
+// Copyright (c) 2026 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "leveldb/rate_limiter.h"
+
+#include "gtest/gtest.h"
+#include "leveldb/env.h"
+
+namespace leveldb {
+
+TEST(RateLimiterTest, Paces) {
+  RateLimiter* limiter = NewRateLimiter(1 << 20);
+  ASSERT_EQ(1 << 20, limiter->GetBytesPerSecond());
+
+  // The bucket starts empty, so 256KB take about a quarter of a second.
+  Env* env = Env::Default();
+  const uint64_t start = env->NowMicros();
+  for (int i = 0; i < 64; i++) {
+    limiter->Request(4096);
+  }
+  const uint64_t elapsed = env->NowMicros() - start;
+  ASSERT_GE(elapsed, 200000);
+  ASSERT_LT(elapsed, 5000000);
+  delete limiter;
+}
+
+TEST(RateLimiterTest, LargeRequest) {
+  // Requests larger than the bucket are let through a bucket at a time.
+  RateLimiter* limiter = NewRateLimiter(1 << 20);
+  Env* env = Env::Default();
+  const uint64_t start = env->NowMicros();
+  limiter->Request(512 << 10);
+  const uint64_t elapsed = env->NowMicros() - start;
+  ASSERT_GE(elapsed, 400000);
+  ASSERT_LT(elapsed, 5000000);
+  delete limiter;
+}
+
+TEST(RateLimiterTest, SetBytesPerSecond) {
+  RateLimiter* limiter = NewRateLimiter(1000);
+  limiter->SetBytesPerSecond(5000);
+  ASSERT_EQ(5000, limiter->GetBytesPerSecond());
+
+  // A fixed limiter ignores the compaction debt.
+  limiter->SetPendingCompactionBytes(0);
+  ASSERT_EQ(5000, limiter->GetBytesPerSecond());
+  delete limiter;
+}
+
+TEST(RateLimiterTest, AutoTuned) {
+  RateLimiter* limiter = NewAutoTunedRateLimiter(1000000, 1000);
+  ASSERT_EQ(50000, limiter->GetBytesPerSecond());
+  limiter->SetPendingCompactionBytes(10);
+  ASSERT_EQ(50000, limiter->GetBytesPerSecond());
+  limiter->SetPendingCompactionBytes(500);
+  ASSERT_EQ(500000, limiter->GetBytesPerSecond());
+  limiter->SetPendingCompactionBytes(1000);
+  ASSERT_EQ(1000000, limiter->GetBytesPerSecond());
+  limiter->SetPendingCompactionBytes(1 << 30);
+  ASSERT_EQ(1000000, limiter->GetBytesPerSecond());
+
+  // The maximum moves the whole range.
+  limiter->SetBytesPerSecond(2000000);
+  ASSERT_EQ(2000000, limiter->GetBytesPerSecond());
+  limiter->SetPendingCompactionBytes(250);
+  ASSERT_EQ(500000, limiter->GetBytesPerSecond());
+  delete limiter;
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,82 @@
+// Copyright (c) 2026 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "leveldb/slice_transform.h"
+
+#include <string>
+
+namespace leveldb {
+
+SliceTransform::~SliceTransform() {}
+
+namespace {
+
+class FixedPrefixTransform : public SliceTransform {
+ public:
+  explicit FixedPrefixTransform(size_t prefix_len)
+      : prefix_len_(prefix_len),
+        name_("leveldb.FixedPrefix." + std::to_string(prefix_len)) {}
+
+  const char* Name() const override { return name_.c_str(); }
+
+  Slice Transform(const Slice& key) const override {
+    return Slice(key.data(), prefix_len_);
+  }
+
+  bool InDomain(const Slice& key) const override {
+    return key.size() >= prefix_len_;
+  }
+
+ private:
+  const size_t prefix_len_;
+  const std::string name_;
+};
+
+class DelimitedPrefixTransform : public SliceTransform {
+ public:
+  DelimitedPrefixTransform(char delimiter, int count)
+      : delimiter_(delimiter),
+        count_(count),
+        name_("leveldb.DelimitedPrefix." +
+              std::to_string(static_cast<unsigned char>(delimiter)) + "." +
+              std::to_string(count)) {}
+
+  const char* Name() const override { return name_.c_str(); }
+
+  Slice Transform(const Slice& key) const override {
+    return Slice(key.data(), PrefixLength(key));
+  }
+
+  bool InDomain(const Slice& key) const override {
+    return PrefixLength(key) != 0;
+  }
+
+ private:
+  // Returns 0 if key has fewer than count_ delimiters.
+  size_t PrefixLength(const Slice& key) const {
+    int seen = 0;
+    for (size_t i = 0; i < key.size(); i++) {
+      if (key[i] == delimiter_ && ++seen == count_) {
+        return i + 1;
+      }
+    }
+    return 0;
+  }
+
+  const char delimiter_;
+  const int count_;
+  const std::string name_;
+};
+
+}  // namespace
+
+const SliceTransform* NewFixedPrefixTransform(size_t prefix_len) {
+  return new FixedPrefixTransform(prefix_len);
+}
+
+const SliceTransform* NewDelimitedPrefixTransform(char delimiter, int count) {
+  return new DelimitedPrefixTransform(delimiter, count);
+}
+
+}  // namespace leveldb
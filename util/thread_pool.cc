@@ -0,0 +1,81 @@
+// Copyright (c) 2026 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "util/thread_pool.h"
+
+#include <cassert>
+
+#include "leveldb/env.h"
+#include "util/mutexlock.h"
+
+namespace leveldb {
+
+ThreadPool::ThreadPool(Env* env, int num_threads)
+    : num_threads_(num_threads),
+      work_cv_(&mu_),
+      shutting_down_(false),
+      live_threads_(num_threads) {
+  assert(num_threads > 0);
+  for (int i = 0; i < num_threads; i++) {
+    env->StartThread(&ThreadPool::ThreadMain, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  MutexLock l(&mu_);
+  shutting_down_ = true;
+  work_cv_.SignalAll();
+  while (live_threads_ > 0) {
+    work_cv_.Wait();
+  }
+}
+
+void ThreadPool::Schedule(void (*function)(void*), void* arg) {
+  MutexLock l(&mu_);
+  assert(!shutting_down_);
+  queue_.push_back(WorkItem{function, arg});
+  work_cv_.Signal();
+}
+
+void ThreadPool::ThreadMain(void* pool) {
+  reinterpret_cast<ThreadPool*>(pool)->Run();
+}
+
+void ThreadPool::Run() {
+  mu_.Lock();
+  while (true) {
+    if (!queue_.empty()) {
+      WorkItem item = queue_.front();
+      queue_.pop_front();
+      mu_.Unlock();
+      (*item.function)(item.arg);
+      mu_.Lock();
+    } else if (shutting_down_) {
+      break;
+    } else {
+      work_cv_.Wait();
+    }
+  }
+  live_threads_--;
+  // The destructor waits on the same condition variable.
+  work_cv_.SignalAll();
+  mu_.Unlock();
+}
+
+void CountDownLatch::CountDown() {
+  MutexLock l(&mu_);
+  assert(count_ > 0);
+  if (--count_ == 0) {
+    cv_.SignalAll();
+  }
+}
+
+void CountDownLatch::Wait() {
+  MutexLock l(&mu_);
+  while (count_ > 0) {
+    cv_.Wait();
+  }
+}
+
+}  // namespace leveldb
@@ -0,0 +1,73 @@
+// Copyright (c) 2026 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#ifndef STORAGE_LEVELDB_UTIL_THREAD_POOL_H_
+#define STORAGE_LEVELDB_UTIL_THREAD_POOL_H_
+
+#include <deque>
+
+#include "port/port.h"
+#include "port/thread_annotations.h"
+
+namespace leveldb {
+
+class Env;
+
+// A fixed set of threads running queued work items.  Unlike
+// Env::Schedule(), work added here never waits behind compactions.
+class ThreadPool {
+ public:
+  // Starts "num_threads" threads through env->StartThread().
+  ThreadPool(Env* env, int num_threads);
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Waits for queued work to finish and for the threads to exit.
+  ~ThreadPool();
+
+  // Arrange to run "(*function)(arg)" on one of the pool's threads.
+  void Schedule(void (*function)(void* arg), void* arg);
+
+  int num_threads() const { return num_threads_; }
+
+ private:
+  struct WorkItem {
+    void (*function)(void*);
+    void* arg;
+  };
+
+  static void ThreadMain(void* pool);
+  void Run();
+
+  const int num_threads_;
+
+  port::Mutex mu_;
+  port::CondVar work_cv_ GUARDED_BY(mu_);
+  std::deque<WorkItem> queue_ GUARDED_BY(mu_);
+  bool shutting_down_ GUARDED_BY(mu_);
+  int live_threads_ GUARDED_BY(mu_);
+};
+
+// Counts down to zero; Wait() blocks until it gets there.  Lets a thread
+// wait for a batch of work items it handed to a ThreadPool.
+class CountDownLatch {
+ public:
+  explicit CountDownLatch(int count) : cv_(&mu_), count_(count) {}
+
+  CountDownLatch(const CountDownLatch&) = delete;
+  CountDownLatch& operator=(const CountDownLatch&) = delete;
+
+  void CountDown();
+  void Wait();
+
+ private:
+  port::Mutex mu_;
+  port::CondVar cv_ GUARDED_BY(mu_);
+  int count_ GUARDED_BY(mu_);
+};
+
+}  // namespace leveldb
+
+#endif  // STORAGE_LEVELDB_UTIL_THREAD_POOL_H_
@@ -0,0 +1,62 @@
+// Copyright (c) 2026 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "util/thread_pool.h"
+
+#include <atomic>
+
+#include "gtest/gtest.h"
+#include "leveldb/env.h"
+
+namespace leveldb {
+
+namespace {
+
+struct Counter {
+  std::atomic<int> count{0};
+  CountDownLatch* done = nullptr;
+};
+
+void Increment(void* arg) {
+  Counter* counter = reinterpret_cast<Counter*>(arg);
+  counter->count.fetch_add(1, std::memory_order_relaxed);
+  if (counter->done != nullptr) {
+    counter->done->CountDown();
+  }
+}
+
+}  // namespace
+
+TEST(ThreadPoolTest, RunsEveryItem) {
+  ThreadPool pool(Env::Default(), 4);
+  ASSERT_EQ(4, pool.num_threads());
+
+  const int kItems = 1000;
+  CountDownLatch done(kItems);
+  Counter counter;
+  counter.done = &done;
+  for (int i = 0; i < kItems; i++) {
+    pool.Schedule(&Increment, &counter);
+  }
+  done.Wait();
+  ASSERT_EQ(kItems, counter.count.load());
+}
+
+TEST(ThreadPoolTest, DestructorDrainsQueue) {
+  Counter counter;
+  {
+    ThreadPool pool(Env::Default(), 2);
+    for (int i = 0; i < 100; i++) {
+      pool.Schedule(&Increment, &counter);
+    }
+  }
+  ASSERT_EQ(100, counter.count.load());
+}
+
+}  // namespace leveldb
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}